@@ -0,0 +1,134 @@
+/*******************************************************************************
+  Cell Data Generator
+
+  File Name:
+    cell_gen.c
+
+  Summary:
+    Module telemetry from the Pack Emulator cell model, faster than real time.
+
+  Description:
+    Runs cell_model.c for a number of modules of a number of cells through
+    the built in drive cycle, every module closed and starting at its own
+    point of the cycle, and prints one CSV line per module per report
+    interval with the figures the Pack Emulator would send in its status
+    frames:
+
+      time_s,module,current_a,mmv_v,volt_hi,volt_lo,volt_avg,temp_hi,temp_lo,temp_avg,soc,soh
+
+    With -c every cell is printed as well. The time the model took against
+    the simulated time goes to stderr.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cell_model.h"
+#include "app.h"
+
+// Encoded figures back to units
+#define VOLTS(x)    ((x) * CELL_VOLTAGE_FACTOR)
+#define CELSIUS(x)  ((x) * TEMPERATURE_FACTOR + TEMPERATURE_BASE)
+#define PERCENT(x)  ((x) * PERCENTAGE_FACTOR)
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: cell_gen [-m modules] [-n cells] [-t hours] [-s step s] [-r report s] [-c]\n");
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned modules = MAX_MODULES_PER_PACK;
+    unsigned cells = 16;
+    double hours = 24.0;
+    double step = 1.0;
+    double report = 60.0;
+    int printCells = 0;
+    batteryModule *m;
+    CELLMODEL_STATE *state;
+    unsigned long steps, s, every;
+    unsigned i, c;
+    float current, t;
+    clock_t start;
+    double elapsed;
+
+    for (i = 1; i < (unsigned) argc; i++) {
+        if (strcmp(argv[i], "-c") == 0) {
+            printCells = 1;
+        } else if (i + 1 < (unsigned) argc && argv[i][0] == '-' && strlen(argv[i]) == 2) {
+            switch (argv[i][1]) {
+                case 'm': modules = (unsigned) atoi(argv[++i]); break;
+                case 'n': cells = (unsigned) atoi(argv[++i]); break;
+                case 't': hours = atof(argv[++i]); break;
+                case 's': step = atof(argv[++i]); break;
+                case 'r': report = atof(argv[++i]); break;
+                default: usage();
+            }
+        } else {
+            usage();
+        }
+    }
+    if (modules == 0 || cells == 0 || cells > 255 || step <= 0.0 || report < step) {
+        usage();
+    }
+
+    m = calloc(modules, sizeof(*m));
+    state = calloc(modules, sizeof(*state));
+    if (m == NULL || state == NULL) {
+        fprintf(stderr, "cell_gen: out of memory\n");
+        return 1;
+    }
+
+    // As APP_GenerateModules, each module a little into the cycle after the one before
+    for (i = 0; i < modules; i++) {
+        m[i].uniqueId = 0xBA771000 + i;
+        m[i].cellCount = (uint8_t) cells;
+        m[i].state = moduleOn;
+        m[i].soc = (uint8_t) ((80 + i % 20) / PERCENTAGE_FACTOR);
+        m[i].soh = (uint8_t) ((90 + i % 10) / PERCENTAGE_FACTOR);
+        CELLMODEL_Init(&state[i], &m[i], 25.0f, i * 97.0f);
+    }
+
+    steps = (unsigned long) (hours * 3600.0 / step);
+    every = (unsigned long) (report / step + 0.5);
+
+    printf(printCells ? "time_s,module,cell,volt,temp,soc,soh\n" :
+            "time_s,module,current_a,mmv_v,volt_hi,volt_lo,volt_avg,temp_hi,temp_lo,temp_avg,soc,soh\n");
+
+    start = clock();
+    for (s = 1; s <= steps; s++) {
+        for (i = 0; i < modules; i++) {
+            current = CELLMODEL_Profile(&state[i], (float) step);
+            CELLMODEL_Step(&state[i], &m[i], current, (float) step);
+        }
+
+        if (s % every) {
+            continue;
+        }
+        t = (float) (s * step);
+        for (i = 0; i < modules; i++) {
+            if (printCells) {
+                for (c = 0; c < cells; c++) {
+                    printf("%.0f,%u,%u,%.3f,%.2f,%.1f,%.1f\n", t, i, c, VOLTS(m[i].cell[c].voltage),
+                            CELSIUS(m[i].cell[c].temp), PERCENT(m[i].cell[c].soc), PERCENT(m[i].cell[c].soh));
+                }
+                continue;
+            }
+            printf("%.0f,%u,%.1f,%.2f,%.3f,%.3f,%.3f,%.2f,%.2f,%.2f,%.1f,%.1f\n", t, i, state[i].current,
+                    m[i].mmv * MODULE_VOLTAGE_FACTOR, VOLTS(m[i].voltHi), VOLTS(m[i].voltLo), VOLTS(m[i].voltAvg),
+                    CELSIUS(m[i].tempHi), CELSIUS(m[i].tempLo), CELSIUS(m[i].tempAvg),
+                    PERCENT(m[i].soc), PERCENT(m[i].soh));
+        }
+    }
+    elapsed = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    fprintf(stderr, "cell_gen: %u modules of %u cells, %.1f h in %.2f s, %.0f x real time, %.1f ns per cell step\n",
+            modules, cells, hours, elapsed, hours * 3600.0 / elapsed,
+            elapsed * 1e9 / ((double) steps * modules * cells));
+
+    free(m);
+    free(state);
+    return 0;
+}
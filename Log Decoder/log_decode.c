@@ -0,0 +1,121 @@
+/*******************************************************************************
+  Log Decoder
+
+  File Name:
+    log_decode.c
+
+  Summary:
+    Expands binary serial log records from the Pack and VCU Emulators.
+
+  Description:
+    Reads the UART byte stream from a file or stdin (a capture, or the serial
+    port itself) and prints one line per record:
+
+      hh:mm:ss.mmm message
+
+    Wall clock time comes from the last LOG_ID_RTC record plus the record
+    tick. Bytes that do not form a record with a valid check byte are
+    skipped, so decoding picks up again after a partial capture.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "log_events.h"
+
+static uint32_t syncSeconds = 0;
+static uint32_t syncTick = 0;
+static unsigned long skipped = 0;
+
+static void LOG_Print(uint8_t id, uint32_t tick, const uint8_t *payload, uint8_t n)
+{
+    char text[512];
+    uint32_t ms;
+    uint32_t seconds;
+    uint32_t args[3];
+
+    if (id == LOG_ID_RTC && n >= 12) {
+        memcpy(args, payload, sizeof(args));
+        syncSeconds = (args[0] * 3600) + (args[1] * 60) + args[2];
+        syncTick = tick;
+    }
+
+    ms = (syncSeconds * 1000) + (tick - syncTick);
+    seconds = (ms / 1000) % 86400;
+
+    LOG_Format(text, sizeof(text), id, payload, n);
+    printf("%02u:%02u:%02u.%03u %s\n", seconds / 3600, (seconds / 60) % 60, seconds % 60, ms % 1000, text);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *in = stdin;
+    uint8_t record[LOG_RECORD_OVERHEAD + 255];
+    uint32_t tick;
+    uint8_t check;
+    size_t have = 0;
+    size_t need;
+    size_t i;
+    int c;
+
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "-h") == 0)) {
+        fprintf(stderr, "usage: log_decode [capture file]\n");
+        return 2;
+    }
+    if (argc == 2 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while ((c = fgetc(in)) != EOF) {
+        record[have++] = (uint8_t) c;
+
+        // A resync can leave more than one record in the buffer
+        for (;;) {
+            if (record[0] != LOG_RECORD_SYNC) {
+                for (i = 0; i < have && record[i] != LOG_RECORD_SYNC; i++) {
+                    skipped++;
+                }
+                memmove(record, record + i, have - i);
+                have -= i;
+            }
+            if (have < LOG_RECORD_HEADER) {
+                break;
+            }
+
+            need = (size_t) record[2] + LOG_RECORD_OVERHEAD;
+            if (have < need) {
+                break;
+            }
+
+            check = 0;
+            for (i = 1; i < need - 1; i++) {
+                check ^= record[i];
+            }
+
+            if (check == record[need - 1]) {
+                tick = record[3] | ((uint32_t) record[4] << 8) | ((uint32_t) record[5] << 16) | ((uint32_t) record[6] << 24);
+                LOG_Print(record[1], tick, record + LOG_RECORD_HEADER, record[2]);
+                memmove(record, record + need, have - need);
+                have -= need;
+            } else {
+                // Not a record, drop its sync byte and look for the next one
+                skipped++;
+                memmove(record, record + 1, have - 1);
+                have--;
+            }
+            if (have == 0) {
+                break;
+            }
+        }
+    }
+
+    if (skipped) {
+        fprintf(stderr, "log_decode: %lu bytes skipped\n", skipped);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    return 0;
+}
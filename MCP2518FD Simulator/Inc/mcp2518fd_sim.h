@@ -0,0 +1,112 @@
+/*******************************************************************************
+  MCP2518FD Simulator
+
+  File Name:
+    mcp2518fd_sim.h
+
+  Summary:
+    Host model of the MCP2518FD SPI protocol.
+
+  Description:
+    Decodes the SPI instruction set (RESET, READ, WRITE, READ_CRC, WRITE_CRC,
+    WRITE_SAFE) against a register file and 2 KB of message RAM. FIFOs, the
+    TXQ, the TEF, acceptance filters, time stamps and the SPI CRC are
+    modelled closely enough to run canfdspi_api.c unchanged. Frames put on
+    the bus are kept in a log the host can read, and frames can be injected
+    as if received from the bus.
+
+    Every transaction is counted, so the cost of any driver call can be
+    measured in SPI transactions and bytes.
+ *******************************************************************************/
+
+#ifndef _MCP2518FD_SIM_H
+#define _MCP2518FD_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Frames kept in the bus log
+#define SIM_BUS_LOG_SIZE    256
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+//! CAN frame as seen on the bus
+typedef struct _SIM_FRAME {
+    uint32_t id;            // SID in bits 0-10, EID in bits 11-28, like the message object
+    bool ide;
+    bool rtr;
+    bool fdf;
+    bool brs;
+    uint8_t dlc;
+    uint32_t seq;           // SEQ of the TX object that produced it
+    uint32_t timeStamp;     // TBC when it left or arrived
+    uint8_t data[64];
+} SIM_FRAME;
+
+//! SPI traffic counters
+typedef struct _SIM_SPI_STATS {
+    uint32_t transactions;
+    uint32_t bytes;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t crcReads;
+    uint32_t crcWrites;
+    uint32_t safeWrites;
+    uint32_t resets;
+    uint32_t crcErrors;
+} SIM_SPI_STATS;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Simulator control
+
+//! Power on reset: registers, RAM and counters
+void SIM_PowerOn(void);
+
+//! One complete SPI transaction (CS low ... CS high)
+void SIM_SpiTransfer(const uint8_t *tx, uint8_t *rx, uint16_t n);
+
+//! Advance the controller clock by n SYSCLK cycles (time base counter)
+void SIM_ClockAdvance(uint32_t cycles);
+
+//! Deliver a frame from the bus to the acceptance filters
+//! Returns false if no filter matched or the FIFO was full
+bool SIM_FrameInject(const SIM_FRAME *frame);
+
+//! Number of frames transmitted since the log was cleared
+uint32_t SIM_BusLogCount(void);
+
+//! Transmitted frame n, oldest first
+const SIM_FRAME* SIM_BusLogGet(uint32_t n);
+
+//! Clear the bus log
+void SIM_BusLogClear(void);
+
+//! Hold transmissions, so TX FIFOs fill as if the bus were busy
+void SIM_BusHold(bool hold);
+
+//! Flip bits of the next read of a RAM word to exercise ECC handling
+void SIM_EccErrorInject(uint16_t address, bool doubleBit);
+
+//! SPI counters
+const SIM_SPI_STATS* SIM_SpiStatsGet(void);
+void SIM_SpiStatsClear(void);
+
+//! State of the INT pin (active low on the device, true = asserted here)
+bool SIM_IntAsserted(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _MCP2518FD_SIM_H
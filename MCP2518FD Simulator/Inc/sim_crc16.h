@@ -0,0 +1,38 @@
+/*******************************************************************************
+  MCP2518FD Simulator - CRC-16
+
+  File Name:
+    sim_crc16.h
+
+  Summary:
+    Host CRC-16 (polynomial 0x8005, seed 0xFFFF) used by the simulator.
+
+  Description:
+    SIM_Crc16Bitwise is the reference: one bit per step, no tables, so it
+    shares nothing with the driver it checks. SIM_Crc16Fast folds 8 bytes per
+    step with carry-less multiplication when built with PCLMUL (-mpclmul or
+    -march=native), and falls back to a byte table otherwise.
+ *******************************************************************************/
+
+#ifndef _SIM_CRC16_H
+#define _SIM_CRC16_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t SIM_Crc16Bitwise(const uint8_t *data, uint32_t n);
+
+uint16_t SIM_Crc16Fast(const uint8_t *data, uint32_t n);
+
+//! True if SIM_Crc16Fast was built with carry-less multiplication
+bool SIM_Crc16FastIsClmul(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SIM_CRC16_H
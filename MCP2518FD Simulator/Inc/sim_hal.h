@@ -0,0 +1,88 @@
+/*******************************************************************************
+  MCP2518FD Simulator - HAL shim
+
+  File Name:
+    sim_hal.h
+
+  Summary:
+    Stands in for the STM32Cube main.h when canfdspi_api.c is built on a host.
+
+  Description:
+    canfdspi_api.c only needs the SPI handle, the CS pin and the two HAL calls
+    it makes per transaction. They are declared here and implemented in
+    spi_shim.c, which forwards every transaction to the simulator. The UART
+    handle only lets serial_log.h compile; log_shim.c prints the records.
+
+    The build force-includes this file (-include Inc/sim_hal.h). It uses the
+    Cube main.h guard __MAIN_H, so the emulator's main.h, which the driver
+    sources find next to them, is then empty and the HAL headers are never
+    read.
+ *******************************************************************************/
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: HAL types
+
+typedef enum {
+    HAL_OK       = 0x00,
+    HAL_ERROR    = 0x01,
+    HAL_BUSY     = 0x02,
+    HAL_TIMEOUT  = 0x03
+} HAL_StatusTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t id;
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t id;
+} SPI_HandleTypeDef;
+
+typedef struct {
+    uint32_t id;
+} UART_HandleTypeDef;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Board defines used by the driver
+
+extern GPIO_TypeDef simGpioD;
+
+#define CAN_CS_Pin          ((uint16_t)0x0100)
+#define CAN_CS_GPIO_Port    (&simGpioD)
+
+#define MAX_BUFFER      100
+#define SPI_TIMEOUT     100
+
+// Code anchor for break points
+#define Nop()
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: HAL functions provided by spi_shim.c
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData,
+        uint8_t *pRxData, uint16_t Size, uint32_t Timeout);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
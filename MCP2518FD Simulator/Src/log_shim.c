@@ -0,0 +1,27 @@
+/*******************************************************************************
+  MCP2518FD Simulator - log shim
+
+  File Name:
+    log_shim.c
+
+  Summary:
+    LOG_Record for host builds.
+
+  Description:
+    Modules shared with the emulators (tx_stats.c, tx_sched.c) log through
+    LOG_EVENT. Here each record is expanded with log_format.c and printed.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include "serial_log.h"
+
+void LOG_Record(uint8_t id, const uint32_t *args, uint8_t nArgs)
+{
+    char text[LOG_TEXT_MAX + 32];
+
+    if (nArgs > LOG_RECORD_MAX_ARGS) {
+        nArgs = LOG_RECORD_MAX_ARGS;
+    }
+    LOG_Format(text, sizeof(text), id, (const uint8_t *) args, nArgs * 4);
+    printf("  %s\r\n", text);
+}
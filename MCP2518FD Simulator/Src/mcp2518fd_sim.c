@@ -0,0 +1,992 @@
+/*******************************************************************************
+  MCP2518FD Simulator
+
+  File Name:
+    mcp2518fd_sim.c
+
+  Summary:
+    Host model of the MCP2518FD SPI protocol.
+
+  Description:
+    Register file, message RAM and FIFO state machine of the MCP2518FD as seen
+    through its SPI interface. Status registers (CiFIFOSTA, CiFIFOUA, CiTEFSTA,
+    CiRXIF, CiTXIF, CiVEC, ...) are derived from the FIFO state before every
+    read, control bits (UINC, TXREQ, FRESET, REQOP) act when written.
+
+    Timing is not modelled: a frame is transmitted as soon as TXREQ is set in
+    a mode that allows it, unless the bus is held by the host.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <string.h>
+#include "mcp2518fd_sim.h"
+#include "sim_crc16.h"
+#include "canfdspi_defines.h"
+#include "canfdspi_register.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+#define SIM_SFR_SIZE        0x300
+#define SIM_MCP_SIZE        0x18
+
+// CiCON fields
+#define SIM_CICON_STEF      (1UL << 19)
+#define SIM_CICON_TXQEN     (1UL << 20)
+#define SIM_CICON_ABAT      0x08        // in byte 3
+
+// CiFIFOCON/CiTEFCON byte 1 control bits
+#define SIM_CON1_UINC       0x01
+#define SIM_CON1_TXREQ      0x02
+#define SIM_CON1_FRESET     0x04
+
+// CiINT flag bits
+#define SIM_INT_TXIF        (1UL << 0)
+#define SIM_INT_RXIF        (1UL << 1)
+#define SIM_INT_TBCIF       (1UL << 2)
+#define SIM_INT_MODIF       (1UL << 3)
+#define SIM_INT_TEFIF       (1UL << 4)
+#define SIM_INT_ECCIF       (1UL << 8)
+#define SIM_INT_SPICRCIF    (1UL << 9)
+#define SIM_INT_TXATIF      (1UL << 10)
+#define SIM_INT_RXOVIF      (1UL << 11)
+#define SIM_INT_DERIVED     (SIM_INT_TXIF | SIM_INT_RXIF | SIM_INT_TEFIF | SIM_INT_ECCIF | \
+                             SIM_INT_SPICRCIF | SIM_INT_TXATIF | SIM_INT_RXOVIF)
+
+// CiVEC code when nothing is pending
+#define SIM_VEC_NONE        0x40
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+//! FIFO state kept beside the register file
+typedef struct _SIM_FIFO {
+    uint16_t base;          // RAM offset of object 0
+    uint8_t objSize;
+    uint8_t depth;
+    uint8_t head;           // next object written (by host for TX, by CAN for RX)
+    uint8_t tail;           // next object read (by CAN for TX, by host for RX)
+    uint8_t count;
+    bool overflow;
+    bool txRequest;
+    bool aborted;
+} SIM_FIFO;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+static uint8_t sfr[SIM_SFR_SIZE];
+static uint8_t mcp[SIM_MCP_SIZE];
+static uint8_t ram[cRAM_SIZE];
+
+static SIM_FIFO fifo[CAN_FIFO_TOTAL_CHANNELS];
+static SIM_FIFO tef;
+
+static uint32_t tbc;
+static uint32_t tbcCycles;
+static uint8_t lastFilterHit;
+
+static SIM_FRAME busLog[SIM_BUS_LOG_SIZE];
+static uint32_t busLogCount;
+static bool busHold;
+
+static uint16_t eccAddress;
+static uint8_t eccMode;     // 0 none, 1 single bit, 2 double bit
+
+static SIM_SPI_STATS stats;
+
+static const uint8_t dlcBytes[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+static const uint8_t payloadBytes[8] = {8, 12, 16, 20, 24, 32, 48, 64};
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Register file helpers
+
+static uint32_t SIM_RegGet(uint16_t a)
+{
+    return (uint32_t) sfr[a] | ((uint32_t) sfr[a + 1] << 8) |
+            ((uint32_t) sfr[a + 2] << 16) | ((uint32_t) sfr[a + 3] << 24);
+}
+
+static void SIM_RegSet(uint16_t a, uint32_t v)
+{
+    sfr[a] = (uint8_t) v;
+    sfr[a + 1] = (uint8_t) (v >> 8);
+    sfr[a + 2] = (uint8_t) (v >> 16);
+    sfr[a + 3] = (uint8_t) (v >> 24);
+}
+
+static uint32_t SIM_McpGet(uint16_t a)
+{
+    a -= cREGADDR_OSC;
+    return (uint32_t) mcp[a] | ((uint32_t) mcp[a + 1] << 8) |
+            ((uint32_t) mcp[a + 2] << 16) | ((uint32_t) mcp[a + 3] << 24);
+}
+
+static void SIM_McpSet(uint16_t a, uint32_t v)
+{
+    a -= cREGADDR_OSC;
+    mcp[a] = (uint8_t) v;
+    mcp[a + 1] = (uint8_t) (v >> 8);
+    mcp[a + 2] = (uint8_t) (v >> 16);
+    mcp[a + 3] = (uint8_t) (v >> 24);
+}
+
+static uint32_t SIM_RamGet(uint16_t offset)
+{
+    if (offset + 4 > cRAM_SIZE) {
+        return 0;
+    }
+    return (uint32_t) ram[offset] | ((uint32_t) ram[offset + 1] << 8) |
+            ((uint32_t) ram[offset + 2] << 16) | ((uint32_t) ram[offset + 3] << 24);
+}
+
+static void SIM_RamSet(uint16_t offset, uint32_t v)
+{
+    if (offset + 4 > cRAM_SIZE) {
+        return;
+    }
+    ram[offset] = (uint8_t) v;
+    ram[offset + 1] = (uint8_t) (v >> 8);
+    ram[offset + 2] = (uint8_t) (v >> 16);
+    ram[offset + 3] = (uint8_t) (v >> 24);
+}
+
+static uint16_t SIM_FifoConAddress(uint8_t ch)
+{
+    return cREGADDR_CiFIFOCON + (ch * CiFIFO_OFFSET);
+}
+
+static bool SIM_FifoIsTx(uint8_t ch)
+{
+    REG_CiFIFOCON con;
+
+    if (ch == CAN_TXQUEUE_CH0) {
+        return true;
+    }
+    con.word = SIM_RegGet(SIM_FifoConAddress(ch));
+    return con.txBF.TxEnable;
+}
+
+static uint8_t SIM_OpModeGet(void)
+{
+    return (sfr[cREGADDR_CiCON + 2] >> 5) & 0x07;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: FIFO state
+
+static void SIM_FifoClear(SIM_FIFO *f)
+{
+    f->head = 0;
+    f->tail = 0;
+    f->count = 0;
+    f->overflow = false;
+    f->txRequest = false;
+    f->aborted = false;
+}
+
+// RAM is handed out in order TEF, TXQ, FIFO1..31 when leaving Configuration mode
+static void SIM_Layout(void)
+{
+    uint32_t con = SIM_RegGet(cREGADDR_CiCON);
+    uint16_t offset = 0;
+    REG_CiTEFCON tefCon;
+    REG_CiFIFOCON fifoCon;
+    uint8_t ch;
+
+    memset(&tef, 0, sizeof(tef));
+    if (con & SIM_CICON_STEF) {
+        tefCon.word = SIM_RegGet(cREGADDR_CiTEFCON);
+        tef.base = offset;
+        tef.depth = tefCon.bF.FifoSize + 1;
+        tef.objSize = 8 + (tefCon.bF.TimeStampEnable ? 4 : 0);
+        offset += tef.depth * tef.objSize;
+    }
+
+    for (ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+        SIM_FifoClear(&fifo[ch]);
+        fifo[ch].depth = 0;
+
+        if (ch == CAN_TXQUEUE_CH0 && !(con & SIM_CICON_TXQEN)) {
+            continue;
+        }
+
+        fifoCon.word = SIM_RegGet(SIM_FifoConAddress(ch));
+        fifo[ch].base = offset;
+        fifo[ch].depth = fifoCon.rxBF.FifoSize + 1;
+        fifo[ch].objSize = 8 + payloadBytes[fifoCon.rxBF.PayLoadSize];
+        if (!SIM_FifoIsTx(ch) && fifoCon.rxBF.RxTimeStampEnable) {
+            fifo[ch].objSize += 4;
+        }
+        offset += fifo[ch].depth * fifo[ch].objSize;
+    }
+}
+
+static void SIM_FifoControl(uint8_t ch, uint8_t control)
+{
+    SIM_FIFO *f = &fifo[ch];
+
+    if (control & SIM_CON1_FRESET) {
+        SIM_FifoClear(f);
+        return;
+    }
+
+    if (control & SIM_CON1_UINC) {
+        if (SIM_FifoIsTx(ch)) {
+            if (f->count < f->depth) {
+                f->head = (f->head + 1) % f->depth;
+                f->count++;
+            }
+        } else if (f->count) {
+            f->tail = (f->tail + 1) % f->depth;
+            f->count--;
+        }
+    }
+
+    if ((control & SIM_CON1_TXREQ) && SIM_FifoIsTx(ch)) {
+        f->txRequest = true;
+        f->aborted = false;
+    }
+}
+
+static void SIM_TefControl(uint8_t control)
+{
+    if (control & SIM_CON1_FRESET) {
+        SIM_FifoClear(&tef);
+        return;
+    }
+
+    if ((control & SIM_CON1_UINC) && tef.count) {
+        tef.tail = (tef.tail + 1) % tef.depth;
+        tef.count--;
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: CAN side
+
+static bool SIM_FrameDeliver(const SIM_FRAME *frame)
+{
+    REG_CiFLTCON_BYTE fltCon;
+    REG_CiFLTOBJ fltObj;
+    REG_CiMASK mask;
+    REG_CiFIFOCON fifoCon;
+    uint32_t idMask;
+    uint32_t ctrl;
+    uint16_t a;
+    uint8_t n, i, f;
+    SIM_FIFO *rx;
+
+    for (f = 0; f < CAN_FILTER_TOTAL; f++) {
+        fltCon.byte = sfr[cREGADDR_CiFLTCON + f];
+        if (!fltCon.bF.Enable) {
+            continue;
+        }
+
+        fltObj.word = SIM_RegGet(cREGADDR_CiFLTOBJ + (f * CiFILTER_OFFSET));
+        mask.word = SIM_RegGet(cREGADDR_CiMASK + (f * CiFILTER_OFFSET));
+
+        if (mask.bF.MIDE && (fltObj.bF.EXIDE != frame->ide)) {
+            continue;
+        }
+
+        idMask = mask.word & 0x7FF;
+        if (frame->ide) {
+            idMask |= mask.word & (0x3FFFFUL << 11);
+        }
+        if ((frame->id ^ fltObj.word) & idMask) {
+            continue;
+        }
+
+        // First matching filter decides the FIFO
+        rx = &fifo[fltCon.bF.BufferPointer];
+        if (SIM_FifoIsTx(fltCon.bF.BufferPointer) || rx->depth == 0) {
+            return false;
+        }
+        if (rx->count == rx->depth) {
+            rx->overflow = true;
+            return false;
+        }
+
+        fifoCon.word = SIM_RegGet(SIM_FifoConAddress(fltCon.bF.BufferPointer));
+        a = rx->base + (rx->head * rx->objSize);
+
+        ctrl = (frame->dlc & 0x0F) | (frame->ide << 4) | (frame->rtr << 5) |
+                (frame->brs << 6) | (frame->fdf << 7) | ((uint32_t) f << 11);
+        SIM_RamSet(a, frame->id & 0x1FFFFFFF);
+        SIM_RamSet(a + 4, ctrl);
+        a += 8;
+        if (fifoCon.rxBF.RxTimeStampEnable) {
+            SIM_RamSet(a, tbc);
+            a += 4;
+        }
+
+        n = dlcBytes[frame->dlc & 0x0F];
+        if (n > payloadBytes[fifoCon.rxBF.PayLoadSize]) {
+            n = payloadBytes[fifoCon.rxBF.PayLoadSize];
+        }
+        for (i = 0; i < n && a + i < cRAM_SIZE; i++) {
+            ram[a + i] = frame->data[i];
+        }
+
+        rx->head = (rx->head + 1) % rx->depth;
+        rx->count++;
+        lastFilterHit = f;
+
+        return true;
+    }
+
+    return false;
+}
+
+static void SIM_TefStore(uint32_t id, uint32_t ctrl)
+{
+    uint16_t a;
+
+    if (tef.depth == 0) {
+        return;
+    }
+    if (tef.count == tef.depth) {
+        tef.overflow = true;
+        return;
+    }
+
+    a = tef.base + (tef.head * tef.objSize);
+    SIM_RamSet(a, id);
+    SIM_RamSet(a + 4, ctrl);
+    if (tef.objSize > 8) {
+        SIM_RamSet(a + 8, tbc);
+    }
+
+    tef.head = (tef.head + 1) % tef.depth;
+    tef.count++;
+}
+
+// Sends every requested TX object, highest TXPRI first, lowest channel on a tie
+static void SIM_TxProcess(void)
+{
+    uint8_t mode = SIM_OpModeGet();
+    REG_CiFIFOCON fifoCon;
+    SIM_FRAME frame;
+    SIM_FIFO *f;
+    uint32_t id, ctrl;
+    uint16_t a;
+    int16_t best;
+    uint8_t bestPri = 0;
+    uint8_t ch, i, n;
+
+    if (busHold) {
+        return;
+    }
+    if (mode != CAN_NORMAL_MODE && mode != CAN_INTERNAL_LOOPBACK_MODE &&
+            mode != CAN_EXTERNAL_LOOPBACK_MODE && mode != CAN_CLASSIC_MODE) {
+        return;
+    }
+
+    for (;;) {
+        best = -1;
+        for (ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+            if (!fifo[ch].txRequest || fifo[ch].count == 0 || !SIM_FifoIsTx(ch)) {
+                continue;
+            }
+            fifoCon.word = SIM_RegGet(SIM_FifoConAddress(ch));
+            if (best < 0 || fifoCon.txBF.TxPriority > bestPri) {
+                best = ch;
+                bestPri = fifoCon.txBF.TxPriority;
+            }
+        }
+        if (best < 0) {
+            return;
+        }
+
+        f = &fifo[best];
+        a = f->base + (f->tail * f->objSize);
+        id = SIM_RamGet(a);
+        ctrl = SIM_RamGet(a + 4);
+
+        memset(&frame, 0, sizeof(frame));
+        frame.id = id & 0x1FFFFFFF;
+        frame.dlc = ctrl & 0x0F;
+        frame.ide = (ctrl >> 4) & 1;
+        frame.rtr = (ctrl >> 5) & 1;
+        frame.brs = (ctrl >> 6) & 1;
+        frame.fdf = (ctrl >> 7) & 1;
+        frame.seq = ctrl >> 9;
+        frame.timeStamp = tbc;
+
+        n = dlcBytes[frame.dlc];
+        if (n > f->objSize - 8) {
+            n = f->objSize - 8;
+        }
+        for (i = 0; i < n && a + 8 + i < cRAM_SIZE; i++) {
+            frame.data[i] = ram[a + 8 + i];
+        }
+
+        busLog[busLogCount % SIM_BUS_LOG_SIZE] = frame;
+        busLogCount++;
+
+        if (SIM_RegGet(cREGADDR_CiCON) & SIM_CICON_STEF) {
+            SIM_TefStore(id, ctrl);
+        }
+
+        if (mode == CAN_INTERNAL_LOOPBACK_MODE || mode == CAN_EXTERNAL_LOOPBACK_MODE) {
+            SIM_FrameDeliver(&frame);
+        }
+
+        f->tail = (f->tail + 1) % f->depth;
+        f->count--;
+        if (f->count == 0) {
+            f->txRequest = false;
+        }
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Derived registers
+
+static uint32_t SIM_FifoStatus(uint8_t ch)
+{
+    SIM_FIFO *f = &fifo[ch];
+    uint32_t sta = 0;
+
+    if (f->depth == 0) {
+        return 0;
+    }
+
+    if (SIM_FifoIsTx(ch)) {
+        if (f->count < f->depth) sta |= 0x01;
+        if (f->count <= f->depth / 2) sta |= 0x02;
+        if (f->count == 0) sta |= 0x04;
+        if (f->aborted) sta |= 0x80;
+        sta |= (uint32_t) f->tail << 8;
+    } else {
+        if (f->count) sta |= 0x01;
+        if (f->count >= f->depth / 2 && f->count) sta |= 0x02;
+        if (f->count == f->depth) sta |= 0x04;
+        if (f->overflow) sta |= 0x08;
+        sta |= (uint32_t) f->head << 8;
+    }
+
+    return sta;
+}
+
+static void SIM_Refresh(void)
+{
+    uint32_t rxif = 0, txif = 0, rxovif = 0, txatif = 0, txreq = 0;
+    uint32_t con, sta, ua, intf, tefsta = 0;
+    uint8_t rxcode = SIM_VEC_NONE, txcode = SIM_VEC_NONE, icode = SIM_VEC_NONE;
+    uint16_t a;
+    uint8_t ch;
+
+    for (ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+        a = SIM_FifoConAddress(ch);
+        con = SIM_RegGet(a);
+        sta = SIM_FifoStatus(ch);
+
+        // TXREQ reads back until the FIFO is sent, UINC and FRESET read 0
+        con &= ~((uint32_t) (SIM_CON1_UINC | SIM_CON1_TXREQ | SIM_CON1_FRESET) << 8);
+        if (fifo[ch].txRequest) {
+            con |= (uint32_t) SIM_CON1_TXREQ << 8;
+            txreq |= 1UL << ch;
+        }
+        SIM_RegSet(a, con);
+        SIM_RegSet(a + 4, sta);
+
+        if (SIM_FifoIsTx(ch)) {
+            ua = fifo[ch].base + (fifo[ch].head * fifo[ch].objSize);
+            if (sta & con & 0x17) {
+                txif |= 1UL << ch;
+                if (txcode == SIM_VEC_NONE) txcode = ch;
+            }
+        } else {
+            ua = fifo[ch].base + (fifo[ch].tail * fifo[ch].objSize);
+            if (sta & con & 0x0F) {
+                rxif |= 1UL << ch;
+                if (rxcode == SIM_VEC_NONE) rxcode = ch;
+            }
+            if (fifo[ch].overflow) {
+                rxovif |= 1UL << ch;
+            }
+        }
+        SIM_RegSet(a + 8, ua & 0xFFF);
+
+        if (((txif | rxif) & (1UL << ch)) && icode == SIM_VEC_NONE) {
+            icode = ch;
+        }
+    }
+
+    SIM_RegSet(cREGADDR_CiRXIF, rxif);
+    SIM_RegSet(cREGADDR_CiTXIF, txif);
+    SIM_RegSet(cREGADDR_CiRXOVIF, rxovif);
+    SIM_RegSet(cREGADDR_CiTXATIF, txatif);
+    SIM_RegSet(cREGADDR_CiTXREQ, txreq);
+    SIM_RegSet(cREGADDR_CiFIFOBA, cRAMADDR_START);
+
+    // TEF
+    if (tef.depth) {
+        if (tef.count) tefsta |= 0x01;
+        if (tef.count >= tef.depth / 2 && tef.count) tefsta |= 0x02;
+        if (tef.count == tef.depth) tefsta |= 0x04;
+        if (tef.overflow) tefsta |= 0x08;
+    }
+    con = SIM_RegGet(cREGADDR_CiTEFCON) & ~((uint32_t) (SIM_CON1_UINC | SIM_CON1_FRESET) << 8);
+    SIM_RegSet(cREGADDR_CiTEFCON, con);
+    SIM_RegSet(cREGADDR_CiTEFSTA, tefsta);
+    SIM_RegSet(cREGADDR_CiTEFUA, (tef.base + (tef.tail * tef.objSize)) & 0xFFF);
+
+    // Interrupt flags
+    intf = SIM_RegGet(cREGADDR_CiINT) & ~SIM_INT_DERIVED;
+    if (txif) intf |= SIM_INT_TXIF;
+    if (rxif) intf |= SIM_INT_RXIF;
+    if (tefsta & con & 0x0F) intf |= SIM_INT_TEFIF;
+    if (rxovif) intf |= SIM_INT_RXOVIF;
+    if (txatif) intf |= SIM_INT_TXATIF;
+    if (SIM_McpGet(cREGADDR_ECCSTA) & 0x06) intf |= SIM_INT_ECCIF;
+    if (SIM_McpGet(cREGADDR_CRC) & 0x30000) intf |= SIM_INT_SPICRCIF;
+    SIM_RegSet(cREGADDR_CiINT, intf);
+
+    SIM_RegSet(cREGADDR_CiVEC, icode | ((uint32_t) lastFilterHit << 8) |
+            ((uint32_t) txcode << 16) | ((uint32_t) rxcode << 24));
+
+    SIM_RegSet(cREGADDR_CiTBC, tbc);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Reset
+
+static void SIM_DeviceReset(void)
+{
+    uint16_t a;
+    uint8_t ch, f;
+
+    memset(sfr, 0, sizeof(sfr));
+    memset(mcp, 0, sizeof(mcp));
+
+    for (a = 0; a < sizeof(canControlResetValues) / 4; a++) {
+        SIM_RegSet(a * 4, canControlResetValues[a]);
+    }
+    for (ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+        SIM_RegSet(SIM_FifoConAddress(ch), canFifoResetValues[0] & ~((uint32_t) SIM_CON1_FRESET << 8));
+        SIM_RegSet(SIM_FifoConAddress(ch) + 4, canFifoResetValues[1]);
+        SIM_RegSet(SIM_FifoConAddress(ch) + 8, canFifoResetValues[2]);
+    }
+    for (f = 0; f < CAN_FILTER_TOTAL; f++) {
+        sfr[cREGADDR_CiFLTCON + f] = (uint8_t) canFilterControlResetValue;
+        SIM_RegSet(cREGADDR_CiFLTOBJ + (f * CiFILTER_OFFSET), canFilterObjectResetValues[0]);
+        SIM_RegSet(cREGADDR_CiMASK + (f * CiFILTER_OFFSET), canFilterObjectResetValues[1]);
+    }
+    for (a = 0; a < sizeof(mcp25xxfdControlResetValues) / 4; a++) {
+        SIM_McpSet(cREGADDR_OSC + (a * 4), mcp25xxfdControlResetValues[a]);
+    }
+    SIM_McpSet(cREGADDR_DEVID, 0x14);
+
+    tbc = 0;
+    tbcCycles = 0;
+    lastFilterHit = 0;
+    eccMode = 0;
+
+    SIM_Layout();
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: SPI byte access
+
+static uint8_t SIM_ByteRead(uint16_t address)
+{
+    uint16_t offset;
+    uint8_t d;
+
+    if (address < SIM_SFR_SIZE) {
+        return sfr[address];
+    }
+
+    if (address >= cRAMADDR_START && address < cRAMADDR_END) {
+        offset = address - cRAMADDR_START;
+        d = ram[offset];
+
+        if (eccMode && (address & ~3) == eccAddress) {
+            REG_ECCCON eccCon;
+            REG_ECCSTA eccSta;
+
+            eccCon.word = SIM_McpGet(cREGADDR_ECCCON);
+            eccSta.word = SIM_McpGet(cREGADDR_ECCSTA);
+            if (!eccCon.bF.EccEn || eccMode == 2) {
+                d ^= 0x01;
+            }
+            if (eccCon.bF.EccEn) {
+                if (eccMode == 1) {
+                    eccSta.bF.SECIF = 1;
+                } else {
+                    eccSta.bF.DEDIF = 1;
+                }
+                eccSta.bF.ErrorAddress = address;
+                SIM_McpSet(cREGADDR_ECCSTA, eccSta.word);
+            }
+            eccMode = 0;
+        }
+        return d;
+    }
+
+    if (address >= cREGADDR_OSC && address < cREGADDR_OSC + SIM_MCP_SIZE) {
+        return mcp[address - cREGADDR_OSC];
+    }
+
+    return 0;
+}
+
+static void SIM_ByteWrite(uint16_t address, uint8_t d)
+{
+    uint8_t old;
+    uint8_t ch;
+    uint16_t r;
+
+    if (address >= cRAMADDR_START && address < cRAMADDR_END) {
+        ram[address - cRAMADDR_START] = d;
+        return;
+    }
+
+    if (address >= cREGADDR_OSC && address < cREGADDR_OSC + SIM_MCP_SIZE) {
+        r = address - cREGADDR_OSC;
+        old = mcp[r];
+        if (address == cREGADDR_OSC) {
+            // Clocks are ready as soon as they are asked for
+            mcp[r] = d;
+            mcp[r + 1] = (uint8_t) (((d & 0x01) ? 0x01 : 0) | ((d & 0x04) ? 0 : 0x04) | 0x10);
+        } else if (address == cREGADDR_CRC + 2 || address == cREGADDR_ECCSTA) {
+            // Flags clear when written 0
+            mcp[r] = old & d;
+        } else if (address >= cREGADDR_DEVID) {
+            // Read only
+        } else {
+            mcp[r] = d;
+        }
+        return;
+    }
+
+    if (address >= SIM_SFR_SIZE) {
+        return;
+    }
+
+    old = sfr[address];
+
+    // CiCON: OPMOD is read only, REQOP changes mode at once
+    if (address == cREGADDR_CiCON + 2) {
+        sfr[address] = (uint8_t) ((d & 0x1F) | (old & 0xE0));
+        return;
+    }
+    if (address == cREGADDR_CiCON + 3) {
+        uint8_t from = SIM_OpModeGet();
+        uint8_t to = d & 0x07;
+
+        sfr[address] = d & ~SIM_CICON_ABAT;
+        if (d & SIM_CICON_ABAT) {
+            for (ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+                if (fifo[ch].txRequest) {
+                    fifo[ch].txRequest = false;
+                    fifo[ch].aborted = true;
+                }
+            }
+        }
+        if (to != from) {
+            sfr[cREGADDR_CiCON + 2] = (uint8_t) ((sfr[cREGADDR_CiCON + 2] & 0x1F) | (to << 5));
+            if (from == CAN_CONFIGURATION_MODE) {
+                SIM_Layout();
+            } else if (to == CAN_CONFIGURATION_MODE) {
+                for (ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+                    SIM_FifoClear(&fifo[ch]);
+                }
+                SIM_FifoClear(&tef);
+            }
+            sfr[cREGADDR_CiINT] |= (uint8_t) SIM_INT_MODIF;
+        }
+        return;
+    }
+
+    // CiTBC: writing sets the counter
+    if (address >= cREGADDR_CiTBC && address < cREGADDR_CiTBC + 4) {
+        sfr[address] = d;
+        tbc = SIM_RegGet(cREGADDR_CiTBC);
+        return;
+    }
+
+    // CiINT: flags only clear, enables are plain
+    if (address == cREGADDR_CiINT || address == cREGADDR_CiINT + 1) {
+        sfr[address] = old & d;
+        return;
+    }
+
+    // Status and request summary registers
+    if (address >= cREGADDR_CiRXIF && address < cREGADDR_CiTXREQ) {
+        return;
+    }
+    if (address >= cREGADDR_CiTXREQ && address < cREGADDR_CiTXREQ + 4) {
+        for (ch = 0; ch < 8; ch++) {
+            if (d & (1 << ch)) {
+                SIM_FifoControl((uint8_t) ((address - cREGADDR_CiTXREQ) * 8 + ch), SIM_CON1_TXREQ);
+            }
+        }
+        return;
+    }
+
+    // TEF control and status
+    if (address == cREGADDR_CiTEFCON + 1) {
+        sfr[address] = d & ~(SIM_CON1_UINC | SIM_CON1_FRESET);
+        SIM_TefControl(d);
+        return;
+    }
+    if (address >= cREGADDR_CiTEFSTA && address < cREGADDR_CiTEFSTA + 8) {
+        if (address == cREGADDR_CiTEFSTA && !(d & 0x08)) {
+            tef.overflow = false;
+        }
+        return;
+    }
+
+    // FIFO control, status and user address
+    if (address >= cREGADDR_CiFIFOCON && address < cREGADDR_CiFLTCON) {
+        ch = (address - cREGADDR_CiFIFOCON) / CiFIFO_OFFSET;
+        r = (address - cREGADDR_CiFIFOCON) % CiFIFO_OFFSET;
+
+        if (r == 1) {
+            sfr[address] = d & ~(SIM_CON1_UINC | SIM_CON1_TXREQ | SIM_CON1_FRESET);
+            SIM_FifoControl(ch, d);
+        } else if (r < 4) {
+            sfr[address] = d;
+        } else if (r == 4) {
+            // RXOVIF and TXATIF clear when written 0
+            if (!(d & 0x08)) {
+                fifo[ch].overflow = false;
+            }
+            if (!(d & 0x80)) {
+                fifo[ch].aborted = false;
+            }
+        }
+        return;
+    }
+
+    sfr[address] = d;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Simulator control
+
+void SIM_PowerOn(void)
+{
+    memset(ram, 0, sizeof(ram));
+    memset(&stats, 0, sizeof(stats));
+    busLogCount = 0;
+    busHold = false;
+    SIM_DeviceReset();
+}
+
+static void SIM_CrcError(uint16_t crc)
+{
+    REG_CRC crcReg;
+
+    crcReg.word = SIM_McpGet(cREGADDR_CRC);
+    crcReg.bF.CRC16 = crc;
+    crcReg.bF.CRCERRIF = 1;
+    SIM_McpSet(cREGADDR_CRC, crcReg.word);
+    stats.crcErrors++;
+}
+
+void SIM_SpiTransfer(const uint8_t *tx, uint8_t *rx, uint16_t n)
+{
+    uint8_t instruction;
+    uint16_t address;
+    uint16_t count;
+    uint16_t crc;
+    uint16_t i;
+
+    stats.transactions++;
+    stats.bytes += n;
+    memset(rx, 0, n);
+
+    if (n < 2) {
+        return;
+    }
+
+    instruction = tx[0] >> 4;
+    address = (uint16_t) (((tx[0] & 0x0F) << 8) | tx[1]);
+
+    switch (instruction) {
+        case cINSTRUCTION_RESET:
+            stats.resets++;
+            SIM_DeviceReset();
+            break;
+
+        case cINSTRUCTION_READ:
+            stats.reads++;
+            SIM_Refresh();
+            for (i = 2; i < n; i++) {
+                rx[i] = SIM_ByteRead(address++);
+            }
+            break;
+
+        case cINSTRUCTION_WRITE:
+            stats.writes++;
+            for (i = 2; i < n; i++) {
+                SIM_ByteWrite(address++, tx[i]);
+            }
+            break;
+
+        case cINSTRUCTION_READ_CRC:
+            stats.crcReads++;
+            if (n < 5) {
+                break;
+            }
+            count = (address >= cRAMADDR_START && address < cRAMADDR_END) ? tx[2] * 4 : tx[2];
+            if (count + 5 > n) {
+                count = n - 5;
+            }
+            SIM_Refresh();
+            for (i = 0; i < count; i++) {
+                rx[3 + i] = SIM_ByteRead(address + i);
+            }
+            // CRC covers command, address, length and data
+            rx[0] = tx[0];
+            rx[1] = tx[1];
+            rx[2] = tx[2];
+            crc = SIM_Crc16Bitwise(rx, count + 3);
+            rx[0] = rx[1] = rx[2] = 0;
+            rx[3 + count] = (uint8_t) (crc >> 8);
+            rx[4 + count] = (uint8_t) crc;
+            break;
+
+        case cINSTRUCTION_WRITE_CRC:
+            stats.crcWrites++;
+            if (n < 5) {
+                break;
+            }
+            count = (address >= cRAMADDR_START && address < cRAMADDR_END) ? tx[2] * 4 : tx[2];
+            if (count + 5 > n) {
+                count = n - 5;
+            }
+            crc = SIM_Crc16Bitwise(tx, count + 3);
+            if (crc != (uint16_t) ((tx[3 + count] << 8) | tx[4 + count])) {
+                SIM_CrcError(crc);
+                break;
+            }
+            for (i = 0; i < count; i++) {
+                SIM_ByteWrite(address + i, tx[3 + i]);
+            }
+            break;
+
+        case cINSTRUCTION_WRITE_SAFE:
+            stats.safeWrites++;
+            if (n < 5) {
+                break;
+            }
+            crc = SIM_Crc16Bitwise(tx, n - 2);
+            if (crc != (uint16_t) ((tx[n - 2] << 8) | tx[n - 1])) {
+                SIM_CrcError(crc);
+                break;
+            }
+            for (i = 2; i < n - 2; i++) {
+                SIM_ByteWrite(address++, tx[i]);
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    SIM_TxProcess();
+}
+
+void SIM_ClockAdvance(uint32_t cycles)
+{
+    REG_CiTSCON tsCon;
+    uint32_t prescale;
+    uint32_t old = tbc;
+
+    tsCon.word = SIM_RegGet(cREGADDR_CiTSCON);
+    if (!tsCon.bF.TBCEnable) {
+        return;
+    }
+
+    prescale = tsCon.bF.TBCPrescaler + 1;
+    tbcCycles += cycles;
+    tbc += tbcCycles / prescale;
+    tbcCycles %= prescale;
+
+    if (tbc < old) {
+        sfr[cREGADDR_CiINT] |= (uint8_t) SIM_INT_TBCIF;
+    }
+}
+
+bool SIM_FrameInject(const SIM_FRAME *frame)
+{
+    uint8_t mode = SIM_OpModeGet();
+
+    if (mode == CAN_CONFIGURATION_MODE || mode == CAN_SLEEP_MODE ||
+            mode == CAN_INTERNAL_LOOPBACK_MODE) {
+        return false;
+    }
+
+    return SIM_FrameDeliver(frame);
+}
+
+uint32_t SIM_BusLogCount(void)
+{
+    return busLogCount;
+}
+
+const SIM_FRAME* SIM_BusLogGet(uint32_t n)
+{
+    if (n >= busLogCount || busLogCount - n > SIM_BUS_LOG_SIZE) {
+        return NULL;
+    }
+    return &busLog[n % SIM_BUS_LOG_SIZE];
+}
+
+void SIM_BusLogClear(void)
+{
+    busLogCount = 0;
+}
+
+void SIM_BusHold(bool hold)
+{
+    busHold = hold;
+    if (!hold) {
+        SIM_TxProcess();
+    }
+}
+
+void SIM_EccErrorInject(uint16_t address, bool doubleBit)
+{
+    eccAddress = address & ~3;
+    eccMode = doubleBit ? 2 : 1;
+}
+
+const SIM_SPI_STATS* SIM_SpiStatsGet(void)
+{
+    return &stats;
+}
+
+void SIM_SpiStatsClear(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SIM_IntAsserted(void)
+{
+    uint32_t intReg;
+
+    SIM_Refresh();
+    intReg = SIM_RegGet(cREGADDR_CiINT);
+
+    return ((intReg & 0xFFFF) & (intReg >> 16)) != 0;
+}
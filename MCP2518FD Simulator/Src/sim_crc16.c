@@ -0,0 +1,148 @@
+/*******************************************************************************
+  MCP2518FD Simulator - CRC-16
+
+  File Name:
+    sim_crc16.c
+
+  Summary:
+    Host CRC-16 (polynomial 0x8005, seed 0xFFFF, MSB first, no final XOR).
+
+  Description:
+    The CLMUL variant treats 8 message bytes, with the running CRC XORed into
+    the top 16 bits, as a polynomial A of degree < 64 and reduces A * x^16
+    modulo P = x^16 + 0x8005 by Barrett reduction:
+
+      q   = floor(A * mu / x^64), mu = floor(x^80 / P) = x^64 + muLow
+          = A ^ high64(A * muLow)
+      crc = low16(q * 0x8005)
+
+    which is exact over GF(2), so no correction step is needed.
+ *******************************************************************************/
+
+#include "sim_crc16.h"
+
+#if defined(__PCLMUL__)
+#include <wmmintrin.h>
+#endif
+
+#define SIM_CRC16_POLY      0x8005
+#define SIM_CRC16_SEED      0xFFFF
+
+static uint16_t crcTable[256];
+static bool crcTableReady = false;
+
+uint16_t SIM_Crc16Bitwise(const uint8_t *data, uint32_t n)
+{
+    uint16_t crc = SIM_CRC16_SEED;
+    uint8_t bit;
+
+    while (n--) {
+        crc ^= (uint16_t) (*data++) << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ SIM_CRC16_POLY) : (uint16_t) (crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static void SIM_Crc16TableInit(void)
+{
+    uint16_t b, crc;
+    uint8_t bit;
+
+    for (b = 0; b < 256; b++) {
+        crc = (uint16_t) (b << 8);
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ SIM_CRC16_POLY) : (uint16_t) (crc << 1);
+        }
+        crcTable[b] = crc;
+    }
+    crcTableReady = true;
+}
+
+static uint16_t SIM_Crc16Bytes(uint16_t crc, const uint8_t *data, uint32_t n)
+{
+    while (n--) {
+        crc = (uint16_t) ((crc << 8) ^ crcTable[(uint8_t) (crc >> 8) ^ *data++]);
+    }
+    return crc;
+}
+
+#if defined(__PCLMUL__)
+
+static uint64_t muLow;
+
+// Low 64 bits of floor(x^80 / P), bit 64 is always set
+static void SIM_Crc16MuInit(void)
+{
+    uint32_t rem = 0;
+    int i;
+
+    muLow = 0;
+    for (i = 80; i >= 0; i--) {
+        rem = (rem << 1) | (i == 80 ? 1 : 0);
+        if (rem & 0x10000) {
+            rem ^= 0x10000 | SIM_CRC16_POLY;
+            if (i < 64) {
+                muLow |= 1ULL << i;
+            }
+        }
+    }
+}
+
+static inline __m128i SIM_Clmul(uint64_t a, uint64_t b)
+{
+    return _mm_clmulepi64_si128(_mm_cvtsi64_si128((long long) a), _mm_cvtsi64_si128((long long) b), 0x00);
+}
+
+uint16_t SIM_Crc16Fast(const uint8_t *data, uint32_t n)
+{
+    uint16_t crc = SIM_CRC16_SEED;
+    uint64_t a, q;
+    __m128i p;
+
+    if (!crcTableReady) {
+        SIM_Crc16TableInit();
+        SIM_Crc16MuInit();
+    }
+
+    while (n >= 8) {
+        a = ((uint64_t) data[0] << 56) | ((uint64_t) data[1] << 48) |
+                ((uint64_t) data[2] << 40) | ((uint64_t) data[3] << 32) |
+                ((uint64_t) data[4] << 24) | ((uint64_t) data[5] << 16) |
+                ((uint64_t) data[6] << 8) | data[7];
+        a ^= (uint64_t) crc << 48;
+
+        p = SIM_Clmul(a, muLow);
+        q = a ^ (uint64_t) _mm_cvtsi128_si64(_mm_srli_si128(p, 8));
+        crc = (uint16_t) _mm_cvtsi128_si64(SIM_Clmul(q, SIM_CRC16_POLY));
+
+        data += 8;
+        n -= 8;
+    }
+
+    return SIM_Crc16Bytes(crc, data, n);
+}
+
+bool SIM_Crc16FastIsClmul(void)
+{
+    return true;
+}
+
+#else
+
+uint16_t SIM_Crc16Fast(const uint8_t *data, uint32_t n)
+{
+    if (!crcTableReady) {
+        SIM_Crc16TableInit();
+    }
+    return SIM_Crc16Bytes(SIM_CRC16_SEED, data, n);
+}
+
+bool SIM_Crc16FastIsClmul(void)
+{
+    return false;
+}
+
+#endif
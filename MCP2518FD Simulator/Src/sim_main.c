@@ -0,0 +1,896 @@
+/*******************************************************************************
+  MCP2518FD Simulator - driver benchmark
+
+  File Name:
+    sim_main.c
+
+  Summary:
+    Runs canfdspi_api.c against the simulator and counts SPI traffic.
+
+  Description:
+    The controller is set up like APP_CANFDSPI_Init in the Pack Emulator, but
+    in internal loopback so every transmitted frame comes back through
+    filter 0 into the RX FIFO. Frames are sent and received in rounds, first
+    with the per message calls the applications used originally, then with the
+    batch calls. Every received frame is checked against what was sent.
+
+    The CRC-16 engines (driver, bitwise reference, host CLMUL) are then
+    cross-checked on random buffers and timed at SPI frame sizes.
+
+    Last, traffic of a busy multi-pack bus is injected into a controller set
+    up as the Pack Emulator receiver, once with the old accept all filter and
+    once with the filters CANFILTER_Build derives from the handled IDs, and
+    the SPI cost of reading it is compared.
+
+    Finally the TX scheduler is run against one shared TX FIFO: a burst of
+    cell detail and status frames is queued while the bus is busy, then a
+    state frame, and the position the state frame gets on the bus is
+    compared.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "sim_hal.h"
+#include "canfdspi_api.h"
+#include "mcp2518fd_sim.h"
+#include "sim_crc16.h"
+#include "can_filter.h"
+#include "tx_sched.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+#define SIM_TX_FIFO         CAN_FIFO_CH2
+#define SIM_RX_FIFO         CAN_FIFO_CH1
+
+#define SIM_FRAMES          256
+#define SIM_ROUND           4
+#define SIM_PAYLOAD         8
+
+#define SIM_CRC_CHECKS      20000
+#define SIM_CRC_MAX_LENGTH  300
+#define SIM_CRC_BENCH_BYTES (64UL * 1024 * 1024)
+
+#define SIM_RX_HP_FIFO      CAN_FIFO_CH3
+#define SIM_FILTER_CYCLES   100
+#define SIM_FILTER_PACKS    4
+#define SIM_FILTER_MODULES  8
+#define SIM_FILTER_SERVICE  8       // frames on the bus between two RX interrupt services
+
+#define SIM_TX_BULK_FIFO    CAN_FIFO_CH4
+#define SIM_SCHED_BULK      32      // cell detail frames in the burst
+#define SIM_SCHED_STATUS    16      // status 2 and 3 frames in the burst
+#define SIM_SCHED_MS        1000
+
+// Pack Emulator receive IDs, CAN_ID_ALL.h is not part of this repository
+#define SIM_ID_MODULE_REGISTRATION      0x510
+#define SIM_ID_MODULE_HARDWARE_REQUEST  0x511
+#define SIM_ID_MODULE_STATUS_REQUEST    0x512
+#define SIM_ID_MODULE_STATE_CHANGE      0x514
+#define SIM_ID_MODULE_DETAIL_REQUEST    0x515
+#define SIM_ID_MODULE_TIME              0x516
+#define SIM_ID_MODULE_ALL_DEREGISTER    0x51E
+#define SIM_ID_MODULE_ALL_ISOLATE       0x51F
+
+// Same default as canfdspi_api.c, pass -D to both when changing it
+#ifndef DRV_CANFDSPI_CRC16_SLICES
+#define DRV_CANFDSPI_CRC16_SLICES 4
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+typedef struct _SIM_COST {
+    uint32_t transactions;
+    uint32_t bytes;
+} SIM_COST;
+
+static CAN_TX_MSGOBJ txObj[SIM_ROUND];
+static uint8_t txd[SIM_ROUND][SIM_PAYLOAD];
+static CAN_RX_MSGOBJ rxObj[SIM_ROUND];
+static uint8_t rxd[SIM_ROUND][MAX_DATA_BYTES];
+
+static uint32_t framesSent;
+static uint32_t framesChecked;
+static uint32_t framesBad;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Helpers
+
+static void SIM_Init(void)
+{
+    CAN_CONFIG config;
+    CAN_TX_FIFO_CONFIG txConfig;
+    CAN_RX_FIFO_CONFIG rxConfig;
+    REG_CiFLTOBJ fObj;
+    REG_CiMASK mObj;
+
+    SIM_PowerOn();
+
+    DRV_CANFDSPI_Reset(DRV_CANFDSPI_INDEX_0);
+    DRV_CANFDSPI_EccEnable(DRV_CANFDSPI_INDEX_0);
+    DRV_CANFDSPI_RamInit(DRV_CANFDSPI_INDEX_0, 0xff);
+
+    DRV_CANFDSPI_ConfigureObjectReset(&config);
+    config.IsoCrcEnable = 1;
+    config.StoreInTEF = 0;
+    DRV_CANFDSPI_Configure(DRV_CANFDSPI_INDEX_0, &config);
+
+    DRV_CANFDSPI_TransmitChannelConfigureObjectReset(&txConfig);
+    txConfig.FifoSize = 15;
+    txConfig.PayLoadSize = CAN_PLSIZE_8;
+    txConfig.TxPriority = 1;
+    DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_TX_FIFO, &txConfig);
+
+    DRV_CANFDSPI_ReceiveChannelConfigureObjectReset(&rxConfig);
+    rxConfig.FifoSize = 15;
+    rxConfig.PayLoadSize = CAN_PLSIZE_64;
+    DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_RX_FIFO, &rxConfig);
+
+    fObj.word = 0;
+    DRV_CANFDSPI_FilterObjectConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &fObj.bF);
+    mObj.word = 0;
+    DRV_CANFDSPI_FilterMaskConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &mObj.bF);
+    DRV_CANFDSPI_FilterToFifoLink(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, SIM_RX_FIFO, true);
+
+    DRV_CANFDSPI_BitTimeConfigure(DRV_CANFDSPI_INDEX_0, CAN_500K_2M, CAN_SSP_MODE_AUTO, CAN_SYSCLK_40M);
+
+    DRV_CANFDSPI_OperationModeSelect(DRV_CANFDSPI_INDEX_0, CAN_INTERNAL_LOOPBACK_MODE);
+
+    SIM_SpiStatsClear();
+    framesSent = 0;
+    framesChecked = 0;
+    framesBad = 0;
+}
+
+// Extended IDs and payloads that differ per frame, so misplaced objects show up
+static void SIM_FramesBuild(uint8_t n)
+{
+    uint8_t i, b;
+
+    for (i = 0; i < n; i++) {
+        uint32_t k = framesSent + i;
+
+        memset(&txObj[i], 0, sizeof(txObj[i]));
+        txObj[i].bF.id.SID = 0x100 | (k & 0xFF);
+        txObj[i].bF.id.EID = k;
+        txObj[i].bF.ctrl.IDE = 1;
+        txObj[i].bF.ctrl.BRS = 1;
+        txObj[i].bF.ctrl.FDF = 1;
+        txObj[i].bF.ctrl.DLC = CAN_DLC_8;
+        txObj[i].bF.ctrl.SEQ = k;
+        for (b = 0; b < SIM_PAYLOAD; b++) {
+            txd[i][b] = (uint8_t) (k * 7 + b);
+        }
+    }
+}
+
+static void SIM_FrameCheck(const CAN_RX_MSGOBJ *obj, const uint8_t *data)
+{
+    uint32_t k = framesChecked++;
+    uint8_t b;
+    bool ok = obj->bF.id.SID == (0x100 | (k & 0xFF)) && obj->bF.id.EID == (k & 0x3FFFF) &&
+            obj->bF.ctrl.IDE && obj->bF.ctrl.DLC == CAN_DLC_8;
+
+    for (b = 0; b < SIM_PAYLOAD; b++) {
+        ok = ok && data[b] == (uint8_t) (k * 7 + b);
+    }
+    if (!ok) {
+        framesBad++;
+    }
+}
+
+static void SIM_CostTake(SIM_COST *cost, const SIM_SPI_STATS *before)
+{
+    const SIM_SPI_STATS *now = SIM_SpiStatsGet();
+
+    cost->transactions += now->transactions - before->transactions;
+    cost->bytes += now->bytes - before->bytes;
+}
+
+static void SIM_CostPrint(const char *name, const SIM_COST *cost)
+{
+    printf("  %-34s %8u %8u %10.2f %10.2f\r\n", name, cost->transactions, cost->bytes,
+            (double) cost->transactions / SIM_FRAMES, (double) cost->bytes / SIM_FRAMES);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Benchmarks
+
+// As the applications did before the batch calls: event poll plus one call per frame
+static void SIM_RunPerMessage(SIM_COST *tx, SIM_COST *rx)
+{
+    CAN_TX_FIFO_EVENT txFlags;
+    CAN_RX_FIFO_EVENT rxFlags;
+    SIM_SPI_STATS before;
+    uint8_t i;
+
+    SIM_Init();
+
+    while (framesSent < SIM_FRAMES) {
+        SIM_FramesBuild(SIM_ROUND);
+
+        before = *SIM_SpiStatsGet();
+        for (i = 0; i < SIM_ROUND; i++) {
+            DRV_CANFDSPI_TransmitChannelEventGet(DRV_CANFDSPI_INDEX_0, SIM_TX_FIFO, &txFlags);
+            if (txFlags & CAN_TX_FIFO_NOT_FULL_EVENT) {
+                DRV_CANFDSPI_TransmitChannelLoad(DRV_CANFDSPI_INDEX_0, SIM_TX_FIFO, &txObj[i], txd[i], SIM_PAYLOAD, true);
+            }
+        }
+        SIM_CostTake(tx, &before);
+        framesSent += SIM_ROUND;
+
+        before = *SIM_SpiStatsGet();
+        for (;;) {
+            DRV_CANFDSPI_ReceiveChannelEventGet(DRV_CANFDSPI_INDEX_0, SIM_RX_FIFO, &rxFlags);
+            if (!(rxFlags & CAN_RX_FIFO_NOT_EMPTY_EVENT)) {
+                break;
+            }
+            DRV_CANFDSPI_ReceiveMessageGet(DRV_CANFDSPI_INDEX_0, SIM_RX_FIFO, &rxObj[0], rxd[0], MAX_DATA_BYTES);
+            SIM_CostTake(rx, &before);
+            SIM_FrameCheck(&rxObj[0], rxd[0]);
+            before = *SIM_SpiStatsGet();
+        }
+        SIM_CostTake(rx, &before);
+    }
+}
+
+// Batch calls: one LoadBatch per round, GetBatch until a short batch
+static void SIM_RunBatch(SIM_COST *tx, SIM_COST *rx)
+{
+    SIM_SPI_STATS before;
+    uint8_t loaded, count, i;
+
+    SIM_Init();
+
+    while (framesSent < SIM_FRAMES) {
+        SIM_FramesBuild(SIM_ROUND);
+
+        before = *SIM_SpiStatsGet();
+        DRV_CANFDSPI_TransmitChannelLoadBatch(DRV_CANFDSPI_INDEX_0, SIM_TX_FIFO, txObj, &txd[0][0],
+                SIM_PAYLOAD, SIM_ROUND, &loaded, true);
+        SIM_CostTake(tx, &before);
+        framesSent += loaded;
+
+        do {
+            before = *SIM_SpiStatsGet();
+            DRV_CANFDSPI_ReceiveMessageGetBatch(DRV_CANFDSPI_INDEX_0, SIM_RX_FIFO, rxObj, &rxd[0][0],
+                    MAX_DATA_BYTES, SIM_ROUND, &count);
+            SIM_CostTake(rx, &before);
+            for (i = 0; i < count; i++) {
+                SIM_FrameCheck(&rxObj[i], rxd[i]);
+            }
+        } while (count == SIM_ROUND);
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: CRC-16
+
+typedef uint16_t (*SIM_CRC_FUNCTION)(const uint8_t *data, uint32_t n);
+
+static uint32_t crcSeed = 0x12345678;
+static uint8_t crcBuffer[SIM_CRC_MAX_LENGTH + 8];
+
+static uint32_t SIM_Random(void)
+{
+    crcSeed ^= crcSeed << 13;
+    crcSeed ^= crcSeed >> 17;
+    crcSeed ^= crcSeed << 5;
+    return crcSeed;
+}
+
+static uint16_t SIM_Crc16Driver(const uint8_t *data, uint32_t n)
+{
+    return DRV_CANFDSPI_CalculateCRC16((uint8_t *) data, (uint16_t) n);
+}
+
+// The driver's tables, hard-coded in canfdspi_api.c
+extern const uint16_t crc16_table[256];
+#if DRV_CANFDSPI_CRC16_SLICES >= 4
+extern const uint16_t crc16_table1[256], crc16_table2[256], crc16_table3[256];
+#endif
+#if DRV_CANFDSPI_CRC16_SLICES >= 8
+extern const uint16_t crc16_table4[256], crc16_table5[256], crc16_table6[256], crc16_table7[256];
+#endif
+
+// Rebuilds the driver's tables from the polynomial and returns the number
+// of entries that differ
+static uint32_t SIM_CrcTables(void)
+{
+    static const uint16_t *const driver[] = {
+        crc16_table,
+#if DRV_CANFDSPI_CRC16_SLICES >= 4
+        crc16_table1, crc16_table2, crc16_table3,
+#endif
+#if DRV_CANFDSPI_CRC16_SLICES >= 8
+        crc16_table4, crc16_table5, crc16_table6, crc16_table7,
+#endif
+    };
+    uint16_t table[256], entry;
+    uint32_t bad = 0;
+    uint32_t t, b, bit;
+
+    // Table 0 bit by bit, table N is table N-1 shifted on by a zero byte
+    for (b = 0; b < 256; b++) {
+        entry = (uint16_t) (b << 8);
+        for (bit = 0; bit < 8; bit++) {
+            entry = (entry & 0x8000) ? (uint16_t) ((entry << 1) ^ 0x8005) : (uint16_t) (entry << 1);
+        }
+        table[b] = entry;
+    }
+    for (t = 0; t < sizeof(driver) / sizeof(driver[0]); t++) {
+        for (b = 0; b < 256; b++) {
+            entry = table[b];
+            for (bit = 0; bit < t; bit++) {
+                entry = (uint16_t) ((entry << 8) ^ table[entry >> 8]);
+            }
+            if (driver[t][b] != entry) {
+                bad++;
+            }
+        }
+    }
+
+    printf("\r\nCRC-16 0x8005, %u driver table(s) rebuilt from the polynomial, %u entries differ\r\n",
+            (uint32_t) (sizeof(driver) / sizeof(driver[0])), bad);
+    return bad;
+}
+
+static double SIM_CrcTime(SIM_CRC_FUNCTION crc, uint32_t length)
+{
+    struct timespec t0, t1;
+    uint32_t rounds = SIM_CRC_BENCH_BYTES / length;
+    volatile uint16_t sink = 0;
+    uint32_t i;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < rounds; i++) {
+        crcBuffer[0] = (uint8_t) i;
+        sink ^= crc(crcBuffer, length);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    (void) sink;
+
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double) rounds * length);
+}
+
+// Returns the number of mismatches
+static uint32_t SIM_RunCrc(void)
+{
+    static const uint8_t check[] = "123456789";
+    static const uint32_t lengths[] = {3, 7, 19, 67, 259};
+    uint32_t bad = 0;
+    uint32_t i, b, n, offset;
+    uint16_t reference;
+    char label[40];
+
+    bad += SIM_CrcTables();
+
+    // CRC-16/CMS check value
+    if (SIM_Crc16Bitwise(check, 9) != 0xAEE7 || SIM_Crc16Driver(check, 9) != 0xAEE7 ||
+            SIM_Crc16Fast(check, 9) != 0xAEE7) {
+        bad++;
+    }
+
+    for (i = 0; i < SIM_CRC_CHECKS; i++) {
+        n = SIM_Random() % (SIM_CRC_MAX_LENGTH + 1);
+        offset = SIM_Random() % 8;
+        for (b = 0; b < n; b++) {
+            crcBuffer[offset + b] = (uint8_t) SIM_Random();
+        }
+        reference = SIM_Crc16Bitwise(crcBuffer + offset, n);
+        if (SIM_Crc16Driver(crcBuffer + offset, n) != reference ||
+                SIM_Crc16Fast(crcBuffer + offset, n) != reference) {
+            bad++;
+        }
+    }
+
+    printf("\r\nCRC-16 0x8005, %u random buffers cross-checked, %u mismatches\r\n\r\n", SIM_CRC_CHECKS, bad);
+    printf("  %-34s", "ns/byte at frame length");
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        printf(" %7u", lengths[i]);
+    }
+    printf("\r\n");
+
+    printf("  %-34s", "bitwise (reference)");
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        printf(" %7.2f", SIM_CrcTime(SIM_Crc16Bitwise, lengths[i]));
+    }
+    printf("\r\n");
+
+    snprintf(label, sizeof(label), "driver, %u slice(s)", DRV_CANFDSPI_CRC16_SLICES);
+    printf("  %-34s", label);
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        printf(" %7.2f", SIM_CrcTime(SIM_Crc16Driver, lengths[i]));
+    }
+    printf("\r\n");
+
+    printf("  %-34s", SIM_Crc16FastIsClmul() ? "host CLMUL" : "host byte table (no PCLMUL)");
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        printf(" %7.2f", SIM_CrcTime(SIM_Crc16Fast, lengths[i]));
+    }
+    printf("\r\n");
+
+    return bad;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Acceptance filters
+
+// As rxFilterIds in the Pack Emulator app.c
+static const CANFILTER_ID filterIds[] = {
+    {SIM_ID_MODULE_STATE_CHANGE,     CANFILTER_ANY, SIM_RX_HP_FIFO},
+    {SIM_ID_MODULE_ALL_ISOLATE,      CANFILTER_ANY, SIM_RX_HP_FIFO},
+    {SIM_ID_MODULE_REGISTRATION,     CANFILTER_ANY, SIM_RX_FIFO},
+    {SIM_ID_MODULE_ALL_DEREGISTER,   CANFILTER_ANY, SIM_RX_FIFO},
+    {SIM_ID_MODULE_DETAIL_REQUEST,   CANFILTER_ANY, SIM_RX_FIFO},
+    {SIM_ID_MODULE_STATUS_REQUEST,   CANFILTER_ANY, SIM_RX_FIFO},
+    {SIM_ID_MODULE_HARDWARE_REQUEST, CANFILTER_ANY, SIM_RX_FIFO},
+    {SIM_ID_MODULE_TIME,             CANFILTER_ANY, SIM_RX_FIFO},
+};
+
+#define SIM_FILTER_IDS (sizeof(filterIds) / sizeof(filterIds[0]))
+
+typedef struct _SIM_FILTER_RESULT {
+    SIM_COST cost;
+    uint32_t busFrames;
+    uint32_t handledFrames;
+    uint32_t framesRead;
+    uint32_t hpFramesRead;
+    uint32_t lost;
+    uint32_t wrong;
+} SIM_FILTER_RESULT;
+
+static CANFILTER_RULE filterRules[CAN_FILTER_TOTAL];
+static int8_t filterRuleCount;
+static SIM_FRAME filterFrame;
+
+static CAN_FIFO_CHANNEL SIM_FilterFifo(uint16_t sid, bool *handled)
+{
+    uint8_t i;
+
+    for (i = 0; i < SIM_FILTER_IDS; i++) {
+        if (filterIds[i].sid == sid) {
+            *handled = true;
+            return filterIds[i].fifo;
+        }
+    }
+    *handled = false;
+    return SIM_RX_FIFO;
+}
+
+// Receiver set up like the Pack Emulator APP_CANFDSPI_Init, in Normal mode
+static void SIM_FilterInit(bool filtered)
+{
+    CAN_CONFIG config;
+    CAN_TX_FIFO_CONFIG txConfig;
+    CAN_RX_FIFO_CONFIG rxConfig;
+    REG_CiFLTOBJ fObj;
+    REG_CiMASK mObj;
+
+    SIM_PowerOn();
+
+    DRV_CANFDSPI_Reset(DRV_CANFDSPI_INDEX_0);
+    DRV_CANFDSPI_EccEnable(DRV_CANFDSPI_INDEX_0);
+    DRV_CANFDSPI_RamInit(DRV_CANFDSPI_INDEX_0, 0xff);
+
+    DRV_CANFDSPI_ConfigureObjectReset(&config);
+    config.IsoCrcEnable = 1;
+    DRV_CANFDSPI_Configure(DRV_CANFDSPI_INDEX_0, &config);
+
+    DRV_CANFDSPI_TransmitChannelConfigureObjectReset(&txConfig);
+    txConfig.FifoSize = 15;
+    txConfig.PayLoadSize = CAN_PLSIZE_8;
+    DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_TX_FIFO, &txConfig);
+
+    DRV_CANFDSPI_ReceiveChannelConfigureObjectReset(&rxConfig);
+    rxConfig.FifoSize = 15;
+    rxConfig.PayLoadSize = CAN_PLSIZE_64;
+    rxConfig.RxTimeStampEnable = 1;
+    DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_RX_FIFO, &rxConfig);
+
+    rxConfig.FifoSize = 3;
+    rxConfig.PayLoadSize = CAN_PLSIZE_8;
+    DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_RX_HP_FIFO, &rxConfig);
+
+    if (filtered) {
+        CANFILTER_Apply(DRV_CANFDSPI_INDEX_0, filterRules, filterRuleCount);
+    } else {
+        fObj.word = 0;
+        DRV_CANFDSPI_FilterObjectConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &fObj.bF);
+        mObj.word = 0;
+        DRV_CANFDSPI_FilterMaskConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &mObj.bF);
+        DRV_CANFDSPI_FilterToFifoLink(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, SIM_RX_FIFO, true);
+    }
+
+    DRV_CANFDSPI_BitTimeConfigure(DRV_CANFDSPI_INDEX_0, CAN_500K_2M, CAN_SSP_MODE_AUTO, CAN_SYSCLK_40M);
+
+    DRV_CANFDSPI_ReceiveChannelEventEnable(DRV_CANFDSPI_INDEX_0, SIM_RX_FIFO, CAN_RX_FIFO_NOT_EMPTY_EVENT);
+    DRV_CANFDSPI_ReceiveChannelEventEnable(DRV_CANFDSPI_INDEX_0, SIM_RX_HP_FIFO, CAN_RX_FIFO_NOT_EMPTY_EVENT);
+    DRV_CANFDSPI_ModuleEventEnable(DRV_CANFDSPI_INDEX_0, CAN_RX_EVENT);
+
+    DRV_CANFDSPI_OperationModeSelect(DRV_CANFDSPI_INDEX_0, CAN_NORMAL_MODE);
+
+    SIM_SpiStatsClear();
+}
+
+// As APP_ReceiveMessage_Tasks: only when INT is asserted, HP FIFO first, batches of SIM_ROUND
+static void SIM_FilterService(SIM_FILTER_RESULT *result, bool filtered)
+{
+    static const CAN_FIFO_CHANNEL fifos[] = {SIM_RX_HP_FIFO, SIM_RX_FIFO};
+    CAN_FIFO_CHANNEL expected;
+    SIM_SPI_STATS before;
+    bool handled;
+    uint8_t count, f, i;
+
+    if (!SIM_IntAsserted()) {
+        return;
+    }
+
+    for (f = 0; f < 2; f++) {
+        do {
+            before = *SIM_SpiStatsGet();
+            DRV_CANFDSPI_ReceiveMessageGetBatch(DRV_CANFDSPI_INDEX_0, fifos[f], rxObj, &rxd[0][0],
+                    MAX_DATA_BYTES, SIM_ROUND, &count);
+            SIM_CostTake(&result->cost, &before);
+
+            for (i = 0; i < count; i++) {
+                expected = SIM_FilterFifo(rxObj[i].bF.id.SID, &handled);
+                result->framesRead++;
+                if (fifos[f] == SIM_RX_HP_FIFO) {
+                    result->hpFramesRead++;
+                }
+                if (filtered && (!handled || expected != fifos[f])) {
+                    result->wrong++;
+                }
+            }
+        } while (count == SIM_ROUND);
+    }
+}
+
+static void SIM_FilterSend(SIM_FILTER_RESULT *result, bool filtered, uint16_t sid, bool ide, uint32_t eid, uint8_t dlc)
+{
+    bool handled;
+
+    memset(&filterFrame, 0, sizeof(filterFrame));
+    filterFrame.id = sid | ((eid & 0x3FFFF) << 11);
+    filterFrame.ide = ide;
+    filterFrame.dlc = dlc;
+    filterFrame.fdf = dlc > CAN_DLC_8;
+    filterFrame.brs = filterFrame.fdf;
+
+    SIM_FilterFifo(sid, &handled);
+    result->busFrames++;
+    if (handled) {
+        result->handledFrames++;
+    }
+    if (!SIM_FrameInject(&filterFrame) && (handled || !filtered)) {
+        result->lost++;
+    }
+    if (result->busFrames % SIM_FILTER_SERVICE == 0) {
+        SIM_FilterService(result, filtered);
+    }
+}
+
+// One poll cycle of a bus shared by SIM_FILTER_PACKS packs; pack 0 is the emulated one
+static void SIM_RunFilter(SIM_FILTER_RESULT *result, bool filtered)
+{
+    uint32_t cycle;
+    uint16_t p, m, sid;
+
+    memset(result, 0, sizeof(*result));
+    SIM_FilterInit(filtered);
+
+    for (cycle = 0; cycle < SIM_FILTER_CYCLES; cycle++) {
+        for (p = 0; p < SIM_FILTER_PACKS; p++) {
+            // Pack controller polls its modules, the replies of the other packs' modules are foreign
+            for (m = 0; m < SIM_FILTER_MODULES; m++) {
+                SIM_FilterSend(result, filtered, SIM_ID_MODULE_STATUS_REQUEST, true, p * SIM_FILTER_MODULES + m, CAN_DLC_8);
+                if (p != 0) {
+                    for (sid = 0x502; sid <= 0x504; sid++) {
+                        SIM_FilterSend(result, filtered, sid, true, p * SIM_FILTER_MODULES + m, CAN_DLC_8);
+                    }
+                }
+            }
+            if (cycle % 10 == p) {
+                SIM_FilterSend(result, filtered, SIM_ID_MODULE_DETAIL_REQUEST, true, p * SIM_FILTER_MODULES + (cycle & 7), CAN_DLC_8);
+            }
+
+            // Pack controller reports to the VCU
+            for (sid = 0x421; sid <= 0x429; sid++) {
+                SIM_FilterSend(result, filtered, sid, false, 0, CAN_DLC_8);
+            }
+            SIM_FilterSend(result, filtered, 0x410, false, 0, CAN_DLC_8);
+        }
+
+        // VCU command and time, state change now and then
+        SIM_FilterSend(result, filtered, 0x400, false, 0, CAN_DLC_8);
+        if (cycle % 10 == 0) {
+            SIM_FilterSend(result, filtered, SIM_ID_MODULE_TIME, true, 0, CAN_DLC_8);
+        }
+        if (cycle % 25 == 5) {
+            SIM_FilterSend(result, filtered, SIM_ID_MODULE_STATE_CHANGE, true, cycle & 7, CAN_DLC_8);
+        }
+
+        // Firmware and configuration transfer to a module of another pack, 64 byte FD frames
+        for (m = 0; m < 4; m++) {
+            SIM_FilterSend(result, filtered, 0x5F0, true, cycle * 4 + m, CAN_DLC_64);
+        }
+    }
+
+    SIM_FilterService(result, filtered);
+}
+
+static void SIM_FilterPrint(const char *name, const SIM_FILTER_RESULT *result)
+{
+    printf("  %-22s %8u %8u %8u %10.2f %10.2f %10.2f\r\n", name, result->framesRead, result->cost.transactions,
+            result->cost.bytes, (double) result->cost.transactions / result->busFrames,
+            (double) result->cost.bytes / result->busFrames,
+            (double) result->cost.bytes / result->handledFrames);
+}
+
+// Returns the number of mismatches
+static uint32_t SIM_FilterCheck(void)
+{
+    SIM_FILTER_RESULT all, filtered;
+    CAN_FIFO_CHANNEL fifo;
+    CAN_FIFO_CHANNEL expected;
+    uint32_t bad = 0;
+    uint32_t sid;
+    bool handled;
+    bool ide;
+    uint8_t i;
+
+    filterRuleCount = CANFILTER_Build(filterIds, SIM_FILTER_IDS, filterRules, CAN_FILTER_TOTAL);
+    if (filterRuleCount <= 0) {
+        printf("\r\nCANFILTER_Build failed\r\n");
+        return 1;
+    }
+
+    // Every SID in both formats: accepted exactly when listed, into the listed FIFO
+    for (sid = 0; sid < 0x800; sid++) {
+        for (ide = false; ; ide = true) {
+            expected = SIM_FilterFifo((uint16_t) sid, &handled);
+            if (CANFILTER_Accepts(filterRules, filterRuleCount, (uint16_t) sid, sid * 37, ide, &fifo) != handled ||
+                    (handled && fifo != expected)) {
+                bad++;
+            }
+            if (ide) {
+                break;
+            }
+        }
+    }
+
+    printf("\r\nAcceptance filters for %u Pack Emulator IDs: %d rules, %u mismatches\r\n\r\n",
+            (unsigned) SIM_FILTER_IDS, filterRuleCount, bad);
+    for (i = 0; i < filterRuleCount; i++) {
+        printf("  filter %u  SID 0x%03X mask 0x%03X  %s  FIFO %u\r\n", i,
+                filterRules[i].value & 0x7FF, filterRules[i].mask & 0x7FF,
+                (filterRules[i].mask & (1UL << 30)) ? ((filterRules[i].value & (1UL << 30)) ? "EXT" : "STD") : "ANY",
+                filterRules[i].fifo);
+    }
+
+    SIM_RunFilter(&all, false);
+    SIM_RunFilter(&filtered, true);
+
+    printf("\r\n%u poll cycles, %u packs of %u modules: %u bus frames, %u handled\r\n\r\n",
+            SIM_FILTER_CYCLES, SIM_FILTER_PACKS, SIM_FILTER_MODULES, all.busFrames, all.handledFrames);
+    printf("  %-22s %8s %8s %8s %10s %10s %10s\r\n", "", "read", "trans", "bytes", "trans/bus", "bytes/bus", "bytes/hdl");
+    SIM_FilterPrint("accept all", &all);
+    SIM_FilterPrint("built filters", &filtered);
+    printf("\r\n  high priority frames read from FIFO %u: %u, lost: %u / %u, misrouted: %u\r\n",
+            SIM_RX_HP_FIFO, filtered.hpFramesRead, all.lost, filtered.lost, filtered.wrong);
+
+    return bad + all.lost + filtered.lost + filtered.wrong +
+            (filtered.framesRead != filtered.handledFrames) + (all.framesRead != all.busFrames);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Transmit scheduler
+
+#define SIM_ID_MODULE_STATUS_1          0x502
+#define SIM_ID_MODULE_STATUS_2          0x503
+#define SIM_ID_MODULE_STATUS_3          0x504
+#define SIM_ID_MODULE_DETAIL            0x505
+
+// As txClasses in the Pack Emulator app.c
+static const TXSCHED_CLASS_CONFIG schedClasses[TXSCHED_CLASSES] = {
+    {CAN_TXQUEUE_CH0,   0,      0,  50},
+    {SIM_TX_FIFO,       0,      0,  200},
+    {SIM_TX_BULK_FIFO,  200,    8,  1000},
+};
+
+// Before: the same queues, but every class loads into the one 16 deep TX FIFO
+static const TXSCHED_CLASS_CONFIG schedSingle[TXSCHED_CLASSES] = {
+    {SIM_TX_FIFO,       0,      0,  0},
+    {SIM_TX_FIFO,       0,      0,  0},
+    {SIM_TX_FIFO,       0,      0,  0},
+};
+
+typedef struct _SIM_SCHED_RESULT {
+    uint32_t stateAhead;        // frames on the bus before the state frame
+    uint32_t stateMs;           // ms from queuing the state frame to the bus
+    uint32_t bulkMs;            // ms until the last cell detail frame was on the bus
+    uint32_t sent;
+    uint32_t lost;
+} SIM_SCHED_RESULT;
+
+static void SIM_SchedInit(bool classes)
+{
+    CAN_CONFIG config;
+    CAN_TX_QUEUE_CONFIG txqConfig;
+    CAN_TX_FIFO_CONFIG txConfig;
+
+    SIM_PowerOn();
+
+    DRV_CANFDSPI_Reset(DRV_CANFDSPI_INDEX_0);
+    DRV_CANFDSPI_EccEnable(DRV_CANFDSPI_INDEX_0);
+    DRV_CANFDSPI_RamInit(DRV_CANFDSPI_INDEX_0, 0xff);
+
+    DRV_CANFDSPI_ConfigureObjectReset(&config);
+    config.IsoCrcEnable = 1;
+    config.TXQEnable = classes;
+    DRV_CANFDSPI_Configure(DRV_CANFDSPI_INDEX_0, &config);
+
+    if (classes) {
+        DRV_CANFDSPI_TransmitQueueConfigureObjectReset(&txqConfig);
+        txqConfig.FifoSize = 3;
+        txqConfig.PayLoadSize = CAN_PLSIZE_8;
+        txqConfig.TxPriority = 2;
+        DRV_CANFDSPI_TransmitQueueConfigure(DRV_CANFDSPI_INDEX_0, &txqConfig);
+    }
+
+    DRV_CANFDSPI_TransmitChannelConfigureObjectReset(&txConfig);
+    txConfig.FifoSize = classes ? 7 : 15;
+    txConfig.PayLoadSize = CAN_PLSIZE_8;
+    txConfig.TxPriority = 1;
+    DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_TX_FIFO, &txConfig);
+
+    if (classes) {
+        txConfig.FifoSize = 7;
+        txConfig.TxPriority = 0;
+        DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, SIM_TX_BULK_FIFO, &txConfig);
+    }
+
+    DRV_CANFDSPI_BitTimeConfigure(DRV_CANFDSPI_INDEX_0, CAN_500K_2M, CAN_SSP_MODE_AUTO, CAN_SYSCLK_40M);
+
+    SIM_BusHold(true);
+    DRV_CANFDSPI_OperationModeSelect(DRV_CANFDSPI_INDEX_0, CAN_NORMAL_MODE);
+
+    TXSCHED_Init(classes ? schedClasses : schedSingle);
+    SIM_BusLogClear();
+}
+
+static void SIM_SchedQueue(SIM_SCHED_RESULT *result, TXSCHED_CLASS cls, uint16_t sid, uint32_t eid, uint32_t now)
+{
+    memset(&txObj[0], 0, sizeof(txObj[0]));
+    txObj[0].bF.id.SID = sid;
+    txObj[0].bF.id.EID = eid;
+    txObj[0].bF.ctrl.IDE = 1;
+    txObj[0].bF.ctrl.DLC = CAN_DLC_8;
+    memset(txd[0], (uint8_t) eid, SIM_PAYLOAD);
+
+    if (TXSCHED_Queue(cls, &txObj[0], txd[0], now)) {
+        result->lost++;
+    }
+}
+
+// A node with higher priority IDs keeps the bus for the first 2 ms, after that every
+// frame loaded in one ms is on the bus by the next
+static void SIM_RunSched(SIM_SCHED_RESULT *result, bool classes)
+{
+    const SIM_FRAME *frame;
+    uint32_t now, n, logged = 0;
+    uint16_t sid;
+
+    memset(result, 0, sizeof(*result));
+    SIM_SchedInit(classes);
+
+    // Registration burst: status 2/3 and cell detail for every module
+    for (n = 0; n < SIM_SCHED_BULK; n++) {
+        if (n < SIM_SCHED_STATUS) {
+            sid = (n & 1) ? SIM_ID_MODULE_STATUS_3 : SIM_ID_MODULE_STATUS_2;
+            SIM_SchedQueue(result, TXSCHED_TELEMETRY, sid, n / 2, 0);
+        }
+        SIM_SchedQueue(result, TXSCHED_BULK, SIM_ID_MODULE_DETAIL, n, 0);
+    }
+    TXSCHED_Service(0);
+
+    // State change reply while the burst is still waiting
+    SIM_SchedQueue(result, TXSCHED_STATE, SIM_ID_MODULE_STATUS_1, 0x7F, 1);
+    TXSCHED_Service(1);
+
+    for (now = 2; now < SIM_SCHED_MS; now++) {
+        SIM_BusHold(false);
+        SIM_BusHold(true);
+
+        for (; logged < SIM_BusLogCount(); logged++) {
+            frame = SIM_BusLogGet(logged);
+            if ((frame->id & 0x7FF) == SIM_ID_MODULE_STATUS_1) {
+                result->stateAhead = logged;
+                result->stateMs = now - 1;
+            }
+            if ((frame->id & 0x7FF) == SIM_ID_MODULE_DETAIL) {
+                result->bulkMs = now;
+            }
+        }
+
+        TXSCHED_Service(now);
+    }
+    result->sent = SIM_BusLogCount();
+}
+
+static void SIM_SchedPrint(const char *name, const SIM_SCHED_RESULT *result)
+{
+    printf("  %-22s %10u %10u %10u %8u %8u\r\n", name, result->stateAhead, result->stateMs,
+            result->bulkMs, result->sent, result->lost);
+}
+
+// Returns the number of failures
+static uint32_t SIM_SchedCheck(void)
+{
+    SIM_SCHED_RESULT single, classes;
+    uint32_t total = SIM_SCHED_BULK + SIM_SCHED_STATUS + 1;
+
+    printf("\r\nTX scheduler: burst of %u cell detail and %u status frames, then one state frame\r\n\r\n",
+            SIM_SCHED_BULK, SIM_SCHED_STATUS);
+    printf("  %-22s %10s %10s %10s %8s %8s\r\n", "", "ahead", "state ms", "bulk ms", "sent", "lost");
+
+    SIM_RunSched(&single, false);
+    SIM_SchedPrint("one FIFO", &single);
+    SIM_RunSched(&classes, true);
+    SIM_SchedPrint("classes", &classes);
+
+    printf("\r\n");
+    TXSCHED_Report();
+
+    return (classes.stateAhead != 0) + (single.sent != total) + (classes.sent != total) +
+            single.lost + classes.lost;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Main
+
+int main(void)
+{
+    SIM_COST txSingle = {0, 0}, rxSingle = {0, 0}, txBatch = {0, 0}, rxBatch = {0, 0};
+    uint32_t bad;
+    uint32_t checked;
+    uint32_t crcBad;
+    uint32_t filterBad;
+    uint32_t schedBad;
+
+    printf("MCP2518FD driver SPI cost, %u frames, %u per round, %u data bytes\r\n\r\n",
+            SIM_FRAMES, SIM_ROUND, SIM_PAYLOAD);
+    printf("  %-34s %8s %8s %10s %10s\r\n", "", "trans", "bytes", "trans/frm", "bytes/frm");
+
+    SIM_RunPerMessage(&txSingle, &rxSingle);
+    bad = framesBad;
+    checked = framesChecked;
+    SIM_CostPrint("TransmitChannelLoad", &txSingle);
+    SIM_CostPrint("ReceiveMessageGet", &rxSingle);
+
+    SIM_RunBatch(&txBatch, &rxBatch);
+    bad += framesBad;
+    checked += framesChecked;
+    SIM_CostPrint("TransmitChannelLoadBatch", &txBatch);
+    SIM_CostPrint("ReceiveMessageGetBatch", &rxBatch);
+
+    printf("\r\n  frames checked %u, bad %u, CRC errors %u\r\n", checked, bad, SIM_SpiStatsGet()->crcErrors);
+
+    crcBad = SIM_RunCrc();
+
+    filterBad = SIM_FilterCheck();
+
+    schedBad = SIM_SchedCheck();
+
+    return (bad == 0 && checked == 2 * SIM_FRAMES && crcBad == 0 && filterBad == 0 && schedBad == 0) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+/*******************************************************************************
+  MCP2518FD Simulator - HAL shim
+
+  File Name:
+    spi_shim.c
+
+  Summary:
+    HAL_SPI_TransmitReceive and HAL_GPIO_WritePin for host builds.
+
+  Description:
+    Tracks the CAN chip select and hands every transaction made while it is
+    low to the simulator. A transfer with CS high fails, which catches a driver
+    that forgets to select the device.
+ *******************************************************************************/
+
+#include <stdbool.h>
+#include "sim_hal.h"
+#include "mcp2518fd_sim.h"
+
+SPI_HandleTypeDef hspi1;
+GPIO_TypeDef simGpioD;
+
+static bool csLow = false;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (GPIOx == CAN_CS_GPIO_Port && (GPIO_Pin & CAN_CS_Pin)) {
+        csLow = (PinState == GPIO_PIN_RESET);
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData,
+        uint8_t *pRxData, uint16_t Size, uint32_t Timeout)
+{
+    (void) Timeout;
+
+    if (hspi != &hspi1 || !csLow) {
+        return HAL_ERROR;
+    }
+
+    SIM_SpiTransfer(pTxData, pRxData, Size);
+
+    return HAL_OK;
+}
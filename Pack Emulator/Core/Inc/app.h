@@ -29,8 +29,6 @@
 //! Use RX and TX Interrupt pins to check FIFO status
 #define APP_USE_RX_INT
 
-#define MAX_TXQUEUE_ATTEMPTS 50
-
 
 // Switches
 #define APP_SWITCH_RELEASED true  //Switch has an internal pullup when not pressed - input = 1
@@ -80,12 +78,53 @@
 //#define TST1_OUT	EXT1_PIN_5
 
 
-// Transmit Channels
-#define APP_TX_FIFO CAN_FIFO_CH2
+// Transmit Channels, one per traffic class of the TX scheduler (tx_sched.h).
+// Sizes are depth - 1, TxPriority decides which FIFO goes on the bus first
+#define APP_TXQ_SIZE 3                      // safety and state, TXQ, priority 2
+#define APP_TX_FIFO CAN_FIFO_CH2            // periodic telemetry, priority 1
+#define APP_TX_FIFO_SIZE 7
+#define APP_TX_BULK_FIFO CAN_FIFO_CH4       // bulk diagnostics, priority 0
+#define APP_TX_BULK_FIFO_SIZE 7
+
+// Bulk frames per second and back to back burst, so cell detail and hardware
+// replies leave bus time for other nodes
+#define APP_TX_BULK_RATE 200
+#define APP_TX_BULK_BURST 8
+
+// ms a frame may wait in the scheduler before it is stale and discarded
+#define APP_TX_STATE_DEADLINE 50
+#define APP_TX_TELEMETRY_DEADLINE 200
+#define APP_TX_BULK_DEADLINE 1000
 
 // Receive Channels
 #define APP_RX_FIFO CAN_FIFO_CH1
 
+// High priority receive channel, read before APP_RX_FIFO so urgent commands
+// do not queue behind bulk traffic. Classic frames only, depth - 1
+#define APP_RX_HP_FIFO CAN_FIFO_CH3
+#define APP_RX_HP_FIFO_SIZE 3
+
+// Messages read from the RX FIFO per SPI burst
+#define APP_RX_BATCH_SIZE 4
+
+// Time base counter prescaler, 40 MHz SYSCLK / (39 + 1) = 1 us receive time stamps
+#define APP_TBC_PRESCALER 39
+
+// Transmit Event FIFO depth - 1, holds the frames sent between two drains
+#define APP_TEF_FIFO_SIZE 31
+
+// Interval between TEF drains in the idle state
+#define APP_TEF_DRAIN_MS 10
+
+// Cell model (cell_model.h): cell figures follow a drive cycle while a module is on.
+// One module is stepped per idle pass, each every APP_CELL_MODEL_MS
+#define APP_CELL_MODEL
+#define APP_CELL_MODEL_MS 1000
+#define APP_CELL_AMBIENT 25.0f          // degrees C
+
+// Frames a class may collect during a receive burst before they are loaded
+#define APP_TX_BATCH_SIZE 8
+
 // Switch states
 
 typedef struct {
@@ -191,6 +230,12 @@ void APP_CANFDSPI_Init(void);
 //! Add message to transmit FIFO
 void APP_TransmitMessageQueue(void);
 
+//! Queue transmit messages until APP_TransmitBurstEnd
+void APP_TransmitBurstBegin(void);
+
+//! Load queued transmit messages
+void APP_TransmitBurstEnd(void);
+
 //! Decode received messages
 APP_STATES APP_ReceiveMessage_Tasks(void);
 
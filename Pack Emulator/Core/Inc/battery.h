@@ -8,10 +8,26 @@
 #ifndef INC_BATTERY_H_
 #define INC_BATTERY_H_
 
-#include "main.h"
-
+#include <stdint.h>
+#include <stdbool.h>
+
+// Scaling mode: define SCALE_MODULES to emulate that many generated modules (up to 254)
+// instead of the two set up in APP_Initialize, to load the pack controllers' registration
+// and polling. Cells per module are cut so the modules fit in RAM.
+//#define SCALE_MODULES          128
+
+#ifdef SCALE_MODULES
+#if SCALE_MODULES > 254
+#error "SCALE_MODULES is at most 254, module IDs and indexes are uint8_t and 255 is MODTABLE_NONE"
+#endif
+#define MAX_CELLS_PER_MODULE   16
+#define MAX_MODULES_PER_PACK   SCALE_MODULES
+#define MODULE_ANNOUNCE_MS     10        // interval between announcements of unregistered modules
+#else
 #define MAX_CELLS_PER_MODULE   256
 #define MAX_MODULES_PER_PACK   32
+#define MODULE_ANNOUNCE_MS     1000
+#endif
 
 #define MODULE_VOLTAGE_FACTOR     0.015     // Volts
 
@@ -24,10 +40,10 @@ typedef enum {
 
 
 typedef struct {
-  uint16_t    voltage;    // cell 10 bit temperature
-  uint16_t    temp;       // cell 12 bit temperature
-  uint8_t     soc;				// cell 8 bit soc
-  uint8_t     soh;        // cell 8 bit soh
+  uint16_t    voltage;    // cell voltage, CELL_VOLTAGE_FACTOR
+  uint16_t    temp;       // cell temperature, TEMPERATURE_FACTOR and _BASE
+  uint8_t     soc;				// cell soc, PERCENTAGE_FACTOR
+  uint8_t     soh;        // cell soh, PERCENTAGE_FACTOR
 }batteryCell;
 
 
@@ -36,6 +52,7 @@ typedef struct {
   uint8_t     partId;  		// module part ID
   uint32_t    uniqueId;		// module unique Id
   uint8_t     moduleId;		// module Id
+  uint8_t     controllerId; // controller the module is registered with
   uint16_t    fwVersion;
   uint16_t    hwVersion;
   uint16_t    maxChargeA;
@@ -61,10 +78,11 @@ typedef struct {
 }batteryModule;
 
 
-batteryModule module[MAX_MODULES_PER_PACK];
-uint8_t       moduleCount;
+// Defined in app.c
+extern batteryModule module[MAX_MODULES_PER_PACK];
+extern uint8_t       moduleCount;
 
-uint16_t      busVoltage;
+extern uint16_t      busVoltage;
 
 
 
@@ -0,0 +1,81 @@
+/*******************************************************************************
+  CAN Filter Builder
+
+  File Name:
+    can_filter.h
+
+  Summary:
+    Derives MCP2518FD acceptance filter/mask pairs from the IDs a node handles.
+
+  Description:
+    The application lists the IDs it has a case for and the RX FIFO each one
+    goes to. CANFILTER_Build merges them into as few filter/mask pairs as
+    possible without accepting any ID that is not listed; only if that still
+    needs more filters than allowed are pairs merged that also let some
+    unlisted IDs through, picking the merges that keep the most mask bits.
+    Rules for different FIFOs are never merged and are ordered by the order
+    of their FIFOs' first appearance in the list, so list high priority IDs
+    first: the controller stores a frame that matches several filters in
+    the FIFO of the lowest numbered one.
+
+    CANFILTER_Apply writes the rules to the controller, which must be in
+    Configuration mode.
+ *******************************************************************************/
+
+#ifndef _CAN_FILTER_H
+#define _CAN_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "canfdspi_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+//! Frame formats an ID is accepted in
+typedef enum {
+    CANFILTER_STANDARD,
+    CANFILTER_EXTENDED,     // EID is not checked, it carries the module ID
+    CANFILTER_ANY
+} CANFILTER_FORMAT;
+
+//! One ID the node handles
+typedef struct {
+    uint16_t sid;
+    CANFILTER_FORMAT format;
+    CAN_FIFO_CHANNEL fifo;
+} CANFILTER_ID;
+
+//! One filter/mask pair, in CiFLTOBJ/CiMASK bit layout
+typedef struct {
+    uint32_t value;
+    uint32_t mask;
+    CAN_FIFO_CHANNEL fifo;
+} CANFILTER_RULE;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Build at most maxRules rules accepting every listed ID
+//! Returns the number of rules, or -1 if the IDs cannot fit in maxRules
+int8_t CANFILTER_Build(const CANFILTER_ID *ids, uint8_t nIds,
+        CANFILTER_RULE *rules, uint8_t maxRules);
+
+//! Program the rules into filters 0.. and disable the remaining filters
+int8_t CANFILTER_Apply(CANFDSPI_MODULE_ID index, const CANFILTER_RULE *rules, uint8_t nRules);
+
+//! True if a frame with this SID/IDE passes the rules (host checks and tests)
+bool CANFILTER_Accepts(const CANFILTER_RULE *rules, uint8_t nRules,
+        uint16_t sid, uint32_t eid, bool ide, CAN_FIFO_CHANNEL *fifo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CAN_FILTER_H
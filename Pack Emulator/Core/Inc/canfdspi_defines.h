@@ -287,6 +287,22 @@ typedef struct _CAN_TEF_CONFIG {
     uint32_t FifoSize : 5;
 } CAN_TEF_CONFIG;
 
+//! CAN FIFO Geometry
+/*!
+ * Kept by the driver when a FIFO is configured, so message objects can be
+ * addressed in RAM without re-reading CiFIFOCON/CiFIFOUA on every access.
+ */
+
+typedef struct _CAN_FIFO_GEOMETRY {
+    uint16_t RamAddress;    // Address of message object 0, 0 until learned
+    uint8_t ObjectSize;     // Bytes per message object
+    uint8_t Depth;          // Number of message objects
+    uint8_t Index;          // Next object the host reads (RX) or writes (TX)
+    uint8_t Free;           // TX: slots known to be free
+    bool TxEnable;
+    bool TimeStampEnable;
+} CAN_FIFO_GEOMETRY;
+
 /* CAN Message Objects */
 
 //! CAN Message Object ID
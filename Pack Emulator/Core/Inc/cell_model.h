@@ -0,0 +1,95 @@
+/*******************************************************************************
+  Cell Model
+
+  File Name:
+    cell_model.h
+
+  Summary:
+    Equivalent circuit model of the cells of an emulated module.
+
+  Description:
+    Each cell is an OCV-SOC curve, a series resistance R0, one RC pair and a
+    thermal node to ambient. CELLMODEL_Step advances a module by dt under a
+    current and writes voltage, temperature, SOC and SOH of every cell and
+    the module figures derived from them (voltHi/Lo/Avg, tempHi/Lo/Avg, mmv,
+    mmc, soc, soh) in the encodings of the CAN frames.
+
+    The cells of a module are in series and carry the same current, and all
+    cells share the RC and thermal time constants. The dynamic states are
+    therefore kept once per module, and a cell only differs by its
+    capacity, resistance, initial SOC and SOH. These spreads are derived
+    from the module unique ID and the cell number, so no memory is needed
+    per cell and a step is one straight loop over the cells. That keeps
+    32 modules of 256 cells in real time on the F4, and lets host tools
+    include this file to generate test data much faster than real time.
+
+    Everything is float, the F4 has a single precision FPU.
+ *******************************************************************************/
+
+#ifndef _CELL_MODEL_H
+#define _CELL_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "battery.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Nominal cell
+#define CELLMODEL_CAPACITY_AH   50.0f       // at SOH 100%
+#define CELLMODEL_R0            0.0010f     // ohm, series
+#define CELLMODEL_R1            0.0006f     // ohm, RC pair
+#define CELLMODEL_TAU_RC        30.0f       // s, RC pair time constant
+#define CELLMODEL_HEAT_CAPACITY 1000.0f     // J/K, cell to its thermal node
+#define CELLMODEL_HEAT_LOSS     0.5f        // W/K, thermal node to ambient
+
+// Spread between cells, +- of nominal
+#define CELLMODEL_CAPACITY_SPREAD   0.03f   // fraction
+#define CELLMODEL_RESISTANCE_SPREAD 0.10f   // fraction
+#define CELLMODEL_SOC_SPREAD        0.02f   // SOC, 0-1
+#define CELLMODEL_SOH_SPREAD        0.02f   // SOH, 0-1
+
+// SOH lost per full equivalent cycle (2 capacities of throughput)
+#define CELLMODEL_FADE_PER_CYCLE    0.0002f
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+//! Dynamic state of one module, shared by its cells
+typedef struct {
+    float charge;           // Ah into the module since CELLMODEL_Init, discharge negative
+    float throughput;       // Ah moved either way, drives the SOH fade
+    float current;          // A of the last step, charge positive
+    float rcCurrent;        // A through R1 of the RC pair
+    float heat;             // A^2, current squared filtered by the thermal time constant
+    float ambient;          // degrees C
+    float soc;              // module SOC at CELLMODEL_Init, 0-1
+    float soh;              // module SOH at CELLMODEL_Init, 0-1
+    float profileTime;      // s into CELLMODEL_Profile
+} CELLMODEL_STATE;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Start a module at rest from its soc and soh, profileOffset in s sets where it starts the profile
+void CELLMODEL_Init(CELLMODEL_STATE *state, const batteryModule *m, float ambient, float profileOffset);
+
+//! Advance the module by dt s at current A (charge positive) and update module m
+void CELLMODEL_Step(CELLMODEL_STATE *state, batteryModule *m, float current, float dt);
+
+//! Current of the built in drive cycle at the module's profile time, then advance it by dt s
+float CELLMODEL_Profile(CELLMODEL_STATE *state, float dt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _CELL_MODEL_H
@@ -0,0 +1,119 @@
+/*******************************************************************************
+  Serial Log - event table
+
+  File Name:
+    log_events.h
+
+  Summary:
+    Log record IDs and the format each one expands to.
+
+  Description:
+    Shared by the Pack and VCU Emulators and by the host Log Decoder, so IDs
+    and formats cannot drift apart. Every argument is one 32 bit word: %d and
+    %i print it signed, %u %x %X %c unsigned, %f reads the word as a float
+    (pass it through LOG_F) and %s prints the LOG_RAW_NAME it holds. Text
+    records (LOG_ID_TEXT) carry the string itself. Common IDs are 0x00-0x0F,
+    Pack IDs 0x10-0x3F, VCU IDs 0x40-0x7F. Never renumber an ID, add new
+    ones at the end of their range.
+ *******************************************************************************/
+
+#ifndef _LOG_EVENTS_H
+#define _LOG_EVENTS_H
+
+#include <stdint.h>
+
+#define LOG_EVENT_TABLE(X) \
+    X(LOG_ID_TEXT,                  0x00, "%s") \
+    X(LOG_ID_RTC,                   0x01, "RTC %02u:%02u:%02u") \
+    X(LOG_ID_LOST,                  0x02, "LOG %u records lost") \
+    X(LOG_ID_RX_STATS,              0x03, "RX STATS %03x:%05x N=%u MIN=%uus AVG=%uus MAX=%uus SD=%uus") \
+    X(LOG_ID_RX_STATS_UNTRACKED,    0x04, "RX STATS %u frames not tracked, more than %u IDs") \
+    X(LOG_ID_TX_STATS,              0x05, "TX STATS LOADED=%u SENT=%u DROPPED=%u RETRIES=%u TEFOVF=%u LATENCY MIN=%uus AVG=%uus MAX=%uus") \
+    X(LOG_ID_TX_SCHED,              0x06, "TX SCHED CLASS %u QUEUED=%u LOADED=%u EXPIRED=%u OVERFLOW=%u WAIT MAX=%ums DEPTH MAX=%u PENDING=%u") \
+    \
+    X(LOG_ID_PACK_TX_FIFO_FULL,     0x10, "TX ERROR - FIFO Full! Check CAN Connection.") \
+    X(LOG_ID_PACK_TX_ANNOUNCE,      0x11, "TX 0x500 Announcement: FW=%02x, MFG=%02x, PN=%02x, ID=%08x") \
+    X(LOG_ID_PACK_TX_HARDWARE,      0x12, "TX 0x501 Hardware: ID=%02x, CHA=%d, DCA=%d, CHV=%d, HW=%d") \
+    X(LOG_ID_PACK_TX_STATUS1,       0x13, "TX 0x502 Status1: ID=%02x STE=%02x STS=%d CNT=%d MMV=%d MMC=%d SOC=%d, SOH=%d") \
+    X(LOG_ID_PACK_TX_STATUS2,       0x14, "TX 0x503 Status2: ID=%02x HIV=%d LOV=%d AVG=%d") \
+    X(LOG_ID_PACK_TX_STATUS3,       0x15, "TX 0x504 Status3: ID=%02x HIT=%d LOT=%d AVG=%d") \
+    X(LOG_ID_PACK_TX_CELL_DETAIL,   0x16, "TX 0x505 Cell Detail: CNT=%02x, CELL=%02x, SOC=%02x, TEMP=%03x, Voltage=%03x") \
+    X(LOG_ID_PACK_TX_TIME_REQUEST,  0x17, "TX 0x506 Time Request") \
+    X(LOG_ID_PACK_RX_REGISTRATION,  0x18, "RX 0x510 Registration: ID=%02x, CTL=%02x, MFG=%02x, PN=%02x, UID=%08x") \
+    X(LOG_ID_PACK_RX_HW_REQUEST,    0x19, "RX 0x511 Hardware Request ID=%02x") \
+    X(LOG_ID_PACK_RX_STATUS_REQUEST, 0x1A, "RX 0x512 Status Request ID=%02x") \
+    X(LOG_ID_PACK_RX_STATE_CHANGE,  0x1B, "RX 0x514 State Change Request ID=%02x STATE=%02x HV=%.2fV") \
+    X(LOG_ID_PACK_RX_DETAIL_REQUEST, 0x1C, "RX 0x515 Request detail: ID=%02x, CELL=%02x") \
+    X(LOG_ID_PACK_RX_SET_TIME,      0x1D, "RX 0x516 Set Time") \
+    X(LOG_ID_PACK_RX_DEREGISTER_ALL, 0x1E, "RX 0x51E De-Register all modules") \
+    X(LOG_ID_PACK_RX_ISOLATE_ALL,   0x1F, "RX 0x51F Isolate all modules") \
+    X(LOG_ID_PACK_TX_CELL_DETAIL_V, 0x20, "TX 0x503 Cell Detail:  CNT=%02x, CELL=%02x, SOH=%02x SOC=%02x, TEMP=%03x, Voltage=%03x") \
+    X(LOG_ID_PACK_MODULE_ID_MOVED,  0x21, "Module ID %02x moved from UID=%08x to UID=%08x") \
+    X(LOG_ID_PACK_DETAIL_UNKNOWN,   0x22, "RX 0x515 Request detail: ID=%02x, CELL=%02x not found, no reply") \
+    \
+    X(LOG_ID_VCU_TX_FIFO_FULL,      0x40, "TX ERROR - FIFO Full! Check CAN Connection.") \
+    X(LOG_ID_VCU_RX_RAW,            0x41, "RX %s=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x") \
+    X(LOG_ID_VCU_RX_STATE,          0x42, "RX BMS_STATE   %03x : STE=%02x SOH=%.2f%% STS=%02x CBS=%d CBA=%d MOFF=%d, MCNT=%d, MACT=%d") \
+    X(LOG_ID_VCU_RX_DATA_1,         0x43, "RX BMS_DATA_1  %03x : VOLT=%.2fV AMPS=%.2fA") \
+    X(LOG_ID_VCU_RX_DATA_2,         0x44, "RX BMS_DATA_2  %03x : HICV=%.2fV LOCV=%.2fV AVCV=%.2fV SOC=%.2f%%") \
+    X(LOG_ID_VCU_RX_DATA_3,         0x45, "RX BMS_DATA_3  %03x : HICT=%.2fC LOCT=%.2fC AVCT=%.2fC") \
+    X(LOG_ID_VCU_RX_DATA_5,         0x46, "RX BMS_DATA_5  %03x : CLIM=%.2fA DLIM=%.2fA VLIM=%.2fV") \
+    X(LOG_ID_VCU_RX_DATA_8,         0x47, "RX BMS_DATA_8  %03x : HIVM=%d LOVM=%d HIVC=%d LOVC=%d") \
+    X(LOG_ID_VCU_RX_DATA_9,         0x48, "RX BMS_DATA_9  %03x : HITM=%d LOTM=%d HITC=%d LOTC=%d") \
+    X(LOG_ID_VCU_RX_DATA_10,        0x49, "RX BMS_DATA_10 %03x : ISOL=%.2fOhms/V") \
+    X(LOG_ID_VCU_TX_COMMAND,        0x4A, "TX 0x400 Command: STATE=%02x HV=%.2fV") \
+    X(LOG_ID_VCU_TX_SET_TIME,       0x4B, "TX 0x401 Set Time") \
+    X(LOG_ID_VCU_TX_MODULE_COMMAND, 0x4C, "TX 0x404 Module Command: ID=%02x STATE=%02x") \
+    X(LOG_ID_VCU_TX_KEEP_ALIVE,     0x4D, "TX 0x405 Keep Alive: ID=%02x") \
+    X(LOG_ID_VCU_SCENARIO_LOADED,   0x4E, "SCENARIO loaded %u bytes") \
+    X(LOG_ID_VCU_SCENARIO_REJECTED, 0x4F, "SCENARIO rejected: ERROR=%d AT=%u") \
+    X(LOG_ID_VCU_SCENARIO_TIMEOUT,  0x50, "SCENARIO WAIT_BMS STATE=%u at %u timed out, BMS=%d, stopped") \
+    X(LOG_ID_VCU_SCENARIO_END,      0x51, "SCENARIO END at %u, holding STATE=%u") \
+    X(LOG_ID_VCU_SCENARIO_STATUS,   0x52, "SCENARIO RUN=%u PC=%u LEN=%u STATE=%u BMS=%d KEEPALIVE=%ums FRAMES=%u") \
+    X(LOG_ID_VCU_RX_TRACE,          0x53, "RX TRACE #%u %x T=%uus DLC=%u FL=%x DATA=%08x %08x")
+
+#define LOG_EVENT_ENUM(name, value, format) name = value,
+
+typedef enum {
+    LOG_EVENT_TABLE(LOG_EVENT_ENUM)
+} LOG_ID;
+
+// Names for LOG_ID_VCU_RX_RAW, passed as its first argument
+#define LOG_RAW_NAME_TABLE(X) \
+    X(LOG_RAW_BMS_DATA_1,       "BMS_DATA_1 SID") \
+    X(LOG_RAW_BMS_DATA_2,       "BMS_DATA_2 SID") \
+    X(LOG_RAW_BMS_DATA_3,       "BMS_DATA_3 SID") \
+    X(LOG_RAW_BMS_DATA_5,       "BMS_DATA_5 SID") \
+    X(LOG_RAW_BMS_DATA_8,       "BMS_DATA_8 SID") \
+    X(LOG_RAW_BMS_DATA_9,       "BMS_DATA_9 SID") \
+    X(LOG_RAW_BMS_DATA_10,      "BMS_DATA_10 SID") \
+    X(LOG_RAW_BMS_STATE,        "BMS_STATE SID") \
+    X(LOG_RAW_BMS_TIME_REQUEST, "BMS_TIME_REQUEST SID") \
+    X(LOG_RAW_UNKNOWN,          "UNKNOWN ID")
+
+#define LOG_RAW_NAME_ENUM(name, text) name,
+
+typedef enum {
+    LOG_RAW_NAME_TABLE(LOG_RAW_NAME_ENUM)
+    LOG_RAW_NAME_TOTAL
+} LOG_RAW_NAME;
+
+// Record on the wire, all fields little endian:
+//   0xA5, id, n, tick[4], payload[n], xor of id..payload
+#define LOG_RECORD_SYNC         0xA5
+#define LOG_RECORD_HEADER       7
+#define LOG_RECORD_OVERHEAD     8
+#define LOG_RECORD_MAX_ARGS     12
+
+// Formats a record payload, returns the length written (excluding the 0)
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int LOG_Format(char *out, int size, uint8_t id, const uint8_t *payload, uint8_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _LOG_EVENTS_H
@@ -56,6 +56,7 @@ void Error_Handler(void);
 /* USER CODE BEGIN EFP */
 void getTime(void);
 void serialOut(char* message);
+void serialCommand(void);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
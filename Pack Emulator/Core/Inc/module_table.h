@@ -0,0 +1,73 @@
+/*******************************************************************************
+  Module Table
+
+  File Name:
+    module_table.h
+
+  Summary:
+    Constant time lookup of emulated modules by unique ID and by module ID.
+
+  Description:
+    Registration frames name a module by manufacturer, part and unique ID,
+    every later request by the 8 bit module ID the pack controller gave it.
+    With many modules a scan of module[] per frame no longer keeps up with
+    the receive bursts, so the slots are indexed twice: an open addressing
+    hash on the unique ID, and a table of 256 slots indexed by module ID.
+
+    The table does not know batteryModule, it only maps keys to slot
+    numbers. Modules are added once at start up and never removed; module
+    IDs come and go with registration.
+ *******************************************************************************/
+
+#ifndef _MODULE_TABLE_H
+#define _MODULE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Hash entries as a power of two, at least twice the number of modules
+#ifndef MODTABLE_HASH_BITS
+#define MODTABLE_HASH_BITS  9
+#endif
+#define MODTABLE_HASH_SIZE  (1U << MODTABLE_HASH_BITS)
+
+// Returned by the lookups when there is no such module, also the highest
+// slot number plus one
+#define MODTABLE_NONE       0xFF
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Empty both indexes
+void MODTABLE_Init(void);
+
+//! Index a module slot by its identity
+//! Returns 0, -1 if the hash is full or slot is MODTABLE_NONE, -2 if the identity is already indexed
+int8_t MODTABLE_Add(uint8_t mfgId, uint8_t partId, uint32_t uniqueId, uint8_t slot);
+
+//! Slot of a module by identity, MODTABLE_NONE if unknown
+uint8_t MODTABLE_FindUnique(uint8_t mfgId, uint8_t partId, uint32_t uniqueId);
+
+//! Point a module ID at a slot, returns the slot that held the ID before or MODTABLE_NONE
+uint8_t MODTABLE_Register(uint8_t moduleId, uint8_t slot);
+
+//! Release a module ID
+void MODTABLE_Unregister(uint8_t moduleId);
+
+//! Slot a module ID is registered to, MODTABLE_NONE if none (module ID 0 never is)
+uint8_t MODTABLE_FindId(uint8_t moduleId);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _MODULE_TABLE_H
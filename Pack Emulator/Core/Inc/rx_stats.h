@@ -0,0 +1,57 @@
+/*******************************************************************************
+  RX Statistics
+
+  File Name:
+    rx_stats.h
+
+  Summary:
+    Inter-arrival statistics per CAN ID from MCP2518FD receive time stamps.
+
+  Description:
+    Every received message object carries the controller's time base counter
+    (CiTBC) latched at start of frame. RXSTATS_Update keeps, per CAN ID, the
+    count and the minimum, mean, maximum and standard deviation of the time
+    between frames, so bus and SPI latency on the emulator side do not show
+    up in the figures. Time stamps are in TBC ticks; APP_CANFDSPI_Init sets
+    the prescaler for 1 us ticks.
+
+    RXSTATS_Report logs one LOG_ID_RX_STATS record per ID. Call it from thread
+    mode, never from an interrupt handler.
+ *******************************************************************************/
+
+#ifndef _RX_STATS_H
+#define _RX_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "canfdspi_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// CAN IDs tracked, frames with further IDs are only counted
+#define RXSTATS_MAX_IDS     32
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Account one received message, call once per object read from the RX FIFO
+void RXSTATS_Update(const CAN_RX_MSGOBJ *rxObj);
+
+//! Log the statistics of every ID seen since the last reset
+void RXSTATS_Report(void);
+
+//! Forget all IDs and figures
+void RXSTATS_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RX_STATS_H
@@ -14,6 +14,13 @@
 #include "string.h"
 #include "stdio.h"
 #include "can_id_module.h"
+#include "serial_log.h"
+#include "rx_stats.h"
+#include "tx_stats.h"
+#include "can_filter.h"
+#include "tx_sched.h"
+#include "module_table.h"
+#include "cell_model.h"
 #include "../../../Pack-Controller-EEPROM/protocols/can_frm_mod.h"
 
 /***************************************************************************************************************
@@ -25,6 +32,11 @@
 
 APP_DATA appData;
 
+// Emulated modules, see battery.h
+batteryModule module[MAX_MODULES_PER_PACK];
+uint8_t       moduleCount;
+uint16_t      busVoltage;
+
 CAN_CONFIG config;
 CAN_OPERATION_MODE opMode;
 
@@ -33,6 +45,21 @@ CAN_TX_FIFO_CONFIG txConfig;
 CAN_TX_FIFO_EVENT txFlags;
 CAN_TX_MSGOBJ txObj;
 uint8_t txd[MAX_DATA_BYTES];
+CAN_TX_QUEUE_CONFIG txqConfig;
+bool txBurst = false;
+
+// Transmit scheduler classes, see APP_TransmitClass
+static const TXSCHED_CLASS_CONFIG txClasses[TXSCHED_CLASSES] = {
+    // FIFO             rate/s              burst               deadline ms
+    {CAN_TXQUEUE_CH0,   0,                  0,                  APP_TX_STATE_DEADLINE},
+    {APP_TX_FIFO,       0,                  0,                  APP_TX_TELEMETRY_DEADLINE},
+    {APP_TX_BULK_FIFO,  APP_TX_BULK_RATE,   APP_TX_BULK_BURST,  APP_TX_BULK_DEADLINE},
+};
+
+// Transmit event objects
+CAN_TEF_CONFIG tefConfig;
+CAN_TEF_MSGOBJ tefObj;
+uint32_t tefLastDrain = 0;
 
 // Receive objects
 CAN_RX_FIFO_CONFIG rxConfig;
@@ -41,6 +68,37 @@ REG_CiMASK mObj;
 CAN_RX_FIFO_EVENT rxFlags;
 CAN_RX_MSGOBJ rxObj;
 uint8_t rxd[MAX_DATA_BYTES];
+CAN_RX_MSGOBJ rxBatchObj[APP_RX_BATCH_SIZE];
+uint8_t rxBatchData[APP_RX_BATCH_SIZE][MAX_DATA_BYTES];
+uint8_t rxCount;
+
+// IDs with a case in APP_ReceiveMessage_Tasks, urgent ones first so their
+// filters take precedence. Requests carry the module ID in the EID, the
+// format is left open as the accept all mask did
+static const CANFILTER_ID rxFilterIds[] = {
+    {ID_MODULE_STATE_CHANGE,     CANFILTER_ANY, APP_RX_HP_FIFO},
+    {ID_MODULE_ALL_ISOLATE,      CANFILTER_ANY, APP_RX_HP_FIFO},
+    {ID_MODULE_REGISTRATION,     CANFILTER_ANY, APP_RX_FIFO},
+    {ID_MODULE_ALL_DEREGISTER,   CANFILTER_ANY, APP_RX_FIFO},
+    {ID_MODULE_DETAIL_REQUEST,   CANFILTER_ANY, APP_RX_FIFO},
+    {ID_MODULE_STATUS_REQUEST,   CANFILTER_ANY, APP_RX_FIFO},
+    {ID_MODULE_HARDWARE_REQUEST, CANFILTER_ANY, APP_RX_FIFO},
+    {ID_MODULE_TIME,             CANFILTER_ANY, APP_RX_FIFO},
+};
+CANFILTER_RULE rxFilters[CAN_FILTER_TOTAL];
+int8_t rxFilterCount;
+
+// Read in this order, see APP_RX_HP_FIFO
+static const CAN_FIFO_CHANNEL rxFifos[] = {APP_RX_HP_FIFO, APP_RX_FIFO};
+
+// Cell model state and last step per module
+CELLMODEL_STATE cellModel[MAX_MODULES_PER_PACK];
+uint32_t cellModelTick[MAX_MODULES_PER_PACK];
+uint8_t cellModelNext = 0;
+
+// Announcements, one unregistered module per MODULE_ANNOUNCE_MS
+uint32_t announceLast = 0;
+uint8_t announceNext = 0;
 
 uint32_t delayCount = APP_LED_TIME;
 
@@ -68,6 +126,11 @@ extern void serialOut(char* message);
 void APP_ProcessHardwareRequest(void);
 void APP_ProcessTime(void);
 void APP_RequestTime(void);
+void APP_TransmitService(void);
+TXSCHED_CLASS APP_TransmitClass(uint16_t sid);
+void APP_TefDrain(void);
+void APP_GenerateModules(void);
+void APP_CellModelTasks(void);
 
 /***************************************************************************************************************
 *
@@ -141,10 +204,14 @@ void APP_LED_Write(uint8_t led)
 void APP_Initialize(void)
 {
 
+  uint8_t index;
 
   //clear the batteryModule Array
   memset(module,0,sizeof(module));
 
+#ifdef SCALE_MODULES
+  APP_GenerateModules();
+#else
   //set up a couple of modules
   //module[0]
   module[0].mfgId           = 0xDC;
@@ -235,6 +302,21 @@ void APP_Initialize(void)
   module[1].cell[4].soc     = 91;
   module[1].cell[4].soh     = 100;
   moduleCount++;
+#endif
+
+  // Index the modules for registration and requests
+  MODTABLE_Init();
+  for(index = 0; index < moduleCount; index++){
+    MODTABLE_Add(module[index].mfgId, module[index].partId, module[index].uniqueId, index);
+  }
+
+#ifdef APP_CELL_MODEL
+  // Start every module at rest at its own point of the drive cycle, with its cell figures filled in
+  for(index = 0; index < moduleCount; index++){
+    CELLMODEL_Init(&cellModel[index], &module[index], APP_CELL_AMBIENT, index * 97.0f);
+    CELLMODEL_Step(&cellModel[index], &module[index], 0.0f, 0.0f);
+  }
+#endif
 
 
   serialOut("");
@@ -263,6 +345,53 @@ void APP_Initialize(void)
 
 }
 
+/***************************************************************************************************************
+*     A P P _ G e n e r a t e M o d u l e s                                            P A C K   E M U L A T O R
+***************************************************************************************************************/
+#ifdef SCALE_MODULES
+void APP_GenerateModules(void){
+
+  uint8_t index;
+  uint8_t cell;
+  batteryModule *m;
+
+  // MAX_MODULES_PER_PACK modules with serial unique IDs and a spread of readings
+  for(index = 0; index < MAX_MODULES_PER_PACK; index++){
+    m = &module[index];
+
+    m->mfgId           = 0xDC;
+    m->partId          = 0x01;
+    m->uniqueId        = 0xBA771000 + index;
+    m->mmv             = (uint16_t)( (390 + index % 10) /MODULE_VOLTAGE_FACTOR);
+    m->mmc             = (uint16_t)( (5 + index % 5) /MODULE_CURRENT_FACTOR - (MODULE_CURRENT_BASE/MODULE_CURRENT_FACTOR));
+    m->state           = moduleOff;
+    m->fwVersion       = 8200;
+    m->hwVersion       = 1000;
+    m->maxChargeA      = (uint16_t)( ( 20/MODULE_CURRENT_FACTOR) - (MODULE_CURRENT_BASE/MODULE_CURRENT_FACTOR));
+    m->maxDischargeA   = (uint16_t)( (-50/MODULE_CURRENT_FACTOR) - (MODULE_CURRENT_BASE/MODULE_CURRENT_FACTOR));
+    m->maxChargeEndV   = (uint16_t)( 400  /MODULE_VOLTAGE_FACTOR);
+    m->voltHi          = (uint16_t)( (3.6 + (index % 10) * 0.01) /CELL_VOLTAGE_FACTOR);
+    m->voltLo          = (uint16_t)( (3.4 + (index % 10) * 0.01) /CELL_VOLTAGE_FACTOR);
+    m->voltAvg         = (uint16_t)( (3.5 + (index % 10) * 0.01) /CELL_VOLTAGE_FACTOR);
+    m->tempHi          = (uint16_t)( (45 + index % 8) /TEMPERATURE_FACTOR - (TEMPERATURE_BASE/TEMPERATURE_FACTOR));
+    m->tempLo          = (uint16_t)( (42 + index % 8) /TEMPERATURE_FACTOR - (TEMPERATURE_BASE/TEMPERATURE_FACTOR));
+    m->tempAvg         = (uint16_t)( (43 + index % 8) /TEMPERATURE_FACTOR - (TEMPERATURE_BASE/TEMPERATURE_FACTOR));
+    m->soc             = (uint8_t) ( (80 + index % 20) /PERCENTAGE_FACTOR);
+    m->soh             = (uint8_t) ( (90 + index % 10) /PERCENTAGE_FACTOR);
+    m->cellCount       = MAX_CELLS_PER_MODULE;
+
+    // Cell voltages spread evenly from voltLo to voltHi, so they agree with the module figures
+    for(cell = 0; cell < m->cellCount; cell++){
+      m->cell[cell].voltage = m->voltLo + (uint16_t)((uint32_t)(m->voltHi - m->voltLo) * cell / (m->cellCount - 1));
+      m->cell[cell].temp    = 45 + (index + cell) % 8;
+      m->cell[cell].soc     = 80 + index % 20;
+      m->cell[cell].soh     = 90 + (index + cell) % 10;
+    }
+    moduleCount++;
+  }
+}
+#endif
+
 /***************************************************************************************************************
 *     A P P _ T a s k s                                                                P A C K   E M U L A T O R
 ***************************************************************************************************************/
@@ -290,11 +419,29 @@ void APP_Tasks(void)
            // Check for unregistered modules and send announcements
           APP_AnnounceUnregisteredModules();
 
+          // One time request covers every module, APP_ProcessTime sets them all
           for(index = 0; index < moduleCount; index++){
             if(module[index].rtcValid == false && module[index].timeRequested == false){
-               APP_RequestTime();
-               module[index].timeRequested = true;
-             }
+              break;
+            }
+          }
+          if(index < moduleCount){
+            APP_RequestTime();
+            for(index = 0; index < moduleCount; index++){
+              module[index].timeRequested = true;
+            }
+          }
+
+#ifdef APP_CELL_MODEL
+          APP_CellModelTasks();
+#endif
+
+          // Load frames that were waiting for FIFO space or their rate limit
+          APP_TransmitService();
+
+          // Collect transmit completions
+          if (HAL_GetTick() - tefLastDrain >= APP_TEF_DRAIN_MS) {
+            APP_TefDrain();
           }
           break;
         }
@@ -355,57 +502,105 @@ void APP_CANFDSPI_Init(void)
     // Configure device
     DRV_CANFDSPI_ConfigureObjectReset(&config);
     config.IsoCrcEnable = 1;
-    config.StoreInTEF = 0;
+    config.StoreInTEF = 1;
+    config.TXQEnable = 1;
 
     DRV_CANFDSPI_Configure(DRV_CANFDSPI_INDEX_0, &config);
 
-    // Setup TX FIFO
+    // Setup TXQ, safety and state frames
+    DRV_CANFDSPI_TransmitQueueConfigureObjectReset(&txqConfig);
+    txqConfig.FifoSize = APP_TXQ_SIZE;
+    txqConfig.PayLoadSize = CAN_PLSIZE_8;
+    txqConfig.TxPriority = 2;
+
+    DRV_CANFDSPI_TransmitQueueConfigure(DRV_CANFDSPI_INDEX_0, &txqConfig);
+
+    // Setup TX FIFO, periodic telemetry
     DRV_CANFDSPI_TransmitChannelConfigureObjectReset(&txConfig);
-    txConfig.FifoSize = 7;
-    txConfig.PayLoadSize = CAN_PLSIZE_64;
+    txConfig.FifoSize = APP_TX_FIFO_SIZE;
+    txConfig.PayLoadSize = CAN_PLSIZE_8;
     txConfig.TxPriority = 1;
 
     DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, &txConfig);
 
+    // Setup bulk TX FIFO, diagnostics
+    DRV_CANFDSPI_TransmitChannelConfigureObjectReset(&txConfig);
+    txConfig.FifoSize = APP_TX_BULK_FIFO_SIZE;
+    txConfig.PayLoadSize = CAN_PLSIZE_8;
+    txConfig.TxPriority = 0;
+
+    DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_TX_BULK_FIFO, &txConfig);
+
+    // Setup TEF, transmitted frames come back with SEQ and time stamp
+    DRV_CANFDSPI_TefConfigureObjectReset(&tefConfig);
+    tefConfig.FifoSize = APP_TEF_FIFO_SIZE;
+    tefConfig.TimeStampEnable = 1;
+
+    DRV_CANFDSPI_TefConfigure(DRV_CANFDSPI_INDEX_0, &tefConfig);
+
     // Setup RX FIFO
     DRV_CANFDSPI_ReceiveChannelConfigureObjectReset(&rxConfig);
     rxConfig.FifoSize = 15;
     rxConfig.PayLoadSize = CAN_PLSIZE_64;
+    rxConfig.RxTimeStampEnable = 1;
 
     DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxConfig);
 
-    // Setup RX Filter
-    fObj.word = 0;
-    //fObj.bF.SID = 0xda;
-    fObj.bF.SID = 0x00;
-    fObj.bF.EXIDE = 0;
-    fObj.bF.EID = 0x00;
-
-    DRV_CANFDSPI_FilterObjectConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &fObj.bF);
-
-    // Setup RX Mask
-    mObj.word = 0;
-    mObj.bF.MSID = 0x0;
-    mObj.bF.MIDE = 0; // Both standard and extended frames accepted
-    mObj.bF.MEID = 0x0;
-    DRV_CANFDSPI_FilterMaskConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &mObj.bF);
-
-    // Link FIFO and Filter
-    DRV_CANFDSPI_FilterToFifoLink(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, APP_RX_FIFO, true);
+    // Setup high priority RX FIFO
+    DRV_CANFDSPI_ReceiveChannelConfigureObjectReset(&rxConfig);
+    rxConfig.FifoSize = APP_RX_HP_FIFO_SIZE;
+    rxConfig.PayLoadSize = CAN_PLSIZE_8;
+    rxConfig.RxTimeStampEnable = 1;
+
+    DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_RX_HP_FIFO, &rxConfig);
+
+    // Setup RX Filters, only the IDs handled in APP_ReceiveMessage_Tasks are read over SPI
+    rxFilterCount = CANFILTER_Build(rxFilterIds, sizeof(rxFilterIds) / sizeof(rxFilterIds[0]), rxFilters, CAN_FILTER_TOTAL);
+    if (rxFilterCount > 0) {
+      CANFILTER_Apply(DRV_CANFDSPI_INDEX_0, rxFilters, rxFilterCount);
+    } else {
+      // Accept all into APP_RX_FIFO as before
+      fObj.word = 0;
+      //fObj.bF.SID = 0xda;
+      fObj.bF.SID = 0x00;
+      fObj.bF.EXIDE = 0;
+      fObj.bF.EID = 0x00;
+
+      DRV_CANFDSPI_FilterObjectConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &fObj.bF);
+
+      // Setup RX Mask
+      mObj.word = 0;
+      mObj.bF.MSID = 0x0;
+      mObj.bF.MIDE = 0; // Both standard and extended frames accepted
+      mObj.bF.MEID = 0x0;
+      DRV_CANFDSPI_FilterMaskConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &mObj.bF);
+
+      // Link FIFO and Filter
+      DRV_CANFDSPI_FilterToFifoLink(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, APP_RX_FIFO, true);
+    }
 
     // Setup Bit Time
     DRV_CANFDSPI_BitTimeConfigure(DRV_CANFDSPI_INDEX_0, CAN_500K_2M, CAN_SSP_MODE_AUTO, CAN_SYSCLK_40M);
 
+    // Setup Time Base, received messages are stamped at start of frame
+    DRV_CANFDSPI_TimeStampPrescalerSet(DRV_CANFDSPI_INDEX_0, APP_TBC_PRESCALER);
+    DRV_CANFDSPI_TimeStampModeConfigure(DRV_CANFDSPI_INDEX_0, CAN_TS_SOF);
+    DRV_CANFDSPI_TimeStampEnable(DRV_CANFDSPI_INDEX_0);
+
     // Setup Transmit and Receive Interrupts
     DRV_CANFDSPI_GpioModeConfigure(DRV_CANFDSPI_INDEX_0, GPIO_MODE_INT, GPIO_MODE_INT);
 	#ifdef APP_USE_TX_INT
     DRV_CANFDSPI_TransmitChannelEventEnable(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, CAN_TX_FIFO_NOT_FULL_EVENT);
 	#endif
     DRV_CANFDSPI_ReceiveChannelEventEnable(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, CAN_RX_FIFO_NOT_EMPTY_EVENT);
+    DRV_CANFDSPI_ReceiveChannelEventEnable(DRV_CANFDSPI_INDEX_0, APP_RX_HP_FIFO, CAN_RX_FIFO_NOT_EMPTY_EVENT);
     DRV_CANFDSPI_ModuleEventEnable(DRV_CANFDSPI_INDEX_0, CAN_TX_EVENT | CAN_RX_EVENT);
 
     // Select Normal Mode
     DRV_CANFDSPI_OperationModeSelect(DRV_CANFDSPI_INDEX_0, CAN_NORMAL_MODE);
+
+    // Empty transmit queues
+    TXSCHED_Init(txClasses);
 }
 
 /***************************************************************************************************************
@@ -417,46 +612,53 @@ APP_STATES APP_ReceiveMessage_Tasks(void)
     // CANFRM_REGISTER registration;
     //uint8_t index;
 
-    // Check if FIFO is not empty
-    DRV_CANFDSPI_ReceiveChannelEventGet(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxFlags);
-
-    while ( rxFlags & CAN_RX_FIFO_NOT_EMPTY_EVENT){
-
-      // Get message
-      DRV_CANFDSPI_ReceiveMessageGet(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxObj, rxd, MAX_DATA_BYTES);
-
-      switch (rxObj.bF.id.SID) {
-        case ID_MODULE_REGISTRATION:
-          APP_RegisterModule();
-          break;
-        case ID_MODULE_ALL_DEREGISTER   :
-          APP_DeRegisterAllModules();
-          break;
-        case ID_MODULE_ALL_ISOLATE      :
-          APP_IsolateAllModules();
-          break;
-        case ID_MODULE_DETAIL_REQUEST   :
-          APP_ReplyToCellDetailRequest();
-          break;
-        case ID_MODULE_STATUS_REQUEST   :
-          APP_ReplyToStatusRequest();
-          break;
-        case ID_MODULE_HARDWARE_REQUEST:
-          APP_ProcessHardwareRequest();
-          break;
-        case ID_MODULE_STATE_CHANGE   :
-          APP_StateChange();
-          break;
-        case ID_MODULE_TIME :
-          APP_ProcessTime();
-        default:
-          break;
-      }
-
-      // check for any more messages
-      DRV_CANFDSPI_ReceiveChannelEventGet(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxFlags);
+    // Replies to a batch of requests are loaded together
+    APP_TransmitBurstBegin();
+
+    // High priority FIFO first, then up to a batch of messages at a time,
+    // a full batch means there may be more
+    for (uint8_t f = 0; f < sizeof(rxFifos) / sizeof(rxFifos[0]); f++) {
+      do {
+        DRV_CANFDSPI_ReceiveMessageGetBatch(DRV_CANFDSPI_INDEX_0, rxFifos[f], rxBatchObj, rxBatchData[0], MAX_DATA_BYTES, APP_RX_BATCH_SIZE, &rxCount);
+
+        for (uint8_t n = 0; n < rxCount; n++) {
+          rxObj = rxBatchObj[n];
+          memcpy(rxd, rxBatchData[n], MAX_DATA_BYTES);
+          RXSTATS_Update(&rxObj);
+
+          switch (rxObj.bF.id.SID) {
+            case ID_MODULE_REGISTRATION:
+              APP_RegisterModule();
+              break;
+            case ID_MODULE_ALL_DEREGISTER   :
+              APP_DeRegisterAllModules();
+              break;
+            case ID_MODULE_ALL_ISOLATE      :
+              APP_IsolateAllModules();
+              break;
+            case ID_MODULE_DETAIL_REQUEST   :
+              APP_ReplyToCellDetailRequest();
+              break;
+            case ID_MODULE_STATUS_REQUEST   :
+              APP_ReplyToStatusRequest();
+              break;
+            case ID_MODULE_HARDWARE_REQUEST:
+              APP_ProcessHardwareRequest();
+              break;
+            case ID_MODULE_STATE_CHANGE   :
+              APP_StateChange();
+              break;
+            case ID_MODULE_TIME :
+              APP_ProcessTime();
+            default:
+              break;
+          }
+        }
+      } while (rxCount == APP_RX_BATCH_SIZE);
     }
 
+    APP_TransmitBurstEnd();
+
     //    APP_LED_Clear(APP_RX_LED);
 
     nextState = APP_STATE_IDLE;
@@ -470,35 +672,92 @@ APP_STATES APP_ReceiveMessage_Tasks(void)
 ***************************************************************************************************************/
 void APP_TransmitMessageQueue(void)
 {
+  TXSCHED_CLASS txClass = APP_TransmitClass(txObj.bF.id.SID);
+
+  // Queue the frame built in txObj/txd, a full queue means the bus is not taking frames
+  if (TXSCHED_Queue(txClass, &txObj, txd, HAL_GetTick()) == -1) {
+    LOG_EVENT0(LOG_ID_PACK_TX_FIFO_FULL);
+  }
+
+  // Outside a burst, or with a batch collected, load now
+  if (!txBurst || TXSCHED_Pending(txClass) >= APP_TX_BATCH_SIZE) {
+    APP_TransmitService();
+  }
+}
+
+/***************************************************************************************************************
+*     A P P _ T r a n s m i t C l a s s                                                P A C K   E M U L A T O R
+***************************************************************************************************************/
+TXSCHED_CLASS APP_TransmitClass(uint16_t sid)
+{
+  switch (sid) {
+    case ID_MODULE_STATUS_1:              // module state and status flags
+      return TXSCHED_STATE;
+    case ID_MODULE_STATUS_2:
+    case ID_MODULE_STATUS_3:
+    case ID_MODULE_TIME_REQUEST:
+      return TXSCHED_TELEMETRY;
+    default:                              // cell detail, hardware, announcements
+      return TXSCHED_BULK;
+  }
+}
+
+/***************************************************************************************************************
+*     A P P _ T r a n s m i t S e r v i c e                                            P A C K   E M U L A T O R
+***************************************************************************************************************/
+void APP_TransmitService(void)
+{
+  // Load what the FIFOs and rate limits take, the rest stays queued for the next pass
   APP_LED_Set(APP_TX_LED);
+  TXSCHED_Service(HAL_GetTick());
+  APP_LED_Clear(APP_TX_LED);
+}
+
+/***************************************************************************************************************
+*     A P P _ T e f D r a i n                                                          P A C K   E M U L A T O R
+***************************************************************************************************************/
+void APP_TefDrain(void)
+{
+  CAN_TEF_FIFO_STATUS tefStatus;
 
-  uint8_t attempts = MAX_TXQUEUE_ATTEMPTS;
+  tefLastDrain = HAL_GetTick();
 
-  // Check if FIFO is not full
-  do {
-    DRV_CANFDSPI_TransmitChannelEventGet(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, &txFlags);
-    if (attempts == 0) {
-        Nop();
-        Nop();
-        DRV_CANFDSPI_ErrorCountStateGet(DRV_CANFDSPI_INDEX_0, &tec, &rec, &errorFlags);
-        sprintf(tempBuffer,"TX ERROR - FIFO Full! Check CAN Connection."); serialOut(tempBuffer);
+  if (DRV_CANFDSPI_TefStatusGet(DRV_CANFDSPI_INDEX_0, &tefStatus)) {
+    return;
+  }
+  if (tefStatus & CAN_TEF_FIFO_OVERFLOW) {
+    TXSTATS_TefOverflow();
+    DRV_CANFDSPI_TefEventOverflowClear(DRV_CANFDSPI_INDEX_0);
+  }
 
-        //Flush channel
-        DRV_CANFDSPI_TransmitChannelFlush(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO);
-        DRV_CANFDSPI_TransmitChannelReset(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO);
+  // Each entry is a frame that made it onto the bus
+  while (tefStatus & CAN_TEF_FIFO_NOT_EMPTY) {
+    if (DRV_CANFDSPI_TefMessageGet(DRV_CANFDSPI_INDEX_0, &tefObj)) {
+      return;
+    }
+    TXSTATS_Sent(&tefObj);
 
-        return;
+    if (DRV_CANFDSPI_TefStatusGet(DRV_CANFDSPI_INDEX_0, &tefStatus)) {
+      return;
     }
-    attempts--;
   }
-  while (!(txFlags & CAN_TX_FIFO_NOT_FULL_EVENT));
-
-  // Load message and transmit
-  uint8_t n = DRV_CANFDSPI_DlcToDataBytes(txObj.bF.ctrl.DLC);
+}
 
-  DRV_CANFDSPI_TransmitChannelLoad(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, &txObj, txd, n, true);
+/***************************************************************************************************************
+*     A P P _ T r a n s m i t B u r s t B e g i n                                      P A C K   E M U L A T O R
+***************************************************************************************************************/
+void APP_TransmitBurstBegin(void)
+{
+  txBurst = true;
+}
 
-  APP_LED_Clear(APP_TX_LED);
+/***************************************************************************************************************
+*     A P P _ T r a n s m i t B u r s t E n d                                          P A C K   E M U L A T O R
+***************************************************************************************************************/
+void APP_TransmitBurstEnd(void)
+{
+  txBurst = false;
+  APP_TransmitService();
 }
 
 /***************************************************************************************************************
@@ -507,10 +766,18 @@ void APP_TransmitMessageQueue(void)
 void APP_AnnounceUnregisteredModules(void){
 
   uint8_t index;
+  uint8_t n;
   CANFRM_MODULE_ANNOUNCEMENT announcement;
 
-  // check for unregistered modules and send out ANNOUNCE packets
-  for(index = 0; index < MAX_MODULES_PER_PACK; index++){
+  if (HAL_GetTick() - announceLast < MODULE_ANNOUNCE_MS) {
+    return;
+  }
+
+  // send an ANNOUNCE packet for the next unregistered module, round robin so every module gets a turn
+  for(n = 0; n < moduleCount; n++){
+    index = announceNext;
+    announceNext = (announceNext + 1) % moduleCount;
+
     if((module[index].uniqueId != 0) && (module[index].moduleId == 0)){
 
       announcement.moduleFw = module[index].fwVersion;        // fill in the details
@@ -531,16 +798,43 @@ void APP_AnnounceUnregisteredModules(void){
       txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
       txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-      sprintf(tempBuffer,"TX 0x500 Announcement: FW=%02x, MFG=%02x, PN=%02x, ID=%08x",announcement.moduleFw, announcement.moduleMfgId, announcement.modulePartId,(int)announcement.moduleUniqueId); serialOut(tempBuffer);
+      LOG_EVENT(LOG_ID_PACK_TX_ANNOUNCE, announcement.moduleFw, announcement.moduleMfgId, announcement.modulePartId, announcement.moduleUniqueId);
 
       APP_TransmitMessageQueue();                     // Send it
 
-      HAL_Delay(1000);
+      announceLast = HAL_GetTick();
+      return;
     }
   }
 }
 
 
+/***************************************************************************************************************
+*     A P P _ C e l l M o d e l T a s k s                                              P A C K   E M U L A T O R
+***************************************************************************************************************/
+void APP_CellModelTasks(void){
+
+  uint32_t now = HAL_GetTick();
+  uint8_t index = cellModelNext;
+  float dt;
+  float current;
+
+  if (moduleCount == 0 || now - cellModelTick[index] < APP_CELL_MODEL_MS) {
+    return;
+  }
+
+  dt = (float)(now - cellModelTick[index]) * 0.001f;
+  cellModelTick[index] = now;
+  cellModelNext = (index + 1) % moduleCount;
+
+  // the drive cycle keeps running, current only flows with the relays closed
+  current = CELLMODEL_Profile(&cellModel[index], dt);
+  if (module[index].state != moduleOn) {
+    current = 0.0f;
+  }
+  CELLMODEL_Step(&cellModel[index], &module[index], current, dt);
+}
+
 /***************************************************************************************************************
 *     A P P _ R e q u e s t T i m e                                                    P A C K   E M U L A T O R
 ***************************************************************************************************************/
@@ -558,7 +852,7 @@ void APP_RequestTime(void){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  sprintf(tempBuffer,"TX 0x506 Time Request"); serialOut(tempBuffer);
+  LOG_EVENT0(LOG_ID_PACK_TX_TIME_REQUEST);
 
   APP_TransmitMessageQueue();                     // Send it
 
@@ -592,8 +886,8 @@ void APP_TransmitHardware(uint8_t index){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  sprintf(tempBuffer,"TX 0x501 Hardware: ID=%02x, CHA=%d, DCA=%d, CHV=%d, HW=%d",
-          rxObj.bF.id.EID, module[index].maxChargeA, module[index].maxDischargeA,  module[index].maxChargeEndV,module[index].hwVersion); serialOut(tempBuffer);
+  LOG_EVENT(LOG_ID_PACK_TX_HARDWARE,
+          rxObj.bF.id.EID, module[index].maxChargeA, module[index].maxDischargeA,  module[index].maxChargeEndV,module[index].hwVersion);
 
   APP_TransmitMessageQueue();                     // Send it
 
@@ -630,9 +924,9 @@ void APP_TransmitStatus1(uint8_t index){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  sprintf(tempBuffer,"TX 0x502 Status1: ID=%02x STE=%02x STS=%d CNT=%d MMV=%d MMC=%d SOC=%d, SOH=%d",
+  LOG_EVENT(LOG_ID_PACK_TX_STATUS1,
         module[index].moduleId,module[index].state,module[index].status,module[index].cellCount,
-        module[index].mmv,module[index].mmc,module[index].soc,module[index].soc); serialOut(tempBuffer);
+        module[index].mmv,module[index].mmc,module[index].soc,module[index].soc);
 
 
   APP_TransmitMessageQueue();                     // Send it
@@ -665,8 +959,8 @@ void APP_TransmitStatus2(uint8_t index){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  sprintf(tempBuffer,"TX 0x503 Status2: ID=%02x HIV=%d LOV=%d AVG=%d",
-      module[index].moduleId,  module[index].voltHi,module[index].voltLo, module[index].voltAvg); serialOut(tempBuffer);
+  LOG_EVENT(LOG_ID_PACK_TX_STATUS2,
+      module[index].moduleId,  module[index].voltHi,module[index].voltLo, module[index].voltAvg);
 
   APP_TransmitMessageQueue();                     // Send it
   //APP_TransmitCellZeroDetails(index);
@@ -699,8 +993,8 @@ void APP_TransmitStatus3(uint8_t index){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  sprintf(tempBuffer,"TX 0x504 Status3: ID=%02x HIT=%d LOT=%d AVG=%d",
-        module[index].moduleId,  module[index].tempHi,module[index].tempLo, module[index].tempAvg); serialOut(tempBuffer);
+  LOG_EVENT(LOG_ID_PACK_TX_STATUS3,
+        module[index].moduleId,  module[index].tempHi,module[index].tempLo, module[index].tempAvg);
 
   APP_TransmitMessageQueue();                     // Send it
   //APP_TransmitCellZeroDetails(index);
@@ -738,7 +1032,7 @@ void APP_TransmitCellZeroDetails(uint8_t index){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  sprintf(tempBuffer,"TX 0x503 Cell Detail:  CNT=%02x, CELL=%02x, SOH=%02x SOC=%02x, TEMP=%03x, Voltage=%03x", cellDetail.cellCount, cellDetail.cellId, cellDetail.cellSoh, cellDetail.cellSoc, cellDetail.cellTemp, cellDetail.cellVoltage); serialOut(tempBuffer);
+  LOG_EVENT(LOG_ID_PACK_TX_CELL_DETAIL_V, cellDetail.cellCount, cellDetail.cellId, cellDetail.cellSoh, cellDetail.cellSoc, cellDetail.cellTemp, cellDetail.cellVoltage);
   APP_TransmitMessageQueue();                     // Send it
 }
 
@@ -749,20 +1043,15 @@ void APP_TransmitCellZeroDetails(uint8_t index){
 void APP_ProcessHardwareRequest(void){
 
    uint8_t moduleIndex = 0;
-   uint8_t index;
    uint8_t moduleId;
 
    moduleId = rxObj.bF.id.EID;
 
-   sprintf(tempBuffer,"RX 0x511 Hardware Request ID=%02x",moduleId); serialOut(tempBuffer);
+   LOG_EVENT(LOG_ID_PACK_RX_HW_REQUEST, moduleId);
 
  //find the index for the module
- moduleIndex = moduleCount; //default the index to the next entry (we are using 0 so next index is the moduleCount)
- for(index = 0; index < moduleCount; index++){
-   if(moduleId == module[index].moduleId)
-     moduleIndex = index; // module is already registered, save the index
- }
- if(moduleIndex != moduleCount) {
+ moduleIndex = MODTABLE_FindId(moduleId);
+ if(moduleIndex != MODTABLE_NONE) {
      // Transmit the hardware message
      APP_TransmitHardware(moduleIndex);
     }
@@ -775,20 +1064,15 @@ void APP_ProcessHardwareRequest(void){
 void APP_ReplyToStatusRequest(void){
 
    uint8_t moduleIndex = 0;
-   uint8_t index;
    uint8_t moduleId;
 
    moduleId = rxObj.bF.id.EID;
 
-   sprintf(tempBuffer,"RX 0x512 Status Request ID=%02x",moduleId); serialOut(tempBuffer);
+   LOG_EVENT(LOG_ID_PACK_RX_STATUS_REQUEST, moduleId);
 
  //find the index for the module
- moduleIndex = moduleCount; //default the index to the next entry (we are using 0 so next index is the moduleCount)
- for(index = 0; index < moduleCount; index++){
-   if(moduleId == module[index].moduleId)
-     moduleIndex = index; // module is already registered, save the index
- }
- if(moduleIndex != moduleCount) {
+ moduleIndex = MODTABLE_FindId(moduleId);
+ if(moduleIndex != MODTABLE_NONE) {
      // Transmit the 3 status frames
      APP_TransmitStatus1(moduleIndex);
      APP_TransmitStatus2(moduleIndex);
@@ -803,7 +1087,6 @@ void APP_ReplyToStatusRequest(void){
 void APP_StateChange(void){
 
    uint8_t moduleIndex = 0;
-   uint8_t index;
    uint8_t moduleId;
 
    moduleId = rxObj.bF.id.EID;
@@ -812,17 +1095,13 @@ void APP_StateChange(void){
    memcpy(&state, rxd,4);
 
  //find the index for the module
- moduleIndex = moduleCount; //default the index to the next entry (we are using 0 so next index is the moduleCount)
- for(index = 0; index < moduleCount; index++){
-   if(moduleId == module[index].moduleId)
-     moduleIndex = index; // module is already registered, save the index
- }
- if(moduleIndex != moduleCount){
+ moduleIndex = MODTABLE_FindId(moduleId);
+ if(moduleIndex != MODTABLE_NONE){
    module[moduleIndex].state = state.state;
    module[moduleIndex].hvBusVoltage = state.hvBusVoltage;
 
 
-   sprintf(tempBuffer,"RX 0x514 State Change Request ID=%02x STATE=%02x HV=%.2fV",moduleId,state.state, state.hvBusVoltage * MODULE_VOLTAGE_FACTOR); serialOut(tempBuffer);
+   LOG_EVENT(LOG_ID_PACK_RX_STATE_CHANGE, moduleId, state.state, LOG_F(state.hvBusVoltage * MODULE_VOLTAGE_FACTOR));
    // Transmit the 3 status frames
         APP_TransmitStatus1(moduleIndex);
         APP_TransmitStatus2(moduleIndex);
@@ -841,7 +1120,7 @@ void APP_ProcessTime(void){
 
  CANFRM_MODULE_TIME moduleTime;
 
- sprintf(tempBuffer,"RX 0x516 Set Time"); serialOut(tempBuffer);
+ LOG_EVENT0(LOG_ID_PACK_RX_SET_TIME);
 
  // copy received data to status structure
  memset(&moduleTime,0,sizeof(moduleTime));
@@ -867,19 +1146,14 @@ void APP_ReplyToCellDetailRequest(void){
   CANFRM_MODULE_DETAIL_REQUEST detailRequest;
  CANFRM_MODULE_DETAIL cellDetail;
  uint8_t moduleIndex = 0;
- uint8_t index;
 
  // copy data to announcement structure
  memcpy(&detailRequest, rxd,3);
- sprintf(tempBuffer,"RX 0x515 Request detail: ID=%02x, CELL=%02x",detailRequest.moduleId,detailRequest.cellId ); serialOut(tempBuffer);
+ LOG_EVENT(LOG_ID_PACK_RX_DETAIL_REQUEST, detailRequest.moduleId, detailRequest.cellId);
 
- //find the index for the module
- moduleIndex = moduleCount; //default the index to the next entry (we are using 0 so next index is the moduleCount)
- for(index = 0; index < moduleCount; index++){
-   if(detailRequest.moduleId == module[index].moduleId)
-     moduleIndex = index; // module is already registered, save the index
- }
- if(moduleIndex != moduleCount){
+ //find the index for the module, the cell must exist
+ moduleIndex = MODTABLE_FindId(detailRequest.moduleId);
+ if(moduleIndex != MODTABLE_NONE && detailRequest.cellId < module[moduleIndex].cellCount){
     // store the details
     cellDetail.cellCount   = module[moduleIndex].cellCount;
     cellDetail.cellId      = detailRequest.cellId;
@@ -896,17 +1170,18 @@ void APP_ReplyToCellDetailRequest(void){
     memcpy(txd, &cellDetail, 8);
 
     txObj.bF.id.SID = ID_MODULE_DETAIL;             // Standard ID
-    txObj.bF.id.EID = module[index].moduleId;       // Extended ID
+    txObj.bF.id.EID = module[moduleIndex].moduleId; // Extended ID
 
     txObj.bF.ctrl.BRS = 0;                          // Bit Rate Switch - use DBR when set, NBR when cleared
     txObj.bF.ctrl.DLC = CAN_DLC_8;                  // 3 bytes to transmit
     txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
     txObj.bF.ctrl.IDE = 1;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-    sprintf(tempBuffer,"TX 0x505 Cell Detail: CNT=%02x, CELL=%02x, SOC=%02x, TEMP=%03x, Voltage=%03x", cellDetail.cellCount, cellDetail.cellId, cellDetail.cellSoc, cellDetail.cellTemp, cellDetail.cellVoltage); serialOut(tempBuffer);
+    LOG_EVENT(LOG_ID_PACK_TX_CELL_DETAIL, cellDetail.cellCount, cellDetail.cellId, cellDetail.cellSoc, cellDetail.cellTemp, cellDetail.cellVoltage);
      APP_TransmitMessageQueue();                     // Send it
    }else{
-     // TODO : We couldn't find the module.
+     // no such module or cell here, the requester times out
+     LOG_EVENT(LOG_ID_PACK_DETAIL_UNKNOWN, detailRequest.moduleId, detailRequest.cellId);
    }
 }
 
@@ -917,24 +1192,40 @@ void APP_RegisterModule(void){
 
   CANFRM_MODULE_REGISTRATION registration;
   uint8_t index = 0;
+  uint8_t moduleId;
+  uint8_t previous;
 
   // copy data to announcement structure
   memcpy(&registration, rxd,8);
   //sprintf(tempBuffer,"RX 0x510 Registration: ID=%02x, CTL=%02x, MFG=%02x, PN=%02x, UID=%08x",registration.moduleId, registration.controllerId, registration.moduleMfgId, registration.modulePartId,(int)registration.moduleUniqueId); serialOut(tempBuffer);
-  sprintf(tempBuffer,"RX 0x510 Registration: ID=%02x, CTL=%02x, MFG=%02x, PN=%02x, UID=%08x",rxObj.bF.id.EID, registration.controllerId, registration.moduleMfgId, registration.modulePartId,(int)registration.moduleUniqueId); serialOut(tempBuffer);
+  LOG_EVENT(LOG_ID_PACK_RX_REGISTRATION, rxObj.bF.id.EID, registration.controllerId, registration.moduleMfgId, registration.modulePartId, registration.moduleUniqueId);
 
   // update our record
-  for(index = 0; index < moduleCount; index++){
-   if((registration.moduleMfgId == module[index].mfgId) && (registration.modulePartId == module[index].partId) && (registration.moduleUniqueId == module[index].uniqueId)){
-      //module[index].moduleId = registration.moduleId;
-      module[index].moduleId = rxObj.bF.id.EID;
-
-      // Tranmist the 3 status frames
-      APP_TransmitStatus1(index);
-      APP_TransmitStatus2(index);
-      APP_TransmitStatus3(index);
-      APP_TransmitHardware(index);
+  index = MODTABLE_FindUnique(registration.moduleMfgId, registration.modulePartId, registration.moduleUniqueId);
+  if(index != MODTABLE_NONE){
+    //moduleId = registration.moduleId;
+    moduleId = rxObj.bF.id.EID;
+
+    // release the ID the module had, then take the new one
+    if(module[index].moduleId != moduleId){
+      MODTABLE_Unregister(module[index].moduleId);
+    }
+    previous = MODTABLE_Register(moduleId, index);
+
+    // another controller gave the same ID to a different module, that one has to register again
+    if(previous != MODTABLE_NONE && previous != index){
+      LOG_EVENT(LOG_ID_PACK_MODULE_ID_MOVED, moduleId, module[previous].uniqueId, module[index].uniqueId);
+      module[previous].moduleId = 0;
     }
+
+    module[index].moduleId = moduleId;
+    module[index].controllerId = registration.controllerId;
+
+    // Tranmist the 3 status frames
+    APP_TransmitStatus1(index);
+    APP_TransmitStatus2(index);
+    APP_TransmitStatus3(index);
+    APP_TransmitHardware(index);
   }
 }
 
@@ -943,11 +1234,19 @@ void APP_RegisterModule(void){
 ***************************************************************************************************************/
 void APP_DeRegisterAllModules(void){
 
+  CANFRM_MODULE_ALL_DEREGISTER deregister;
   uint8_t index;
 
-  sprintf(tempBuffer,"RX 0x51E De-Register all modules"); serialOut(tempBuffer);
+  memcpy(&deregister, rxd, sizeof(deregister));
+
+  LOG_EVENT0(LOG_ID_PACK_RX_DEREGISTER_ALL);
+
+  // only the modules of the controller that sent it, all of them if it names none
   for(index = 0; index < moduleCount; index++){
-    module[index].moduleId = 0;
+    if(rxObj.bF.ctrl.DLC == CAN_DLC_0 || module[index].controllerId == deregister.controllerId){
+      MODTABLE_Unregister(module[index].moduleId);
+      module[index].moduleId = 0;
+    }
   }
 }
 
@@ -959,7 +1258,7 @@ void APP_IsolateAllModules(void){
 
   uint8_t index;
 
-  sprintf(tempBuffer,"RX 0x51F Isolate all modules"); serialOut(tempBuffer);
+  LOG_EVENT0(LOG_ID_PACK_RX_ISOLATE_ALL);
   for(index = 0; index < moduleCount; index++){
     module[index].state = moduleOff;
   }
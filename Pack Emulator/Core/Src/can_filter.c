@@ -0,0 +1,239 @@
+/*******************************************************************************
+  CAN Filter Builder
+
+  File Name:
+    can_filter.c
+
+  Summary:
+    Derives MCP2518FD acceptance filter/mask pairs from the IDs a node handles.
+
+  Description:
+    A rule matches a frame when (frame ^ value) & mask == 0, with the frame
+    in CiFLTOBJ layout: SID in bits 0-10, EID in bits 11-28, EXIDE in bit 30.
+    The exact pass is the first step of Quine-McCluskey: two rules with the
+    same mask whose values differ in one masked bit cover exactly the IDs of
+    a rule with that bit cleared from the mask, and a rule whose IDs are all
+    covered by another rule is dropped. The lists are a few dozen IDs at most
+    and this runs once at start up, so the passes are simple O(n^2) scans.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include "can_filter.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+#define CANFILTER_SID_MASK      0x000007FFUL
+#define CANFILTER_EXIDE         (1UL << 30)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+
+static uint8_t CANFILTER_BitCount(uint32_t x)
+{
+    uint8_t n = 0;
+
+    while (x) {
+        x &= x - 1;
+        n++;
+    }
+    return n;
+}
+
+// True if every frame accepted by b is also accepted by a
+static bool CANFILTER_Covers(const CANFILTER_RULE *a, const CANFILTER_RULE *b)
+{
+    return (a->fifo == b->fifo) && ((a->mask & ~b->mask) == 0) &&
+            (((a->value ^ b->value) & a->mask) == 0);
+}
+
+static void CANFILTER_Remove(CANFILTER_RULE *rules, uint8_t *nRules, uint8_t i)
+{
+    (*nRules)--;
+    for (; i < *nRules; i++) {
+        rules[i] = rules[i + 1];
+    }
+}
+
+// One exact merge or removal, returns false when nothing changed
+static bool CANFILTER_ReduceExact(CANFILTER_RULE *rules, uint8_t *nRules)
+{
+    uint32_t diff;
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < *nRules; i++) {
+        for (j = 0; j < *nRules; j++) {
+            if (i == j) {
+                continue;
+            }
+            if (CANFILTER_Covers(&rules[i], &rules[j])) {
+                CANFILTER_Remove(rules, nRules, j);
+                return true;
+            }
+            if (j > i && rules[i].fifo == rules[j].fifo && rules[i].mask == rules[j].mask) {
+                diff = (rules[i].value ^ rules[j].value) & rules[i].mask;
+                if (CANFILTER_BitCount(diff) == 1) {
+                    rules[i].mask &= ~diff;
+                    rules[i].value &= rules[i].mask;
+                    CANFILTER_Remove(rules, nRules, j);
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Merge the two rules of one FIFO whose union keeps the most mask bits
+static bool CANFILTER_ReduceLossy(CANFILTER_RULE *rules, uint8_t *nRules)
+{
+    uint32_t mask;
+    uint8_t best = 0;
+    uint8_t bestI = 0;
+    uint8_t bestJ = 0;
+    uint8_t bits;
+    uint8_t i;
+    uint8_t j;
+
+    for (i = 0; i < *nRules; i++) {
+        for (j = i + 1; j < *nRules; j++) {
+            if (rules[i].fifo != rules[j].fifo) {
+                continue;
+            }
+            mask = rules[i].mask & rules[j].mask & ~(rules[i].value ^ rules[j].value);
+            bits = CANFILTER_BitCount(mask) + 1;
+            if (bits > best) {
+                best = bits;
+                bestI = i;
+                bestJ = j;
+            }
+        }
+    }
+    if (best == 0) {
+        return false;
+    }
+
+    rules[bestI].mask &= rules[bestJ].mask & ~(rules[bestI].value ^ rules[bestJ].value);
+    rules[bestI].value &= rules[bestI].mask;
+    CANFILTER_Remove(rules, nRules, bestJ);
+    return true;
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+int8_t CANFILTER_Build(const CANFILTER_ID *ids, uint8_t nIds,
+        CANFILTER_RULE *rules, uint8_t maxRules)
+{
+    CANFILTER_RULE work[CAN_FILTER_TOTAL];
+    CANFILTER_RULE rule;
+    uint8_t nWork = 0;
+    uint8_t nRules = 0;
+    uint8_t n;
+    uint8_t i;
+
+    if (maxRules > CAN_FILTER_TOTAL) {
+        maxRules = CAN_FILTER_TOTAL;
+    }
+
+    // One rule per ID, duplicates dropped by the exact pass
+    for (i = 0; i < nIds; i++) {
+        if (nWork == CAN_FILTER_TOTAL) {
+            while (CANFILTER_ReduceExact(work, &nWork)) {
+            }
+            if (nWork == CAN_FILTER_TOTAL && !CANFILTER_ReduceLossy(work, &nWork)) {
+                return -1;
+            }
+        }
+
+        work[nWork].value = ids[i].sid & CANFILTER_SID_MASK;
+        work[nWork].mask = CANFILTER_SID_MASK;
+        if (ids[i].format == CANFILTER_EXTENDED) {
+            work[nWork].value |= CANFILTER_EXIDE;
+        }
+        if (ids[i].format != CANFILTER_ANY) {
+            work[nWork].mask |= CANFILTER_EXIDE;
+        }
+        work[nWork].fifo = ids[i].fifo;
+        nWork++;
+    }
+
+    while (CANFILTER_ReduceExact(work, &nWork)) {
+    }
+    while (nWork > maxRules) {
+        if (!CANFILTER_ReduceLossy(work, &nWork)) {
+            return -1;
+        }
+    }
+
+    // Group by FIFO in the order the FIFOs were first listed
+    for (i = 0; i < nIds && nRules < nWork; i++) {
+        for (n = 0; n < nWork; n++) {
+            if (work[n].fifo != ids[i].fifo) {
+                continue;
+            }
+            rule = work[n];
+            rules[nRules++] = rule;
+            work[n].fifo = CAN_FIFO_TOTAL_CHANNELS;   // taken
+        }
+    }
+
+    return (int8_t) nRules;
+}
+
+int8_t CANFILTER_Apply(CANFDSPI_MODULE_ID index, const CANFILTER_RULE *rules, uint8_t nRules)
+{
+    REG_CiFLTOBJ fObj;
+    REG_CiMASK mObj;
+    int8_t spiTransferError = 0;
+    uint8_t i;
+
+    for (i = 0; i < CAN_FILTER_TOTAL && spiTransferError == 0; i++) {
+        spiTransferError = DRV_CANFDSPI_FilterDisable(index, (CAN_FILTER) i);
+        if (i >= nRules || spiTransferError) {
+            continue;
+        }
+
+        fObj.word = rules[i].value;
+        spiTransferError = DRV_CANFDSPI_FilterObjectConfigure(index, (CAN_FILTER) i, &fObj.bF);
+        if (spiTransferError) {
+            break;
+        }
+
+        mObj.word = rules[i].mask;
+        spiTransferError = DRV_CANFDSPI_FilterMaskConfigure(index, (CAN_FILTER) i, &mObj.bF);
+        if (spiTransferError) {
+            break;
+        }
+
+        spiTransferError = DRV_CANFDSPI_FilterToFifoLink(index, (CAN_FILTER) i, rules[i].fifo, true);
+    }
+
+    return spiTransferError;
+}
+
+bool CANFILTER_Accepts(const CANFILTER_RULE *rules, uint8_t nRules,
+        uint16_t sid, uint32_t eid, bool ide, CAN_FIFO_CHANNEL *fifo)
+{
+    uint32_t frame;
+    uint8_t i;
+
+    frame = (sid & CANFILTER_SID_MASK) | ((eid & 0x3FFFFUL) << 11) | (ide ? CANFILTER_EXIDE : 0);
+
+    for (i = 0; i < nRules; i++) {
+        if (((frame ^ rules[i].value) & rules[i].mask) == 0) {
+            if (fifo) {
+                *fifo = rules[i].fifo;
+            }
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,249 @@
+/*******************************************************************************
+  Cell Model
+
+  File Name:
+    cell_model.c
+
+  Summary:
+    Equivalent circuit model of the cells of an emulated module.
+
+  Description:
+    The RC pair and the thermal node are first order lags of the current
+    and of the current squared. They are advanced with the exact solution
+    for a current held over the step, so the result does not depend on dt
+    and host tools can take steps of minutes.
+
+    A cell's temperature rise is its resistance times the filtered current
+    squared over the heat loss, its voltage is the OCV at its own SOC plus
+    the drops over its own R0 and R1. Figures are written in the encodings
+    of the CAN frames (app.h), clamped to the field ranges.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <math.h>
+#include "cell_model.h"
+#include "app.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+#define CELLMODEL_OCV_POINTS    11      // every 10% SOC
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+typedef struct {
+    float duration;         // s
+    float current;          // A, charge positive
+} CELLMODEL_SEGMENT;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+// NMC cell at rest, 0% to 100% SOC
+static const float ocvTable[CELLMODEL_OCV_POINTS] = {
+    3.00f, 3.45f, 3.55f, 3.62f, 3.67f, 3.72f, 3.79f, 3.87f, 3.96f, 4.06f, 4.18f
+};
+
+// Drive, regen, drive, rest, charge back what was taken, rest. Net charge is
+// about zero, so the cycle can repeat for as long as the emulator runs
+static const CELLMODEL_SEGMENT profile[] = {
+    {  60.0f,    0.0f},
+    { 600.0f,  -40.0f},
+    {  60.0f,   15.0f},
+    { 600.0f,  -25.0f},
+    { 300.0f,    0.0f},
+    {1905.0f,   20.0f},
+    { 300.0f,    0.0f},
+};
+
+// Encodings as float, the F4 FPU has no double
+static const float voltScale = (float) (1.0 / CELL_VOLTAGE_FACTOR);
+static const float moduleVoltScale = (float) (1.0 / MODULE_VOLTAGE_FACTOR);
+static const float currentBase = (float) MODULE_CURRENT_BASE;
+static const float currentScale = (float) (1.0 / MODULE_CURRENT_FACTOR);
+static const float tempBase = (float) TEMPERATURE_BASE;
+static const float tempScale = (float) (1.0 / TEMPERATURE_FACTOR);
+static const float percentScale = (float) (100.0 / PERCENTAGE_FACTOR);
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+
+// Well mixed 32 bits per cell, the same every run
+static uint32_t CELLMODEL_Hash(uint32_t uniqueId, uint32_t cell)
+{
+    uint32_t h = (uniqueId * 0x9E3779B1U) ^ (cell * 0x85EBCA77U);
+
+    h ^= h >> 15;
+    h *= 0x2C1B3C6DU;
+    h ^= h >> 12;
+    h *= 0x297A2D39U;
+    h ^= h >> 15;
+
+    return h;
+}
+
+// One byte of a hash as -1 to 1
+static inline float CELLMODEL_Spread(uint32_t h)
+{
+    return ((float) (h & 0xFF) - 127.5f) * (1.0f / 127.5f);
+}
+
+static inline float CELLMODEL_Ocv(float soc)
+{
+    float x = soc * (CELLMODEL_OCV_POINTS - 1);
+    int i = (int) x;
+
+    if (i > CELLMODEL_OCV_POINTS - 2) {
+        i = CELLMODEL_OCV_POINTS - 2;
+    }
+
+    return ocvTable[i] + (ocvTable[i + 1] - ocvTable[i]) * (x - (float) i);
+}
+
+static inline uint16_t CELLMODEL_Encode16(float value)
+{
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 65535.0f) {
+        return 65535;
+    }
+    return (uint16_t) (value + 0.5f);
+}
+
+static inline uint8_t CELLMODEL_Encode8(float value)
+{
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 255.0f) {
+        return 255;
+    }
+    return (uint8_t) (value + 0.5f);
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+void CELLMODEL_Init(CELLMODEL_STATE *state, const batteryModule *m, float ambient, float profileOffset)
+{
+    state->charge = 0.0f;
+    state->throughput = 0.0f;
+    state->current = 0.0f;
+    state->rcCurrent = 0.0f;
+    state->heat = 0.0f;
+    state->ambient = ambient;
+    state->soc = (float) m->soc / percentScale;
+    state->soh = (float) m->soh / percentScale;
+    if (state->soh < 0.5f) {
+        state->soh = 1.0f;              // no figure set, take the module as new
+    }
+    state->profileTime = 0.0f;
+
+    CELLMODEL_Profile(state, profileOffset);
+}
+
+void CELLMODEL_Step(CELLMODEL_STATE *state, batteryModule *m, float current, float dt)
+{
+    float aRc = expf(-dt * (1.0f / CELLMODEL_TAU_RC));
+    float aHeat = expf(-dt * (CELLMODEL_HEAT_LOSS / CELLMODEL_HEAT_CAPACITY));
+    float fade;
+    float drop;
+    float rise;
+    float vHi = 0.0f, vLo = 100.0f, vSum = 0.0f;
+    float tHi = -100.0f, tLo = 1000.0f, tSum = 0.0f;
+    float socSum = 0.0f, sohSum = 0.0f;
+    float rScale, soc, soh, v, t;
+    uint32_t h;
+    uint16_t n = m->cellCount;
+    uint16_t c;
+
+    // Module states
+    state->current = current;
+    state->rcCurrent = current + (state->rcCurrent - current) * aRc;
+    state->heat = current * current + (state->heat - current * current) * aHeat;
+    state->charge += current * dt * (1.0f / 3600.0f);
+    state->throughput += fabsf(current) * dt * (1.0f / 3600.0f);
+
+    // The same for every cell apart from its resistance
+    fade = CELLMODEL_FADE_PER_CYCLE * state->throughput * (1.0f / (2.0f * CELLMODEL_CAPACITY_AH));
+    drop = current * CELLMODEL_R0 + state->rcCurrent * CELLMODEL_R1;
+    rise = (CELLMODEL_R0 + CELLMODEL_R1) * state->heat * (1.0f / CELLMODEL_HEAT_LOSS);
+
+    for (c = 0; c < n; c++) {
+        h = CELLMODEL_Hash(m->uniqueId, c);
+        rScale = 1.0f + CELLMODEL_Spread(h >> 8) * CELLMODEL_RESISTANCE_SPREAD;
+
+        soh = state->soh + CELLMODEL_Spread(h >> 16) * CELLMODEL_SOH_SPREAD - fade;
+        soh = (soh < 1.0f) ? soh : 1.0f;
+
+        soc = state->soc + CELLMODEL_Spread(h >> 24) * CELLMODEL_SOC_SPREAD +
+                state->charge / (CELLMODEL_CAPACITY_AH * soh * (1.0f + CELLMODEL_Spread(h) * CELLMODEL_CAPACITY_SPREAD));
+        soc = (soc > 0.0f) ? ((soc < 1.0f) ? soc : 1.0f) : 0.0f;
+
+        v = CELLMODEL_Ocv(soc) + rScale * drop;
+        t = state->ambient + rScale * rise;
+
+        m->cell[c].voltage = CELLMODEL_Encode16(v * voltScale);
+        m->cell[c].temp = CELLMODEL_Encode16((t - tempBase) * tempScale);
+        m->cell[c].soc = CELLMODEL_Encode8(soc * percentScale);
+        m->cell[c].soh = CELLMODEL_Encode8(soh * percentScale);
+
+        vHi = (v > vHi) ? v : vHi;
+        vLo = (v < vLo) ? v : vLo;
+        vSum += v;
+        tHi = (t > tHi) ? t : tHi;
+        tLo = (t < tLo) ? t : tLo;
+        tSum += t;
+        socSum += soc;
+        sohSum += soh;
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    m->voltHi = CELLMODEL_Encode16(vHi * voltScale);
+    m->voltLo = CELLMODEL_Encode16(vLo * voltScale);
+    m->voltAvg = CELLMODEL_Encode16(vSum / n * voltScale);
+    m->tempHi = CELLMODEL_Encode16((tHi - tempBase) * tempScale);
+    m->tempLo = CELLMODEL_Encode16((tLo - tempBase) * tempScale);
+    m->tempAvg = CELLMODEL_Encode16((tSum / n - tempBase) * tempScale);
+    m->mmv = CELLMODEL_Encode16(vSum * moduleVoltScale);
+    m->mmc = CELLMODEL_Encode16((current - currentBase) * currentScale);
+    m->soc = CELLMODEL_Encode8(socSum / n * percentScale);
+    m->soh = CELLMODEL_Encode8(sohSum / n * percentScale);
+}
+
+float CELLMODEL_Profile(CELLMODEL_STATE *state, float dt)
+{
+    float t = state->profileTime;
+    float total = 0.0f;
+    float current = 0.0f;
+    uint8_t i;
+
+    for (i = 0; i < sizeof(profile) / sizeof(profile[0]); i++) {
+        total += profile[i].duration;
+    }
+
+    for (i = 0; i < sizeof(profile) / sizeof(profile[0]); i++) {
+        if (t < profile[i].duration) {
+            current = profile[i].current;
+            break;
+        }
+        t -= profile[i].duration;
+    }
+
+    state->profileTime = fmodf(state->profileTime + dt, total);
+
+    return current;
+}
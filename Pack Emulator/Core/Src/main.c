@@ -28,6 +28,10 @@
 #include "canfdspi_register.h"
 #include "app.h"
 #include "time.h"
+#include "serial_log.h"
+#include "rx_stats.h"
+#include "tx_stats.h"
+#include "tx_sched.h"
 
 /* USER CODE END Includes */
 
@@ -54,8 +58,10 @@ SPI_HandleTypeDef hspi1;
 UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
+DMA_HandleTypeDef hdma_usart2_tx;
+uint8_t uartRxByte;
+volatile uint8_t uartCommand = 0;
 char logTime[9];
-char txBuffer[MAX_BUFFER];
 char tempBuffer[MAX_BUFFER];
 uint8_t canRxInterrupt = 0;
 uint8_t canTxInterrupt = 0;
@@ -82,12 +88,8 @@ time_t readRTC(void);
 *     S E R I A L   O U T                                                              P A C K   E M U L A T O R
 ***************************************************************************************************************/
 void serialOut(char* message){
-  getTime();
-  sprintf(txBuffer,"%s %s\r\n",logTime, message);
-
-  if (HAL_UART_Transmit(&huart2, (uint8_t*)txBuffer, strlen(txBuffer), 2000) != HAL_OK){// Sending in normal mode
-    Error_Handler();
-  }
+  // Queued for LOG_Tasks, the time stamp is added when the record is expanded
+  LOG_Text(message);
 }
 
 /***************************************************************************************************************
@@ -98,12 +100,44 @@ void getTime(void){
   RTC_TimeTypeDef sTime = {0};
   RTC_DateTypeDef sDate = {0};
 
-  HAL_RTC_GetTime(&hrtc,&sTime, RTC_FORMAT_BCD);
-  HAL_RTC_GetDate(&hrtc,&sDate, RTC_FORMAT_BCD);
+  HAL_RTC_GetTime(&hrtc,&sTime, RTC_FORMAT_BIN);
+  HAL_RTC_GetDate(&hrtc,&sDate, RTC_FORMAT_BIN);
   uint8_t seconds = sTime.Seconds;
   uint8_t minutes = sTime.Minutes;
   uint8_t hours = sTime.Hours;
-  sprintf(logTime,"%02x:%02x:%02x",hours,minutes,seconds);
+  sprintf(logTime,"%02u:%02u:%02u",hours,minutes,seconds);
+
+  // Log records carry the tick, this ties it to the RTC
+  LOG_TimeSync(hours,minutes,seconds);
+}
+
+/***************************************************************************************************************
+*     S E R I A L   C O M M A N D                                                      P A C K   E M U L A T O R
+***************************************************************************************************************/
+void serialCommand(void){
+  // One key from the terminal: s = report RX and TX statistics, r = reset them
+  uint8_t command = uartCommand;
+
+  if (command == 0) return;
+  uartCommand = 0;
+
+  switch (command){
+    case 's':
+    case 'S':
+      RXSTATS_Report();
+      TXSTATS_Report();
+      TXSCHED_Report();
+      break;
+    case 'r':
+    case 'R':
+      RXSTATS_Reset();
+      TXSTATS_Reset();
+      TXSCHED_Reset();
+      serialOut("RX/TX STATS reset");
+      break;
+    default:
+      break;
+  }
 }
 
 /***************************************************************************************************************
@@ -167,6 +201,8 @@ void writeRTC(time_t now)
 
  HAL_RTCEx_BKUPWrite(&hrtc,RTC_BKP_DR0,0x32F2);       // lock it in with the backup registers
 
+ getTime();                                           // resync the log time stamps
+
 }
 
 /***************************************************************************************************************
@@ -281,7 +317,9 @@ int main(void)
   MX_RTC_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
-
+  LOG_Init(&huart2);
+  getTime();
+  HAL_UART_Receive_IT(&huart2, &uartRxByte, 1);   // single key commands, see serialCommand()
 
   DRV_CANFDSPI_Reset(DRV_CANFDSPI_INDEX_0);
   APP_Initialize();
@@ -295,6 +333,8 @@ int main(void)
 
     /* USER CODE BEGIN 3 */
     APP_Tasks();
+    serialCommand();
+    LOG_Tasks();
   }
   /* USER CODE END 3 */
 }
@@ -510,6 +550,38 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+/***************************************************************************************************************
+*     U A R T   T X   C O M P L E T E                                                  P A C K   E M U L A T O R
+***************************************************************************************************************/
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  LOG_TxComplete(huart);
+}
+
+/***************************************************************************************************************
+*     U A R T   R X   C O M P L E T E                                                  P A C K   E M U L A T O R
+***************************************************************************************************************/
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+  if (huart == &huart2){
+    uartCommand = uartRxByte;
+    HAL_UART_Receive_IT(&huart2, &uartRxByte, 1);
+  }
+}
+
+/***************************************************************************************************************
+*     U A R T   E R R O R                                                              P A C K   E M U L A T O R
+***************************************************************************************************************/
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  // A DMA error ends the log transfer without TxCplt, an overrun stops reception
+  if (huart->gState == HAL_UART_STATE_READY){
+    LOG_TxComplete(huart);
+  }
+  if (huart == &huart2 && huart->RxState == HAL_UART_STATE_READY){
+    HAL_UART_Receive_IT(&huart2, &uartRxByte, 1);
+  }
+}
 
 /* USER CODE END 4 */
 
@@ -0,0 +1,132 @@
+/*******************************************************************************
+  Module Table
+
+  File Name:
+    module_table.c
+
+  Summary:
+    Constant time lookup of emulated modules by unique ID and by module ID.
+
+  Description:
+    The unique ID hash uses linear probing. Unique IDs are usually serial
+    numbers with a common prefix, so they are spread with a multiplicative
+    (Fibonacci) hash and the top bits pick the bucket. An entry stores the
+    whole identity, a probe only ends on a match or an empty entry.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <string.h>
+#include "module_table.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+typedef struct {
+    uint32_t uniqueId;
+    uint8_t  mfgId;
+    uint8_t  partId;
+    uint8_t  slot;          // MODTABLE_NONE when the entry is empty
+} MODTABLE_ENTRY;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+static MODTABLE_ENTRY hashTable[MODTABLE_HASH_SIZE];
+static uint8_t idTable[256];
+static uint16_t hashCount = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+
+static uint16_t MODTABLE_Hash(uint32_t uniqueId)
+{
+    return (uint16_t) ((uint32_t) (uniqueId * 2654435761U) >> (32 - MODTABLE_HASH_BITS));
+}
+
+// Entry holding the identity, or the empty entry where it would go
+static MODTABLE_ENTRY *MODTABLE_Probe(uint8_t mfgId, uint8_t partId, uint32_t uniqueId)
+{
+    MODTABLE_ENTRY *entry;
+    uint16_t h = MODTABLE_Hash(uniqueId);
+
+    for (;;) {
+        entry = &hashTable[h];
+        if (entry->slot == MODTABLE_NONE ||
+                (entry->uniqueId == uniqueId && entry->mfgId == mfgId && entry->partId == partId)) {
+            return entry;
+        }
+        h = (h + 1) & (MODTABLE_HASH_SIZE - 1);
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+void MODTABLE_Init(void)
+{
+    memset(hashTable, MODTABLE_NONE, sizeof(hashTable));
+    memset(idTable, MODTABLE_NONE, sizeof(idTable));
+    hashCount = 0;
+}
+
+int8_t MODTABLE_Add(uint8_t mfgId, uint8_t partId, uint32_t uniqueId, uint8_t slot)
+{
+    MODTABLE_ENTRY *entry;
+
+    // Keep one entry empty so a probe always ends
+    if (slot == MODTABLE_NONE || hashCount >= MODTABLE_HASH_SIZE - 1) {
+        return -1;
+    }
+
+    entry = MODTABLE_Probe(mfgId, partId, uniqueId);
+    if (entry->slot != MODTABLE_NONE) {
+        return -2;
+    }
+
+    entry->uniqueId = uniqueId;
+    entry->mfgId = mfgId;
+    entry->partId = partId;
+    entry->slot = slot;
+    hashCount++;
+
+    return 0;
+}
+
+uint8_t MODTABLE_FindUnique(uint8_t mfgId, uint8_t partId, uint32_t uniqueId)
+{
+    return MODTABLE_Probe(mfgId, partId, uniqueId)->slot;
+}
+
+uint8_t MODTABLE_Register(uint8_t moduleId, uint8_t slot)
+{
+    uint8_t previous;
+
+    // Module ID 0 means not registered
+    if (moduleId == 0) {
+        return MODTABLE_NONE;
+    }
+
+    previous = idTable[moduleId];
+    idTable[moduleId] = slot;
+
+    return previous;
+}
+
+void MODTABLE_Unregister(uint8_t moduleId)
+{
+    if (moduleId != 0) {
+        idTable[moduleId] = MODTABLE_NONE;
+    }
+}
+
+uint8_t MODTABLE_FindId(uint8_t moduleId)
+{
+    return idTable[moduleId];
+}
@@ -0,0 +1,269 @@
+/*******************************************************************************
+  TX Scheduler
+
+  File Name:
+    tx_sched.c
+
+  Summary:
+    Software transmit queues per traffic class in front of the MCP2518FD
+    TXQ and TX FIFOs.
+
+  Description:
+    Each class is a ring of message objects with their data and queue times.
+    A service pass takes the longest run from the head of a ring that does
+    not wrap and that the rate limit allows, and hands it to
+    DRV_CANFDSPI_TransmitChannelLoadBatch, which loads what fits in one SPI
+    burst. SEQ is assigned at load time, so the TX statistics window only
+    has to cover the frames in the FIFOs and the TEF, not the queues.
+
+    The rate limit is a token bucket counted in thousandths of a frame, so
+    rates below 1000 frames per second refill by whole ms ticks.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <string.h>
+#include "tx_sched.h"
+#include "tx_stats.h"
+#include "serial_log.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+#define TXSCHED_FRAME   1000UL      // token bucket credit for one frame
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+typedef struct {
+    CAN_TX_MSGOBJ obj[TXSCHED_QUEUE_DEPTH];
+    uint8_t data[TXSCHED_QUEUE_DEPTH][TXSCHED_PAYLOAD_SIZE];
+    uint32_t queuedAt[TXSCHED_QUEUE_DEPTH];
+    uint8_t head;
+    uint8_t count;
+    bool blocked;           // the FIFO was full on the last pass
+
+    uint32_t credit;
+    uint32_t lastRefill;
+
+    // Counters since the last reset
+    uint32_t queued;
+    uint32_t loaded;
+    uint32_t expired;
+    uint32_t overflowed;
+    uint32_t waitMax;
+    uint8_t depthMax;
+} TXSCHED_QUEUE;
+
+static TXSCHED_CLASS_CONFIG classConfig[TXSCHED_CLASSES];
+static TXSCHED_QUEUE queue[TXSCHED_CLASSES];
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+
+static void TXSCHED_Refill(TXSCHED_QUEUE *q, const TXSCHED_CLASS_CONFIG *c, uint32_t now)
+{
+    uint32_t limit = c->burst * TXSCHED_FRAME;
+    uint32_t elapsed = now - q->lastRefill;
+
+    q->lastRefill = now;
+    if (c->rate == 0) {
+        return;
+    }
+
+    // Saturate before multiplying, a long idle period only refills to the burst
+    if (elapsed > limit / c->rate) {
+        q->credit = limit;
+    } else {
+        q->credit += elapsed * c->rate;
+        if (q->credit > limit) {
+            q->credit = limit;
+        }
+    }
+}
+
+// Drop frames at the head that have waited longer than the class deadline
+static void TXSCHED_Expire(TXSCHED_QUEUE *q, const TXSCHED_CLASS_CONFIG *c, uint32_t now)
+{
+    uint8_t n = 0;
+
+    if (c->deadline == 0) {
+        return;
+    }
+
+    while (q->count && now - q->queuedAt[q->head] > c->deadline) {
+        q->head = (q->head + 1) % TXSCHED_QUEUE_DEPTH;
+        q->count--;
+        n++;
+    }
+    if (n) {
+        q->expired += n;
+        TXSTATS_Discarded(n);
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+void TXSCHED_Init(const TXSCHED_CLASS_CONFIG *config)
+{
+    uint8_t c;
+
+    memcpy(classConfig, config, sizeof(classConfig));
+    memset(queue, 0, sizeof(queue));
+
+    for (c = 0; c < TXSCHED_CLASSES; c++) {
+        // A rate limited class needs room for at least one frame
+        if (classConfig[c].rate && classConfig[c].burst == 0) {
+            classConfig[c].burst = 1;
+        }
+        queue[c].credit = classConfig[c].burst * TXSCHED_FRAME;
+    }
+}
+
+int8_t TXSCHED_Queue(TXSCHED_CLASS cls, const CAN_TX_MSGOBJ *txObj, const uint8_t *txd, uint32_t now)
+{
+    TXSCHED_QUEUE *q = &queue[cls];
+    uint8_t n;
+    uint8_t i;
+
+    n = (uint8_t) DRV_CANFDSPI_DlcToDataBytes((CAN_DLC) txObj->bF.ctrl.DLC);
+    if (n > TXSCHED_PAYLOAD_SIZE) {
+        return -2;
+    }
+
+    // A full queue means the bus or the rate limit cannot keep up, the newest frame goes
+    if (q->count == TXSCHED_QUEUE_DEPTH) {
+        q->overflowed++;
+        TXSTATS_Discarded(1);
+        return -1;
+    }
+
+    i = (q->head + q->count) % TXSCHED_QUEUE_DEPTH;
+    q->obj[i] = *txObj;
+    memcpy(q->data[i], txd, n);
+    q->queuedAt[i] = now;
+    q->count++;
+    q->queued++;
+
+    if (q->count > q->depthMax) {
+        q->depthMax = q->count;
+    }
+
+    return 0;
+}
+
+uint8_t TXSCHED_Service(uint32_t now)
+{
+    const TXSCHED_CLASS_CONFIG *c;
+    TXSCHED_QUEUE *q;
+    uint32_t queued = 0;
+    bool stamped = false;
+    uint8_t total = 0;
+    uint8_t loaded;
+    uint8_t cls;
+    uint8_t n;
+    uint8_t i;
+
+    for (cls = 0; cls < TXSCHED_CLASSES; cls++) {
+        c = &classConfig[cls];
+        q = &queue[cls];
+
+        TXSCHED_Expire(q, c, now);
+        TXSCHED_Refill(q, c, now);
+
+        while (q->count) {
+            // Longest run that does not wrap and that the rate allows
+            n = q->count;
+            if (n > TXSCHED_QUEUE_DEPTH - q->head) {
+                n = TXSCHED_QUEUE_DEPTH - q->head;
+            }
+            if (c->rate && n > q->credit / TXSCHED_FRAME) {
+                n = (uint8_t) (q->credit / TXSCHED_FRAME);
+            }
+            if (n == 0) {
+                break;
+            }
+
+            for (i = 0; i < n; i++) {
+                TXSTATS_Sequence(&q->obj[q->head + i]);
+            }
+
+            // Load time for all frames of this pass, the TEF time stamps give the wire time
+            if (!stamped) {
+                DRV_CANFDSPI_TimeStampGet(DRV_CANFDSPI_INDEX_0, &queued);
+                stamped = true;
+            }
+
+            if (DRV_CANFDSPI_TransmitChannelLoadBatch(DRV_CANFDSPI_INDEX_0, c->fifo, &q->obj[q->head],
+                    q->data[q->head], TXSCHED_PAYLOAD_SIZE, n, &loaded, true) < 0) {
+                break;
+            }
+            TXSTATS_Loaded(&q->obj[q->head], loaded, queued);
+
+            for (i = 0; i < loaded; i++) {
+                if (now - q->queuedAt[q->head + i] > q->waitMax) {
+                    q->waitMax = now - q->queuedAt[q->head + i];
+                }
+            }
+            q->head = (q->head + loaded) % TXSCHED_QUEUE_DEPTH;
+            q->count -= loaded;
+            q->loaded += loaded;
+            if (c->rate) {
+                q->credit -= loaded * TXSCHED_FRAME;
+            }
+            total += loaded;
+
+            // FIFO full, the rest waits for the next pass; count a retry once per stall
+            if (loaded < n) {
+                if (!q->blocked) {
+                    TXSTATS_Retry();
+                }
+                q->blocked = true;
+                break;
+            }
+            q->blocked = false;
+        }
+    }
+
+    return total;
+}
+
+uint8_t TXSCHED_Pending(TXSCHED_CLASS cls)
+{
+    return queue[cls].count;
+}
+
+void TXSCHED_Report(void)
+{
+    TXSCHED_QUEUE *q;
+    uint8_t cls;
+
+    for (cls = 0; cls < TXSCHED_CLASSES; cls++) {
+        q = &queue[cls];
+        LOG_EVENT(LOG_ID_TX_SCHED, cls, q->queued, q->loaded, q->expired, q->overflowed,
+                q->waitMax, q->depthMax, q->count);
+    }
+}
+
+void TXSCHED_Reset(void)
+{
+    TXSCHED_QUEUE *q;
+    uint8_t cls;
+
+    for (cls = 0; cls < TXSCHED_CLASSES; cls++) {
+        q = &queue[cls];
+        q->queued = 0;
+        q->loaded = 0;
+        q->expired = 0;
+        q->overflowed = 0;
+        q->waitMax = 0;
+        q->depthMax = q->count;
+    }
+}
@@ -0,0 +1,120 @@
+/*******************************************************************************
+  TX Statistics
+
+  File Name:
+    tx_stats.c
+
+  Summary:
+    Transmit completion, queue-to-wire latency and loss counters from the
+    MCP2518FD Transmit Event FIFO.
+
+  Description:
+    Queue times are kept in a ring indexed by the low bits of SEQ, which
+    the MCP2517FD (7 bit SEQ) and MCP2518FD (23 bit SEQ) both return
+    unchanged.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include "tx_stats.h"
+#include "serial_log.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+static uint32_t txSeq = 0;
+static uint32_t queueTime[TXSTATS_SEQ_WINDOW];
+
+static uint32_t txLoaded = 0;       // frames put in the TX FIFO
+static uint32_t txSent = 0;         // frames confirmed by the TEF
+static uint32_t txUnloaded = 0;     // frames discarded before reaching the FIFO
+static uint32_t txRetries = 0;
+static uint32_t tefOverflows = 0;
+
+// Latency since the last report reset, TBC ticks
+static uint32_t latencyMin = UINT32_MAX;
+static uint32_t latencyMax = 0;
+static uint64_t latencySum = 0;
+static uint32_t latencyCount = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+void TXSTATS_Sequence(CAN_TX_MSGOBJ *txObj)
+{
+    txObj->bF.ctrl.SEQ = txSeq++;
+}
+
+void TXSTATS_Loaded(const CAN_TX_MSGOBJ *txObj, uint8_t n, uint32_t timeStamp)
+{
+    uint8_t i;
+
+    for (i = 0; i < n; i++) {
+        queueTime[txObj[i].bF.ctrl.SEQ & (TXSTATS_SEQ_WINDOW - 1)] = timeStamp;
+    }
+    txLoaded += n;
+}
+
+void TXSTATS_Retry(void)
+{
+    txRetries++;
+}
+
+void TXSTATS_Discarded(uint32_t n)
+{
+    txUnloaded += n;
+}
+
+void TXSTATS_Sent(const CAN_TEF_MSGOBJ *tefObj)
+{
+    uint32_t latency;
+
+    latency = tefObj->bF.timeStamp - queueTime[tefObj->bF.ctrl.SEQ & (TXSTATS_SEQ_WINDOW - 1)];
+
+    if (latency < latencyMin) {
+        latencyMin = latency;
+    }
+    if (latency > latencyMax) {
+        latencyMax = latency;
+    }
+    latencySum += latency;
+    latencyCount++;
+
+    txSent++;
+}
+
+void TXSTATS_TefOverflow(void)
+{
+    tefOverflows++;
+}
+
+void TXSTATS_Report(void)
+{
+    uint32_t average = 0;
+
+    if (latencyCount) {
+        average = (uint32_t) ((latencySum + (latencyCount / 2)) / latencyCount);
+    }
+
+    LOG_EVENT(LOG_ID_TX_STATS, txLoaded, txSent, txUnloaded, txRetries, tefOverflows,
+            latencyCount ? latencyMin : 0, average, latencyMax);
+}
+
+void TXSTATS_Reset(void)
+{
+    // Only frames still in flight stay counted as loaded
+    txLoaded = txLoaded - txSent;
+    txSent = 0;
+    txUnloaded = 0;
+    txRetries = 0;
+    tefOverflows = 0;
+
+    latencyMin = UINT32_MAX;
+    latencyMax = 0;
+    latencySum = 0;
+    latencyCount = 0;
+}
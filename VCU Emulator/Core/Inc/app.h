@@ -44,8 +44,6 @@
 //! Use RX and TX Interrupt pins to check FIFO status
 #define APP_USE_RX_INT
 
-#define MAX_TXQUEUE_ATTEMPTS 50
-
 
 // Switches
 #define APP_SWITCH_RELEASED true  //Switch has an internal pullup when not pressed - input = 1
@@ -85,12 +83,54 @@
 //#define TST1_OUT	EXT1_PIN_5
 
 
-// Transmit Channels
-#define APP_TX_FIFO CAN_FIFO_CH2
+// Transmit Channels, one per traffic class of the TX scheduler (tx_sched.h).
+// Sizes are depth - 1, TxPriority decides which FIFO goes on the bus first
+#define APP_TXQ_SIZE 3                      // safety and state, TXQ, priority 2
+#define APP_TX_FIFO CAN_FIFO_CH2            // periodic telemetry and bulk, priority 1
+#define APP_TX_FIFO_SIZE 7
+
+// Bulk frames per second and back to back burst
+#define APP_TX_BULK_RATE 100
+#define APP_TX_BULK_BURST 4
+
+// ms a frame may wait in the scheduler before it is stale and discarded, a
+// newer VCU command follows every keep-alive period (SCENARIO_KEEPALIVE_MS)
+#define APP_TX_STATE_DEADLINE 50
+#define APP_TX_TELEMETRY_DEADLINE 200
+#define APP_TX_BULK_DEADLINE 1000
 
 // Receive Channels
 #define APP_RX_FIFO CAN_FIFO_CH1
 
+// High priority receive channel, read before APP_RX_FIFO so urgent commands
+// do not queue behind bulk traffic. Classic frames only, depth - 1
+#define APP_RX_HP_FIFO CAN_FIFO_CH3
+#define APP_RX_HP_FIFO_SIZE 3
+
+// Messages read from the RX FIFO per SPI burst
+#define APP_RX_BATCH_SIZE 4
+
+// Time base counter prescaler, 40 MHz SYSCLK / (39 + 1) = 1 us receive time stamps
+#define APP_TBC_PRESCALER 39
+
+// Transmit Event FIFO depth - 1, holds the frames sent between two drains.
+// Kept at 8 so the TXQ, TX, RX, high priority RX FIFOs and the TEF fit in 2 KB RAM
+#define APP_TEF_FIFO_SIZE 7
+
+// Interval between TEF drains in the run state
+#define APP_TEF_DRAIN_MS 10
+
+// Scenario load over CAN (scenario.h), standard frames of 8 bytes from a
+// host on the pack bus. Byte 0 is the command: begin with the length in
+// bytes 1-2, data with the offset in bytes 1-2 and up to 5 program bytes
+// in 3-7 (DLC says how many), end to check and run it, restart to run it
+// again from the top
+#define APP_SCENARIO_ID         0x4F0
+#define APP_SCENARIO_BEGIN      0x00
+#define APP_SCENARIO_DATA       0x01
+#define APP_SCENARIO_END        0x02
+#define APP_SCENARIO_RESTART    0x03
+
 
 
 
@@ -148,6 +188,10 @@ typedef struct {
 ***************************************************************************************************************/
 extern void VCU_Initialize(void);
 extern void VCU_Tasks(void);
+extern void VCU_TransmitState(packState state);
+extern void VCU_TransmitTime(void);
+extern void VCU_TransmitModuleCommand(uint8_t moduleId, packState state);
+extern void VCU_TransmitKeepAlive(uint8_t moduleId);
 
 extern batteryModule module[MAX_MODULES_PER_PACK];
 extern batteryPack pack;
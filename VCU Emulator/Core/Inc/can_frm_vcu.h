@@ -30,6 +30,24 @@ typedef struct {                                // 0x401 VCU_TIME - 8 bytes
 }CANFRM_0x401_VCU_TIME;
 
 
+typedef struct {                                // 0x404 VCU_MODULE_COMMAND - 8 bytes
+  uint32_t module_id                      : 8;  // 00-07
+  uint32_t module_contactor_ctrl          : 2;  // 08-09  1          0        0       3
+  uint32_t module_cell_balance_ctrl       : 2;  // 10-11  1          0        0       3
+  uint32_t module_hv_bus_actv_iso         : 2;  // 12-13  1          0        0       3
+  uint32_t UNUSED_06_15                   : 10; // 14-23
+  uint32_t vcu_hv_bus_voltage             : 16; // 32-47  0.015      0        0       983.025       Volts             Inverter hv bus voltage, does not fit in the first word
+  uint32_t UNUSED_32_63                   : 24; // 48-71, as the pack controller has it, only 8 bytes are sent
+}CANFRM_0x404_VCU_MODULE_COMMAND;
+
+
+typedef struct {                                // 0x405 VCU_KEEP_ALIVE - 8 bytes
+  uint32_t module_id                      : 8;  // 00-07
+  uint32_t UNUSED_08_31                   : 24; // 08-31
+  uint32_t UNUSED_32_63                   : 32; // 32-63
+}CANFRM_0x405_VCU_KEEP_ALIVE;
+
+
 
 typedef struct {                                // 0x410 BMS_STATE - 8 bytes
                                                 // Bits   Factor     Offset   Min     Max           Unit
@@ -54,7 +54,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include "canfdspi_defines.h"
-#include "Canfdspi_register.h"
+#include "canfdspi_register.h"
 
 // DOM-IGNORE-BEGIN
 #ifdef __cplusplus  // Provide C++ Compatibility
@@ -256,6 +256,21 @@ int8_t DRV_CANFDSPI_TransmitChannelLoad(CANFDSPI_MODULE_ID index,
         CAN_FIFO_CHANNEL channel, CAN_TX_MSGOBJ* txObj,
         uint8_t *txd, uint32_t txdNumBytes, bool flush);
 
+// *****************************************************************************
+//! Load Batch of Transmit Messages
+/*!
+ * Writes up to nMessages objects back to back into TX FIFO RAM using the
+ * geometry cached by TransmitChannelConfigure, then sets UINC per object and
+ * TXREQ once if flush is set. txd holds nMessages * nBytes. Free slots are
+ * tracked locally and refreshed from CiFIFOSTA only when short, so nLoaded
+ * can be less than nMessages when the FIFO is full.
+ */
+
+int8_t DRV_CANFDSPI_TransmitChannelLoadBatch(CANFDSPI_MODULE_ID index,
+        CAN_FIFO_CHANNEL channel, CAN_TX_MSGOBJ* txObj,
+        uint8_t *txd, uint8_t nBytes, uint8_t nMessages, uint8_t *nLoaded,
+        bool flush);
+
 // *****************************************************************************
 //! TX Queue Load
 
@@ -455,6 +470,19 @@ int8_t DRV_CANFDSPI_ReceiveMessageGet(CANFDSPI_MODULE_ID index,
         CAN_FIFO_CHANNEL channel, CAN_RX_MSGOBJ* rxObj,
         uint8_t *rxd, uint8_t nBytes);
 
+// *****************************************************************************
+//! Get Batch of Received Messages
+/*!
+ * Reads up to maxMessages from channel using the FIFO geometry cached by
+ * ReceiveChannelConfigure: one CiFIFOSTA read, then burst reads of
+ * consecutive message objects. rxObj holds maxMessages objects, rxd holds
+ * maxMessages * nBytes. nMessages returns the number read, 0 if empty.
+ */
+
+int8_t DRV_CANFDSPI_ReceiveMessageGetBatch(CANFDSPI_MODULE_ID index,
+        CAN_FIFO_CHANNEL channel, CAN_RX_MSGOBJ* rxObj,
+        uint8_t *rxd, uint8_t nBytes, uint8_t maxMessages, uint8_t *nMessages);
+
 // *****************************************************************************
 //! Receive FIFO Reset
 
@@ -1120,6 +1148,11 @@ int8_t DRV_CANFDSPI_FifoIndexGet(CANFDSPI_MODULE_ID index,
 
 // *****************************************************************************
 //! Calculate CRC16
+/*!
+ * Polynomial 0x8005, seed 0xFFFF, as used by the SPI CRC instructions.
+ * DRV_CANFDSPI_CRC16_SLICES selects 1, 4 or 8 table look-ups per step,
+ * DRV_CANFDSPI_CRC16_HW uses the CRC unit where it is programmable.
+ */
 
 uint16_t DRV_CANFDSPI_CalculateCRC16(uint8_t* data, uint16_t size);
 
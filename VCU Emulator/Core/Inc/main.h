@@ -40,9 +40,6 @@ extern "C" {
 extern uint32_t etTimerOverflows;
 extern TIM_HandleTypeDef htim1;
 extern uint8_t decSec;
-extern uint16_t secondCounter;
-extern uint8_t sendState;
-extern uint8_t changeState;
 
 /* USER CODE END ET */
 
@@ -62,6 +59,7 @@ void Error_Handler(void);
 /* USER CODE BEGIN EFP */
 void getTime(void);
 void serialOut(char* message);
+void serialCommand(void);
 
 extern void writeRTC(time_t now);
 extern time_t readRTC(void);
@@ -106,20 +104,30 @@ extern time_t readRTC(void);
 #define SPI_TIMEOUT			100
 
 // Debug Levels
-#define DEBUG_LEVEL     0x07
+#define DEBUG_LEVEL     0x17
 #define DBG_DISABLED    0x00
 #define DBG_ERRORS      0x01
 #define DBG_PCU         0x02
 #define DBG_VCU         0x04
 #define DBG_VERBOSE     0x08
+#define DBG_TRACE       0x10    // received frames into the trace ring (rx_trace.h)
+
+// Levels compiled in. Output for any other level is a constant false in
+// DBG_ENABLED, the compiler drops the test, the call and its arguments
+#define DEBUG_COMPILED  (DBG_ERRORS | DBG_PCU | DBG_VCU | DBG_VERBOSE | DBG_TRACE)
+
+// Every bit of level compiled in and set in debugLevel
+#define DBG_ENABLED(level)  ((((DEBUG_COMPILED) & (level)) == (level)) && ((debugLevel & (level)) == (level)))
 
 extern uint8_t debugLevel;
 
+// Scenario at start up, a state digit (packState) every STATE_INTERVAL
+// seconds. A scenario loaded over UART or CAN replaces it, see scenario.h
 #define MAX_SEQUENCE_LEN      80
 
 #define STATE_SEQUENCE        "0123"
 #define STATE_REPEAT          1
-#define STATE_INTERVAL        60      // seconds - max 65536 = 18 hours+
+#define STATE_INTERVAL        60      // seconds - max 65535 = 18 hours+
 
 // Code anchor for break points
 #define Nop() asm("nop")
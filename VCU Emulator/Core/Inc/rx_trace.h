@@ -0,0 +1,86 @@
+/*******************************************************************************
+  RX Trace
+
+  File Name:
+    rx_trace.h
+
+  Summary:
+    Binary ring of the last received frames for host decoding.
+
+  Description:
+    RXTRACE_Frame copies a received frame into a 20 byte entry (ID, receive
+    time stamp, DLC, flags, a sequence number and the first 8 data bytes)
+    and returns, nothing is formatted. The ring keeps the last RXTRACE_DEPTH
+    frames and overwrites the oldest, so it can stay on through a bus load
+    test and still hold what led up to a failure.
+
+    RXTRACE_Dump starts sending the ring to the log as LOG_ID_VCU_RX_TRACE
+    records; RXTRACE_Tasks sends a few per pass while the log ring has room,
+    so a dump never crowds out other records. Frames keep being recorded
+    during a dump. Gaps in the sequence numbers are frames that were
+    overwritten before they were sent.
+
+    Single producer and consumer in thread mode, like the log.
+ *******************************************************************************/
+
+#ifndef _RX_TRACE_H
+#define _RX_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "canfdspi_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Frames kept, a power of two
+#define RXTRACE_DEPTH       256
+
+// Records sent per RXTRACE_Tasks call during a dump
+#define RXTRACE_DUMP_BURST  4
+
+// Entry flags
+#define RXTRACE_FDF         0x01    // CAN FD frame
+#define RXTRACE_BRS         0x02    // data phase at the data bit rate
+#define RXTRACE_ESI         0x04    // sender error passive
+#define RXTRACE_TRUNCATED   0x08    // more than 8 data bytes, only 8 kept
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+typedef struct {
+    uint32_t id;            // SID | EID << 11 | IDE << 29, as RX statistics
+    uint32_t timeStamp;     // TBC at start of frame, us
+    uint16_t seq;           // frames recorded before this one
+    uint8_t  dlc;
+    uint8_t  flags;         // RXTRACE_FDF ...
+    uint8_t  data[8];
+} RXTRACE_ENTRY;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Record one frame, call once per object read from an RX FIFO
+void RXTRACE_Frame(const CAN_RX_MSGOBJ *rxObj, const uint8_t *data);
+
+//! Send the frames held now to the log, oldest first
+void RXTRACE_Dump(void);
+
+//! Continue a dump, call from the main loop
+void RXTRACE_Tasks(void);
+
+//! Forget the recorded frames
+void RXTRACE_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RX_TRACE_H
@@ -0,0 +1,143 @@
+/*******************************************************************************
+  Scenario Engine
+
+  File Name:
+    scenario.h
+
+  Summary:
+    Bytecode interpreter for scripted VCU behaviour.
+
+  Description:
+    A scenario is a short program of byte coded instructions that drives
+    what the VCU Emulator sends to the pack controller: contactor states
+    and how long to hold them, gaps in the keep-alive, time sync, direct
+    module commands, bursts of frames at a set rate and waits on the state
+    the BMS reports. Programs are loaded at run time over the UART or CAN,
+    so load tests of a pack controller are reproducible and need no
+    rebuild. The compile time STATE_SEQUENCE is translated into a program
+    at start up.
+
+    The program runs once the pack controller has made contact and
+    restarts from the beginning when contact is lost. The VCU command
+    (0x400) carrying the current state is sent every keep-alive period
+    alongside whatever the program does; END stops the program but not the
+    keep-alive, the last state is held.
+
+    Instructions, operands little endian:
+
+      op    name        operands                    bytes
+      0x00  END                                     1
+      0x01  STATE       state u8 (packState)        2
+      0x02  WAIT        ms u16                      3
+      0x03  WAIT_S      s u16                       3
+      0x04  KEEPALIVE   period ms u16, 0 = gap      3
+      0x05  TIME                                    1
+      0x06  MODULE      module ID u8, state u8      3
+      0x07  BURST       frame u8, arg u8,           7
+                        count u16, period ms u16
+      0x08  WAIT_BMS    state u8, timeout ms u16    4
+      0x09  REPEAT      count u16, 0 = forever      3
+      0x0A  NEXT                                    1
+
+    BURST sends count frames of one kind (SCENARIO_FRAME) period ms apart,
+    period 0 sends one per pass as fast as the transmit scheduler takes
+    them. arg is the module ID for module commands and keep-alives.
+    WAIT_BMS holds until the last BMS_STATE reported the state; a timeout
+    (0 waits forever) stops the program, so a failed expectation is
+    visible in the log. REPEAT and NEXT nest up to SCENARIO_LOOP_DEPTH.
+
+    Everything is static, a program is checked when it is loaded and the
+    interpreter never allocates.
+ *******************************************************************************/
+
+#ifndef _SCENARIO_H
+#define _SCENARIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Program size in bytes, a STATE_SEQUENCE of MAX_SEQUENCE_LEN states takes 405
+#define SCENARIO_SIZE           512
+
+// REPEAT blocks open at once
+#define SCENARIO_LOOP_DEPTH     4
+
+// Instructions run per SCENARIO_Tasks call, bounds a loop without a wait
+#define SCENARIO_STEPS_PER_PASS 16
+
+// ms between VCU commands when the program does not say otherwise
+#define SCENARIO_KEEPALIVE_MS   200
+
+// Opcodes
+#define SCENARIO_OP_END         0x00
+#define SCENARIO_OP_STATE       0x01
+#define SCENARIO_OP_WAIT        0x02
+#define SCENARIO_OP_WAIT_S      0x03
+#define SCENARIO_OP_KEEPALIVE   0x04
+#define SCENARIO_OP_TIME        0x05
+#define SCENARIO_OP_MODULE      0x06
+#define SCENARIO_OP_BURST       0x07
+#define SCENARIO_OP_WAIT_BMS    0x08
+#define SCENARIO_OP_REPEAT      0x09
+#define SCENARIO_OP_NEXT        0x0A
+#define SCENARIO_OP_COUNT       0x0B    // opcodes from here on are invalid
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+//! Frames a BURST can send
+typedef enum {
+    SCENARIO_FRAME_COMMAND = 0,     // 0x400 VCU command with the current state
+    SCENARIO_FRAME_TIME,            // 0x401 VCU time
+    SCENARIO_FRAME_MODULE,          // 0x404 module command, current state to module arg
+    SCENARIO_FRAME_KEEPALIVE,       // 0x405 keep-alive for module arg
+    SCENARIO_FRAMES
+} SCENARIO_FRAME;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Replace the program with one stepping through a string of state digits
+//! Returns 0, -1 if the sequence is empty, too long or holds anything but 0-3
+int8_t SCENARIO_FromSequence(const char *sequence, uint16_t intervalS, bool repeat);
+
+//! Start the program from the beginning with the pack off
+void SCENARIO_Restart(void);
+
+//! Run the program, call from the main loop while the pack controller is in contact
+void SCENARIO_Tasks(uint32_t now);
+
+//! State of the last BMS_STATE frame, for WAIT_BMS
+void SCENARIO_BmsState(uint8_t state);
+
+//! Start loading a program of length bytes, the running one carries on until SCENARIO_LoadEnd
+//! Returns 0, -1 if it does not fit
+int8_t SCENARIO_LoadBegin(uint16_t length);
+
+//! Program bytes at offset, in order from 0
+//! Returns 0, -1 without a load in progress, out of order (a chunk was lost) or past the length
+int8_t SCENARIO_LoadData(uint16_t offset, const uint8_t *data, uint8_t n);
+
+//! Check the loaded program and run it in place of the current one
+//! Returns 0, -1 without a complete load, -2 bad opcode, -3 truncated instruction,
+//! -4 bad operand, -5 unbalanced REPEAT/NEXT
+int8_t SCENARIO_LoadEnd(void);
+
+//! Log where the program is
+void SCENARIO_Report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SCENARIO_H
@@ -0,0 +1,109 @@
+/*******************************************************************************
+  Serial Log
+
+  File Name:
+    serial_log.h
+
+  Summary:
+    Non-blocking UART logging through a record ring drained by DMA.
+
+  Description:
+    Callers append compact records (ID, tick, argument words) to a ring and
+    return at once; nothing is formatted and the RTC is not read on the
+    caller's path. LOG_Tasks, run from the main loop, moves records to a DMA
+    buffer whenever the UART is idle.
+
+    With LOG_OUTPUT_BINARY set the records go out as they are and the host
+    Log Decoder expands them. Otherwise LOG_Tasks formats them into text lines
+    on the target, still off the caller's path.
+
+    The ring has one producer and one consumer, both in thread mode: do not
+    log from interrupt handlers. When the ring is full records are dropped and
+    counted, and a LOG_ID_LOST record is sent once there is room.
+ *******************************************************************************/
+
+#ifndef _SERIAL_LOG_H
+#define _SERIAL_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "main.h"
+#include "log_events.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Ring size in bytes, must be a power of two
+#define LOG_RING_SIZE       2048
+
+// Bytes handed to the DMA per transfer
+#define LOG_DMA_SIZE        256
+
+// Longest text record
+#define LOG_TEXT_MAX        MAX_BUFFER
+
+// 1: send binary records, 0: send text lines
+#ifndef LOG_OUTPUT_BINARY
+#define LOG_OUTPUT_BINARY   1
+#endif
+
+// Records one LOG_ID_* event, arguments are 32 bit words
+#define LOG_EVENT(id, ...) \
+    do { \
+        const uint32_t logArgs_[] = { __VA_ARGS__ }; \
+        LOG_Record((id), logArgs_, sizeof(logArgs_) / sizeof(logArgs_[0])); \
+    } while (0)
+
+#define LOG_EVENT0(id)      LOG_Record((id), NULL, 0)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Set the UART the log drains to
+void LOG_Init(UART_HandleTypeDef *huart);
+
+//! Tie the tick to wall clock time, logs a LOG_ID_RTC record
+void LOG_TimeSync(uint8_t hours, uint8_t minutes, uint8_t seconds);
+
+//! Append a text record
+void LOG_Text(const char *message);
+
+//! Append an event record with nArgs argument words
+void LOG_Record(uint8_t id, const uint32_t *args, uint8_t nArgs);
+
+//! Start the next DMA transfer if the UART is idle, call from the main loop
+void LOG_Tasks(void);
+
+//! Call from HAL_UART_TxCpltCallback
+void LOG_TxComplete(UART_HandleTypeDef *huart);
+
+//! Records dropped because the ring was full
+uint32_t LOG_LostGet(void);
+
+//! Bytes free in the ring, for callers that pace bulk output
+uint32_t LOG_FreeGet(void);
+
+//! Float argument for %f
+static inline uint32_t LOG_F(float f)
+{
+    union {
+        float f;
+        uint32_t word;
+    } v;
+
+    v.f = f;
+    return v.word;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SERIAL_LOG_H
@@ -0,0 +1,96 @@
+/*******************************************************************************
+  TX Scheduler
+
+  File Name:
+    tx_sched.h
+
+  Summary:
+    Software transmit queues per traffic class in front of the MCP2518FD
+    TXQ and TX FIFOs.
+
+  Description:
+    Frames are queued in one of three classes: safety and state, periodic
+    telemetry and bulk diagnostics. Each class has its own software queue
+    and its own hardware TX FIFO (or the TXQ), so a burst of one class can
+    fill its FIFO without taking slots from another, and the controller
+    picks the next frame for the bus by FIFO priority.
+
+    TXSCHED_Service moves frames from the queues to the FIFOs, highest class
+    first. It never waits for a FIFO to drain: what does not fit stays queued
+    for the next call. A class can be limited to a frame rate with a burst
+    allowance, and frames older than the class deadline are discarded rather
+    than sent late. Call TXSCHED_Service from the main loop and after queuing
+    a burst; call everything from thread mode.
+ *******************************************************************************/
+
+#ifndef _TX_SCHED_H
+#define _TX_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "canfdspi_api.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Frames each class can hold in software
+#ifndef TXSCHED_QUEUE_DEPTH
+#define TXSCHED_QUEUE_DEPTH 32
+#endif
+
+// Data bytes kept per frame, all emulator frames are classic CAN
+#define TXSCHED_PAYLOAD_SIZE 8
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+//! Traffic classes, highest priority first
+typedef enum {
+    TXSCHED_STATE,          // safety and state, contactor commands, keep-alive
+    TXSCHED_TELEMETRY,      // periodic status
+    TXSCHED_BULK,           // cell detail, hardware, announcements
+    TXSCHED_CLASSES
+} TXSCHED_CLASS;
+
+//! Per class setup
+typedef struct {
+    CAN_FIFO_CHANNEL fifo;  // TX FIFO or CAN_TXQUEUE_CH0, classes may share one
+    uint16_t rate;          // frames per second, 0 = no limit
+    uint8_t burst;          // frames that may be sent back to back under the rate limit
+    uint16_t deadline;      // ms a frame may wait in the queue, 0 = no limit
+} TXSCHED_CLASS_CONFIG;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Set up the classes from an array of TXSCHED_CLASSES entries and empty the queues
+void TXSCHED_Init(const TXSCHED_CLASS_CONFIG *config);
+
+//! Queue a frame at time now (ms)
+//! Returns 0, -1 if the class queue is full, -2 if the data does not fit TXSCHED_PAYLOAD_SIZE
+int8_t TXSCHED_Queue(TXSCHED_CLASS cls, const CAN_TX_MSGOBJ *txObj, const uint8_t *txd, uint32_t now);
+
+//! Move queued frames to the FIFOs, returns the number loaded
+uint8_t TXSCHED_Service(uint32_t now);
+
+//! Frames waiting in the queue of a class
+uint8_t TXSCHED_Pending(TXSCHED_CLASS cls);
+
+//! Log one LOG_ID_TX_SCHED record per class
+void TXSCHED_Report(void);
+
+//! Clear the counters
+void TXSCHED_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TX_SCHED_H
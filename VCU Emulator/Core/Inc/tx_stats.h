@@ -0,0 +1,73 @@
+/*******************************************************************************
+  TX Statistics
+
+  File Name:
+    tx_stats.h
+
+  Summary:
+    Transmit completion, queue-to-wire latency and loss counters from the
+    MCP2518FD Transmit Event FIFO.
+
+  Description:
+    Every frame gets a sequence number in its SEQ field when it is loaded
+    into a TX FIFO. The TBC is read when a batch of frames is loaded, and the
+    TEF returns the SEQ of each frame that went out together with the TBC at
+    its start of frame, so the difference is the time the frame spent in the
+    TX FIFO while the bus was busy or higher priority FIFOs went first. Time
+    spent in the software queues is reported by TXSCHED_Report. A growing latency and a non zero drop count
+    are the signs of a saturated bus.
+
+    TXSTATS_Report logs one LOG_ID_TX_STATS record. Call from thread mode.
+ *******************************************************************************/
+
+#ifndef _TX_STATS_H
+#define _TX_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "canfdspi_defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Queue times kept, power of two larger than the TX FIFOs plus TEF depth
+#define TXSTATS_SEQ_WINDOW  64
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+//! Give a frame the next sequence number, before it is loaded
+void TXSTATS_Sequence(CAN_TX_MSGOBJ *txObj);
+
+//! n frames were loaded into the TX FIFO, timeStamp is the TBC when they were queued
+void TXSTATS_Loaded(const CAN_TX_MSGOBJ *txObj, uint8_t n, uint32_t timeStamp);
+
+//! A load found the TX FIFO full and has to be repeated
+void TXSTATS_Retry(void);
+
+//! n frames were discarded by the application before reaching a TX FIFO
+void TXSTATS_Discarded(uint32_t n);
+
+//! A frame read from the TEF
+void TXSTATS_Sent(const CAN_TEF_MSGOBJ *tefObj);
+
+//! The TEF overflowed, some completions were lost
+void TXSTATS_TefOverflow(void);
+
+//! Log the counters and latencies since the last reset
+void TXSTATS_Report(void);
+
+//! Clear counters and latencies, sequence numbering continues
+void TXSTATS_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _TX_STATS_H
@@ -17,6 +17,13 @@
 #include "../../../Pack-Controller-EEPROM/protocols/can_frm_bms_diag.h"
 #include "can_id_bms_vcu.h"
 #include "can_id_bms_diag.h"
+#include "serial_log.h"
+#include "rx_stats.h"
+#include "tx_stats.h"
+#include "can_filter.h"
+#include "tx_sched.h"
+#include "scenario.h"
+#include "rx_trace.h"
 
 //#include "led.h"
 
@@ -25,11 +32,14 @@
 //! Function prototypes
 void VCU_Initialize(void);
 void VCU_TransmitMessageQueue(void);
+TXSCHED_CLASS VCU_TransmitClass(uint16_t sid);
+void VCU_TransmitService(void);
+void VCU_TefDrain(void);
 void VCU_ReceiveMessage_Tasks(void);
 void VCU_Tasks(void);
 bool VCU_TestRegisterAccess(void);
 bool VCU_TestRamAccess(void);
-void VCU_TransmitState(packState state);
+void VCU_ProcessScenarioLoad(void);
 
 void VCU_ProcessState(void);
 void VCU_ProcessData1(void);
@@ -55,7 +65,7 @@ void APP_TransmitStatus(uint8_t index);
 void APP_ReplyToCellDetailRequest(void);
 void APP_TransmitCellZeroDetails(uint8_t index);
 uint32_t VCU_TicksSinceLastMessage(void);
-packState VCU_GetState(uint8_t index);
+LOG_RAW_NAME VCU_RawName(uint16_t sid);
 
 
 /***************************************************************************************************************
@@ -75,6 +85,20 @@ CAN_TX_FIFO_CONFIG txConfig;
 CAN_TX_FIFO_EVENT txFlags;
 CAN_TX_MSGOBJ txObj;
 uint8_t txd[MAX_DATA_BYTES];
+CAN_TX_QUEUE_CONFIG txqConfig;
+
+// Transmit scheduler classes, see VCU_TransmitClass. Bulk shares the TX FIFO
+static const TXSCHED_CLASS_CONFIG txClasses[TXSCHED_CLASSES] = {
+    // FIFO             rate/s              burst               deadline ms
+    {CAN_TXQUEUE_CH0,   0,                  0,                  APP_TX_STATE_DEADLINE},
+    {APP_TX_FIFO,       0,                  0,                  APP_TX_TELEMETRY_DEADLINE},
+    {APP_TX_FIFO,       APP_TX_BULK_RATE,   APP_TX_BULK_BURST,  APP_TX_BULK_DEADLINE},
+};
+
+// Transmit event objects
+CAN_TEF_CONFIG tefConfig;
+CAN_TEF_MSGOBJ tefObj;
+uint32_t tefLastDrain = 0;
 
 // Receive objects
 CAN_RX_FIFO_CONFIG rxConfig;
@@ -83,6 +107,29 @@ REG_CiMASK mObj;
 CAN_RX_FIFO_EVENT rxFlags;
 CAN_RX_MSGOBJ rxObj;
 uint8_t rxd[MAX_DATA_BYTES];
+CAN_RX_MSGOBJ rxBatchObj[APP_RX_BATCH_SIZE];
+uint8_t rxBatchData[APP_RX_BATCH_SIZE][MAX_DATA_BYTES];
+uint8_t rxCount;
+
+// IDs with a case in VCU_ReceiveMessage_Tasks, urgent ones first so their
+// filters take precedence. The pack only sends standard frames to the VCU
+static const CANFILTER_ID rxFilterIds[] = {
+    {ID_BMS_STATE,        CANFILTER_STANDARD, APP_RX_HP_FIFO},
+    {ID_BMS_DATA_1,       CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_DATA_2,       CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_DATA_3,       CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_DATA_5,       CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_DATA_8,       CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_DATA_9,       CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_DATA_10,      CANFILTER_STANDARD, APP_RX_FIFO},
+    {ID_BMS_TIME_REQUEST, CANFILTER_STANDARD, APP_RX_FIFO},
+    {APP_SCENARIO_ID,     CANFILTER_STANDARD, APP_RX_FIFO},
+};
+CANFILTER_RULE rxFilters[CAN_FILTER_TOTAL];
+int8_t rxFilterCount;
+
+// Read in this order, see APP_RX_HP_FIFO
+static const CAN_FIFO_CHANNEL rxFifos[] = {APP_RX_HP_FIFO, APP_RX_FIFO};
 
 uint32_t delayCount = APP_LED_TIME;
 
@@ -115,10 +162,6 @@ extern uint8_t canTxInterrupt;
 extern void serialOut(char* message);
 extern moduleState vcuStateRequested;
 
-char    stateSequence[MAX_SEQUENCE_LEN];
-uint8_t sequenceIndex;
-uint8_t sequenceLen;
-
 /***************************************************************************************************************
 *
 *                   Section: Application Local Functions                                 V C U   E M U L A T O R
@@ -242,21 +285,11 @@ void VCU_Tasks(void)
           APP_LED_Clear(APP_INIT_LED);
 
 
-          memset(&stateSequence[0], 0, sizeof(stateSequence));
-
-          if (strlen(STATE_SEQUENCE) == 0){
-            if(debugLevel & (DBG_ERRORS)){ sprintf(tempBuffer,"ERROR - STATE_SEQUENCE length = 0! Default sequence 0123 set."); serialOut(tempBuffer);}
-            strncpy(stateSequence, "0123", 5);
-          }else if (strlen(STATE_SEQUENCE) > MAX_SEQUENCE_LEN){
-            if(debugLevel & (DBG_ERRORS)){ sprintf(tempBuffer,"ERROR - STATE_SEQUENCE length > MAX_SEQUENCE_LEN! Default sequence 0123 set."); serialOut(tempBuffer);}
-            strncpy(stateSequence, "0123", 5);
-          }else{
-            strncpy(stateSequence, STATE_SEQUENCE, strlen(STATE_SEQUENCE)+1);
+          // The compile time sequence is the scenario until one is loaded
+          if (strlen(STATE_SEQUENCE) > MAX_SEQUENCE_LEN || SCENARIO_FromSequence(STATE_SEQUENCE, STATE_INTERVAL, STATE_REPEAT) != 0){
+            if(debugLevel & (DBG_ERRORS)){ sprintf(tempBuffer,"ERROR - STATE_SEQUENCE empty, too long or not 0-3! Default sequence 0123 set."); serialOut(tempBuffer);}
+            SCENARIO_FromSequence("0123", STATE_INTERVAL, STATE_REPEAT);
           }
-          sequenceLen     = strlen(stateSequence);
-          sequenceIndex   = 0;
-          // get the initial state
-          vcuState = VCU_GetState(sequenceIndex);
 
           //reset counter since last contact
           pack.lastFrame.ticks = htim1.Instance->CNT;
@@ -273,35 +306,22 @@ void VCU_Tasks(void)
 
           //Check for expired last contact from Pack Controller
           if(VCU_TicksSinceLastMessage() > PCU_ET_TIMEOUT){
-            vcuState = packOff;
-            sequenceIndex = 0;
+            // pack off, the scenario starts again at the next contact
+            SCENARIO_Restart();
             activeConnection = 0;
             if(debugLevel & (DBG_PCU)){ sprintf(tempBuffer,"PC LOST CONTACT TIMEOUT!"); serialOut(tempBuffer);}
           }
-          // only start sending state data once pack controller has contacted us
+          // only run the scenario once pack controller has contacted us
           if(activeConnection){
+            SCENARIO_Tasks(HAL_GetTick());
+          }
 
-            if(changeState){
-              // any more states in the sequence?
-              if(sequenceIndex < sequenceLen){
-                // yes - next state
-                sequenceIndex++;
-              } else {
-                // no - are we repeating the sequence
-                if(STATE_REPEAT == true){
-                  // yes - reset to beginning, otherwise hold the last state indefinitely
-                  sequenceIndex = 0;
-                }
-              }
-              vcuState = VCU_GetState(sequenceIndex);
-              changeState = 0;
-            }
-
-            // sendState fires at interval defined by STATE_INTERVAL
-            if (sendState){
-              VCU_TransmitState(vcuState);
-              sendState = 0;
-            }
+          // Load frames that were waiting for FIFO space or their rate limit
+          VCU_TransmitService();
+
+          // Collect transmit completions
+          if (HAL_GetTick() - tefLastDrain >= APP_TEF_DRAIN_MS) {
+            VCU_TefDrain();
           }
 
           break;
@@ -359,78 +379,99 @@ void APP_CANFDSPI_Init(void)
     // Configure device
     DRV_CANFDSPI_ConfigureObjectReset(&config);
     config.IsoCrcEnable = 1;
-    config.StoreInTEF = 0;
+    config.StoreInTEF = 1;
+    config.TXQEnable = 1;
 
     DRV_CANFDSPI_Configure(DRV_CANFDSPI_INDEX_0, &config);
 
-    // Setup TX FIFO
+    // Setup TXQ, VCU command
+    DRV_CANFDSPI_TransmitQueueConfigureObjectReset(&txqConfig);
+    txqConfig.FifoSize = APP_TXQ_SIZE;
+    txqConfig.PayLoadSize = CAN_PLSIZE_8;
+    txqConfig.TxPriority = 2;
+
+    DRV_CANFDSPI_TransmitQueueConfigure(DRV_CANFDSPI_INDEX_0, &txqConfig);
+
+    // Setup TX FIFO, everything else
     DRV_CANFDSPI_TransmitChannelConfigureObjectReset(&txConfig);
-    txConfig.FifoSize = 7;
+    txConfig.FifoSize = APP_TX_FIFO_SIZE;
     txConfig.PayLoadSize = CAN_PLSIZE_64;
     txConfig.TxPriority = 1;
 
     DRV_CANFDSPI_TransmitChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, &txConfig);
 
+    // Setup TEF, transmitted frames come back with SEQ and time stamp
+    DRV_CANFDSPI_TefConfigureObjectReset(&tefConfig);
+    tefConfig.FifoSize = APP_TEF_FIFO_SIZE;
+    tefConfig.TimeStampEnable = 1;
+
+    DRV_CANFDSPI_TefConfigure(DRV_CANFDSPI_INDEX_0, &tefConfig);
+
     // Setup RX FIFO
     DRV_CANFDSPI_ReceiveChannelConfigureObjectReset(&rxConfig);
     rxConfig.FifoSize = 15;
     rxConfig.PayLoadSize = CAN_PLSIZE_64;
+    rxConfig.RxTimeStampEnable = 1;
 
     DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxConfig);
 
-    // Setup RX Filter
-    fObj.word = 0;
-    //fObj.bF.SID = 0xda;
-    fObj.bF.SID = 0x00;
-    fObj.bF.EXIDE = 0;
-    fObj.bF.EID = 0x00;
-
-    DRV_CANFDSPI_FilterObjectConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &fObj.bF);
-
-    // Setup RX Mask
-    mObj.word = 0;
-    mObj.bF.MSID = 0x0;
-    mObj.bF.MIDE = 1; // Only allow standard IDs
-    mObj.bF.MEID = 0x0;
-    DRV_CANFDSPI_FilterMaskConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &mObj.bF);
-
-    // Link FIFO and Filter
-    DRV_CANFDSPI_FilterToFifoLink(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, APP_RX_FIFO, true);
+    // Setup high priority RX FIFO
+    DRV_CANFDSPI_ReceiveChannelConfigureObjectReset(&rxConfig);
+    rxConfig.FifoSize = APP_RX_HP_FIFO_SIZE;
+    rxConfig.PayLoadSize = CAN_PLSIZE_8;
+    rxConfig.RxTimeStampEnable = 1;
+
+    DRV_CANFDSPI_ReceiveChannelConfigure(DRV_CANFDSPI_INDEX_0, APP_RX_HP_FIFO, &rxConfig);
+
+    // Setup RX Filters, only the IDs handled in VCU_ReceiveMessage_Tasks are read over SPI
+    rxFilterCount = CANFILTER_Build(rxFilterIds, sizeof(rxFilterIds) / sizeof(rxFilterIds[0]), rxFilters, CAN_FILTER_TOTAL);
+    if (rxFilterCount > 0) {
+      CANFILTER_Apply(DRV_CANFDSPI_INDEX_0, rxFilters, rxFilterCount);
+    } else {
+      // Accept all into APP_RX_FIFO as before
+      fObj.word = 0;
+      //fObj.bF.SID = 0xda;
+      fObj.bF.SID = 0x00;
+      fObj.bF.EXIDE = 0;
+      fObj.bF.EID = 0x00;
+
+      DRV_CANFDSPI_FilterObjectConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &fObj.bF);
+
+      // Setup RX Mask
+      mObj.word = 0;
+      mObj.bF.MSID = 0x0;
+      mObj.bF.MIDE = 1; // Only allow standard IDs
+      mObj.bF.MEID = 0x0;
+      DRV_CANFDSPI_FilterMaskConfigure(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, &mObj.bF);
+
+      // Link FIFO and Filter
+      DRV_CANFDSPI_FilterToFifoLink(DRV_CANFDSPI_INDEX_0, CAN_FILTER0, APP_RX_FIFO, true);
+    }
 
     // Setup Bit Time
     DRV_CANFDSPI_BitTimeConfigure(DRV_CANFDSPI_INDEX_0, CAN_500K_2M, CAN_SSP_MODE_AUTO, CAN_SYSCLK_40M);
 
+    // Setup Time Base, received messages are stamped at start of frame
+    DRV_CANFDSPI_TimeStampPrescalerSet(DRV_CANFDSPI_INDEX_0, APP_TBC_PRESCALER);
+    DRV_CANFDSPI_TimeStampModeConfigure(DRV_CANFDSPI_INDEX_0, CAN_TS_SOF);
+    DRV_CANFDSPI_TimeStampEnable(DRV_CANFDSPI_INDEX_0);
+
     // Setup Transmit and Receive Interrupts
     DRV_CANFDSPI_GpioModeConfigure(DRV_CANFDSPI_INDEX_0, GPIO_MODE_INT, GPIO_MODE_INT);
 	#ifdef APP_USE_TX_INT
     DRV_CANFDSPI_TransmitChannelEventEnable(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, CAN_TX_FIFO_NOT_FULL_EVENT);
 	#endif
     DRV_CANFDSPI_ReceiveChannelEventEnable(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, CAN_RX_FIFO_NOT_EMPTY_EVENT);
+    DRV_CANFDSPI_ReceiveChannelEventEnable(DRV_CANFDSPI_INDEX_0, APP_RX_HP_FIFO, CAN_RX_FIFO_NOT_EMPTY_EVENT);
     DRV_CANFDSPI_ModuleEventEnable(DRV_CANFDSPI_INDEX_0, CAN_TX_EVENT | CAN_RX_EVENT);
 
     // Select Normal Mode
     DRV_CANFDSPI_OperationModeSelect(DRV_CANFDSPI_INDEX_0, CAN_NORMAL_MODE);
-}
-
-/***************************************************************************************************************
-*     V C U _ G e t S t a t e                                                            V C U   E M U L A T O R
-***************************************************************************************************************/
-packState VCU_GetState(uint8_t index)
-{
-  packState state;
-  state = stateSequence[sequenceIndex] - '0';
-
-  if (state > packOn || state < packOff){
-    //rubbish data in the sequence
-    if(debugLevel & DBG_ERRORS){ sprintf(tempBuffer,"ERROR - STATE_SEQUENCE bad data at index %d!",sequenceIndex); serialOut(tempBuffer);}
-    state = 0;
-  }
-
 
-  return state;
+    // Empty transmit queues
+    TXSCHED_Init(txClasses);
 }
 
-
 /***************************************************************************************************************
 *     V C U _ R e c e i v e M e s s a g e _ T a s k s                                    V C U   E M U L A T O R
 ***************************************************************************************************************/
@@ -440,64 +481,67 @@ void VCU_ReceiveMessage_Tasks(void)
     // CANPKT_REGISTER registration;
     //uint8_t index;
 
-    // Check if FIFO is not empty
-    DRV_CANFDSPI_ReceiveChannelEventGet(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxFlags);
+    // High priority FIFO first, then up to a batch of messages at a time,
+    // a full batch means there may be more
+    for (uint8_t f = 0; f < sizeof(rxFifos) / sizeof(rxFifos[0]); f++) {
+      do {
+        DRV_CANFDSPI_ReceiveMessageGetBatch(DRV_CANFDSPI_INDEX_0, rxFifos[f], rxBatchObj, rxBatchData[0], MAX_DATA_BYTES, APP_RX_BATCH_SIZE, &rxCount);
 
-    while ( rxFlags & CAN_RX_FIFO_NOT_EMPTY_EVENT){
+        for (uint8_t n = 0; n < rxCount; n++) {
+          rxObj = rxBatchObj[n];
+          memcpy(rxd, rxBatchData[n], MAX_DATA_BYTES);
+          RXSTATS_Update(&rxObj);
 
-      // Get message
-      DRV_CANFDSPI_ReceiveMessageGet(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxObj, rxd, MAX_DATA_BYTES);
+          // Every frame into the trace ring, a copy and no formatting
+          if (DBG_ENABLED(DBG_TRACE)) {RXTRACE_Frame(&rxObj, rxd);}
 
-      activeConnection = 1;
-      // reset last contact
-      pack.lastFrame.ticks = htim1.Instance->CNT;
-      pack.lastFrame.overflows = etTimerOverflows;
+          // Frames as log records as they arrive, for a quiet bus
+          if (DBG_ENABLED(DBG_PCU + DBG_VERBOSE)) {LOG_EVENT(LOG_ID_VCU_RX_RAW, VCU_RawName(rxObj.bF.id.SID), rxObj.bF.id.SID, rxd[0], rxd[1], rxd[2], rxd[3], rxd[4], rxd[5], rxd[6], rxd[7]);}
 
-      switch (rxObj.bF.id.SID) {
-        case ID_BMS_DATA_1:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_1 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData1();
-          break;
-        case ID_BMS_DATA_2:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_2 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData2();
-          break;
-        case ID_BMS_DATA_3:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_3 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData3();
-          break;
-        case ID_BMS_DATA_5:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_5 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData5();
-          break;
-        case ID_BMS_DATA_8:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_8 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData8();
-          break;
-        case ID_BMS_DATA_9:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_9 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData9();
-          break;
-        case ID_BMS_DATA_10:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_DATA_19 SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessData10();
-          break;
-        case ID_BMS_STATE:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_STATE SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessState();
-          break;
-        case ID_BMS_TIME_REQUEST:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX BMS_TIME_REQUEST SID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          VCU_ProcessTimeRequest();
-          break;
-        default:
-          if((debugLevel & (DBG_PCU + DBG_VERBOSE))==(DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"RX UNKNOWN ID=0x%03x : Byte[0..7]=0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x 0x%02x",rxObj.bF.id.SID,rxd[0],rxd[1],rxd[2],rxd[3],rxd[4],rxd[5],rxd[6],rxd[7]); serialOut(tempBuffer);}
-          break;
-      }
+          // Scenario loads come from a host on the bus, not the pack controller
+          if (rxObj.bF.id.SID == APP_SCENARIO_ID) {
+            VCU_ProcessScenarioLoad();
+            continue;
+          }
 
+          activeConnection = 1;
+          // reset last contact
+          pack.lastFrame.ticks = htim1.Instance->CNT;
+          pack.lastFrame.overflows = etTimerOverflows;
 
-      // check for any more messages
-      DRV_CANFDSPI_ReceiveChannelEventGet(DRV_CANFDSPI_INDEX_0, APP_RX_FIFO, &rxFlags);
+          switch (rxObj.bF.id.SID) {
+            case ID_BMS_DATA_1:
+              VCU_ProcessData1();
+              break;
+            case ID_BMS_DATA_2:
+              VCU_ProcessData2();
+              break;
+            case ID_BMS_DATA_3:
+              VCU_ProcessData3();
+              break;
+            case ID_BMS_DATA_5:
+              VCU_ProcessData5();
+              break;
+            case ID_BMS_DATA_8:
+              VCU_ProcessData8();
+              break;
+            case ID_BMS_DATA_9:
+              VCU_ProcessData9();
+              break;
+            case ID_BMS_DATA_10:
+              VCU_ProcessData10();
+              break;
+            case ID_BMS_STATE:
+              VCU_ProcessState();
+              break;
+            case ID_BMS_TIME_REQUEST:
+              VCU_ProcessTimeRequest();
+              break;
+            default:
+              break;
+          }
+        }
+      } while (rxCount == APP_RX_BATCH_SIZE);
     }
 
     //    APP_LED_Clear(APP_RX_LED);
@@ -506,40 +550,96 @@ void VCU_ReceiveMessage_Tasks(void)
     canRxInterrupt = 0;
 
 }
+
+/***************************************************************************************************************
+*     V C U _ R a w N a m e                                                              V C U   E M U L A T O R
+***************************************************************************************************************/
+LOG_RAW_NAME VCU_RawName(uint16_t sid)
+{
+    switch (sid) {
+        case ID_BMS_DATA_1:         return LOG_RAW_BMS_DATA_1;
+        case ID_BMS_DATA_2:         return LOG_RAW_BMS_DATA_2;
+        case ID_BMS_DATA_3:         return LOG_RAW_BMS_DATA_3;
+        case ID_BMS_DATA_5:         return LOG_RAW_BMS_DATA_5;
+        case ID_BMS_DATA_8:         return LOG_RAW_BMS_DATA_8;
+        case ID_BMS_DATA_9:         return LOG_RAW_BMS_DATA_9;
+        case ID_BMS_DATA_10:        return LOG_RAW_BMS_DATA_10;
+        case ID_BMS_STATE:          return LOG_RAW_BMS_STATE;
+        case ID_BMS_TIME_REQUEST:   return LOG_RAW_BMS_TIME_REQUEST;
+        default:                    return LOG_RAW_UNKNOWN;
+    }
+}
 /***************************************************************************************************************
 *     A P P _ T r a n s m i t M e s s a g e Q u e u e                                    V C U   E M U L A T O R
 ***************************************************************************************************************/
 void VCU_TransmitMessageQueue(void)
 {
+    TXSCHED_CLASS txClass = VCU_TransmitClass(txObj.bF.id.SID);
+
+    // Queue the frame built in txObj/txd, a full queue means the bus is not taking frames
+    if (TXSCHED_Queue(txClass, &txObj, txd, HAL_GetTick()) == -1) {
+        LOG_EVENT0(LOG_ID_VCU_TX_FIFO_FULL);
+    }
+
+    VCU_TransmitService();
+}
+
+/***************************************************************************************************************
+*     V C U _ T r a n s m i t C l a s s                                                  V C U   E M U L A T O R
+***************************************************************************************************************/
+TXSCHED_CLASS VCU_TransmitClass(uint16_t sid)
+{
+    switch (sid) {
+        case ID_VCU_COMMAND:                // contactor command, doubles as keep-alive
+        case ID_VCU_MODULE_COMMAND:
+        case ID_VCU_KEEP_ALIVE:
+            return TXSCHED_STATE;
+        case ID_VCU_TIME:
+            return TXSCHED_TELEMETRY;
+        default:
+            return TXSCHED_BULK;
+    }
+}
+
+/***************************************************************************************************************
+*     V C U _ T r a n s m i t S e r v i c e                                              V C U   E M U L A T O R
+***************************************************************************************************************/
+void VCU_TransmitService(void)
+{
+    // Load what the FIFOs and rate limits take, the rest stays queued for the next pass
     APP_LED_Set(APP_TX_LED);
+    TXSCHED_Service(HAL_GetTick());
+    APP_LED_Clear(APP_TX_LED);
+}
 
-    uint8_t attempts = MAX_TXQUEUE_ATTEMPTS;
+/***************************************************************************************************************
+*     V C U _ T e f D r a i n                                                            V C U   E M U L A T O R
+***************************************************************************************************************/
+void VCU_TefDrain(void)
+{
+    CAN_TEF_FIFO_STATUS tefStatus;
 
-    // Check if FIFO is not full
-    do {
-        DRV_CANFDSPI_TransmitChannelEventGet(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, &txFlags);
-        if (attempts == 0) {
-            Nop();
-            Nop();
-            DRV_CANFDSPI_ErrorCountStateGet(DRV_CANFDSPI_INDEX_0, &tec, &rec, &errorFlags);
+    tefLastDrain = HAL_GetTick();
 
-            // Error - FIFO full!
-            sprintf(tempBuffer,"TX ERROR - FIFO Full! Check CAN Connection."); serialOut(tempBuffer);
+    if (DRV_CANFDSPI_TefStatusGet(DRV_CANFDSPI_INDEX_0, &tefStatus)) {
+        return;
+    }
+    if (tefStatus & CAN_TEF_FIFO_OVERFLOW) {
+        TXSTATS_TefOverflow();
+        DRV_CANFDSPI_TefEventOverflowClear(DRV_CANFDSPI_INDEX_0);
+    }
 
-            //Flush channel
-            DRV_CANFDSPI_TransmitChannelReset(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO);
+    // Each entry is a frame that made it onto the bus
+    while (tefStatus & CAN_TEF_FIFO_NOT_EMPTY) {
+        if (DRV_CANFDSPI_TefMessageGet(DRV_CANFDSPI_INDEX_0, &tefObj)) {
             return;
         }
-        attempts--;
-    }
-    while (!(txFlags & CAN_TX_FIFO_NOT_FULL_EVENT));
+        TXSTATS_Sent(&tefObj);
 
-    // Load message and transmit
-    uint8_t n = DRV_CANFDSPI_DlcToDataBytes(txObj.bF.ctrl.DLC);
-
-    DRV_CANFDSPI_TransmitChannelLoad(DRV_CANFDSPI_INDEX_0, APP_TX_FIFO, &txObj, txd, n, true);
-
-    APP_LED_Clear(APP_TX_LED);
+        if (DRV_CANFDSPI_TefStatusGet(DRV_CANFDSPI_INDEX_0, &tefStatus)) {
+            return;
+        }
+    }
 }
 
 /***************************************************************************************************************
@@ -556,11 +656,15 @@ void VCU_ProcessState(void){
   memset(&state,0,sizeof(state));
   memcpy(&state, rxd, sizeof(state));
 
+  SCENARIO_BmsState(state.bms_state);
+
+  if (!DBG_ENABLED(DBG_VCU)) return;             // the rest only feeds the log, here and below
+
   soh = VCU_SOH_PERCENTAGE_BASE + (state.bms_soh * VCU_SOH_PERCENTAGE_FACTOR);
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_STATE   %03x : STE=%02x SOH=%.2f%% STS=%02x CBS=%d CBA=%d MOFF=%d, MCNT=%d, MACT=%d"
-      ,rxObj.bF.id.SID,state.bms_state,soh, state.bms_status, state.bms_cell_balance_status, state.bms_cell_balance_active, state.bms_module_off,
-      state.bms_total_mod_cnt, state.bms_active_mod_cnt)  ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_STATE
+      ,rxObj.bF.id.SID,state.bms_state,LOG_F(soh), state.bms_status, state.bms_cell_balance_status, state.bms_cell_balance_active, state.bms_module_off,
+      state.bms_total_mod_cnt, state.bms_active_mod_cnt);
 }
 
 
@@ -574,6 +678,8 @@ void VCU_ProcessData1(void){
   float voltage = 0;
   float current = 0;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
@@ -581,7 +687,7 @@ void VCU_ProcessData1(void){
   voltage = data.bms_pack_voltage * VCU_VOLTAGE_FACTOR;
   current = VCU_CURRENT_BASE + (data.bms_pack_current * VCU_CURRENT_FACTOR);
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_1  %03x : VOLT=%.2fV AMPS=%.2fA",rxObj.bF.id.SID,voltage,current) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_1,rxObj.bF.id.SID,LOG_F(voltage),LOG_F(current));
 }
 
 
@@ -597,6 +703,8 @@ void VCU_ProcessData2(void){
   float loCellVolt  = 0;
   float avgCellVolt = 0;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
@@ -606,7 +714,7 @@ void VCU_ProcessData2(void){
   avgCellVolt = data.bms_avg_cell_volt  * VCU_CELL_VOLTAGE_FACTOR;
   soc         = data.bms_soc            * VCU_SOC_PERCENTAGE_FACTOR;
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_2  %03x : HICV=%.2fV LOCV=%.2fV AVCV=%.2fV SOC=%.2f%%",rxObj.bF.id.SID,hiCellVolt,loCellVolt,avgCellVolt,soc) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_2,rxObj.bF.id.SID,LOG_F(hiCellVolt),LOG_F(loCellVolt),LOG_F(avgCellVolt),LOG_F(soc));
 }
 
 /***************************************************************************************************************
@@ -620,6 +728,8 @@ void VCU_ProcessData3(void){
   float loCellTemp  = 0;
   float avgCellTemp = 0;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
@@ -628,7 +738,7 @@ void VCU_ProcessData3(void){
   loCellTemp  = VCU_TEMPERATURE_BASE + (data.bms_low_cell_temp  * VCU_TEMPERATURE_FACTOR);
   avgCellTemp = VCU_TEMPERATURE_BASE + (data.bms_avg_cell_temp  * VCU_TEMPERATURE_FACTOR);
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_3  %03x : HICT=%.2fC LOCT=%.2fC AVCT=%.2fC",rxObj.bF.id.SID,hiCellTemp,loCellTemp,avgCellTemp) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_3,rxObj.bF.id.SID,LOG_F(hiCellTemp),LOG_F(loCellTemp),LOG_F(avgCellTemp));
 }
 
 
@@ -643,6 +753,8 @@ void VCU_ProcessData5(void){
   float dischgLimit  = 0;
   float endVoltage   = 0;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
@@ -651,7 +763,7 @@ void VCU_ProcessData5(void){
   dischgLimit   = VCU_CURRENT_BASE + (data.bms_dischage_limit * VCU_CURRENT_FACTOR);
   endVoltage    = data.bms_charge_end_voltage_limit * VCU_VOLTAGE_FACTOR;
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_5  %03x : CLIM=%.2fA DLIM=%.2fA VLIM=%.2fV",rxObj.bF.id.SID, chgLimit, dischgLimit, endVoltage) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_5,rxObj.bF.id.SID, LOG_F(chgLimit), LOG_F(dischgLimit), LOG_F(endVoltage));
 }
 
 
@@ -662,11 +774,13 @@ void VCU_ProcessData8(void){
 
   CANFRM_0x428_BMS_DATA_8 data;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_8  %03x : HIVM=%d LOVM=%d HIVC=%d LOVC=%d",rxObj.bF.id.SID, data.bms_max_volt_mod, data.bms_min_volt_mod, data.bms_max_volt_cell, data.bms_min_volt_cell) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_8,rxObj.bF.id.SID, data.bms_max_volt_mod, data.bms_min_volt_mod, data.bms_max_volt_cell, data.bms_min_volt_cell);
 }
 
 
@@ -677,11 +791,13 @@ void VCU_ProcessData9(void){
 
   CANFRM_0x429_BMS_DATA_9 data;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_9  %03x : HITM=%d LOTM=%d HITC=%d LOTC=%d",rxObj.bF.id.SID,data.bms_max_temp_mod, data.bms_min_temp_mod, data.bms_max_temp_cell, data.bms_min_temp_cell) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_9,rxObj.bF.id.SID,data.bms_max_temp_mod, data.bms_min_temp_mod, data.bms_max_temp_cell, data.bms_min_temp_cell);
 }
 
 
@@ -694,13 +810,15 @@ void VCU_ProcessData10(void){
 
   float isolation     = 0;
 
+  if (!DBG_ENABLED(DBG_VCU)) return;
+
   // copy received data to status structure
   memset(&data,0,sizeof(data));
   memcpy(&data, rxd, sizeof(data));
 
   isolation = data.bms_hv_bus_actv_iso * VCU_ISOLATION_FACTOR;
 
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_10 %03x : ISOL=%.2fOhms/V",rxObj.bF.id.SID,isolation) ; serialOut(tempBuffer);}
+  LOG_EVENT(LOG_ID_VCU_RX_DATA_10,rxObj.bF.id.SID,LOG_F(isolation));
 }
 
 
@@ -730,7 +848,7 @@ void VCU_TransmitState(packState state){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 0;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  if(debugLevel & (DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"TX 0x400 Command: STATE=%02x HV=%.2fV",state, command.vcu_hv_bus_voltage * MODULE_VOLTAGE_FACTOR ); serialOut(tempBuffer);}
+  if(debugLevel & (DBG_PCU + DBG_VERBOSE)){LOG_EVENT(LOG_ID_VCU_TX_COMMAND,state, LOG_F(command.vcu_hv_bus_voltage * MODULE_VOLTAGE_FACTOR));}
   VCU_TransmitMessageQueue();                     // Send it
 }
 
@@ -740,6 +858,15 @@ void VCU_TransmitState(packState state){
 ***************************************************************************************************************/
 void VCU_ProcessTimeRequest(void){
 
+  VCU_TransmitTime();
+}
+
+
+/***************************************************************************************************************
+*     V C U _ T r a n s m i t T i m e                                                    V C U   E M U L A T O R
+***************************************************************************************************************/
+void VCU_TransmitTime(void){
+
   CANFRM_0x401_VCU_TIME vcuTime;
 
   memset(&vcuTime,0,sizeof(vcuTime));
@@ -761,11 +888,106 @@ void VCU_ProcessTimeRequest(void){
   txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
   txObj.bF.ctrl.IDE = 0;                          // ID Extension selection - send base frame when cleared, extended frame when set
 
-  if(debugLevel & (DBG_PCU + DBG_VERBOSE)){sprintf(tempBuffer,"TX 0x401 Set Time"); serialOut(tempBuffer);}
+  if(debugLevel & (DBG_PCU + DBG_VERBOSE)){LOG_EVENT0(LOG_ID_VCU_TX_SET_TIME);}
+  VCU_TransmitMessageQueue();                     // Send it
+}
+
+
+/***************************************************************************************************************
+*     V C U _ T r a n s m i t M o d u l e C o m m a n d                                  V C U   E M U L A T O R
+***************************************************************************************************************/
+void VCU_TransmitModuleCommand(uint8_t moduleId, packState state){
+
+  CANFRM_0x404_VCU_MODULE_COMMAND command;
+  memset(&command,0,sizeof(command));
+
+  command.module_id = moduleId;
+  command.module_contactor_ctrl = state;
+  command.vcu_hv_bus_voltage = 26668; //400.02V
+
+
+  txObj.word[0] = 0;                              // Configure transmit message
+  txObj.word[1] = 0;
+  txObj.word[2] = 0;
+
+  memcpy(txd, &command, 8);
+
+  txObj.bF.id.SID = ID_VCU_MODULE_COMMAND;        // Standard ID
+  txObj.bF.id.EID = 0;                            // Extended ID
+
+  txObj.bF.ctrl.BRS = 0;                          // Bit Rate Switch - use DBR when set, NBR when cleared
+  txObj.bF.ctrl.DLC = CAN_DLC_8;                  // 8 bytes to transmit
+  txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
+  txObj.bF.ctrl.IDE = 0;                          // ID Extension selection - send base frame when cleared, extended frame when set
+
+  if(debugLevel & (DBG_PCU + DBG_VERBOSE)){LOG_EVENT(LOG_ID_VCU_TX_MODULE_COMMAND, moduleId, state);}
   VCU_TransmitMessageQueue();                     // Send it
 }
 
 
+/***************************************************************************************************************
+*     V C U _ T r a n s m i t K e e p A l i v e                                          V C U   E M U L A T O R
+***************************************************************************************************************/
+void VCU_TransmitKeepAlive(uint8_t moduleId){
+
+  CANFRM_0x405_VCU_KEEP_ALIVE keepAlive;
+  memset(&keepAlive,0,sizeof(keepAlive));
+
+  keepAlive.module_id = moduleId;                 // 0 for the whole pack
+
+
+  txObj.word[0] = 0;                              // Configure transmit message
+  txObj.word[1] = 0;
+  txObj.word[2] = 0;
+
+  memcpy(txd, &keepAlive, sizeof(keepAlive));
+
+  txObj.bF.id.SID = ID_VCU_KEEP_ALIVE;            // Standard ID
+  txObj.bF.id.EID = 0;                            // Extended ID
+
+  txObj.bF.ctrl.BRS = 0;                          // Bit Rate Switch - use DBR when set, NBR when cleared
+  txObj.bF.ctrl.DLC = CAN_DLC_8;                  // 8 bytes to transmit
+  txObj.bF.ctrl.FDF = 0;                          // Frame Data Format - CAN FD when set, CAN 2.0 when cleared
+  txObj.bF.ctrl.IDE = 0;                          // ID Extension selection - send base frame when cleared, extended frame when set
+
+  if(debugLevel & (DBG_PCU + DBG_VERBOSE)){LOG_EVENT(LOG_ID_VCU_TX_KEEP_ALIVE, moduleId);}
+  VCU_TransmitMessageQueue();                     // Send it
+}
+
+
+/***************************************************************************************************************
+*     V C U _ P r o c e s s S c e n a r i o L o a d                                      V C U   E M U L A T O R
+***************************************************************************************************************/
+void VCU_ProcessScenarioLoad(void){
+
+  uint8_t bytes = DRV_CANFDSPI_DlcToDataBytes((CAN_DLC) rxObj.bF.ctrl.DLC);
+
+  if (bytes == 0) return;
+
+  // see APP_SCENARIO_ID for the frame layout
+  switch (rxd[0]) {
+    case APP_SCENARIO_BEGIN:
+      if (bytes < 3 || SCENARIO_LoadBegin(rxd[1] | (rxd[2] << 8)) != 0) {
+        LOG_EVENT(LOG_ID_VCU_SCENARIO_REJECTED, -1, 0);
+      }
+      break;
+    case APP_SCENARIO_DATA:
+      if (bytes < 4 || bytes > 8 || SCENARIO_LoadData(rxd[1] | (rxd[2] << 8), &rxd[3], bytes - 3) != 0) {
+        LOG_EVENT(LOG_ID_VCU_SCENARIO_REJECTED, -1, rxd[1] | (rxd[2] << 8));
+      }
+      break;
+    case APP_SCENARIO_END:
+      SCENARIO_LoadEnd();                         // logs the outcome
+      break;
+    case APP_SCENARIO_RESTART:
+      SCENARIO_Restart();
+      break;
+    default:
+      break;
+  }
+}
+
+
 /***************************************************************************************************************
 *     V C U _ T i c k s S i n c e L a s t M e s s a g e                                  V C U   E M U L A T O R
 ***************************************************************************************************************/
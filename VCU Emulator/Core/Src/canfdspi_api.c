@@ -56,6 +56,22 @@
 #define CRCBASE    0xFFFF
 #define CRCUPPER   1
 
+// CRC-16 engine: table look-ups per step, 1 (256 entries), 4 or 8 (slicing)
+// Each slice adds a 512 byte table in flash
+#ifndef DRV_CANFDSPI_CRC16_SLICES
+#define DRV_CANFDSPI_CRC16_SLICES 4
+#endif
+
+#if (DRV_CANFDSPI_CRC16_SLICES != 1) && (DRV_CANFDSPI_CRC16_SLICES != 4) && (DRV_CANFDSPI_CRC16_SLICES != 8)
+#error "DRV_CANFDSPI_CRC16_SLICES must be 1, 4 or 8"
+#endif
+
+// Define DRV_CANFDSPI_CRC16_HW to use the CRC unit instead of tables.
+// Needs a programmable polynomial (STM32WB); the STM32F4 unit is fixed CRC-32.
+#if defined(DRV_CANFDSPI_CRC16_HW) && !defined(CRC_POL_POL)
+#error "DRV_CANFDSPI_CRC16_HW needs a CRC unit with programmable polynomial"
+#endif
+
 // Index to SPI channel
 // Used when multiple MCP25xxFD are connected to the same SPI interface, but with different CS
 
@@ -64,6 +80,12 @@
 
 #define SPI_DEFAULT_BUFFER_LENGTH 96
 
+// Burst buffer holds up to four maximum size message objects plus command
+#define SPI_BURST_BUFFER_LENGTH (4*MAX_MSG_SIZE + 2)
+
+// Most objects a burst can hold, smallest object is 16 bytes
+#define SPI_BURST_MAX_OBJECTS ((SPI_BURST_BUFFER_LENGTH - 2) / 16)
+
 // *****************************************************************************
 // *****************************************************************************
 // Section: Variables
@@ -74,6 +96,16 @@ uint8_t spiTransmitBuffer[SPI_DEFAULT_BUFFER_LENGTH];
 //! SPI Receive buffer
 uint8_t spiReceiveBuffer[SPI_DEFAULT_BUFFER_LENGTH];
 
+//! SPI buffers for multi-object RAM bursts
+static uint8_t spiBurstTransmitBuffer[SPI_BURST_BUFFER_LENGTH];
+static uint8_t spiBurstReceiveBuffer[SPI_BURST_BUFFER_LENGTH];
+
+//! FIFO geometry, filled in by the channel configure functions
+static CAN_FIFO_GEOMETRY fifoGeometry[CAN_FIFO_TOTAL_CHANNELS];
+
+//! Bytes of payload for each CAN_FIFO_PLSIZE
+static const uint8_t payloadSizeBytes[8] = {8, 12, 16, 20, 24, 32, 48, 64};
+
 //! Reverse order of bits in byte
 const uint8_t BitReverseTable256[256] = {
     0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0,
@@ -130,6 +162,256 @@ const uint16_t crc16_table[256] = {
     0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202
 };
 
+#if DRV_CANFDSPI_CRC16_SLICES >= 4
+//! Slicing tables: crc16_tableN[b] is the CRC of byte b followed by N zero bytes
+const uint16_t crc16_table1[256] = {
+    0x0000, 0x8603, 0x8C03, 0x0A00, 0x9803, 0x1E00, 0x1400, 0x9203,
+    0xB003, 0x3600, 0x3C00, 0xBA03, 0x2800, 0xAE03, 0xA403, 0x2200,
+    0xE003, 0x6600, 0x6C00, 0xEA03, 0x7800, 0xFE03, 0xF403, 0x7200,
+    0x5000, 0xD603, 0xDC03, 0x5A00, 0xC803, 0x4E00, 0x4400, 0xC203,
+    0x4003, 0xC600, 0xCC00, 0x4A03, 0xD800, 0x5E03, 0x5403, 0xD200,
+    0xF000, 0x7603, 0x7C03, 0xFA00, 0x6803, 0xEE00, 0xE400, 0x6203,
+    0xA000, 0x2603, 0x2C03, 0xAA00, 0x3803, 0xBE00, 0xB400, 0x3203,
+    0x1003, 0x9600, 0x9C00, 0x1A03, 0x8800, 0x0E03, 0x0403, 0x8200,
+    0x8006, 0x0605, 0x0C05, 0x8A06, 0x1805, 0x9E06, 0x9406, 0x1205,
+    0x3005, 0xB606, 0xBC06, 0x3A05, 0xA806, 0x2E05, 0x2405, 0xA206,
+    0x6005, 0xE606, 0xEC06, 0x6A05, 0xF806, 0x7E05, 0x7405, 0xF206,
+    0xD006, 0x5605, 0x5C05, 0xDA06, 0x4805, 0xCE06, 0xC406, 0x4205,
+    0xC005, 0x4606, 0x4C06, 0xCA05, 0x5806, 0xDE05, 0xD405, 0x5206,
+    0x7006, 0xF605, 0xFC05, 0x7A06, 0xE805, 0x6E06, 0x6406, 0xE205,
+    0x2006, 0xA605, 0xAC05, 0x2A06, 0xB805, 0x3E06, 0x3406, 0xB205,
+    0x9005, 0x1606, 0x1C06, 0x9A05, 0x0806, 0x8E05, 0x8405, 0x0206,
+    0x8009, 0x060A, 0x0C0A, 0x8A09, 0x180A, 0x9E09, 0x9409, 0x120A,
+    0x300A, 0xB609, 0xBC09, 0x3A0A, 0xA809, 0x2E0A, 0x240A, 0xA209,
+    0x600A, 0xE609, 0xEC09, 0x6A0A, 0xF809, 0x7E0A, 0x740A, 0xF209,
+    0xD009, 0x560A, 0x5C0A, 0xDA09, 0x480A, 0xCE09, 0xC409, 0x420A,
+    0xC00A, 0x4609, 0x4C09, 0xCA0A, 0x5809, 0xDE0A, 0xD40A, 0x5209,
+    0x7009, 0xF60A, 0xFC0A, 0x7A09, 0xE80A, 0x6E09, 0x6409, 0xE20A,
+    0x2009, 0xA60A, 0xAC0A, 0x2A09, 0xB80A, 0x3E09, 0x3409, 0xB20A,
+    0x900A, 0x1609, 0x1C09, 0x9A0A, 0x0809, 0x8E0A, 0x840A, 0x0209,
+    0x000F, 0x860C, 0x8C0C, 0x0A0F, 0x980C, 0x1E0F, 0x140F, 0x920C,
+    0xB00C, 0x360F, 0x3C0F, 0xBA0C, 0x280F, 0xAE0C, 0xA40C, 0x220F,
+    0xE00C, 0x660F, 0x6C0F, 0xEA0C, 0x780F, 0xFE0C, 0xF40C, 0x720F,
+    0x500F, 0xD60C, 0xDC0C, 0x5A0F, 0xC80C, 0x4E0F, 0x440F, 0xC20C,
+    0x400C, 0xC60F, 0xCC0F, 0x4A0C, 0xD80F, 0x5E0C, 0x540C, 0xD20F,
+    0xF00F, 0x760C, 0x7C0C, 0xFA0F, 0x680C, 0xEE0F, 0xE40F, 0x620C,
+    0xA00F, 0x260C, 0x2C0C, 0xAA0F, 0x380C, 0xBE0F, 0xB40F, 0x320C,
+    0x100C, 0x960F, 0x9C0F, 0x1A0C, 0x880F, 0x0E0C, 0x040C, 0x820F
+};
+
+const uint16_t crc16_table2[256] = {
+    0x0000, 0x8017, 0x802B, 0x003C, 0x8053, 0x0044, 0x0078, 0x806F,
+    0x80A3, 0x00B4, 0x0088, 0x809F, 0x00F0, 0x80E7, 0x80DB, 0x00CC,
+    0x8143, 0x0154, 0x0168, 0x817F, 0x0110, 0x8107, 0x813B, 0x012C,
+    0x01E0, 0x81F7, 0x81CB, 0x01DC, 0x81B3, 0x01A4, 0x0198, 0x818F,
+    0x8283, 0x0294, 0x02A8, 0x82BF, 0x02D0, 0x82C7, 0x82FB, 0x02EC,
+    0x0220, 0x8237, 0x820B, 0x021C, 0x8273, 0x0264, 0x0258, 0x824F,
+    0x03C0, 0x83D7, 0x83EB, 0x03FC, 0x8393, 0x0384, 0x03B8, 0x83AF,
+    0x8363, 0x0374, 0x0348, 0x835F, 0x0330, 0x8327, 0x831B, 0x030C,
+    0x8503, 0x0514, 0x0528, 0x853F, 0x0550, 0x8547, 0x857B, 0x056C,
+    0x05A0, 0x85B7, 0x858B, 0x059C, 0x85F3, 0x05E4, 0x05D8, 0x85CF,
+    0x0440, 0x8457, 0x846B, 0x047C, 0x8413, 0x0404, 0x0438, 0x842F,
+    0x84E3, 0x04F4, 0x04C8, 0x84DF, 0x04B0, 0x84A7, 0x849B, 0x048C,
+    0x0780, 0x8797, 0x87AB, 0x07BC, 0x87D3, 0x07C4, 0x07F8, 0x87EF,
+    0x8723, 0x0734, 0x0708, 0x871F, 0x0770, 0x8767, 0x875B, 0x074C,
+    0x86C3, 0x06D4, 0x06E8, 0x86FF, 0x0690, 0x8687, 0x86BB, 0x06AC,
+    0x0660, 0x8677, 0x864B, 0x065C, 0x8633, 0x0624, 0x0618, 0x860F,
+    0x8A03, 0x0A14, 0x0A28, 0x8A3F, 0x0A50, 0x8A47, 0x8A7B, 0x0A6C,
+    0x0AA0, 0x8AB7, 0x8A8B, 0x0A9C, 0x8AF3, 0x0AE4, 0x0AD8, 0x8ACF,
+    0x0B40, 0x8B57, 0x8B6B, 0x0B7C, 0x8B13, 0x0B04, 0x0B38, 0x8B2F,
+    0x8BE3, 0x0BF4, 0x0BC8, 0x8BDF, 0x0BB0, 0x8BA7, 0x8B9B, 0x0B8C,
+    0x0880, 0x8897, 0x88AB, 0x08BC, 0x88D3, 0x08C4, 0x08F8, 0x88EF,
+    0x8823, 0x0834, 0x0808, 0x881F, 0x0870, 0x8867, 0x885B, 0x084C,
+    0x89C3, 0x09D4, 0x09E8, 0x89FF, 0x0990, 0x8987, 0x89BB, 0x09AC,
+    0x0960, 0x8977, 0x894B, 0x095C, 0x8933, 0x0924, 0x0918, 0x890F,
+    0x0F00, 0x8F17, 0x8F2B, 0x0F3C, 0x8F53, 0x0F44, 0x0F78, 0x8F6F,
+    0x8FA3, 0x0FB4, 0x0F88, 0x8F9F, 0x0FF0, 0x8FE7, 0x8FDB, 0x0FCC,
+    0x8E43, 0x0E54, 0x0E68, 0x8E7F, 0x0E10, 0x8E07, 0x8E3B, 0x0E2C,
+    0x0EE0, 0x8EF7, 0x8ECB, 0x0EDC, 0x8EB3, 0x0EA4, 0x0E98, 0x8E8F,
+    0x8D83, 0x0D94, 0x0DA8, 0x8DBF, 0x0DD0, 0x8DC7, 0x8DFB, 0x0DEC,
+    0x0D20, 0x8D37, 0x8D0B, 0x0D1C, 0x8D73, 0x0D64, 0x0D58, 0x8D4F,
+    0x0CC0, 0x8CD7, 0x8CEB, 0x0CFC, 0x8C93, 0x0C84, 0x0CB8, 0x8CAF,
+    0x8C63, 0x0C74, 0x0C48, 0x8C5F, 0x0C30, 0x8C27, 0x8C1B, 0x0C0C
+};
+
+const uint16_t crc16_table3[256] = {
+    0x0000, 0x9403, 0xA803, 0x3C00, 0xD003, 0x4400, 0x7800, 0xEC03,
+    0x2003, 0xB400, 0x8800, 0x1C03, 0xF000, 0x6403, 0x5803, 0xCC00,
+    0x4006, 0xD405, 0xE805, 0x7C06, 0x9005, 0x0406, 0x3806, 0xAC05,
+    0x6005, 0xF406, 0xC806, 0x5C05, 0xB006, 0x2405, 0x1805, 0x8C06,
+    0x800C, 0x140F, 0x280F, 0xBC0C, 0x500F, 0xC40C, 0xF80C, 0x6C0F,
+    0xA00F, 0x340C, 0x080C, 0x9C0F, 0x700C, 0xE40F, 0xD80F, 0x4C0C,
+    0xC00A, 0x5409, 0x6809, 0xFC0A, 0x1009, 0x840A, 0xB80A, 0x2C09,
+    0xE009, 0x740A, 0x480A, 0xDC09, 0x300A, 0xA409, 0x9809, 0x0C0A,
+    0x801D, 0x141E, 0x281E, 0xBC1D, 0x501E, 0xC41D, 0xF81D, 0x6C1E,
+    0xA01E, 0x341D, 0x081D, 0x9C1E, 0x701D, 0xE41E, 0xD81E, 0x4C1D,
+    0xC01B, 0x5418, 0x6818, 0xFC1B, 0x1018, 0x841B, 0xB81B, 0x2C18,
+    0xE018, 0x741B, 0x481B, 0xDC18, 0x301B, 0xA418, 0x9818, 0x0C1B,
+    0x0011, 0x9412, 0xA812, 0x3C11, 0xD012, 0x4411, 0x7811, 0xEC12,
+    0x2012, 0xB411, 0x8811, 0x1C12, 0xF011, 0x6412, 0x5812, 0xCC11,
+    0x4017, 0xD414, 0xE814, 0x7C17, 0x9014, 0x0417, 0x3817, 0xAC14,
+    0x6014, 0xF417, 0xC817, 0x5C14, 0xB017, 0x2414, 0x1814, 0x8C17,
+    0x803F, 0x143C, 0x283C, 0xBC3F, 0x503C, 0xC43F, 0xF83F, 0x6C3C,
+    0xA03C, 0x343F, 0x083F, 0x9C3C, 0x703F, 0xE43C, 0xD83C, 0x4C3F,
+    0xC039, 0x543A, 0x683A, 0xFC39, 0x103A, 0x8439, 0xB839, 0x2C3A,
+    0xE03A, 0x7439, 0x4839, 0xDC3A, 0x3039, 0xA43A, 0x983A, 0x0C39,
+    0x0033, 0x9430, 0xA830, 0x3C33, 0xD030, 0x4433, 0x7833, 0xEC30,
+    0x2030, 0xB433, 0x8833, 0x1C30, 0xF033, 0x6430, 0x5830, 0xCC33,
+    0x4035, 0xD436, 0xE836, 0x7C35, 0x9036, 0x0435, 0x3835, 0xAC36,
+    0x6036, 0xF435, 0xC835, 0x5C36, 0xB035, 0x2436, 0x1836, 0x8C35,
+    0x0022, 0x9421, 0xA821, 0x3C22, 0xD021, 0x4422, 0x7822, 0xEC21,
+    0x2021, 0xB422, 0x8822, 0x1C21, 0xF022, 0x6421, 0x5821, 0xCC22,
+    0x4024, 0xD427, 0xE827, 0x7C24, 0x9027, 0x0424, 0x3824, 0xAC27,
+    0x6027, 0xF424, 0xC824, 0x5C27, 0xB024, 0x2427, 0x1827, 0x8C24,
+    0x802E, 0x142D, 0x282D, 0xBC2E, 0x502D, 0xC42E, 0xF82E, 0x6C2D,
+    0xA02D, 0x342E, 0x082E, 0x9C2D, 0x702E, 0xE42D, 0xD82D, 0x4C2E,
+    0xC028, 0x542B, 0x682B, 0xFC28, 0x102B, 0x8428, 0xB828, 0x2C2B,
+    0xE02B, 0x7428, 0x4828, 0xDC2B, 0x3028, 0xA42B, 0x982B, 0x0C28
+};
+#endif
+
+#if DRV_CANFDSPI_CRC16_SLICES >= 8
+const uint16_t crc16_table4[256] = {
+    0x0000, 0x807B, 0x80F3, 0x0088, 0x81E3, 0x0198, 0x0110, 0x816B,
+    0x83C3, 0x03B8, 0x0330, 0x834B, 0x0220, 0x825B, 0x82D3, 0x02A8,
+    0x8783, 0x07F8, 0x0770, 0x870B, 0x0660, 0x861B, 0x8693, 0x06E8,
+    0x0440, 0x843B, 0x84B3, 0x04C8, 0x85A3, 0x05D8, 0x0550, 0x852B,
+    0x8F03, 0x0F78, 0x0FF0, 0x8F8B, 0x0EE0, 0x8E9B, 0x8E13, 0x0E68,
+    0x0CC0, 0x8CBB, 0x8C33, 0x0C48, 0x8D23, 0x0D58, 0x0DD0, 0x8DAB,
+    0x0880, 0x88FB, 0x8873, 0x0808, 0x8963, 0x0918, 0x0990, 0x89EB,
+    0x8B43, 0x0B38, 0x0BB0, 0x8BCB, 0x0AA0, 0x8ADB, 0x8A53, 0x0A28,
+    0x9E03, 0x1E78, 0x1EF0, 0x9E8B, 0x1FE0, 0x9F9B, 0x9F13, 0x1F68,
+    0x1DC0, 0x9DBB, 0x9D33, 0x1D48, 0x9C23, 0x1C58, 0x1CD0, 0x9CAB,
+    0x1980, 0x99FB, 0x9973, 0x1908, 0x9863, 0x1818, 0x1890, 0x98EB,
+    0x9A43, 0x1A38, 0x1AB0, 0x9ACB, 0x1BA0, 0x9BDB, 0x9B53, 0x1B28,
+    0x1100, 0x917B, 0x91F3, 0x1188, 0x90E3, 0x1098, 0x1010, 0x906B,
+    0x92C3, 0x12B8, 0x1230, 0x924B, 0x1320, 0x935B, 0x93D3, 0x13A8,
+    0x9683, 0x16F8, 0x1670, 0x960B, 0x1760, 0x971B, 0x9793, 0x17E8,
+    0x1540, 0x953B, 0x95B3, 0x15C8, 0x94A3, 0x14D8, 0x1450, 0x942B,
+    0xBC03, 0x3C78, 0x3CF0, 0xBC8B, 0x3DE0, 0xBD9B, 0xBD13, 0x3D68,
+    0x3FC0, 0xBFBB, 0xBF33, 0x3F48, 0xBE23, 0x3E58, 0x3ED0, 0xBEAB,
+    0x3B80, 0xBBFB, 0xBB73, 0x3B08, 0xBA63, 0x3A18, 0x3A90, 0xBAEB,
+    0xB843, 0x3838, 0x38B0, 0xB8CB, 0x39A0, 0xB9DB, 0xB953, 0x3928,
+    0x3300, 0xB37B, 0xB3F3, 0x3388, 0xB2E3, 0x3298, 0x3210, 0xB26B,
+    0xB0C3, 0x30B8, 0x3030, 0xB04B, 0x3120, 0xB15B, 0xB1D3, 0x31A8,
+    0xB483, 0x34F8, 0x3470, 0xB40B, 0x3560, 0xB51B, 0xB593, 0x35E8,
+    0x3740, 0xB73B, 0xB7B3, 0x37C8, 0xB6A3, 0x36D8, 0x3650, 0xB62B,
+    0x2200, 0xA27B, 0xA2F3, 0x2288, 0xA3E3, 0x2398, 0x2310, 0xA36B,
+    0xA1C3, 0x21B8, 0x2130, 0xA14B, 0x2020, 0xA05B, 0xA0D3, 0x20A8,
+    0xA583, 0x25F8, 0x2570, 0xA50B, 0x2460, 0xA41B, 0xA493, 0x24E8,
+    0x2640, 0xA63B, 0xA6B3, 0x26C8, 0xA7A3, 0x27D8, 0x2750, 0xA72B,
+    0xAD03, 0x2D78, 0x2DF0, 0xAD8B, 0x2CE0, 0xAC9B, 0xAC13, 0x2C68,
+    0x2EC0, 0xAEBB, 0xAE33, 0x2E48, 0xAF23, 0x2F58, 0x2FD0, 0xAFAB,
+    0x2A80, 0xAAFB, 0xAA73, 0x2A08, 0xAB63, 0x2B18, 0x2B90, 0xABEB,
+    0xA943, 0x2938, 0x29B0, 0xA9CB, 0x28A0, 0xA8DB, 0xA853, 0x2828
+};
+
+const uint16_t crc16_table5[256] = {
+    0x0000, 0xF803, 0x7003, 0x8800, 0xE006, 0x1805, 0x9005, 0x6806,
+    0x4009, 0xB80A, 0x300A, 0xC809, 0xA00F, 0x580C, 0xD00C, 0x280F,
+    0x8012, 0x7811, 0xF011, 0x0812, 0x6014, 0x9817, 0x1017, 0xE814,
+    0xC01B, 0x3818, 0xB018, 0x481B, 0x201D, 0xD81E, 0x501E, 0xA81D,
+    0x8021, 0x7822, 0xF022, 0x0821, 0x6027, 0x9824, 0x1024, 0xE827,
+    0xC028, 0x382B, 0xB02B, 0x4828, 0x202E, 0xD82D, 0x502D, 0xA82E,
+    0x0033, 0xF830, 0x7030, 0x8833, 0xE035, 0x1836, 0x9036, 0x6835,
+    0x403A, 0xB839, 0x3039, 0xC83A, 0xA03C, 0x583F, 0xD03F, 0x283C,
+    0x8047, 0x7844, 0xF044, 0x0847, 0x6041, 0x9842, 0x1042, 0xE841,
+    0xC04E, 0x384D, 0xB04D, 0x484E, 0x2048, 0xD84B, 0x504B, 0xA848,
+    0x0055, 0xF856, 0x7056, 0x8855, 0xE053, 0x1850, 0x9050, 0x6853,
+    0x405C, 0xB85F, 0x305F, 0xC85C, 0xA05A, 0x5859, 0xD059, 0x285A,
+    0x0066, 0xF865, 0x7065, 0x8866, 0xE060, 0x1863, 0x9063, 0x6860,
+    0x406F, 0xB86C, 0x306C, 0xC86F, 0xA069, 0x586A, 0xD06A, 0x2869,
+    0x8074, 0x7877, 0xF077, 0x0874, 0x6072, 0x9871, 0x1071, 0xE872,
+    0xC07D, 0x387E, 0xB07E, 0x487D, 0x207B, 0xD878, 0x5078, 0xA87B,
+    0x808B, 0x7888, 0xF088, 0x088B, 0x608D, 0x988E, 0x108E, 0xE88D,
+    0xC082, 0x3881, 0xB081, 0x4882, 0x2084, 0xD887, 0x5087, 0xA884,
+    0x0099, 0xF89A, 0x709A, 0x8899, 0xE09F, 0x189C, 0x909C, 0x689F,
+    0x4090, 0xB893, 0x3093, 0xC890, 0xA096, 0x5895, 0xD095, 0x2896,
+    0x00AA, 0xF8A9, 0x70A9, 0x88AA, 0xE0AC, 0x18AF, 0x90AF, 0x68AC,
+    0x40A3, 0xB8A0, 0x30A0, 0xC8A3, 0xA0A5, 0x58A6, 0xD0A6, 0x28A5,
+    0x80B8, 0x78BB, 0xF0BB, 0x08B8, 0x60BE, 0x98BD, 0x10BD, 0xE8BE,
+    0xC0B1, 0x38B2, 0xB0B2, 0x48B1, 0x20B7, 0xD8B4, 0x50B4, 0xA8B7,
+    0x00CC, 0xF8CF, 0x70CF, 0x88CC, 0xE0CA, 0x18C9, 0x90C9, 0x68CA,
+    0x40C5, 0xB8C6, 0x30C6, 0xC8C5, 0xA0C3, 0x58C0, 0xD0C0, 0x28C3,
+    0x80DE, 0x78DD, 0xF0DD, 0x08DE, 0x60D8, 0x98DB, 0x10DB, 0xE8D8,
+    0xC0D7, 0x38D4, 0xB0D4, 0x48D7, 0x20D1, 0xD8D2, 0x50D2, 0xA8D1,
+    0x80ED, 0x78EE, 0xF0EE, 0x08ED, 0x60EB, 0x98E8, 0x10E8, 0xE8EB,
+    0xC0E4, 0x38E7, 0xB0E7, 0x48E4, 0x20E2, 0xD8E1, 0x50E1, 0xA8E2,
+    0x00FF, 0xF8FC, 0x70FC, 0x88FF, 0xE0F9, 0x18FA, 0x90FA, 0x68F9,
+    0x40F6, 0xB8F5, 0x30F5, 0xC8F6, 0xA0F0, 0x58F3, 0xD0F3, 0x28F0
+};
+
+const uint16_t crc16_table6[256] = {
+    0x0000, 0x8113, 0x8223, 0x0330, 0x8443, 0x0550, 0x0660, 0x8773,
+    0x8883, 0x0990, 0x0AA0, 0x8BB3, 0x0CC0, 0x8DD3, 0x8EE3, 0x0FF0,
+    0x9103, 0x1010, 0x1320, 0x9233, 0x1540, 0x9453, 0x9763, 0x1670,
+    0x1980, 0x9893, 0x9BA3, 0x1AB0, 0x9DC3, 0x1CD0, 0x1FE0, 0x9EF3,
+    0xA203, 0x2310, 0x2020, 0xA133, 0x2640, 0xA753, 0xA463, 0x2570,
+    0x2A80, 0xAB93, 0xA8A3, 0x29B0, 0xAEC3, 0x2FD0, 0x2CE0, 0xADF3,
+    0x3300, 0xB213, 0xB123, 0x3030, 0xB743, 0x3650, 0x3560, 0xB473,
+    0xBB83, 0x3A90, 0x39A0, 0xB8B3, 0x3FC0, 0xBED3, 0xBDE3, 0x3CF0,
+    0xC403, 0x4510, 0x4620, 0xC733, 0x4040, 0xC153, 0xC263, 0x4370,
+    0x4C80, 0xCD93, 0xCEA3, 0x4FB0, 0xC8C3, 0x49D0, 0x4AE0, 0xCBF3,
+    0x5500, 0xD413, 0xD723, 0x5630, 0xD143, 0x5050, 0x5360, 0xD273,
+    0xDD83, 0x5C90, 0x5FA0, 0xDEB3, 0x59C0, 0xD8D3, 0xDBE3, 0x5AF0,
+    0x6600, 0xE713, 0xE423, 0x6530, 0xE243, 0x6350, 0x6060, 0xE173,
+    0xEE83, 0x6F90, 0x6CA0, 0xEDB3, 0x6AC0, 0xEBD3, 0xE8E3, 0x69F0,
+    0xF703, 0x7610, 0x7520, 0xF433, 0x7340, 0xF253, 0xF163, 0x7070,
+    0x7F80, 0xFE93, 0xFDA3, 0x7CB0, 0xFBC3, 0x7AD0, 0x79E0, 0xF8F3,
+    0x0803, 0x8910, 0x8A20, 0x0B33, 0x8C40, 0x0D53, 0x0E63, 0x8F70,
+    0x8080, 0x0193, 0x02A3, 0x83B0, 0x04C3, 0x85D0, 0x86E0, 0x07F3,
+    0x9900, 0x1813, 0x1B23, 0x9A30, 0x1D43, 0x9C50, 0x9F60, 0x1E73,
+    0x1183, 0x9090, 0x93A0, 0x12B3, 0x95C0, 0x14D3, 0x17E3, 0x96F0,
+    0xAA00, 0x2B13, 0x2823, 0xA930, 0x2E43, 0xAF50, 0xAC60, 0x2D73,
+    0x2283, 0xA390, 0xA0A0, 0x21B3, 0xA6C0, 0x27D3, 0x24E3, 0xA5F0,
+    0x3B03, 0xBA10, 0xB920, 0x3833, 0xBF40, 0x3E53, 0x3D63, 0xBC70,
+    0xB380, 0x3293, 0x31A3, 0xB0B0, 0x37C3, 0xB6D0, 0xB5E0, 0x34F3,
+    0xCC00, 0x4D13, 0x4E23, 0xCF30, 0x4843, 0xC950, 0xCA60, 0x4B73,
+    0x4483, 0xC590, 0xC6A0, 0x47B3, 0xC0C0, 0x41D3, 0x42E3, 0xC3F0,
+    0x5D03, 0xDC10, 0xDF20, 0x5E33, 0xD940, 0x5853, 0x5B63, 0xDA70,
+    0xD580, 0x5493, 0x57A3, 0xD6B0, 0x51C3, 0xD0D0, 0xD3E0, 0x52F3,
+    0x6E03, 0xEF10, 0xEC20, 0x6D33, 0xEA40, 0x6B53, 0x6863, 0xE970,
+    0xE680, 0x6793, 0x64A3, 0xE5B0, 0x62C3, 0xE3D0, 0xE0E0, 0x61F3,
+    0xFF00, 0x7E13, 0x7D23, 0xFC30, 0x7B43, 0xFA50, 0xF960, 0x7873,
+    0x7783, 0xF690, 0xF5A0, 0x74B3, 0xF3C0, 0x72D3, 0x71E3, 0xF0F0
+};
+
+const uint16_t crc16_table7[256] = {
+    0x0000, 0x1006, 0x200C, 0x300A, 0x4018, 0x501E, 0x6014, 0x7012,
+    0x8030, 0x9036, 0xA03C, 0xB03A, 0xC028, 0xD02E, 0xE024, 0xF022,
+    0x8065, 0x9063, 0xA069, 0xB06F, 0xC07D, 0xD07B, 0xE071, 0xF077,
+    0x0055, 0x1053, 0x2059, 0x305F, 0x404D, 0x504B, 0x6041, 0x7047,
+    0x80CF, 0x90C9, 0xA0C3, 0xB0C5, 0xC0D7, 0xD0D1, 0xE0DB, 0xF0DD,
+    0x00FF, 0x10F9, 0x20F3, 0x30F5, 0x40E7, 0x50E1, 0x60EB, 0x70ED,
+    0x00AA, 0x10AC, 0x20A6, 0x30A0, 0x40B2, 0x50B4, 0x60BE, 0x70B8,
+    0x809A, 0x909C, 0xA096, 0xB090, 0xC082, 0xD084, 0xE08E, 0xF088,
+    0x819B, 0x919D, 0xA197, 0xB191, 0xC183, 0xD185, 0xE18F, 0xF189,
+    0x01AB, 0x11AD, 0x21A7, 0x31A1, 0x41B3, 0x51B5, 0x61BF, 0x71B9,
+    0x01FE, 0x11F8, 0x21F2, 0x31F4, 0x41E6, 0x51E0, 0x61EA, 0x71EC,
+    0x81CE, 0x91C8, 0xA1C2, 0xB1C4, 0xC1D6, 0xD1D0, 0xE1DA, 0xF1DC,
+    0x0154, 0x1152, 0x2158, 0x315E, 0x414C, 0x514A, 0x6140, 0x7146,
+    0x8164, 0x9162, 0xA168, 0xB16E, 0xC17C, 0xD17A, 0xE170, 0xF176,
+    0x8131, 0x9137, 0xA13D, 0xB13B, 0xC129, 0xD12F, 0xE125, 0xF123,
+    0x0101, 0x1107, 0x210D, 0x310B, 0x4119, 0x511F, 0x6115, 0x7113,
+    0x8333, 0x9335, 0xA33F, 0xB339, 0xC32B, 0xD32D, 0xE327, 0xF321,
+    0x0303, 0x1305, 0x230F, 0x3309, 0x431B, 0x531D, 0x6317, 0x7311,
+    0x0356, 0x1350, 0x235A, 0x335C, 0x434E, 0x5348, 0x6342, 0x7344,
+    0x8366, 0x9360, 0xA36A, 0xB36C, 0xC37E, 0xD378, 0xE372, 0xF374,
+    0x03FC, 0x13FA, 0x23F0, 0x33F6, 0x43E4, 0x53E2, 0x63E8, 0x73EE,
+    0x83CC, 0x93CA, 0xA3C0, 0xB3C6, 0xC3D4, 0xD3D2, 0xE3D8, 0xF3DE,
+    0x8399, 0x939F, 0xA395, 0xB393, 0xC381, 0xD387, 0xE38D, 0xF38B,
+    0x03A9, 0x13AF, 0x23A5, 0x33A3, 0x43B1, 0x53B7, 0x63BD, 0x73BB,
+    0x02A8, 0x12AE, 0x22A4, 0x32A2, 0x42B0, 0x52B6, 0x62BC, 0x72BA,
+    0x8298, 0x929E, 0xA294, 0xB292, 0xC280, 0xD286, 0xE28C, 0xF28A,
+    0x82CD, 0x92CB, 0xA2C1, 0xB2C7, 0xC2D5, 0xD2D3, 0xE2D9, 0xF2DF,
+    0x02FD, 0x12FB, 0x22F1, 0x32F7, 0x42E5, 0x52E3, 0x62E9, 0x72EF,
+    0x8267, 0x9261, 0xA26B, 0xB26D, 0xC27F, 0xD279, 0xE273, 0xF275,
+    0x0257, 0x1251, 0x225B, 0x325D, 0x424F, 0x5249, 0x6243, 0x7245,
+    0x0202, 0x1204, 0x220E, 0x3208, 0x421A, 0x521C, 0x6216, 0x7210,
+    0x8232, 0x9234, 0xA23E, 0xB238, 0xC22A, 0xD22C, 0xE226, 0xF220
+};
+#endif
+
 extern SPI_HandleTypeDef hspi1;
 
 // *****************************************************************************
@@ -152,6 +434,14 @@ int8_t DRV_CANFDSPI_Reset(CANFDSPI_MODULE_ID index)
   spiTransferError = HAL_SPI_TransmitReceive(&hspi1, spiTransmitBuffer, spiReceiveBuffer, spiTransferSize, SPI_TIMEOUT);
 	HAL_GPIO_WritePin(CAN_CS_GPIO_Port,  CAN_CS_Pin , GPIO_PIN_SET);
 
+  // All FIFOs go back to their reset configuration
+  for (uint8_t ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+      fifoGeometry[ch].Depth = 0;
+      fifoGeometry[ch].RamAddress = 0;
+      fifoGeometry[ch].Index = 0;
+      fifoGeometry[ch].Free = 0;
+  }
+
   return spiTransferError;
 }
 
@@ -391,6 +681,58 @@ int8_t DRV_CANFDSPI_ReadByteArray(CANFDSPI_MODULE_ID index, uint16_t address,
   return spiTransferError;
 }
 
+// Reads nBytes of message RAM in one transaction into the burst buffer.
+// Data starts at spiBurstReceiveBuffer[2].
+static int8_t DRV_CANFDSPI_ReadRamBurst(CANFDSPI_MODULE_ID index, uint16_t address,
+        uint16_t nBytes)
+{
+  uint16_t i;
+  uint16_t spiTransferSize = nBytes + 2;
+  HAL_StatusTypeDef spiTransferError;
+
+  if (spiTransferSize > sizeof(spiBurstTransmitBuffer)) {
+      return -1;
+  }
+
+  // Compose command
+  spiBurstTransmitBuffer[0] = (uint8_t) ((cINSTRUCTION_READ << 4) + ((address >> 8) & 0xF));
+  spiBurstTransmitBuffer[1] = (uint8_t) (address & 0xFF);
+
+  // Clear data
+  for (i = 2; i < spiTransferSize; i++) {
+      spiBurstTransmitBuffer[i] = 0;
+  }
+
+	HAL_GPIO_WritePin(CAN_CS_GPIO_Port,  CAN_CS_Pin , GPIO_PIN_RESET);
+  spiTransferError = HAL_SPI_TransmitReceive(&hspi1, spiBurstTransmitBuffer, spiBurstReceiveBuffer, spiTransferSize, SPI_TIMEOUT);
+	HAL_GPIO_WritePin(CAN_CS_GPIO_Port,  CAN_CS_Pin , GPIO_PIN_SET);
+
+  return spiTransferError;
+}
+
+// Writes nBytes of message RAM in one transaction. The caller places the data
+// at spiBurstTransmitBuffer[2].
+static int8_t DRV_CANFDSPI_WriteRamBurst(CANFDSPI_MODULE_ID index, uint16_t address,
+        uint16_t nBytes)
+{
+  uint16_t spiTransferSize = nBytes + 2;
+  HAL_StatusTypeDef spiTransferError;
+
+  if (spiTransferSize > sizeof(spiBurstTransmitBuffer)) {
+      return -1;
+  }
+
+  // Compose command
+  spiBurstTransmitBuffer[0] = (uint8_t) ((cINSTRUCTION_WRITE << 4) + ((address >> 8) & 0xF));
+  spiBurstTransmitBuffer[1] = (uint8_t) (address & 0xFF);
+
+	HAL_GPIO_WritePin(CAN_CS_GPIO_Port,  CAN_CS_Pin , GPIO_PIN_RESET);
+  spiTransferError = HAL_SPI_TransmitReceive(&hspi1, spiBurstTransmitBuffer, spiBurstReceiveBuffer, spiTransferSize, SPI_TIMEOUT);
+	HAL_GPIO_WritePin(CAN_CS_GPIO_Port,  CAN_CS_Pin , GPIO_PIN_SET);
+
+  return spiTransferError;
+}
+
 int8_t DRV_CANFDSPI_ReadByteArrayWithCRC(CANFDSPI_MODULE_ID index, uint16_t address,
         uint8_t *rxd, uint16_t nBytes, bool fromRam, bool* crcIsCorrect)
 {
@@ -676,6 +1018,15 @@ int8_t DRV_CANFDSPI_OperationModeSelect(CANFDSPI_MODULE_ID index,
       return -2;
   }
 
+  // Configuration mode resets all FIFOs and may move them in RAM
+  if (opMode == CAN_CONFIGURATION_MODE) {
+      for (uint8_t ch = 0; ch < CAN_FIFO_TOTAL_CHANNELS; ch++) {
+          fifoGeometry[ch].RamAddress = 0;
+          fifoGeometry[ch].Index = 0;
+          fifoGeometry[ch].Free = fifoGeometry[ch].Depth;
+      }
+  }
+
   return spiTransferError;
 }
 
@@ -809,6 +1160,18 @@ int8_t DRV_CANFDSPI_TransmitChannelConfigure(CANFDSPI_MODULE_ID index,
   a = cREGADDR_CiFIFOCON + (channel * CiFIFO_OFFSET);
 
   spiTransferError = DRV_CANFDSPI_WriteWord(index, a, ciFifoCon.word);
+  if (spiTransferError) {
+      return -1;
+  }
+
+  // Remember geometry, RAM address is learned on first access
+  fifoGeometry[channel].TxEnable = true;
+  fifoGeometry[channel].TimeStampEnable = false;
+  fifoGeometry[channel].Depth = config->FifoSize + 1;
+  fifoGeometry[channel].ObjectSize = 8 + payloadSizeBytes[config->PayLoadSize];
+  fifoGeometry[channel].RamAddress = 0;
+  fifoGeometry[channel].Index = 0;
+  fifoGeometry[channel].Free = fifoGeometry[channel].Depth;
 
   return spiTransferError;
 }
@@ -845,6 +1208,18 @@ int8_t DRV_CANFDSPI_TransmitQueueConfigure(CANFDSPI_MODULE_ID index,
 
   a = cREGADDR_CiTXQCON;
   spiTransferError = DRV_CANFDSPI_WriteWord(index, a, ciFifoCon.word);
+  if (spiTransferError) {
+      return -1;
+  }
+
+  // Remember geometry, RAM address is learned on first access
+  fifoGeometry[CAN_TXQUEUE_CH0].TxEnable = true;
+  fifoGeometry[CAN_TXQUEUE_CH0].TimeStampEnable = false;
+  fifoGeometry[CAN_TXQUEUE_CH0].Depth = config->FifoSize + 1;
+  fifoGeometry[CAN_TXQUEUE_CH0].ObjectSize = 8 + payloadSizeBytes[config->PayLoadSize];
+  fifoGeometry[CAN_TXQUEUE_CH0].RamAddress = 0;
+  fifoGeometry[CAN_TXQUEUE_CH0].Index = 0;
+  fifoGeometry[CAN_TXQUEUE_CH0].Free = fifoGeometry[CAN_TXQUEUE_CH0].Depth;
 
   return spiTransferError;
 }
@@ -951,6 +1326,142 @@ int8_t DRV_CANFDSPI_TransmitChannelLoad(CANFDSPI_MODULE_ID index,
   return spiTransferError;
 }
 
+int8_t DRV_CANFDSPI_TransmitChannelLoadBatch(CANFDSPI_MODULE_ID index,
+        CAN_FIFO_CHANNEL channel, CAN_TX_MSGOBJ* txObj,
+        uint8_t *txd, uint8_t nBytes, uint8_t nMessages, uint8_t *nLoaded,
+        bool flush)
+{
+  CAN_FIFO_GEOMETRY* fifo = &fifoGeometry[channel];
+  uint32_t fifoReg[2];
+  uint16_t sta = 0;
+  uint16_t a;
+  uint16_t n;
+  uint8_t dataBytes[SPI_BURST_MAX_OBJECTS];
+  uint8_t burst = 0;
+  uint8_t used = 0;
+  uint8_t i, k;
+  uint8_t* ba;
+  REG_CiFIFOSTA ciFifoSta;
+  REG_CiFIFOUA ciFifoUa;
+  int8_t spiTransferError = 0;
+
+  *nLoaded = 0;
+
+  // Only configured transmit FIFOs have a known geometry
+  if (fifo->Depth == 0 || !fifo->TxEnable) {
+      return -1;
+  }
+
+  // Refresh free slots from the controller only when the local count is short
+  if (fifo->Free < nMessages || fifo->RamAddress == 0) {
+      a = cREGADDR_CiFIFOSTA + (channel * CiFIFO_OFFSET);
+      ciFifoSta.word = 0;
+
+      if (fifo->RamAddress == 0) {
+          // First access after configuration: read STA and UA to locate object 0
+          spiTransferError = DRV_CANFDSPI_ReadWordArray(index, a, fifoReg, 2);
+          if (spiTransferError) {
+              return -2;
+          }
+          ciFifoSta.word = fifoReg[0];
+          ciFifoUa.word = fifoReg[1];
+#ifdef USERADDRESS_TIMES_FOUR
+          n = 4 * ciFifoUa.bF.UserAddress;
+#else
+          n = ciFifoUa.bF.UserAddress;
+#endif
+          fifo->RamAddress = n + cRAMADDR_START - (fifo->Index * fifo->ObjectSize);
+      } else {
+          spiTransferError = DRV_CANFDSPI_ReadHalfWord(index, a, &sta);
+          if (spiTransferError) {
+              return -2;
+          }
+          ciFifoSta.byte[0] = (uint8_t) (sta & 0xFF);
+          ciFifoSta.byte[1] = (uint8_t) (sta >> 8);
+      }
+
+      // FIFOCI is the next object to transmit, our index the next to load
+      if (ciFifoSta.txBF.TxEmptyIF) {
+          fifo->Free = fifo->Depth;
+      } else if (!ciFifoSta.txBF.TxNotFullIF) {
+          fifo->Free = 0;
+      } else {
+          fifo->Free = fifo->Depth - ((fifo->Index + fifo->Depth - ciFifoSta.txBF.FifoIndex) % fifo->Depth);
+      }
+  }
+
+  if (nMessages > fifo->Free) {
+      nMessages = fifo->Free;
+  }
+
+  while (*nLoaded < nMessages) {
+      // Burst up to the end of the FIFO RAM or the burst buffer, whichever is first
+      burst = nMessages - *nLoaded;
+      if (burst > fifo->Depth - fifo->Index) {
+          burst = fifo->Depth - fifo->Index;
+      }
+      if (burst > (SPI_BURST_BUFFER_LENGTH - 2) / fifo->ObjectSize) {
+          burst = (SPI_BURST_BUFFER_LENGTH - 2) / fifo->ObjectSize;
+      }
+
+      // Check that each object fits in its slot before touching RAM
+      for (k = 0; k < burst; k++) {
+          dataBytes[k] = DRV_CANFDSPI_DlcToDataBytes((CAN_DLC) txObj[k].bF.ctrl.DLC);
+          if (dataBytes[k] > nBytes || dataBytes[k] + 8 > fifo->ObjectSize) {
+              return -3;
+          }
+      }
+
+      // Lay objects out back to back, padding each to the slot size
+      n = 0;
+      for (k = 0; k < burst; k++) {
+          ba = &spiBurstTransmitBuffer[2 + n];
+
+          for (i = 0; i < 8; i++) {
+              ba[i] = txObj->byte[i];
+          }
+          for (i = 0; i < dataBytes[k]; i++) {
+              ba[i + 8] = txd[i];
+          }
+
+          if (k < burst - 1) {
+              used = fifo->ObjectSize;
+          } else {
+              // Last object only needs header and data, rounded to 4 bytes
+              used = dataBytes[k] + 8;
+              if (used % 4) {
+                  used = used + 4 - (used % 4);
+              }
+          }
+          for (i = dataBytes[k] + 8; i < used; i++) {
+              ba[i] = 0;
+          }
+          n += used;
+
+          txObj++;
+          txd += nBytes;
+      }
+
+      a = fifo->RamAddress + (fifo->Index * fifo->ObjectSize);
+      spiTransferError = DRV_CANFDSPI_WriteRamBurst(index, a, n);
+      if (spiTransferError) {
+          return -4;
+      }
+
+      // UINC once per object, TXREQ only with the last one
+      for (k = 0; k < burst; k++) {
+          spiTransferError = DRV_CANFDSPI_TransmitChannelUpdate(index, channel,
+                  flush && (k == burst - 1));
+          if (spiTransferError) {
+              return -5;
+          }
+          (*nLoaded)++;
+      }
+  }
+
+  return spiTransferError;
+}
+
 int8_t DRV_CANFDSPI_TransmitChannelFlush(CANFDSPI_MODULE_ID index,
         CAN_FIFO_CHANNEL channel)
 {
@@ -1033,6 +1544,17 @@ int8_t DRV_CANFDSPI_TransmitChannelUpdate(CANFDSPI_MODULE_ID index,
       return -1;
   }
 
+  // Keep local FIFO index and free slot count in step with the controller
+  if (fifoGeometry[channel].Depth) {
+      fifoGeometry[channel].Index++;
+      if (fifoGeometry[channel].Index >= fifoGeometry[channel].Depth) {
+          fifoGeometry[channel].Index = 0;
+      }
+      if (fifoGeometry[channel].Free) {
+          fifoGeometry[channel].Free--;
+      }
+  }
+
   return spiTransferError;
 }
 
@@ -1288,6 +1810,20 @@ int8_t DRV_CANFDSPI_ReceiveChannelConfigure(CANFDSPI_MODULE_ID index,
   a = cREGADDR_CiFIFOCON + (channel * CiFIFO_OFFSET);
 
   spiTransferError = DRV_CANFDSPI_WriteWord(index, a, ciFifoCon.word);
+  if (spiTransferError) {
+      return -1;
+  }
+
+  // Remember geometry, RAM address is learned on first access
+  fifoGeometry[channel].TxEnable = false;
+  fifoGeometry[channel].TimeStampEnable = config->RxTimeStampEnable;
+  fifoGeometry[channel].Depth = config->FifoSize + 1;
+  fifoGeometry[channel].ObjectSize = 8 + payloadSizeBytes[config->PayLoadSize];
+  if (config->RxTimeStampEnable) {
+      fifoGeometry[channel].ObjectSize += 4;
+  }
+  fifoGeometry[channel].RamAddress = 0;
+  fifoGeometry[channel].Index = 0;
 
   return spiTransferError;
 }
@@ -1433,6 +1969,149 @@ int8_t DRV_CANFDSPI_ReceiveMessageGet(CANFDSPI_MODULE_ID index,
   return spiTransferError;
 }
 
+int8_t DRV_CANFDSPI_ReceiveMessageGetBatch(CANFDSPI_MODULE_ID index,
+        CAN_FIFO_CHANNEL channel, CAN_RX_MSGOBJ* rxObj,
+        uint8_t *rxd, uint8_t nBytes, uint8_t maxMessages, uint8_t *nMessages)
+{
+  CAN_FIFO_GEOMETRY* fifo = &fifoGeometry[channel];
+  uint32_t fifoReg[2];
+  uint16_t sta = 0;
+  uint16_t a;
+  uint16_t n;
+  uint8_t pending = 0;
+  uint8_t burst = 0;
+  uint8_t header = 0;
+  uint8_t copy = 0;
+  uint8_t i, k;
+  uint8_t* ba;
+  REG_CiFIFOSTA ciFifoSta;
+  REG_CiFIFOUA ciFifoUa;
+  REG_t myReg;
+  int8_t spiTransferError = 0;
+
+  *nMessages = 0;
+
+  // Only configured receive FIFOs have a known geometry
+  if (fifo->Depth == 0 || fifo->TxEnable) {
+      return -1;
+  }
+
+  a = cREGADDR_CiFIFOSTA + (channel * CiFIFO_OFFSET);
+  ciFifoSta.word = 0;
+
+  if (fifo->RamAddress == 0) {
+      // First access after configuration: read STA and UA to locate object 0
+      spiTransferError = DRV_CANFDSPI_ReadWordArray(index, a, fifoReg, 2);
+      if (spiTransferError) {
+          return -2;
+      }
+      ciFifoSta.word = fifoReg[0];
+      ciFifoUa.word = fifoReg[1];
+#ifdef USERADDRESS_TIMES_FOUR
+      n = 4 * ciFifoUa.bF.UserAddress;
+#else
+      n = ciFifoUa.bF.UserAddress;
+#endif
+      fifo->RamAddress = n + cRAMADDR_START - (fifo->Index * fifo->ObjectSize);
+  } else {
+      // Flags and FIFOCI are in the low half word of CiFIFOSTA
+      spiTransferError = DRV_CANFDSPI_ReadHalfWord(index, a, &sta);
+      if (spiTransferError) {
+          return -2;
+      }
+      ciFifoSta.byte[0] = (uint8_t) (sta & 0xFF);
+      ciFifoSta.byte[1] = (uint8_t) (sta >> 8);
+  }
+
+  if (!ciFifoSta.rxBF.RxNotEmptyIF) {
+      return 0;
+  }
+
+  // FIFOCI is the head, our index the tail; equal and not empty means full
+  pending = (ciFifoSta.rxBF.FifoIndex + fifo->Depth - fifo->Index) % fifo->Depth;
+  if (pending == 0) {
+      pending = fifo->Depth;
+  }
+  if (pending > maxMessages) {
+      pending = maxMessages;
+  }
+
+  header = fifo->TimeStampEnable ? 12 : 8;
+  copy = fifo->ObjectSize - header;
+  if (copy > nBytes) {
+      copy = nBytes;
+  }
+
+  while (*nMessages < pending) {
+      // Burst up to the end of the FIFO RAM or the burst buffer, whichever is first
+      burst = pending - *nMessages;
+      if (burst > fifo->Depth - fifo->Index) {
+          burst = fifo->Depth - fifo->Index;
+      }
+      if (burst > (SPI_BURST_BUFFER_LENGTH - 2) / fifo->ObjectSize) {
+          burst = (SPI_BURST_BUFFER_LENGTH - 2) / fifo->ObjectSize;
+      }
+
+      // Last object only needs header and requested data
+      n = (burst - 1) * fifo->ObjectSize + header + copy;
+      if (n % 4) {
+          n = n + 4 - (n % 4);
+      }
+
+      a = fifo->RamAddress + (fifo->Index * fifo->ObjectSize);
+      spiTransferError = DRV_CANFDSPI_ReadRamBurst(index, a, n);
+      if (spiTransferError) {
+          return -3;
+      }
+
+      for (k = 0; k < burst; k++) {
+          ba = &spiBurstReceiveBuffer[2 + (k * fifo->ObjectSize)];
+
+          // Assign message header
+          myReg.byte[0] = ba[0];
+          myReg.byte[1] = ba[1];
+          myReg.byte[2] = ba[2];
+          myReg.byte[3] = ba[3];
+          rxObj->word[0] = myReg.word;
+
+          myReg.byte[0] = ba[4];
+          myReg.byte[1] = ba[5];
+          myReg.byte[2] = ba[6];
+          myReg.byte[3] = ba[7];
+          rxObj->word[1] = myReg.word;
+
+          if (fifo->TimeStampEnable) {
+              myReg.byte[0] = ba[8];
+              myReg.byte[1] = ba[9];
+              myReg.byte[2] = ba[10];
+              myReg.byte[3] = ba[11];
+              rxObj->word[2] = myReg.word;
+          } else {
+              rxObj->word[2] = 0;
+          }
+
+          // Assign message data
+          for (i = 0; i < copy; i++) {
+              rxd[i] = ba[i + header];
+          }
+
+          rxObj++;
+          rxd += nBytes;
+      }
+
+      // UINC once per object, the controller advances its tail one object per write
+      for (k = 0; k < burst; k++) {
+          spiTransferError = DRV_CANFDSPI_ReceiveChannelUpdate(index, channel);
+          if (spiTransferError) {
+              return -4;
+          }
+          (*nMessages)++;
+      }
+  }
+
+  return spiTransferError;
+}
+
 int8_t DRV_CANFDSPI_ReceiveChannelReset(CANFDSPI_MODULE_ID index,
         CAN_FIFO_CHANNEL channel)
 {
@@ -1446,6 +2125,10 @@ int8_t DRV_CANFDSPI_ReceiveChannelReset(CANFDSPI_MODULE_ID index,
   ciFifoCon.rxBF.FRESET = 1;
 
   spiTransferError = DRV_CANFDSPI_WriteByte(index, a, ciFifoCon.byte[1]);
+  if (spiTransferError == 0) {
+      fifoGeometry[channel].Index = 0;
+      fifoGeometry[channel].Free = fifoGeometry[channel].Depth;
+  }
 
   return spiTransferError;
 }
@@ -1465,6 +2148,14 @@ int8_t DRV_CANFDSPI_ReceiveChannelUpdate(CANFDSPI_MODULE_ID index,
   // Write byte
   spiTransferError = DRV_CANFDSPI_WriteByte(index, a, ciFifoCon.byte[1]);
 
+  // Keep local FIFO index in step with the controller
+  if (spiTransferError == 0 && fifoGeometry[channel].Depth) {
+      fifoGeometry[channel].Index++;
+      if (fifoGeometry[channel].Index >= fifoGeometry[channel].Depth) {
+          fifoGeometry[channel].Index = 0;
+      }
+  }
+
   return spiTransferError;
 }
 
@@ -3931,11 +4622,65 @@ int8_t DRV_CANFDSPI_FifoIndexGet(CANFDSPI_MODULE_ID index,
     return spiTransferError;
 }
 
+#if defined(DRV_CANFDSPI_CRC16_HW)
+
+uint16_t DRV_CANFDSPI_CalculateCRC16(uint8_t* data, uint16_t size)
+{
+    static bool crcUnitReady = false;
+
+    if (!crcUnitReady) {
+        __HAL_RCC_CRC_CLK_ENABLE();
+        CRC->POL = 0x8005;
+        CRC->INIT = CRCBASE;
+        CRC->CR = CRC_CR_POLYSIZE_0;   // 16 bit, no bit reversal
+        crcUnitReady = true;
+    }
+
+    CRC->CR |= CRC_CR_RESET;
+
+    // Words are shifted in MSB first, so build them big endian
+    while (size >= 4) {
+        CRC->DR = ((uint32_t) data[0] << 24) | ((uint32_t) data[1] << 16) |
+                ((uint32_t) data[2] << 8) | data[3];
+        data += 4;
+        size -= 4;
+    }
+    while (size-- != 0) {
+        *(__IO uint8_t *) &CRC->DR = *data++;
+    }
+
+    return (uint16_t) CRC->DR;
+}
+
+#else
+
 uint16_t DRV_CANFDSPI_CalculateCRC16(uint8_t* data, uint16_t size)
 {
     uint16_t init = CRCBASE;
     uint8_t index;
 
+#if DRV_CANFDSPI_CRC16_SLICES == 8
+    while (size >= 8) {
+        init ^= (uint16_t) ((data[0] << 8) | data[1]);
+        init = crc16_table7[init >> 8] ^ crc16_table6[init & 0xFF] ^
+                crc16_table5[data[2]] ^ crc16_table4[data[3]] ^
+                crc16_table3[data[4]] ^ crc16_table2[data[5]] ^
+                crc16_table1[data[6]] ^ crc16_table[data[7]];
+        data += 8;
+        size -= 8;
+    }
+#endif
+
+#if DRV_CANFDSPI_CRC16_SLICES >= 4
+    while (size >= 4) {
+        init ^= (uint16_t) ((data[0] << 8) | data[1]);
+        init = crc16_table3[init >> 8] ^ crc16_table2[init & 0xFF] ^
+                crc16_table1[data[2]] ^ crc16_table[data[3]];
+        data += 4;
+        size -= 4;
+    }
+#endif
+
     while (size-- != 0) {
         index = (((uint8_t) (init >>8))&0xFF) ^ *data++;
         init = (init << 8) ^ crc16_table[index];
@@ -3944,6 +4689,8 @@ uint16_t DRV_CANFDSPI_CalculateCRC16(uint8_t* data, uint16_t size)
     return init;
 }
 
+#endif
+
 CAN_DLC DRV_CANFDSPI_DataBytesToDlc(uint8_t n)
 {
     CAN_DLC dlc = CAN_DLC_0;
@@ -0,0 +1,118 @@
+/*******************************************************************************
+  Serial Log - record formatting
+
+  File Name:
+    log_format.c
+
+  Summary:
+    Expands a log record into text.
+
+  Description:
+    Used on the target when logging in text mode, and by the host Log Decoder
+    for binary logs. Depends only on the C library, no HAL.
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "log_events.h"
+
+#define LOG_EVENT_FORMAT(name, value, format) [value] = format,
+#define LOG_RAW_NAME_TEXT(name, text) text,
+
+static const char *const logFormats[256] = {
+    LOG_EVENT_TABLE(LOG_EVENT_FORMAT)
+};
+
+static const char *const logRawNames[LOG_RAW_NAME_TOTAL] = {
+    LOG_RAW_NAME_TABLE(LOG_RAW_NAME_TEXT)
+};
+
+int LOG_Format(char *out, int size, uint8_t id, const uint8_t *payload, uint8_t n)
+{
+    const char *fmt = logFormats[id];
+    uint32_t args[LOG_RECORD_MAX_ARGS];
+    uint8_t nArgs = n / 4;
+    uint8_t arg = 0;
+    char spec[16];
+    int length = 0;
+    int i;
+
+    if (size <= 0) {
+        return 0;
+    }
+    out[0] = 0;
+
+    if (id == LOG_ID_TEXT) {
+        length = (n < size) ? n : size - 1;
+        memcpy(out, payload, length);
+        out[length] = 0;
+        return length;
+    }
+
+    if (fmt == NULL) {
+        return snprintf(out, size, "LOG unknown record 0x%02x", id);
+    }
+
+    if (nArgs > LOG_RECORD_MAX_ARGS) {
+        nArgs = LOG_RECORD_MAX_ARGS;
+    }
+    memcpy(args, payload, nArgs * 4);
+
+    // Walk the format, one argument word per conversion
+    while (*fmt && length < size - 1) {
+        if (*fmt != '%') {
+            out[length++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[length++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        i = 0;
+        spec[i++] = *fmt++;
+        while (*fmt && strchr("-+ #0123456789.", *fmt) && i < (int) sizeof(spec) - 2) {
+            spec[i++] = *fmt++;
+        }
+        while (*fmt == 'l' || *fmt == 'h') {
+            fmt++;
+        }
+        if (*fmt == 0) {
+            break;
+        }
+        spec[i++] = *fmt;
+        spec[i] = 0;
+
+        uint32_t word = (arg < nArgs) ? args[arg] : 0;
+        arg++;
+
+        switch (*fmt++) {
+            case 'd':
+            case 'i':
+                length += snprintf(out + length, size - length, spec, (int) (int32_t) word);
+                break;
+            case 'f':
+            {
+                float f;
+                memcpy(&f, &word, sizeof(f));
+                length += snprintf(out + length, size - length, spec, (double) f);
+                break;
+            }
+            case 's':
+                length += snprintf(out + length, size - length, spec,
+                        (word < LOG_RAW_NAME_TOTAL) ? logRawNames[word] : "?");
+                break;
+            default:
+                length += snprintf(out + length, size - length, spec, (unsigned int) word);
+                break;
+        }
+    }
+
+    if (length > size - 1) {
+        length = size - 1;
+    }
+    out[length] = 0;
+
+    return length;
+}
@@ -20,6 +20,12 @@
 #include "canfdspi_register.h"
 #include "app.h"
 #include "time.h"
+#include "serial_log.h"
+#include "rx_stats.h"
+#include "tx_stats.h"
+#include "tx_sched.h"
+#include "scenario.h"
+#include "rx_trace.h"
 
 /* USER CODE END Includes */
 
@@ -35,6 +41,10 @@
 // You will need to edit the MX_RTC_Init to set up the day, month, year, hour, minute, second.
 //#define SET_TIME
 
+// Terminal bytes waiting for serialCommand, a power of two. Holds a scenario
+// load arriving while VCU_Tasks is busy
+#define UART_RX_RING    64
+
 
 /* USER CODE END PD */
 
@@ -59,8 +69,12 @@ PCD_HandleTypeDef hpcd_USB_FS;
 
 /* USER CODE BEGIN PV */
 
+DMA_HandleTypeDef hdma_usart1_tx;
+uint8_t uartRxByte;
+volatile uint8_t uartRing[UART_RX_RING];
+volatile uint8_t uartHead = 0;
+volatile uint8_t uartTail = 0;
 char logTime[9];
-char txBuffer[MAX_BUFFER];
 char tempBuffer[MAX_BUFFER];
 
 uint8_t canRxInterrupt = 0;
@@ -68,9 +82,6 @@ uint8_t canTxInterrupt = 0;
 uint32_t etTimerOverflows = 0;
 
 uint8_t decSec = 0;
-uint8_t sendState = 0;
-uint8_t changeState =0;
-uint16_t secondCounter=0;
 uint8_t debugLevel = DEBUG_LEVEL;
 
 /* USER CODE END PV */
@@ -98,12 +109,8 @@ static void MX_TIM1_Init(void);
 *     S E R I A L   O U T                                                              P A C K   E M U L A T O R
 ***************************************************************************************************************/
 void serialOut(char* message){
-	getTime();
-  sprintf(txBuffer,"%s %s\r\n",logTime, message);
-
-	if (HAL_UART_Transmit(&huart1, (uint8_t*)txBuffer, strlen(txBuffer), 2000) != HAL_OK){// Sending in normal mode
-		Error_Handler();
-	}
+  // Queued for LOG_Tasks, the time stamp is added when the record is expanded
+  LOG_Text(message);
 }
 
 /***************************************************************************************************************
@@ -114,12 +121,109 @@ void getTime(void){
   RTC_TimeTypeDef sTime = {0};
   RTC_DateTypeDef sDate = {0};
 
-  HAL_RTC_GetTime(&hrtc,&sTime, RTC_FORMAT_BCD);
-  HAL_RTC_GetDate(&hrtc,&sDate, RTC_FORMAT_BCD);
+  HAL_RTC_GetTime(&hrtc,&sTime, RTC_FORMAT_BIN);
+  HAL_RTC_GetDate(&hrtc,&sDate, RTC_FORMAT_BIN);
   uint8_t seconds = sTime.Seconds;
   uint8_t minutes = sTime.Minutes;
   uint8_t hours = sTime.Hours;
-  sprintf(logTime,"%02x:%02x:%02x",hours,minutes,seconds);
+  sprintf(logTime,"%02u:%02u:%02u",hours,minutes,seconds);
+
+  // Log records carry the tick, this ties it to the RTC
+  LOG_TimeSync(hours,minutes,seconds);
+}
+
+/***************************************************************************************************************
+*     S E R I A L   C O M M A N D                                                        V C U   E M U L A T O R
+***************************************************************************************************************/
+void serialCommand(void){
+  // One key from the terminal: s = report RX and TX statistics and the scenario,
+  // r = reset the statistics and the trace, t = dump the RX trace ring,
+  // g = restart the scenario, l = load a scenario.
+  // A load is hex, the length in two bytes little endian then the program
+  // (scenario.h), spaces and line ends are skipped and '.' ends it
+  static bool loading = false;
+  static uint8_t nibbles = 0;
+  static uint8_t value;
+  static uint16_t count;
+  static uint16_t loadLength;
+  uint8_t command;
+  uint8_t digit;
+
+  while (uartTail != uartHead){
+    command = uartRing[uartTail];
+    uartTail = (uartTail + 1) & (UART_RX_RING - 1);
+
+    if (loading){
+      if (command == ' ' || command == '\r' || command == '\n') continue;
+      if (command == '.'){
+        loading = false;
+        if (count < 2 || nibbles != 0 || SCENARIO_LoadEnd() != 0) serialOut("SCENARIO load failed");
+        continue;
+      }
+      if (command >= '0' && command <= '9')      digit = command - '0';
+      else if (command >= 'a' && command <= 'f') digit = command - 'a' + 10;
+      else if (command >= 'A' && command <= 'F') digit = command - 'A' + 10;
+      else {
+        loading = false;
+        serialOut("SCENARIO load aborted");
+        continue;
+      }
+
+      value = (value << 4) | digit;
+      if (++nibbles < 2) continue;
+      nibbles = 0;
+
+      if (count == 0){
+        loadLength = value;
+      }else if (count == 1){
+        loadLength |= value << 8;
+        if (SCENARIO_LoadBegin(loadLength) != 0){
+          loading = false;
+          serialOut("SCENARIO too long");
+        }
+      }else if (SCENARIO_LoadData(count - 2, &value, 1) != 0){
+        loading = false;
+        serialOut("SCENARIO longer than its length");
+      }
+      count++;
+      continue;
+    }
+
+    switch (command){
+      case 's':
+      case 'S':
+        RXSTATS_Report();
+        TXSTATS_Report();
+        TXSCHED_Report();
+        SCENARIO_Report();
+        break;
+      case 'r':
+      case 'R':
+        RXSTATS_Reset();
+        TXSTATS_Reset();
+        TXSCHED_Reset();
+        RXTRACE_Reset();
+        serialOut("RX/TX STATS reset");
+        break;
+      case 't':
+      case 'T':
+        RXTRACE_Dump();
+        break;
+      case 'g':
+      case 'G':
+        SCENARIO_Restart();
+        serialOut("SCENARIO restarted");
+        break;
+      case 'l':
+      case 'L':
+        loading = true;
+        nibbles = 0;
+        count = 0;
+        break;
+      default:
+        break;
+    }
+  }
 }
 
 
@@ -136,17 +240,8 @@ void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
     if(decSec == 10){
       decSec = 0;
       HAL_GPIO_TogglePin(LED_RED_GPIO_Port,  LED_RED_Pin); // This should happen every 1 sec = 10 overflows.
-      if(activeConnection){
-        secondCounter++;
-        if(secondCounter == STATE_INTERVAL){ // 1 minute state changes once contact has been made
-          secondCounter = 0;
-          changeState = 1;
-        }
-      }else{
-        secondCounter=0; //reset the second counter should the firstContact be set to 0
-      }
     }
-   if((decSec % 2) == 0) sendState =1;
+    // State changes and VCU commands are timed by the scenario (scenario.h)
   }
 }
 
@@ -214,6 +309,8 @@ void writeRTC(time_t now)
 
  HAL_RTCEx_BKUPWrite(&hrtc,RTC_BKP_DR0,0x32F2);       // lock it in with the backup registers
 
+ getTime();                                           // resync the log time stamps
+
 }
 
 /***************************************************************************************************************
@@ -334,6 +431,9 @@ int main(void)
   MX_USART1_UART_Init();
   MX_TIM1_Init();
   /* USER CODE BEGIN 2 */
+  LOG_Init(&huart1);
+  getTime();
+  HAL_UART_Receive_IT(&huart1, &uartRxByte, 1);   // single key commands, see serialCommand()
 
   //HAL_GPIO_WritePin(LED_GREEN_GPIO_Port,  LED_GREEN_Pin , GPIO_PIN_SET);    // on
 
@@ -352,6 +452,9 @@ int main(void)
 
     /* USER CODE BEGIN 3 */
     VCU_Tasks();
+    serialCommand();
+    RXTRACE_Tasks();
+    LOG_Tasks();
   }
   /* USER CODE END 3 */
 }
@@ -843,6 +946,42 @@ static void MX_GPIO_Init(void)
 }
 
 /* USER CODE BEGIN 4 */
+/***************************************************************************************************************
+*     U A R T   T X   C O M P L E T E                                                    V C U   E M U L A T O R
+***************************************************************************************************************/
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+  LOG_TxComplete(huart);
+}
+
+/***************************************************************************************************************
+*     U A R T   R X   C O M P L E T E                                                    V C U   E M U L A T O R
+***************************************************************************************************************/
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+  if (huart == &huart1){
+    // Dropped when serialCommand has fallen a whole ring behind
+    if (((uartHead + 1) & (UART_RX_RING - 1)) != uartTail){
+      uartRing[uartHead] = uartRxByte;
+      uartHead = (uartHead + 1) & (UART_RX_RING - 1);
+    }
+    HAL_UART_Receive_IT(&huart1, &uartRxByte, 1);
+  }
+}
+
+/***************************************************************************************************************
+*     U A R T   E R R O R                                                                V C U   E M U L A T O R
+***************************************************************************************************************/
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  // A DMA error ends the log transfer without TxCplt, an overrun stops reception
+  if (huart->gState == HAL_UART_STATE_READY){
+    LOG_TxComplete(huart);
+  }
+  if (huart == &huart1 && huart->RxState == HAL_UART_STATE_READY){
+    HAL_UART_Receive_IT(&huart1, &uartRxByte, 1);
+  }
+}
 
 /* USER CODE END 4 */
 
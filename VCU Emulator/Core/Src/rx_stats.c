@@ -0,0 +1,139 @@
+/*******************************************************************************
+  RX Statistics
+
+  File Name:
+    rx_stats.c
+
+  Summary:
+    Inter-arrival statistics per CAN ID from MCP2518FD receive time stamps.
+
+  Description:
+    IDs are kept in arrival order and searched linearly, starting with the
+    ID of the previous frame, since both emulators see only a handful of
+    IDs. Mean and variance are updated with Welford's method so the sums
+    cannot overflow however long the emulator runs. The TBC is a free
+    running 32 bit counter: unsigned subtraction gives the right interval
+    across a wrap, as long as the gap is shorter than one TBC period
+    (about 71 minutes at 1 us).
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <math.h>
+#include <string.h>
+#include "rx_stats.h"
+#include "serial_log.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+typedef struct {
+    uint32_t id;            // SID in bits 0-10, EID in bits 11-28, IDE in bit 29
+    uint32_t count;         // frames received
+    uint32_t lastTimeStamp;
+    uint32_t min;           // inter-arrival time, TBC ticks
+    uint32_t max;
+    float    mean;
+    float    m2;            // sum of squared differences from the mean
+} RXSTATS_ENTRY;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+static RXSTATS_ENTRY rxStats[RXSTATS_MAX_IDS];
+static uint8_t  rxStatsCount = 0;
+static uint8_t  rxStatsLast = 0;
+static uint32_t rxStatsUntracked = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+void RXSTATS_Update(const CAN_RX_MSGOBJ *rxObj)
+{
+    RXSTATS_ENTRY *entry;
+    uint32_t id;
+    uint32_t delta;
+    float diff;
+    uint8_t i;
+
+    id = rxObj->bF.id.SID | ((uint32_t) rxObj->bF.id.EID << 11) | ((uint32_t) rxObj->bF.ctrl.IDE << 29);
+
+    // Find the ID, trying the previous frame's first
+    i = rxStatsLast;
+    if (i >= rxStatsCount || rxStats[i].id != id) {
+        for (i = 0; i < rxStatsCount; i++) {
+            if (rxStats[i].id == id) {
+                break;
+            }
+        }
+        if (i == rxStatsCount) {
+            if (rxStatsCount == RXSTATS_MAX_IDS) {
+                rxStatsUntracked++;
+                return;
+            }
+            memset(&rxStats[i], 0, sizeof(rxStats[i]));
+            rxStats[i].id = id;
+            rxStats[i].min = UINT32_MAX;
+            rxStatsCount++;
+        }
+        rxStatsLast = i;
+    }
+    entry = &rxStats[i];
+
+    if (entry->count > 0) {
+        delta = rxObj->bF.timeStamp - entry->lastTimeStamp;
+
+        if (delta < entry->min) {
+            entry->min = delta;
+        }
+        if (delta > entry->max) {
+            entry->max = delta;
+        }
+
+        // Welford, n is the number of intervals including this one
+        diff = (float) delta - entry->mean;
+        entry->mean += diff / (float) entry->count;
+        entry->m2 += diff * ((float) delta - entry->mean);
+    }
+
+    entry->lastTimeStamp = rxObj->bF.timeStamp;
+    entry->count++;
+}
+
+void RXSTATS_Report(void)
+{
+    const RXSTATS_ENTRY *entry;
+    uint32_t intervals;
+    uint32_t sd;
+    uint8_t i;
+
+    for (i = 0; i < rxStatsCount; i++) {
+        entry = &rxStats[i];
+        intervals = entry->count - 1;
+
+        if (intervals == 0) {
+            LOG_EVENT(LOG_ID_RX_STATS, entry->id & 0x7FF, (entry->id >> 11) & 0x3FFFF, entry->count, 0, 0, 0, 0);
+            continue;
+        }
+
+        sd = (intervals > 1) ? (uint32_t) sqrtf(entry->m2 / (float) (intervals - 1)) : 0;
+        LOG_EVENT(LOG_ID_RX_STATS, entry->id & 0x7FF, (entry->id >> 11) & 0x3FFFF, entry->count,
+                entry->min, (uint32_t) (entry->mean + 0.5f), entry->max, sd);
+    }
+
+    if (rxStatsUntracked) {
+        LOG_EVENT(LOG_ID_RX_STATS_UNTRACKED, rxStatsUntracked, RXSTATS_MAX_IDS);
+    }
+}
+
+void RXSTATS_Reset(void)
+{
+    rxStatsCount = 0;
+    rxStatsLast = 0;
+    rxStatsUntracked = 0;
+}
@@ -0,0 +1,112 @@
+/*******************************************************************************
+  RX Trace
+
+  File Name:
+    rx_trace.c
+
+  Summary:
+    Binary ring of the last received frames for host decoding.
+
+  Description:
+    The ring counts frames with a free running index, the entry is the
+    index modulo the depth. A dump walks from the oldest frame still held
+    to the index at RXTRACE_Dump; when recording overtakes it, it skips
+    forward to the oldest frame again.
+
+    Data bytes go out as two words with the first byte in the top bits, so
+    %08x prints them in bus order.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <string.h>
+#include "rx_trace.h"
+#include "serial_log.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Defines
+
+// Log ring bytes a trace record takes
+#define RXTRACE_RECORD_SIZE (LOG_RECORD_OVERHEAD + 7 * 4)
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+static RXTRACE_ENTRY trace[RXTRACE_DEPTH];
+static uint32_t traceHead = 0;      // frames recorded
+static uint32_t dumpAt = 0;
+static uint32_t dumpEnd = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+
+static inline uint32_t RXTRACE_Word(const uint8_t *b)
+{
+    return ((uint32_t) b[0] << 24) | ((uint32_t) b[1] << 16) | ((uint32_t) b[2] << 8) | b[3];
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+void RXTRACE_Frame(const CAN_RX_MSGOBJ *rxObj, const uint8_t *data)
+{
+    RXTRACE_ENTRY *entry = &trace[traceHead & (RXTRACE_DEPTH - 1)];
+
+    entry->id = rxObj->bF.id.SID | ((uint32_t) rxObj->bF.id.EID << 11) | ((uint32_t) rxObj->bF.ctrl.IDE << 29);
+    entry->timeStamp = rxObj->bF.timeStamp;
+    entry->seq = (uint16_t) traceHead;
+    entry->dlc = rxObj->bF.ctrl.DLC;
+    entry->flags = (rxObj->bF.ctrl.FDF ? RXTRACE_FDF : 0) |
+                   (rxObj->bF.ctrl.BRS ? RXTRACE_BRS : 0) |
+                   (rxObj->bF.ctrl.ESI ? RXTRACE_ESI : 0) |
+                   (rxObj->bF.ctrl.DLC > CAN_DLC_8 ? RXTRACE_TRUNCATED : 0);
+    memcpy(entry->data, data, sizeof(entry->data));
+
+    traceHead++;
+}
+
+void RXTRACE_Dump(void)
+{
+    dumpEnd = traceHead;
+    dumpAt = (traceHead > RXTRACE_DEPTH) ? traceHead - RXTRACE_DEPTH : 0;
+}
+
+void RXTRACE_Tasks(void)
+{
+    const RXTRACE_ENTRY *entry;
+    uint8_t n;
+
+    for (n = 0; n < RXTRACE_DUMP_BURST && dumpAt != dumpEnd; n++) {
+        // Leave the log room for the records of the rest of the code
+        if (LOG_FreeGet() < 4 * RXTRACE_RECORD_SIZE) {
+            return;
+        }
+
+        // Overwritten while waiting for the log, continue at the oldest
+        if (traceHead - dumpAt > RXTRACE_DEPTH) {
+            dumpAt = traceHead - RXTRACE_DEPTH;
+            if ((int32_t) (dumpEnd - dumpAt) <= 0) {
+                dumpAt = dumpEnd;
+                return;
+            }
+        }
+
+        entry = &trace[dumpAt & (RXTRACE_DEPTH - 1)];
+        LOG_EVENT(LOG_ID_VCU_RX_TRACE, entry->seq, entry->id, entry->timeStamp, entry->dlc, entry->flags,
+                  RXTRACE_Word(&entry->data[0]), RXTRACE_Word(&entry->data[4]));
+        dumpAt++;
+    }
+}
+
+void RXTRACE_Reset(void)
+{
+    traceHead = 0;
+    dumpAt = 0;
+    dumpEnd = 0;
+}
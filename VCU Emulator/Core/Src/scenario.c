@@ -0,0 +1,462 @@
+/*******************************************************************************
+  Scenario Engine
+
+  File Name:
+    scenario.c
+
+  Summary:
+    Bytecode interpreter for scripted VCU behaviour.
+
+  Description:
+    The interpreter keeps a program counter into a fixed program buffer and
+    at most one blocking condition: a time, a BMS state or a burst still
+    sending. SCENARIO_Tasks checks the blocking condition, runs instructions
+    until one blocks or the step limit is reached, then sends the keep-alive
+    if it is due. Time comparisons are signed differences of HAL ticks, so they
+    survive the 49 day wrap.
+
+    Loads go to a second buffer and are only copied over the program once
+    they are complete and have been checked, so a lost chunk never leaves
+    a half written program running. The check walks the program once; at
+    run time operands are read without further range checks.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <string.h>
+#include "scenario.h"
+#include "app.h"
+#include "serial_log.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Types
+
+typedef enum {
+    SCENARIO_WAIT_NONE = 0,
+    SCENARIO_WAIT_TIME,
+    SCENARIO_WAIT_BMS,
+    SCENARIO_WAIT_BURST
+} SCENARIO_WAIT;
+
+typedef struct {
+    uint16_t start;         // first instruction of the body
+    uint16_t left;          // passes left, 0 repeats forever
+} SCENARIO_LOOP;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+// Instruction lengths by opcode, operands included
+static const uint8_t opLength[] = {
+    [SCENARIO_OP_END]       = 1,
+    [SCENARIO_OP_STATE]     = 2,
+    [SCENARIO_OP_WAIT]      = 3,
+    [SCENARIO_OP_WAIT_S]    = 3,
+    [SCENARIO_OP_KEEPALIVE] = 3,
+    [SCENARIO_OP_TIME]      = 1,
+    [SCENARIO_OP_MODULE]    = 3,
+    [SCENARIO_OP_BURST]     = 7,
+    [SCENARIO_OP_WAIT_BMS]  = 4,
+    [SCENARIO_OP_REPEAT]    = 3,
+    [SCENARIO_OP_NEXT]      = 1,
+};
+
+_Static_assert(sizeof(opLength) == SCENARIO_OP_COUNT, "opLength needs a length for every opcode");
+
+static uint8_t program[SCENARIO_SIZE];
+static uint16_t length = 0;
+static uint16_t pc = 0;
+static bool running = false;
+static bool started = false;
+
+static SCENARIO_LOOP loop[SCENARIO_LOOP_DEPTH];
+static uint8_t depth = 0;
+
+static SCENARIO_WAIT wait = SCENARIO_WAIT_NONE;
+static uint32_t waitUntil;
+static uint16_t waitPc;             // instruction that blocks, for the log
+static uint8_t waitState;
+static bool waitTimeout;
+
+static uint8_t burstFrame;
+static uint8_t burstArg;
+static uint16_t burstLeft;
+static uint16_t burstPeriod;
+
+static uint16_t keepAlivePeriod = SCENARIO_KEEPALIVE_MS;
+static uint32_t keepAliveNext;
+
+static uint8_t bmsState;
+static bool bmsValid = false;
+
+static uint32_t frames = 0;
+
+// Load in progress
+static uint8_t load[SCENARIO_SIZE];
+static uint16_t loadLength = 0;
+static uint16_t loadReceived = 0;
+static bool loading = false;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Local Functions
+
+static inline uint16_t SCENARIO_U16(const uint8_t *p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+// Returns 0 or a SCENARIO_LoadEnd error, errorAt is the offending instruction
+static int8_t SCENARIO_Check(const uint8_t *code, uint16_t n, uint16_t *errorAt)
+{
+    uint16_t at = 0;
+    uint8_t open = 0;
+    const uint8_t *p;
+
+    while (at < n) {
+        p = &code[at];
+        *errorAt = at;
+
+        // an opcode the table leaves out has length 0
+        if (p[0] >= SCENARIO_OP_COUNT || opLength[p[0]] == 0) {
+            return -2;
+        }
+        if (at + opLength[p[0]] > n) {
+            return -3;
+        }
+
+        switch (p[0]) {
+            case SCENARIO_OP_STATE:
+                if (p[1] > packOn) return -4;
+                break;
+            case SCENARIO_OP_MODULE:
+                if (p[2] > packOn) return -4;
+                break;
+            case SCENARIO_OP_BURST:
+                if (p[1] >= SCENARIO_FRAMES) return -4;
+                break;
+            case SCENARIO_OP_WAIT_BMS:
+                if (p[1] > packOn) return -4;
+                break;
+            case SCENARIO_OP_REPEAT:
+                if (++open > SCENARIO_LOOP_DEPTH) return -5;
+                break;
+            case SCENARIO_OP_NEXT:
+                if (open == 0) return -5;
+                open--;
+                break;
+            default:
+                break;
+        }
+        at += opLength[p[0]];
+    }
+
+    *errorAt = at;
+    return (open == 0) ? 0 : -5;
+}
+
+static void SCENARIO_Send(uint8_t frame, uint8_t arg)
+{
+    switch (frame) {
+        case SCENARIO_FRAME_COMMAND:
+            VCU_TransmitState(vcuState);
+            break;
+        case SCENARIO_FRAME_TIME:
+            VCU_TransmitTime();
+            break;
+        case SCENARIO_FRAME_MODULE:
+            VCU_TransmitModuleCommand(arg, vcuState);
+            break;
+        case SCENARIO_FRAME_KEEPALIVE:
+            VCU_TransmitKeepAlive(arg);
+            break;
+        default:
+            return;
+    }
+    frames++;
+}
+
+// Returns true while the program has to wait
+static bool SCENARIO_Blocked(uint32_t now)
+{
+    uint8_t sent;
+
+    switch (wait) {
+        case SCENARIO_WAIT_TIME:
+            if ((int32_t) (now - waitUntil) < 0) {
+                return true;
+            }
+            break;
+
+        case SCENARIO_WAIT_BMS:
+            if (bmsValid && bmsState == waitState) {
+                break;
+            }
+            if (waitTimeout && (int32_t) (now - waitUntil) >= 0) {
+                LOG_EVENT(LOG_ID_VCU_SCENARIO_TIMEOUT, waitState, waitPc, bmsValid ? bmsState : -1);
+                running = false;
+            }
+            return true;
+
+        case SCENARIO_WAIT_BURST:
+            // Catch up on frames that are due so the average rate holds when
+            // a pass is slower than the period. Period 0 is one per pass
+            for (sent = 0; burstLeft > 0 && (int32_t) (now - waitUntil) >= 0 && sent < SCENARIO_STEPS_PER_PASS; sent++) {
+                SCENARIO_Send(burstFrame, burstArg);
+                burstLeft--;
+                waitUntil += burstPeriod;
+                if (burstPeriod == 0) {
+                    break;
+                }
+            }
+            if (burstLeft > 0) {
+                return true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    wait = SCENARIO_WAIT_NONE;
+    return false;
+}
+
+// Run the instruction at pc, returns false when it blocks or ends the program
+static bool SCENARIO_Step(uint32_t now)
+{
+    const uint8_t *p;
+    SCENARIO_LOOP *l;
+
+    if (pc >= length) {
+        running = false;
+        return false;
+    }
+
+    p = &program[pc];
+    waitPc = pc;
+    pc += opLength[p[0]];
+
+    switch (p[0]) {
+        case SCENARIO_OP_END:
+            running = false;
+            LOG_EVENT(LOG_ID_VCU_SCENARIO_END, waitPc, vcuState);
+            return false;
+
+        case SCENARIO_OP_STATE:
+            // Sent now so the change is on time, in a keep-alive gap it waits
+            // for the keep-alive to resume
+            vcuState = (packState) p[1];
+            if (keepAlivePeriod != 0) {
+                SCENARIO_Send(SCENARIO_FRAME_COMMAND, 0);
+                keepAliveNext = now + keepAlivePeriod;
+            }
+            return true;
+
+        case SCENARIO_OP_WAIT:
+            wait = SCENARIO_WAIT_TIME;
+            waitUntil = now + SCENARIO_U16(&p[1]);
+            return false;
+
+        case SCENARIO_OP_WAIT_S:
+            wait = SCENARIO_WAIT_TIME;
+            waitUntil = now + SCENARIO_U16(&p[1]) * 1000UL;
+            return false;
+
+        case SCENARIO_OP_KEEPALIVE:
+            keepAlivePeriod = SCENARIO_U16(&p[1]);
+            keepAliveNext = now + keepAlivePeriod;
+            return true;
+
+        case SCENARIO_OP_TIME:
+            SCENARIO_Send(SCENARIO_FRAME_TIME, 0);
+            return true;
+
+        case SCENARIO_OP_MODULE:
+            VCU_TransmitModuleCommand(p[1], (packState) p[2]);
+            frames++;
+            return true;
+
+        case SCENARIO_OP_BURST:
+            wait = SCENARIO_WAIT_BURST;
+            burstFrame = p[1];
+            burstArg = p[2];
+            burstLeft = SCENARIO_U16(&p[3]);
+            burstPeriod = SCENARIO_U16(&p[5]);
+            waitUntil = now;
+            return false;
+
+        case SCENARIO_OP_WAIT_BMS:
+            wait = SCENARIO_WAIT_BMS;
+            waitState = p[1];
+            waitTimeout = SCENARIO_U16(&p[2]) != 0;
+            waitUntil = now + SCENARIO_U16(&p[2]);
+            return false;
+
+        case SCENARIO_OP_REPEAT:
+            l = &loop[depth++];
+            l->start = pc;
+            l->left = SCENARIO_U16(&p[1]);
+            return true;
+
+        case SCENARIO_OP_NEXT:
+            l = &loop[depth - 1];
+            if (l->left == 0 || --l->left > 0) {
+                pc = l->start;
+            } else {
+                depth--;
+            }
+            return true;
+
+        default:
+            running = false;
+            return false;
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Functions
+
+int8_t SCENARIO_FromSequence(const char *sequence, uint16_t intervalS, bool repeat)
+{
+    uint16_t n = (uint16_t) strlen(sequence);
+    uint16_t at = 0;
+    uint16_t i;
+
+    if (n == 0 || (repeat ? 4U : 0U) + 5U * n + 1U > SCENARIO_SIZE) {
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        if (sequence[i] < '0' || sequence[i] > '0' + packOn) {
+            return -1;
+        }
+    }
+
+    if (repeat) {
+        program[at++] = SCENARIO_OP_REPEAT;
+        program[at++] = 0;
+        program[at++] = 0;
+    }
+    for (i = 0; i < n; i++) {
+        program[at++] = SCENARIO_OP_STATE;
+        program[at++] = (uint8_t) (sequence[i] - '0');
+        program[at++] = SCENARIO_OP_WAIT_S;
+        program[at++] = (uint8_t) intervalS;
+        program[at++] = (uint8_t) (intervalS >> 8);
+    }
+    if (repeat) {
+        program[at++] = SCENARIO_OP_NEXT;
+    }
+    program[at++] = SCENARIO_OP_END;
+
+    length = at;
+    SCENARIO_Restart();
+
+    return 0;
+}
+
+void SCENARIO_Restart(void)
+{
+    pc = 0;
+    depth = 0;
+    wait = SCENARIO_WAIT_NONE;
+    keepAlivePeriod = SCENARIO_KEEPALIVE_MS;
+    vcuState = packOff;
+    running = (length > 0);
+    started = false;
+}
+
+void SCENARIO_Tasks(uint32_t now)
+{
+    uint8_t steps;
+
+    if (!started) {
+        keepAliveNext = now;
+        started = true;
+    }
+
+    if (running && !SCENARIO_Blocked(now)) {
+        for (steps = 0; steps < SCENARIO_STEPS_PER_PASS && running; steps++) {
+            if (!SCENARIO_Step(now)) {
+                break;
+            }
+        }
+    }
+
+    // VCU command with the current state, a period of 0 is a keep-alive gap.
+    // After the program, a STATE that just went out moves the next one on
+    if (keepAlivePeriod != 0 && (int32_t) (now - keepAliveNext) >= 0) {
+        keepAliveNext = now + keepAlivePeriod;
+        SCENARIO_Send(SCENARIO_FRAME_COMMAND, 0);
+    }
+}
+
+void SCENARIO_BmsState(uint8_t state)
+{
+    bmsState = state;
+    bmsValid = true;
+}
+
+int8_t SCENARIO_LoadBegin(uint16_t n)
+{
+    loading = false;
+    if (n == 0 || n > SCENARIO_SIZE) {
+        return -1;
+    }
+
+    loadLength = n;
+    loadReceived = 0;
+    loading = true;
+
+    return 0;
+}
+
+int8_t SCENARIO_LoadData(uint16_t offset, const uint8_t *data, uint8_t n)
+{
+    if (!loading || offset != loadReceived || offset + n > loadLength) {
+        loading = false;
+        return -1;
+    }
+
+    memcpy(&load[offset], data, n);
+    loadReceived += n;
+
+    return 0;
+}
+
+int8_t SCENARIO_LoadEnd(void)
+{
+    uint16_t errorAt = 0;
+    int8_t result;
+
+    if (!loading || loadReceived != loadLength) {
+        loading = false;
+        LOG_EVENT(LOG_ID_VCU_SCENARIO_REJECTED, -1, loadReceived);
+        return -1;
+    }
+    loading = false;
+
+    result = SCENARIO_Check(load, loadLength, &errorAt);
+    if (result != 0) {
+        LOG_EVENT(LOG_ID_VCU_SCENARIO_REJECTED, result, errorAt);
+        return result;
+    }
+
+    memcpy(program, load, loadLength);
+    length = loadLength;
+    frames = 0;
+    SCENARIO_Restart();
+    LOG_EVENT(LOG_ID_VCU_SCENARIO_LOADED, length);
+
+    return 0;
+}
+
+void SCENARIO_Report(void)
+{
+    LOG_EVENT(LOG_ID_VCU_SCENARIO_STATUS, running, pc, length, vcuState, bmsValid ? bmsState : -1, keepAlivePeriod, frames);
+}
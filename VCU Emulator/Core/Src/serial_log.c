@@ -0,0 +1,261 @@
+/*******************************************************************************
+  Serial Log
+
+  File Name:
+    serial_log.c
+
+  Summary:
+    Non-blocking UART logging through a record ring drained by DMA.
+
+  Description:
+    Record layout is described in log_events.h. The ring index counters run
+    freely and are masked on access; the producer only writes head, the
+    consumer only writes tail, so no locking is needed between them. The DMA
+    completion interrupt only clears txBusy.
+ *******************************************************************************/
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Included Files
+
+#include <stdio.h>
+#include <string.h>
+#include "serial_log.h"
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Variables
+
+static UART_HandleTypeDef *logUart = NULL;
+
+static uint8_t logRing[LOG_RING_SIZE];
+static volatile uint32_t logHead = 0;      // written by the producer
+static volatile uint32_t logTail = 0;      // written by the consumer
+
+static uint8_t logDmaBuffer[LOG_DMA_SIZE];
+static volatile bool txBusy = false;
+
+static uint32_t logLost = 0;
+static uint32_t logLostReported = 0;
+
+// Wall clock at the last LOG_TimeSync, seconds since midnight
+static uint32_t syncSeconds = 0;
+static uint32_t syncTick = 0;
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Ring
+
+static inline uint32_t LOG_RingFree(void)
+{
+    return LOG_RING_SIZE - (logHead - logTail);
+}
+
+static inline void LOG_RingPut(uint32_t *at, uint8_t b, uint8_t *check)
+{
+    logRing[(*at)++ & (LOG_RING_SIZE - 1)] = b;
+    *check ^= b;
+}
+
+static inline uint8_t LOG_RingPeek(uint32_t at)
+{
+    return logRing[at & (LOG_RING_SIZE - 1)];
+}
+
+// Writes one record and publishes it, false if it did not fit
+static bool LOG_RingWrite(uint8_t id, const uint8_t *payload, uint8_t n)
+{
+    uint32_t at = logHead;
+    uint32_t tick = HAL_GetTick();
+    uint8_t check = 0;
+    uint8_t i;
+
+    if (LOG_RingFree() < (uint32_t) n + LOG_RECORD_OVERHEAD) {
+        return false;
+    }
+
+    logRing[at++ & (LOG_RING_SIZE - 1)] = LOG_RECORD_SYNC;
+    LOG_RingPut(&at, id, &check);
+    LOG_RingPut(&at, n, &check);
+    LOG_RingPut(&at, (uint8_t) tick, &check);
+    LOG_RingPut(&at, (uint8_t) (tick >> 8), &check);
+    LOG_RingPut(&at, (uint8_t) (tick >> 16), &check);
+    LOG_RingPut(&at, (uint8_t) (tick >> 24), &check);
+    for (i = 0; i < n; i++) {
+        LOG_RingPut(&at, payload[i], &check);
+    }
+    logRing[at++ & (LOG_RING_SIZE - 1)] = check;
+
+    // Record must be complete in memory before the consumer can see it
+    __DMB();
+    logHead = at;
+
+    return true;
+}
+
+static void LOG_Append(uint8_t id, const uint8_t *payload, uint8_t n)
+{
+    uint32_t lost;
+
+    if (logLost != logLostReported) {
+        lost = logLost - logLostReported;
+        if (!LOG_RingWrite(LOG_ID_LOST, (const uint8_t *) &lost, sizeof(lost))) {
+            logLost++;
+            return;
+        }
+        logLostReported = logLost;
+    }
+
+    if (!LOG_RingWrite(id, payload, n)) {
+        logLost++;
+    }
+}
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Output
+
+#if LOG_OUTPUT_BINARY
+
+// Records go out byte for byte, boundaries do not matter
+static uint16_t LOG_DmaFill(uint32_t *nextTail)
+{
+    uint32_t tail = logTail;
+    uint32_t n = logHead - tail;
+    uint32_t i;
+
+    if (n > LOG_DMA_SIZE) {
+        n = LOG_DMA_SIZE;
+    }
+    for (i = 0; i < n; i++) {
+        logDmaBuffer[i] = LOG_RingPeek(tail + i);
+    }
+    *nextTail = tail + n;
+
+    return (uint16_t) n;
+}
+
+#else
+
+// Whole records are expanded to "hh:mm:ss message\r\n" while they fit
+static uint16_t LOG_DmaFill(uint32_t *nextTail)
+{
+    uint8_t payload[255];
+    char line[LOG_TEXT_MAX + 32];
+    uint32_t tail = logTail;
+    uint32_t tick, seconds;
+    uint16_t used = 0;
+    uint8_t id, n, i;
+    int length;
+
+    while (logHead != tail) {
+        id = LOG_RingPeek(tail + 1);
+        n = LOG_RingPeek(tail + 2);
+        tick = LOG_RingPeek(tail + 3) | ((uint32_t) LOG_RingPeek(tail + 4) << 8) |
+                ((uint32_t) LOG_RingPeek(tail + 5) << 16) | ((uint32_t) LOG_RingPeek(tail + 6) << 24);
+        for (i = 0; i < n; i++) {
+            payload[i] = LOG_RingPeek(tail + LOG_RECORD_HEADER + i);
+        }
+
+        seconds = (syncSeconds + (tick - syncTick) / 1000) % 86400;
+        length = snprintf(line, sizeof(line), "%02u:%02u:%02u ", (unsigned int) (seconds / 3600),
+                (unsigned int) ((seconds / 60) % 60), (unsigned int) (seconds % 60));
+        length += LOG_Format(line + length, sizeof(line) - length - 2, id, payload, n);
+        line[length++] = '\r';
+        line[length++] = '\n';
+
+        if (used + length > LOG_DMA_SIZE) {
+            break;
+        }
+        memcpy(logDmaBuffer + used, line, length);
+        used += length;
+        tail += (uint32_t) n + LOG_RECORD_OVERHEAD;
+    }
+    *nextTail = tail;
+
+    return used;
+}
+
+#endif
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Interface
+
+void LOG_Init(UART_HandleTypeDef *huart)
+{
+    logUart = huart;
+    logHead = 0;
+    logTail = 0;
+    txBusy = false;
+    logLost = 0;
+    logLostReported = 0;
+}
+
+void LOG_TimeSync(uint8_t hours, uint8_t minutes, uint8_t seconds)
+{
+    uint32_t args[3] = {hours, minutes, seconds};
+
+    syncTick = HAL_GetTick();
+    syncSeconds = (hours * 3600UL) + (minutes * 60UL) + seconds;
+
+    LOG_Record(LOG_ID_RTC, args, 3);
+}
+
+void LOG_Text(const char *message)
+{
+    size_t n = strlen(message);
+
+    if (n > LOG_TEXT_MAX) {
+        n = LOG_TEXT_MAX;
+    }
+    LOG_Append(LOG_ID_TEXT, (const uint8_t *) message, (uint8_t) n);
+}
+
+void LOG_Record(uint8_t id, const uint32_t *args, uint8_t nArgs)
+{
+    if (nArgs > LOG_RECORD_MAX_ARGS) {
+        nArgs = LOG_RECORD_MAX_ARGS;
+    }
+    LOG_Append(id, (const uint8_t *) args, nArgs * 4);
+}
+
+void LOG_Tasks(void)
+{
+    uint32_t nextTail;
+    uint16_t n;
+
+    if (logUart == NULL || txBusy || logHead == logTail) {
+        return;
+    }
+
+    n = LOG_DmaFill(&nextTail);
+    if (n == 0) {
+        return;
+    }
+
+    // Records leave the ring only once the transfer has started
+    txBusy = true;
+    if (HAL_UART_Transmit_DMA(logUart, logDmaBuffer, n) == HAL_OK) {
+        logTail = nextTail;
+    } else {
+        txBusy = false;
+    }
+}
+
+void LOG_TxComplete(UART_HandleTypeDef *huart)
+{
+    if (huart == logUart) {
+        txBusy = false;
+    }
+}
+
+uint32_t LOG_LostGet(void)
+{
+    return logLost;
+}
+
+uint32_t LOG_FreeGet(void)
+{
+    return LOG_RingFree();
+}
@@ -0,0 +1,68 @@
+//---------------------------------------------------------------------------
+
+#include <vcl.h>
+#pragma hdrstop
+
+#include <algorithm>
+#include "CanDispatch.h"
+
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+TCanDispatcher::TCanDispatcher()
+{
+    InitializeCriticalSection(&m_Lock);
+    m_Count = 0;
+    m_Dispatched = 0;
+    m_Claimed = 0;
+}
+//---------------------------------------------------------------------------
+
+TCanDispatcher::~TCanDispatcher()
+{
+    DeleteCriticalSection(&m_Lock);
+}
+//---------------------------------------------------------------------------
+
+void TCanDispatcher::Subscribe(TCanSubscriber *subscriber)
+{
+    EnterCriticalSection(&m_Lock);
+    m_Subscribers.push_back(subscriber);
+    InterlockedExchange(&m_Count, (LONG)m_Subscribers.size());
+    LeaveCriticalSection(&m_Lock);
+}
+//---------------------------------------------------------------------------
+
+void TCanDispatcher::Unsubscribe(TCanSubscriber *subscriber)
+{
+    EnterCriticalSection(&m_Lock);
+    m_Subscribers.erase(std::remove(m_Subscribers.begin(), m_Subscribers.end(), subscriber),
+                        m_Subscribers.end());
+    InterlockedExchange(&m_Count, (LONG)m_Subscribers.size());
+    LeaveCriticalSection(&m_Lock);
+}
+//---------------------------------------------------------------------------
+
+bool TCanDispatcher::Dispatch(const TFrameView &msg)
+{
+    bool claimed = false;
+
+    m_Dispatched++;
+
+    // Nothing is waiting most of the time, telemetry then never takes the lock
+    if (m_Count == 0)
+        return false;
+
+    EnterCriticalSection(&m_Lock);
+    for (size_t i = 0; i < m_Subscribers.size() && !claimed; i++)
+    {
+        if (m_Subscribers[i]->Matches(msg))
+            claimed = m_Subscribers[i]->Deliver(msg);
+    }
+    LeaveCriticalSection(&m_Lock);
+
+    if (claimed)
+        m_Claimed++;
+    return claimed;
+}
+//---------------------------------------------------------------------------
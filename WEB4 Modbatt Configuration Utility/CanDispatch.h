@@ -0,0 +1,71 @@
+//---------------------------------------------------------------------------
+//  CanDispatch.h
+//
+//  Routing of received frames to the code waiting for them.
+//
+//  Only the receive path reads the PCAN queue. Every frame it reads goes to
+//  TCanDispatcher::Dispatch first; a subscriber whose ID pattern matches
+//  takes it there, on the receive thread, and wakes whoever waits on it.
+//  Frames nobody takes go on to the normal decoder, so a transfer waiting
+//  for ACKs never dequeues or drops telemetry.
+//---------------------------------------------------------------------------
+
+#ifndef CanDispatchH
+#define CanDispatchH
+
+#include <windows.h>
+#include <vector>
+#include "PCANBasic.h"
+#include "FrameView.h"
+
+//---------------------------------------------------------------------------
+class TCanSubscriber
+{
+public:
+    // Frames with (ID & mask) == pattern and the same ID type
+    TCanSubscriber(DWORD pattern, DWORD mask, bool extended)
+        : m_Pattern(pattern), m_Mask(mask), m_Extended(extended) {}
+    virtual ~TCanSubscriber() {}
+
+    bool Matches(const TFrameView &msg) const
+    {
+        return (((msg.MSGTYPE & PCAN_MESSAGE_EXTENDED) != 0) == m_Extended) &&
+               ((msg.ID & m_Mask) == m_Pattern);
+    }
+
+    // Called on the receive thread for a matching frame, must not block.
+    // True when the frame was for this subscriber
+    virtual bool Deliver(const TFrameView &msg) = 0;
+
+protected:
+    DWORD m_Pattern;
+    DWORD m_Mask;
+    bool m_Extended;
+};
+
+//---------------------------------------------------------------------------
+class TCanDispatcher
+{
+public:
+    TCanDispatcher();
+    ~TCanDispatcher();
+
+    void Subscribe(TCanSubscriber *subscriber);
+    // No Deliver call to the subscriber is running or follows once this returns
+    void Unsubscribe(TCanSubscriber *subscriber);
+
+    // Offer a received frame to the subscribers, true when one took it
+    bool Dispatch(const TFrameView &msg);
+
+    DWORD Dispatched() const { return m_Dispatched; }
+    DWORD Claimed() const { return m_Claimed; }
+
+private:
+    CRITICAL_SECTION m_Lock;
+    std::vector<TCanSubscriber*> m_Subscribers;
+    volatile LONG m_Count;                  // m_Subscribers.size() for the lock free check
+    DWORD m_Dispatched;
+    DWORD m_Claimed;
+};
+//---------------------------------------------------------------------------
+#endif
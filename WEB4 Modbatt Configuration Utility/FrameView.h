@@ -0,0 +1,95 @@
+//---------------------------------------------------------------------------
+//  FrameView.h
+//
+//  A received frame as the dispatcher and the decoders see it.
+//
+//  TFrameView points at the data of the frame PCAN-Basic just read instead
+//  of holding a copy, so a classic TPCANMsg and a TPCANMsgFD give the same
+//  view and nothing is copied on the way to a decode handler. The view is
+//  passed by reference and only valid until ProcessMessage returns; code
+//  that keeps a frame takes a copy with CopyTo.
+//
+//  Bits reads a field as the CANFRM_* structs of can_frm_vcu.h lay it out:
+//  uint32_t bit fields fill each little endian 32 bit word from bit 0, and
+//  a field that does not fit in what is left of a word starts the next one.
+//  Bytes past Length read as 0, as they did from the zeroed struct copy.
+//---------------------------------------------------------------------------
+
+#ifndef FrameViewH
+#define FrameViewH
+
+#include <windows.h>
+#include <stdint.h>
+#include <string.h>
+#include "PCANBasic.h"
+
+//---------------------------------------------------------------------------
+struct TFrameView
+{
+    DWORD ID;
+    BYTE MSGTYPE;
+    BYTE DLC;
+    BYTE Length;                            // data bytes the DLC stands for
+    const BYTE *Data;                       // into the receive buffer
+    TPCANTimestampFD Timestamp;             // us
+
+    TFrameView(const TPCANMsgFD &msg, TPCANTimestampFD timestamp)
+        : ID(msg.ID), MSGTYPE(msg.MSGTYPE), DLC(msg.DLC),
+          Length(DataLength(msg.DLC, (msg.MSGTYPE & PCAN_MESSAGE_FD) != 0)),
+          Data(msg.DATA), Timestamp(timestamp) {}
+
+    TFrameView(const TPCANMsg &msg, const TPCANTimestamp &timestamp)
+        : ID(msg.ID), MSGTYPE(msg.MSGTYPE), DLC(msg.LEN), Length(DataLength(msg.LEN, false)),
+          Data(msg.DATA),
+          Timestamp(timestamp.micros + (1000ULL * timestamp.millis) +
+                    (0x100000000ULL * 1000ULL * timestamp.millis_overflow)) {}
+
+    uint8_t U8(int offset) const
+    {
+        return (offset < Length) ? Data[offset] : 0;
+    }
+
+    // Little endian 32 bit word n of the data
+    uint32_t Word(int n) const
+    {
+        int offset = n * 4;
+        uint32_t word;
+
+        if (offset + 4 <= Length)
+        {
+            memcpy(&word, Data + offset, sizeof(word));
+            return word;
+        }
+        return U8(offset) | ((uint32_t)U8(offset + 1) << 8) |
+               ((uint32_t)U8(offset + 2) << 16) | ((uint32_t)U8(offset + 3) << 24);
+    }
+
+    // Field of width bits from bit start, within one word
+    uint32_t Bits(int start, int width) const
+    {
+        uint32_t word = Word(start / 32) >> (start % 32);
+
+        return (width >= 32) ? word : (word & ((1UL << width) - 1));
+    }
+
+    void CopyTo(TPCANMsgFD &msg) const
+    {
+        msg.ID = ID;
+        msg.MSGTYPE = MSGTYPE;
+        msg.DLC = DLC;
+        memcpy(msg.DATA, Data, Length);
+    }
+
+    static BYTE DataLength(BYTE dlc, bool fd)
+    {
+        static const BYTE fdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+
+        if (dlc <= 8)
+            return dlc;
+        if (!fd)
+            return 8;
+        return (dlc <= 15) ? fdLengths[dlc - 9] : 64;
+    }
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,289 @@
+//---------------------------------------------------------------------------
+
+#include <vcl.h>
+#pragma hdrstop
+
+#include <string.h>
+#include "KeyTransfer.h"
+
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+// Data length of each FD DLC above 8
+static const uint8_t fdLengths[] = {12, 16, 20, 24, 32, 48, 64};
+
+static int FdPadLength(int length, uint8_t &dlc)
+{
+    if (length <= 8)
+    {
+        dlc = (uint8_t)length;
+        return length;
+    }
+    for (dlc = 0; fdLengths[dlc] < length; dlc++)
+        ;
+    length = fdLengths[dlc];
+    dlc += 9;
+    return length;
+}
+
+TKeyTransfer::TKeyTransfer(uint16_t stdId, uint8_t device, const uint8_t *data, int length, bool fd,
+                           int window, DWORD rtoMs)
+    : TCanSubscriber(0, 0, true)
+{
+    InitializeCriticalSection(&m_Lock);
+    m_hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_hNotify = m_hEvent;
+
+    m_StdId = stdId;
+    m_Device = device;
+    m_Window = (window < 1) ? 1 : window;
+    m_Rto = rtoMs;
+
+    if (length > KEYXFER_MAX_LENGTH)
+        length = KEYXFER_MAX_LENGTH;
+    memset(m_Data, 0, sizeof(m_Data));
+    memcpy(m_Data, data, length);
+
+    m_Fd = fd && (length <= KEYXFER_FD_LENGTH);
+    if (m_Fd)
+    {
+        uint8_t dlc;
+        m_Chunks = 1;
+        m_ChunkLength = FdPadLength(length, dlc);
+    }
+    else
+    {
+        m_Chunks = (length + KEYXFER_CHUNK_SIZE - 1) / KEYXFER_CHUNK_SIZE;
+        if (m_Chunks == 0)
+            m_Chunks = 1;
+        m_ChunkLength = KEYXFER_CHUNK_SIZE;
+    }
+
+    // ACKs of this item, from any chunk
+    m_Pattern = ChunkId(stdId + KEYXFER_ACK_OFFSET, 0, m_Chunks, device);
+    m_Mask = 0x1FFFFFFFUL & ~(KEYXFER_FIELD_MASK << KEYXFER_CHUNK_SHIFT);
+
+    // Over the padding as well, the receiver only knows the bytes it got
+    m_Crc = KeyCrc16(m_Data, m_Chunks * m_ChunkLength);
+
+    m_State = ksSending;
+    m_Acked = 0;
+    m_NextNew = 0;
+    memset(m_SentAt, 0, sizeof(m_SentAt));
+    memset(m_SendCount, 0, sizeof(m_SendCount));
+    m_Sends = 0;
+    m_Retransmits = 0;
+    m_StartTime = GetTickCount();
+    m_EndTime = m_StartTime;
+    m_Error = "";
+}
+//---------------------------------------------------------------------------
+
+TKeyTransfer::~TKeyTransfer()
+{
+    CloseHandle(m_hEvent);
+    DeleteCriticalSection(&m_Lock);
+}
+//---------------------------------------------------------------------------
+
+uint8_t TKeyTransfer::Obfuscate(uint8_t value, int chunk)
+{
+    int rotations = chunk % 8;
+
+    if (rotations == 0)
+        return value;
+    return (uint8_t)((value << rotations) | (value >> (8 - rotations)));
+}
+//---------------------------------------------------------------------------
+
+uint32_t TKeyTransfer::ChunkId(uint16_t stdId, int chunk, int total, uint8_t device)
+{
+    return ((uint32_t)stdId << KEYXFER_STD_ID_SHIFT) |
+           (((uint32_t)chunk & KEYXFER_FIELD_MASK) << KEYXFER_CHUNK_SHIFT) |
+           (((uint32_t)total & KEYXFER_FIELD_MASK) << KEYXFER_TOTAL_SHIFT) |
+           (device & KEYXFER_DEVICE_MASK);
+}
+//---------------------------------------------------------------------------
+
+uint16_t TKeyTransfer::KeyCrc16(const uint8_t *data, int length)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (int i = 0; i < length; i++)
+    {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+//---------------------------------------------------------------------------
+
+void TKeyTransfer::BuildFrame(int index, DWORD now, TPCANMsgFD &frame)
+{
+    const uint8_t *chunkData = &m_Data[index * m_ChunkLength];
+    uint8_t dlc;
+
+    frame = TPCANMsgFD();
+    frame.ID = ChunkId(m_StdId, index + 1, m_Chunks, m_Device);
+    frame.MSGTYPE = PCAN_MESSAGE_EXTENDED;
+    if (m_Fd)
+        frame.MSGTYPE |= PCAN_MESSAGE_FD | PCAN_MESSAGE_BRS;
+    FdPadLength(m_ChunkLength, dlc);
+    frame.DLC = dlc;
+    for (int i = 0; i < m_ChunkLength; i++)
+        frame.DATA[i] = Obfuscate(chunkData[i], index + 1);
+
+    m_SentAt[index] = now;
+    m_SendCount[index]++;
+    m_Sends++;
+}
+//---------------------------------------------------------------------------
+
+void TKeyTransfer::Finish(TState state, const char *error)
+{
+    m_State = state;
+    m_Error = error;
+    m_EndTime = GetTickCount();
+    SetEvent(m_hNotify);
+}
+//---------------------------------------------------------------------------
+
+int TKeyTransfer::Poll(DWORD now, TPCANMsgFD *frames, int max)
+{
+    int count = 0;
+    int inFlight = 0;
+
+    EnterCriticalSection(&m_Lock);
+
+    // Chunks sent but not held yet, oldest first
+    for (int i = 0; i < m_NextNew && m_State == ksSending; i++)
+    {
+        if (m_Acked & (1U << i))
+            continue;
+        inFlight++;
+        if ((now - m_SentAt[i]) < m_Rto || count >= max)
+            continue;
+        if (m_SendCount[i] >= KEYXFER_MAX_SENDS)
+        {
+            Finish(ksFailed, "chunk not acknowledged");
+            break;
+        }
+        BuildFrame(i, now, frames[count++]);
+        m_Retransmits++;
+    }
+
+    // New chunks the window admits
+    while (m_State == ksSending && m_NextNew < m_Chunks && inFlight < m_Window && count < max)
+    {
+        BuildFrame(m_NextNew++, now, frames[count++]);
+        inFlight++;
+    }
+
+    LeaveCriticalSection(&m_Lock);
+    return count;
+}
+//---------------------------------------------------------------------------
+
+DWORD TKeyTransfer::NextDue(DWORD now)
+{
+    DWORD due = INFINITE;
+    int inFlight = 0;
+
+    EnterCriticalSection(&m_Lock);
+    if (m_State == ksSending)
+    {
+        for (int i = 0; i < m_NextNew; i++)
+        {
+            if (m_Acked & (1U << i))
+                continue;
+            inFlight++;
+            DWORD age = now - m_SentAt[i];
+            DWORD left = (age >= m_Rto) ? 0 : m_Rto - age;
+            if (left < due)
+                due = left;
+        }
+        if (m_NextNew < m_Chunks && inFlight < m_Window)
+            due = 0;
+    }
+    LeaveCriticalSection(&m_Lock);
+
+    return due;
+}
+//---------------------------------------------------------------------------
+
+bool TKeyTransfer::Deliver(const TFrameView &msg)
+{
+    if (msg.Length < KEYXFER_ACK_LENGTH)
+        return true;
+
+    uint16_t all = (uint16_t)((1UL << m_Chunks) - 1);
+    uint16_t bitmap = (uint16_t)(msg.Data[2] | (msg.Data[3] << 8));
+    uint16_t crc = (uint16_t)((msg.Data[4] << 8) | msg.Data[5]);
+
+    EnterCriticalSection(&m_Lock);
+    if (m_State == ksSending)
+    {
+        if (msg.Data[0] == KEYXFER_ACK_NACK)
+        {
+            // Everything is due again, the send limit still applies per chunk
+            m_Acked = 0;
+            for (int i = 0; i < m_NextNew; i++)
+                m_SentAt[i] = GetTickCount() - m_Rto;
+        }
+        else
+        {
+            m_Acked |= (bitmap & all);
+        }
+
+        if (m_Acked == all)
+        {
+            if (crc == m_Crc)
+                Finish(ksDone, "");
+            else
+                Finish(ksFailed, "CRC mismatch");
+        }
+        else
+        {
+            SetEvent(m_hNotify);
+        }
+    }
+    LeaveCriticalSection(&m_Lock);
+
+    return true;
+}
+//---------------------------------------------------------------------------
+
+void TKeyTransfer::Abort(const char *reason)
+{
+    EnterCriticalSection(&m_Lock);
+    if (m_State == ksSending)
+        Finish(ksFailed, reason);
+    LeaveCriticalSection(&m_Lock);
+}
+//---------------------------------------------------------------------------
+
+TKeyTransfer::TState TKeyTransfer::State()
+{
+    TState state;
+
+    EnterCriticalSection(&m_Lock);
+    state = m_State;
+    LeaveCriticalSection(&m_Lock);
+
+    return state;
+}
+//---------------------------------------------------------------------------
+
+int TKeyTransfer::ChunksHeld()
+{
+    int held = 0;
+
+    EnterCriticalSection(&m_Lock);
+    for (uint16_t acked = m_Acked; acked; acked &= (uint16_t)(acked - 1))
+        held++;
+    LeaveCriticalSection(&m_Lock);
+
+    return held;
+}
+//---------------------------------------------------------------------------
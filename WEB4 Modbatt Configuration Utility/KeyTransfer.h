@@ -0,0 +1,131 @@
+//---------------------------------------------------------------------------
+//  KeyTransfer.h
+//
+//  Windowed transfer of one Web4 item (a key half or a component ID) to a
+//  pack controller in 8 byte chunks, ID layout and obfuscation as in
+//  CAN_Extended_ID_Chunked_Protocol.md.
+//
+//  Up to Window chunks are on the bus before the first ACK comes back. The
+//  pack controller answers with a bitmap of the chunks it holds, so only the
+//  chunks missing from it are sent again once their ACK is overdue. Nothing
+//  here blocks or writes to the bus: Poll hands out the frames that are due,
+//  the transfer subscribes to its ACK ID with the TCanDispatcher and sets
+//  Event when one is delivered, and the caller waits on Event for at most
+//  NextDue ms between polls.
+//
+//  On a CAN FD connection an item of up to 64 bytes goes in one FD frame
+//  with bit rate switch instead, chunk 1 of 1, and takes one ACK.
+//---------------------------------------------------------------------------
+
+#ifndef KeyTransferH
+#define KeyTransferH
+
+#include <windows.h>
+#include <stdint.h>
+#include "PCANBasic.h"
+#include "CanDispatch.h"
+
+// Extended ID fields
+#define KEYXFER_STD_ID_SHIFT    18
+#define KEYXFER_ENCRYPTED       (1UL << 17)
+#define KEYXFER_CHUNK_SHIFT     12
+#define KEYXFER_TOTAL_SHIFT     8
+#define KEYXFER_FIELD_MASK      0x0FUL      // chunk and total, 16 is sent as 0
+#define KEYXFER_DEVICE_MASK     0xFFUL
+
+#define KEYXFER_CHUNK_SIZE      8
+#define KEYXFER_MAX_CHUNKS      16
+#define KEYXFER_MAX_LENGTH      (KEYXFER_CHUNK_SIZE * KEYXFER_MAX_CHUNKS)
+#define KEYXFER_FD_LENGTH       64          // largest item sent as one FD frame
+
+// The ACK standard ID is the item standard ID + 0xA0 (0x407 -> 0x4A7)
+#define KEYXFER_ACK_OFFSET      0xA0
+
+// ACK payload: status, total, bitmap chunks 1-8, bitmap chunks 9-16,
+// CRC high, CRC low (KeyCrc16 of the de-obfuscated payload bytes of every
+// chunk, valid once complete)
+#define KEYXFER_ACK_LENGTH      6
+#define KEYXFER_ACK_NACK        0x00        // receiver dropped the item, send it all again
+#define KEYXFER_ACK_OK          0x01
+
+// Defaults
+#define KEYXFER_WINDOW          8           // chunks sent before waiting for an ACK
+#define KEYXFER_RTO_MS          100         // send a chunk again when not acked after this
+#define KEYXFER_MAX_SENDS       5           // sends of one chunk before the transfer fails
+
+//---------------------------------------------------------------------------
+class TKeyTransfer : public TCanSubscriber
+{
+public:
+    enum TState { ksSending, ksDone, ksFailed };
+
+    // fd sends the item as one FD frame when it fits
+    TKeyTransfer(uint16_t stdId, uint8_t device, const uint8_t *data, int length, bool fd = false,
+                 int window = KEYXFER_WINDOW, DWORD rtoMs = KEYXFER_RTO_MS);
+    ~TKeyTransfer();
+
+    // Fill frames with up to max chunks due at now: chunks whose ACK is
+    // overdue, then new chunks the window admits. Returns the count
+    int Poll(DWORD now, TPCANMsgFD *frames, int max);
+
+    // ms until Poll has something to send, INFINITE once finished
+    DWORD NextDue(DWORD now);
+
+    // Take an ACK on the receive thread
+    bool Deliver(const TFrameView &msg);
+
+    // Stop with an error, e.g. when a write fails
+    void Abort(const char *reason);
+
+    // Set event instead of Event, e.g. one event for many transfers
+    void Notify(HANDLE event) { m_hNotify = event; }
+
+    TState State();
+    HANDLE Event() const { return m_hEvent; }
+    int ChunksHeld();
+    int FrameLength() const { return m_ChunkLength; }
+    uint16_t StdId() const { return m_StdId; }
+    uint8_t Device() const { return m_Device; }
+    int Chunks() const { return m_Chunks; }
+    bool IsFD() const { return m_Fd; }
+    int Sends() const { return m_Sends; }
+    int Retransmits() const { return m_Retransmits; }
+    DWORD ElapsedMs() const { return m_EndTime - m_StartTime; }
+    const char *Error() const { return m_Error; }
+
+    static uint8_t Obfuscate(uint8_t value, int chunk);
+    static uint32_t ChunkId(uint16_t stdId, int chunk, int total, uint8_t device);
+    // CRC-16/CCITT, polynomial 0x1021, initial value 0xFFFF
+    static uint16_t KeyCrc16(const uint8_t *data, int length);
+
+private:
+    CRITICAL_SECTION m_Lock;
+    HANDLE m_hEvent;
+    HANDLE m_hNotify;
+
+    uint16_t m_StdId;
+    uint8_t m_Device;
+    uint8_t m_Data[KEYXFER_MAX_LENGTH];
+    uint16_t m_Crc;
+    bool m_Fd;
+    int m_Chunks;
+    int m_ChunkLength;                      // payload bytes per frame
+    int m_Window;
+    DWORD m_Rto;
+
+    TState m_State;
+    uint16_t m_Acked;                       // bit n-1 = chunk n held by the receiver
+    int m_NextNew;                          // chunks sent at least once
+    DWORD m_SentAt[KEYXFER_MAX_CHUNKS];
+    uint8_t m_SendCount[KEYXFER_MAX_CHUNKS];
+    int m_Sends;
+    int m_Retransmits;
+    DWORD m_StartTime;
+    DWORD m_EndTime;
+    const char *m_Error;
+
+    void BuildFrame(int index, DWORD now, TPCANMsgFD &frame);
+    void Finish(TState state, const char *error);
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,13 @@
+//---------------------------------------------------------------------------
+//  vcl.h
+//
+//  Stands in for the VCL header on a host. The provisioning sources include
+//  it for the precompiled header only and use nothing from it.
+//---------------------------------------------------------------------------
+
+#ifndef ShimVclH
+#define ShimVclH
+
+#include <windows.h>
+
+#endif
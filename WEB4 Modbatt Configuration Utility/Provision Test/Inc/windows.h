@@ -0,0 +1,86 @@
+//---------------------------------------------------------------------------
+//  windows.h
+//
+//  Stands in for the Win32 header when the provisioning sources are built on
+//  a host.
+//
+//  Provision.cpp, KeyTransfer.cpp and CanDispatch.cpp only need the integer
+//  types PCANBasic.h is written against, critical sections, auto-reset
+//  events and GetTickCount. The test is single threaded, so the critical
+//  sections do nothing and an event is a flag. GetTickCount is the fake
+//  clock of ProvisionTest.cpp.
+//---------------------------------------------------------------------------
+
+#ifndef ShimWindowsH
+#define ShimWindowsH
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint32_t DWORD;
+typedef uint16_t WORD;
+typedef uint8_t BYTE;
+typedef int32_t LONG;
+typedef int BOOL;
+typedef uint64_t UINT64;
+typedef char *LPSTR;
+typedef void *LPVOID;
+typedef void *HANDLE;
+
+#define FALSE       0
+#define TRUE        1
+#define INFINITE    0xFFFFFFFFU
+
+#define WINAPI
+#define __stdcall
+#define __T(x)      x
+
+//---------------------------------------------------------------------------
+typedef struct
+{
+    int Entered;
+} CRITICAL_SECTION;
+
+static inline void InitializeCriticalSection(CRITICAL_SECTION *cs) { cs->Entered = 0; }
+static inline void DeleteCriticalSection(CRITICAL_SECTION *) {}
+static inline void EnterCriticalSection(CRITICAL_SECTION *cs) { cs->Entered++; }
+static inline void LeaveCriticalSection(CRITICAL_SECTION *cs) { cs->Entered--; }
+
+static inline LONG InterlockedExchange(volatile LONG *target, LONG value)
+{
+    LONG old = *target;
+
+    *target = value;
+    return old;
+}
+
+//---------------------------------------------------------------------------
+struct TShimEvent
+{
+    BOOL Set;
+};
+
+static inline HANDLE CreateEvent(void *, BOOL, BOOL initial, const char *)
+{
+    TShimEvent *event = new TShimEvent;
+
+    event->Set = initial;
+    return event;
+}
+
+static inline BOOL SetEvent(HANDLE event)
+{
+    ((TShimEvent *)event)->Set = TRUE;
+    return TRUE;
+}
+
+static inline BOOL CloseHandle(HANDLE event)
+{
+    delete (TShimEvent *)event;
+    return TRUE;
+}
+
+DWORD GetTickCount(void);
+
+//---------------------------------------------------------------------------
+#endif
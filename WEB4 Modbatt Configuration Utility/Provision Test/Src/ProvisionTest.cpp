@@ -0,0 +1,381 @@
+//---------------------------------------------------------------------------
+//  ProvisionTest.cpp
+//
+//  Runs TProvisionScheduler against a fake bus and fake pack controllers.
+//
+//  Write hands each frame to the pack controller it is addressed to, which
+//  keeps the de-obfuscated chunk and queues an ACK with the bitmap of the
+//  chunks it holds, and the CRC once it has all of them, ACK_DELAY_MS
+//  later. Wait moves the fake clock to the next ACK or to the end of the
+//  wait and delivers the ACKs due through the TCanDispatcher, as the read
+//  thread would. Dead pack controllers never answer.
+//
+//  Each run checks that
+//  - every live pack is provisioned and every dead one fails,
+//  - no more than MaxActive packs transfer at once, and while packs are
+//    pending all MaxActive slots are busy, so a failed pack is replaced at
+//    once,
+//  - within one round every pack that still has frames due gets one frame
+//    per pass, no pack gets ahead of another by more,
+//  - over any interval the frames sent fit in the load budget: LoadCap
+//    percent of the bus plus the burst it can save up.
+//
+//  Exits non-zero if any check fails.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include "Provision.h"
+
+#define ACK_DELAY_MS        2
+#define RUN_LIMIT_MS        60000
+
+static DWORD now;
+static int failures;
+
+DWORD GetTickCount(void)
+{
+    return now;
+}
+
+static void Check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+//---------------------------------------------------------------------------
+struct TFakeItem
+{
+    uint16_t Held;
+    int Chunks;
+    int ChunkLength;
+    uint8_t Data[KEYXFER_MAX_LENGTH];
+};
+
+struct TFakeAck
+{
+    DWORD At;
+    TPCANMsgFD Frame;
+};
+
+struct TSent
+{
+    DWORD Time;
+    int Round;
+    uint8_t Device;
+    DWORD Bits;
+};
+
+//---------------------------------------------------------------------------
+class TFakeBus
+{
+public:
+    TFakeBus(TCanDispatcher &dispatcher, TProvisionScheduler &scheduler,
+             const std::set<uint8_t> &dead, int maxActive)
+        : m_Dispatcher(dispatcher), m_Scheduler(scheduler), m_Dead(dead), m_MaxActive(maxActive)
+    {
+        Round = 0;
+        MostActive = 0;
+        Starved = 0;
+    }
+
+    std::vector<TSent> Sent;
+    int Round;
+    int MostActive;
+    int Starved;                            // writes with a free slot and packs pending
+
+    TPCANStatus Write(TPCANMsgFD &frame)
+    {
+        uint16_t stdId = (uint16_t)(frame.ID >> KEYXFER_STD_ID_SHIFT);
+        int chunk = (int)((frame.ID >> KEYXFER_CHUNK_SHIFT) & KEYXFER_FIELD_MASK);
+        int total = (int)((frame.ID >> KEYXFER_TOTAL_SHIFT) & KEYXFER_FIELD_MASK);
+        uint8_t device = (uint8_t)(frame.ID & KEYXFER_DEVICE_MASK);
+        int length = TFrameView::DataLength(frame.DLC, (frame.MSGTYPE & PCAN_MESSAGE_FD) != 0);
+        TSent sent = {now, Round, device, TProvisionScheduler::FrameBits(length)};
+
+        Sent.push_back(sent);
+        CountActive();
+        if (chunk == 0)
+            chunk = KEYXFER_MAX_CHUNKS;
+        if (total == 0)
+            total = KEYXFER_MAX_CHUNKS;
+        if (m_Dead.count(device))
+            return PCAN_ERROR_OK;
+
+        // The pack controller keeps the chunk and acknowledges what it holds
+        TFakeItem &item = m_Items[((uint32_t)device << 16) | stdId];
+        item.Chunks = total;
+        item.ChunkLength = length;
+        for (int i = 0; i < length; i++)
+        {
+            uint8_t value = frame.DATA[i];
+            int rotations = chunk % 8;
+            item.Data[(chunk - 1) * length + i] =
+                rotations ? (uint8_t)((value >> rotations) | (value << (8 - rotations))) : value;
+        }
+        item.Held |= (uint16_t)(1U << (chunk - 1));
+
+        uint16_t all = (uint16_t)((1UL << total) - 1);
+        uint16_t crc = (item.Held == all) ? TKeyTransfer::KeyCrc16(item.Data, total * length) : 0;
+        TFakeAck ack;
+
+        ack.At = now + ACK_DELAY_MS;
+        ack.Frame = TPCANMsgFD();
+        ack.Frame.ID = TKeyTransfer::ChunkId((uint16_t)(stdId + KEYXFER_ACK_OFFSET), chunk, total, device);
+        ack.Frame.MSGTYPE = PCAN_MESSAGE_EXTENDED;
+        ack.Frame.DLC = KEYXFER_ACK_LENGTH;
+        ack.Frame.DATA[0] = KEYXFER_ACK_OK;
+        ack.Frame.DATA[1] = (uint8_t)total;
+        ack.Frame.DATA[2] = (uint8_t)(item.Held & 0xFF);
+        ack.Frame.DATA[3] = (uint8_t)(item.Held >> 8);
+        ack.Frame.DATA[4] = (uint8_t)(crc >> 8);
+        ack.Frame.DATA[5] = (uint8_t)(crc & 0xFF);
+        m_Acks.push_back(ack);
+
+        return PCAN_ERROR_OK;
+    }
+
+    void Wait(HANDLE event, DWORD ms)
+    {
+        DWORD until = (ms == INFINITE) ? INFINITE : now + ms;
+
+        (void)event;
+        Round++;
+        if (!m_Acks.empty() && m_Acks.front().At < until)
+            until = std::max(m_Acks.front().At, now);
+        if (until == INFINITE || until > RUN_LIMIT_MS)
+        {
+            // Nothing would ever wake the scheduler, stop it
+            Check(false, "scheduler waits with nothing due");
+            for (size_t i = 0; i < m_Scheduler.Jobs().size(); i++)
+                for (size_t t = 0; t < m_Scheduler.Jobs()[i]->Transfers.size(); t++)
+                    m_Scheduler.Jobs()[i]->Transfers[t]->Abort("test stopped");
+            return;
+        }
+        now = until;
+
+        while (!m_Acks.empty() && m_Acks.front().At <= now)
+        {
+            TFrameView view(m_Acks.front().Frame, (TPCANTimestampFD)now * 1000);
+            m_Dispatcher.Dispatch(view);
+            m_Acks.pop_front();
+        }
+    }
+
+private:
+    TCanDispatcher &m_Dispatcher;
+    TProvisionScheduler &m_Scheduler;
+    std::set<uint8_t> m_Dead;
+    int m_MaxActive;
+    std::map<uint32_t, TFakeItem> m_Items;
+    std::deque<TFakeAck> m_Acks;
+
+    void CountActive()
+    {
+        int active = 0, pending = 0;
+
+        for (size_t i = 0; i < m_Scheduler.Jobs().size(); i++)
+        {
+            active += (m_Scheduler.Jobs()[i]->State == TPackJob::jsActive);
+            pending += (m_Scheduler.Jobs()[i]->State == TPackJob::jsPending);
+        }
+        MostActive = std::max(MostActive, active);
+        if (pending && active < m_MaxActive)
+            Starved++;
+    }
+};
+
+//---------------------------------------------------------------------------
+// Within a round, every pack still to send gets one frame per pass
+static bool RoundsInterleaved(const std::vector<TSent> &sent)
+{
+    for (size_t first = 0; first < sent.size(); )
+    {
+        size_t last = first;
+        std::map<uint8_t, int> count, left;
+
+        while (last < sent.size() && sent[last].Round == sent[first].Round)
+            left[sent[last++].Device]++;
+
+        for (size_t i = first; i < last; i++)
+        {
+            int fewest = 1 << 30, most = 0;
+
+            count[sent[i].Device]++;
+            left[sent[i].Device]--;
+            for (std::map<uint8_t, int>::iterator it = left.begin(); it != left.end(); ++it)
+            {
+                if (it->second == 0)
+                    continue;
+                fewest = std::min(fewest, count[it->first]);
+                most = std::max(most, count[it->first]);
+            }
+            if (most - fewest > 1)
+                return false;
+        }
+        first = last;
+    }
+    return true;
+}
+
+// Bits sent from any ms to any later one fit in the budget
+static bool WithinLoadCap(const std::vector<TSent> &sent, double bitsPerMs, double burstBits)
+{
+    for (size_t i = 0; i < sent.size(); i++)
+    {
+        double bits = 0;
+
+        for (size_t j = i; j < sent.size(); j++)
+        {
+            bits += sent[j].Bits;
+            if (bits > burstBits + bitsPerMs * (sent[j].Time - sent[i].Time) + 0.5)
+                return false;
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+static void Run(const char *name, int packs, bool fd, const std::set<uint8_t> &dead)
+{
+    const DWORD bitRate = 500000;
+    const int itemLengths[4] = {64, 64, 20, 20};
+    std::vector<TProvisionItem> items(4);
+    TCanDispatcher dispatcher;
+    TProvisionScheduler scheduler(dispatcher, bitRate, fd);
+    TFakeBus bus(dispatcher, scheduler, dead, PROVISION_MAX_ACTIVE);
+
+    printf("%s: %d packs, %d dead, %s\n", name, packs, (int)dead.size(), fd ? "CAN FD" : "classic CAN");
+
+    now = 1000;
+    for (int i = 0; i < 4; i++)
+    {
+        items[i].StdId = (uint16_t)(0x407 + i);
+        for (int b = 0; b < itemLengths[i]; b++)
+            items[i].Data.push_back((uint8_t)(i * 64 + b));
+    }
+    for (int device = 0; device < packs; device++)
+        scheduler.AddPack((uint8_t)device, items);
+
+    scheduler.Write = [&bus](TPCANMsgFD &frame) { return bus.Write(frame); };
+    scheduler.Wait = [&bus](HANDLE event, DWORD ms) { bus.Wait(event, ms); };
+
+    TProvisionSummary summary = scheduler.Run();
+
+    printf("  %u ms, %.1f packs/min, %d frames, %d retransmitted, %.1f%% bus load\n",
+           summary.ElapsedMs, summary.PacksPerMinute, summary.Frames, summary.Retransmits, summary.BusLoad);
+
+    // Outcome
+    Check(summary.Packs == packs, "every pack has a job");
+    Check(summary.Done == packs - (int)dead.size(), "every live pack provisioned");
+    Check(summary.Failed == (int)dead.size(), "every dead pack failed");
+    for (size_t i = 0; i < scheduler.Jobs().size(); i++)
+    {
+        const TPackJob *job = scheduler.Jobs()[i].get();
+        if (dead.count(job->Device))
+            Check(job->State == TPackJob::jsFailed && strcmp(job->Error, "chunk not acknowledged") == 0,
+                  "dead pack failed for want of ACKs");
+        else
+            Check(job->State == TPackJob::jsDone && job->ChunksHeld == job->ChunksTotal,
+                  "live pack holds every chunk");
+    }
+
+    // Concurrency and refill
+    int refilled = 0, failedEarly = 0;
+    for (size_t i = 0; i < scheduler.Jobs().size(); i++)
+    {
+        const TPackJob *failed = scheduler.Jobs()[i].get();
+        bool later = false, replaced = false;
+
+        if (failed->State != TPackJob::jsFailed)
+            continue;
+        for (size_t j = 0; j < scheduler.Jobs().size(); j++)
+        {
+            later |= (scheduler.Jobs()[j]->StartTime >= failed->EndTime && j != i);
+            replaced |= (scheduler.Jobs()[j]->StartTime == failed->EndTime && j != i);
+        }
+        failedEarly += later;
+        refilled += (later && replaced);
+    }
+    printf("  at most %d packs at once, %d of %d failures with packs pending replaced at once\n",
+           bus.MostActive, refilled, failedEarly);
+    Check(bus.MostActive == std::min(packs, PROVISION_MAX_ACTIVE), "MaxActive packs transfer at once");
+    Check(bus.Starved == 0, "no free slot while packs are pending");
+    Check(failedEarly > 0, "a pack failed while others were pending");
+    Check(refilled == failedEarly, "a failed pack is replaced at once");
+
+    // Interleaving
+    std::set<uint8_t> firstRound;
+    size_t firstFrames = 0;
+    for (; firstFrames < bus.Sent.size() && bus.Sent[firstFrames].Round == 0; firstFrames++)
+        firstRound.insert(bus.Sent[firstFrames].Device);
+    Check((int)firstRound.size() == std::min((int)firstFrames, std::min(packs, PROVISION_MAX_ACTIVE)),
+          "the first round goes to as many packs as it has frames");
+    Check(RoundsInterleaved(bus.Sent), "packs take turns within a round");
+
+    // Load cap
+    double bitsPerMs = bitRate * PROVISION_LOAD_CAP / 100.0 / 1000.0;
+    double burstBits = std::max((double)(DWORD)(bitRate * PROVISION_LOAD_CAP / 100) * PROVISION_BURST_MS / 1000,
+                                (double)TProvisionScheduler::FrameBits(fd ? KEYXFER_FD_LENGTH : KEYXFER_CHUNK_SIZE));
+    Check(WithinLoadCap(bus.Sent, bitsPerMs, burstBits), "frames stay within the load budget");
+    Check(summary.BusLoad <= PROVISION_LOAD_CAP + 100.0 * burstBits / (summary.ElapsedMs * bitRate / 1000.0),
+          "bus load at most the cap");
+}
+
+//---------------------------------------------------------------------------
+static void ParseIds(const char *text, bool ok, const uint8_t *expected, size_t count)
+{
+    std::vector<uint8_t> devices;
+    bool parsed = ParsePackIds(text, devices);
+
+    if (parsed != ok || (ok && devices != std::vector<uint8_t>(expected, expected + count)))
+    {
+        printf("  FAILED: ParsePackIds(\"%s\")\n", text);
+        failures++;
+    }
+}
+
+static void ParseTest(void)
+{
+    static const uint8_t list[] = {0, 1, 2, 3, 7, 9};
+    static const uint8_t pair[] = {1, 3};
+    static const uint8_t once[] = {3, 2};
+    static const uint8_t top[] = {254, 255};
+
+    printf("ParsePackIds\n");
+    ParseIds("0-3, 7,9", true, list, sizeof(list));
+    ParseIds(" 1 3 ", true, pair, sizeof(pair));
+    ParseIds("3, 2-3", true, once, sizeof(once));
+    ParseIds("254 - 255", true, top, sizeof(top));
+    ParseIds("", false, NULL, 0);
+    ParseIds("5-2", false, NULL, 0);
+    ParseIds("256", false, NULL, 0);
+    ParseIds("1;2", false, NULL, 0);
+    ParseIds("-1", false, NULL, 0);
+    ParseIds("4-", false, NULL, 0);
+}
+
+//---------------------------------------------------------------------------
+int main(void)
+{
+    std::set<uint8_t> dead;
+
+    dead.insert(2);
+    dead.insert(9);
+    dead.insert(15);
+    Run("Classic", 40, false, dead);
+    Run("FD", 64, true, dead);
+    ParseTest();
+
+    printf(failures ? "%d checks failed\n" : "All checks passed\n", failures);
+    return failures ? 1 : 0;
+}
+//---------------------------------------------------------------------------
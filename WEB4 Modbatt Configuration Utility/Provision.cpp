@@ -0,0 +1,308 @@
+//---------------------------------------------------------------------------
+
+#include <vcl.h>
+#pragma hdrstop
+
+#include <algorithm>
+#include <stdlib.h>
+#include <ctype.h>
+#include "Provision.h"
+
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+TPackJob::TPackJob(uint8_t device, const std::vector<TProvisionItem> &items)
+    : Device(device), Items(items)
+{
+    State = jsPending;
+    ChunksTotal = 0;
+    ChunksHeld = 0;
+    NextItem = 0;
+    StartTime = 0;
+    EndTime = 0;
+    Error = "";
+}
+//---------------------------------------------------------------------------
+
+TProvisionScheduler::TProvisionScheduler(TCanDispatcher &dispatcher, DWORD bitRate, bool fd,
+                                         int loadCap, int maxActive)
+    : m_Dispatcher(dispatcher)
+{
+    m_hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_BitRate = bitRate;
+    m_Fd = fd;
+    m_BitsPerSecond = (DWORD)((double)bitRate * std::max(1, std::min(loadCap, 100)) / 100.0);
+    m_BurstBits = std::max(m_BitsPerSecond * PROVISION_BURST_MS / 1000,
+                           FrameBits(fd ? KEYXFER_FD_LENGTH : KEYXFER_CHUNK_SIZE));
+    m_MaxActive = std::max(1, maxActive);
+
+    m_Budget = 0;
+    m_BudgetTime = 0;
+    m_Offset = 0;
+    m_Frames = 0;
+    m_BitsSent = 0;
+}
+//---------------------------------------------------------------------------
+
+TProvisionScheduler::~TProvisionScheduler()
+{
+    for (size_t i = 0; i < m_Active.size(); i++)
+        for (size_t t = 0; t < m_Active[i]->Transfers.size(); t++)
+            m_Dispatcher.Unsubscribe(m_Active[i]->Transfers[t].get());
+    CloseHandle(m_hEvent);
+}
+//---------------------------------------------------------------------------
+
+DWORD TProvisionScheduler::FrameBits(int length)
+{
+    // 67 bits of frame around the data, one stuff bit per 4 after the first 54 + data
+    DWORD bits = 67 + 8 * length;
+
+    return bits + (54 + 8 * length - 1) / 4;
+}
+//---------------------------------------------------------------------------
+
+void TProvisionScheduler::AddPack(uint8_t device, const std::vector<TProvisionItem> &items)
+{
+    m_Jobs.push_back(std::unique_ptr<TPackJob>(new TPackJob(device, items)));
+}
+//---------------------------------------------------------------------------
+
+void TProvisionScheduler::StartJobs(DWORD now)
+{
+    for (size_t i = 0; i < m_Jobs.size() && (int)m_Active.size() < m_MaxActive; i++)
+    {
+        TPackJob *job = m_Jobs[i].get();
+
+        if (job->State != TPackJob::jsPending)
+            continue;
+
+        for (size_t t = 0; t < job->Items.size(); t++)
+        {
+            const TProvisionItem &item = job->Items[t];
+            TKeyTransfer *transfer = new TKeyTransfer(item.StdId, job->Device,
+                                                      item.Data.empty() ? NULL : &item.Data[0],
+                                                      (int)item.Data.size(), m_Fd);
+            transfer->Notify(m_hEvent);
+            job->Transfers.push_back(std::unique_ptr<TKeyTransfer>(transfer));
+            job->ChunksTotal += transfer->Chunks();
+            m_Dispatcher.Subscribe(transfer);
+        }
+
+        job->State = TPackJob::jsActive;
+        job->StartTime = now;
+        m_Active.push_back(job);
+        if (Progress)
+            Progress(*job);
+    }
+}
+//---------------------------------------------------------------------------
+
+bool TProvisionScheduler::UpdateJob(TPackJob *job, DWORD now)
+{
+    int held = 0;
+    bool sending = false;
+    bool failed = false;
+
+    for (size_t t = 0; t < job->Transfers.size(); t++)
+    {
+        TKeyTransfer *transfer = job->Transfers[t].get();
+        TKeyTransfer::TState state = transfer->State();
+
+        held += transfer->ChunksHeld();
+        if (state == TKeyTransfer::ksSending)
+            sending = true;
+        else if (state == TKeyTransfer::ksFailed && !failed)
+        {
+            failed = true;
+            job->Error = transfer->Error();
+        }
+    }
+
+    // One failed item fails the pack, the others need not finish
+    if (failed)
+    {
+        for (size_t t = 0; t < job->Transfers.size(); t++)
+            job->Transfers[t]->Abort("pack failed");
+        sending = false;
+    }
+
+    bool changed = (held != job->ChunksHeld);
+    job->ChunksHeld = held;
+
+    if (!sending)
+    {
+        for (size_t t = 0; t < job->Transfers.size(); t++)
+            m_Dispatcher.Unsubscribe(job->Transfers[t].get());
+        job->State = failed ? TPackJob::jsFailed : TPackJob::jsDone;
+        job->EndTime = now;
+        changed = true;
+    }
+
+    if (changed && Progress)
+        Progress(*job);
+    return sending;
+}
+//---------------------------------------------------------------------------
+
+DWORD TProvisionScheduler::SendRound(DWORD now)
+{
+    bool sent = true;
+
+    // Refill the bus load budget
+    m_Budget += (double)(now - m_BudgetTime) * m_BitsPerSecond / 1000.0;
+    m_Budget = std::min(m_Budget, (double)m_BurstBits);
+    m_BudgetTime = now;
+
+    // One frame per pack and round, from the next pack on each round
+    while (sent && !m_Active.empty())
+    {
+        sent = false;
+        for (size_t k = 0; k < m_Active.size(); k++)
+        {
+            TPackJob *job = m_Active[(m_Offset + k) % m_Active.size()];
+            int items = (int)job->Transfers.size();
+
+            for (int n = 0; n < items; n++)
+            {
+                int index = (job->NextItem + n) % items;
+                TKeyTransfer *transfer = job->Transfers[index].get();
+                TPCANMsgFD frame;
+                DWORD bits = FrameBits(transfer->FrameLength());
+
+                if (transfer->State() != TKeyTransfer::ksSending || transfer->NextDue(now) != 0)
+                    continue;
+                if (m_Budget < bits)
+                    return (DWORD)((bits - m_Budget) * 1000.0 / m_BitsPerSecond) + 1;
+                if (transfer->Poll(now, &frame, 1) == 0)
+                    continue;
+
+                // A full transmit queue only delays the frame, it goes again
+                // when its ACK is overdue
+                TPCANStatus result = Write(frame);
+                if (result != PCAN_ERROR_OK && result != PCAN_ERROR_QXMTFULL && result != PCAN_ERROR_XMTFULL)
+                    transfer->Abort("write failed");
+
+                m_Budget -= bits;
+                m_BitsSent += bits;
+                m_Frames++;
+                job->NextItem = (index + 1) % items;
+                sent = true;
+                break;
+            }
+        }
+        m_Offset++;
+    }
+
+    return 0;
+}
+//---------------------------------------------------------------------------
+
+TProvisionSummary TProvisionScheduler::Run()
+{
+    TProvisionSummary summary = TProvisionSummary();
+    DWORD start = GetTickCount();
+
+    m_BudgetTime = start;
+    m_Budget = m_BurstBits;
+
+    StartJobs(start);
+    while (!m_Active.empty())
+    {
+        DWORD now = GetTickCount();
+        DWORD starved = SendRound(now);
+        DWORD wait = INFINITE;
+
+        // Finished packs make room for pending ones
+        for (size_t i = 0; i < m_Active.size(); )
+        {
+            if (UpdateJob(m_Active[i], now))
+                i++;
+            else
+                m_Active.erase(m_Active.begin() + i);
+        }
+        StartJobs(now);
+        if (m_Active.empty())
+            break;
+
+        if (starved)
+        {
+            wait = starved;
+        }
+        else
+        {
+            for (size_t i = 0; i < m_Active.size(); i++)
+                for (size_t t = 0; t < m_Active[i]->Transfers.size(); t++)
+                    wait = std::min(wait, m_Active[i]->Transfers[t]->NextDue(now));
+        }
+
+        Wait(m_hEvent, wait);
+    }
+
+    summary.ElapsedMs = GetTickCount() - start;
+    summary.Packs = (int)m_Jobs.size();
+    for (size_t i = 0; i < m_Jobs.size(); i++)
+    {
+        TPackJob *job = m_Jobs[i].get();
+        if (job->State == TPackJob::jsDone)
+            summary.Done++;
+        else
+            summary.Failed++;
+        for (size_t t = 0; t < job->Transfers.size(); t++)
+            summary.Retransmits += job->Transfers[t]->Retransmits();
+    }
+    summary.Frames = m_Frames;
+    if (summary.ElapsedMs > 0)
+    {
+        summary.PacksPerMinute = summary.Done * 60000.0 / summary.ElapsedMs;
+        summary.BusLoad = m_BitsSent * 100.0 * 1000.0 / ((double)summary.ElapsedMs * m_BitRate);
+    }
+
+    return summary;
+}
+//---------------------------------------------------------------------------
+
+bool ParsePackIds(const char *text, std::vector<uint8_t> &devices)
+{
+    const char *p = text;
+
+    devices.clear();
+    for (;;)
+    {
+        while (*p == ' ' || *p == ',')
+            p++;
+        if (*p == '\0')
+            break;
+        if (!isdigit((unsigned char)*p))
+            return false;
+
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        const char *dash = end;
+
+        p = end;
+        while (*dash == ' ')
+            dash++;
+        if (*dash == '-')
+        {
+            p = dash + 1;
+            while (*p == ' ')
+                p++;
+            if (!isdigit((unsigned char)*p))
+                return false;
+            last = strtol(p, &end, 10);
+            p = end;
+        }
+        if (first > 255 || last > 255 || last < first)
+            return false;
+        if (*p != '\0' && *p != ' ' && *p != ',')
+            return false;
+
+        for (long id = first; id <= last; id++)
+            if (std::find(devices.begin(), devices.end(), (uint8_t)id) == devices.end())
+                devices.push_back((uint8_t)id);
+    }
+    return !devices.empty();
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,133 @@
+//---------------------------------------------------------------------------
+//  Provision.h
+//
+//  Key and component ID distribution to many pack controllers on one bus.
+//
+//  Each pack is a job of TKeyTransfers addressed to its pack ID. Up to
+//  MaxActive jobs run at once and the scheduler takes one frame per pack in
+//  turn, starting one pack further on each round, so no pack's window
+//  crowds out the others. Frames are only sent while the bus load budget
+//  allows: the transfers together get LoadCap percent of the bus, saved up
+//  for at most PROVISION_BURST_MS. Between rounds the scheduler sleeps until
+//  an ACK arrives, a chunk is due again or the budget has refilled.
+//
+//  The caller supplies how to write a frame, how to wait and what to do
+//  with progress; everything runs on the thread that calls Run. The packs
+//  to provision are added with AddPack before Run, any number of them.
+//---------------------------------------------------------------------------
+
+#ifndef ProvisionH
+#define ProvisionH
+
+#include <windows.h>
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "PCANBasic.h"
+#include "CanDispatch.h"
+#include "KeyTransfer.h"
+
+#define PROVISION_MAX_ACTIVE    16          // packs transferring at once
+#define PROVISION_LOAD_CAP      30          // percent of the bus for key transfers
+#define PROVISION_BURST_MS      20          // bus time the load budget can save up
+
+//---------------------------------------------------------------------------
+struct TProvisionItem
+{
+    uint16_t StdId;
+    std::vector<uint8_t> Data;
+};
+
+//---------------------------------------------------------------------------
+class TPackJob
+{
+public:
+    enum TJobState { jsPending, jsActive, jsDone, jsFailed };
+
+    uint8_t Device;
+    std::vector<TProvisionItem> Items;
+    std::vector<std::unique_ptr<TKeyTransfer> > Transfers;
+
+    TJobState State;
+    int ChunksTotal;
+    int ChunksHeld;
+    int NextItem;                           // item polled first in the next round
+    DWORD StartTime;
+    DWORD EndTime;
+    const char *Error;
+
+    TPackJob(uint8_t device, const std::vector<TProvisionItem> &items);
+};
+
+//---------------------------------------------------------------------------
+struct TProvisionSummary
+{
+    int Packs;
+    int Done;
+    int Failed;
+    DWORD ElapsedMs;
+    double PacksPerMinute;
+    int Frames;
+    int Retransmits;
+    double BusLoad;                         // percent of the bus used while running
+};
+
+//---------------------------------------------------------------------------
+class TProvisionScheduler
+{
+public:
+    typedef std::function<TPCANStatus(TPCANMsgFD &frame)> TWriteFunc;
+    typedef std::function<void(HANDLE event, DWORD ms)> TWaitFunc;
+    typedef std::function<void(const TPackJob &job)> TProgressFunc;
+
+    TWriteFunc Write;
+    // Return when event is set or after ms, the receive path has to keep running
+    TWaitFunc Wait;
+    // A pack started, got further or finished
+    TProgressFunc Progress;
+
+    TProvisionScheduler(TCanDispatcher &dispatcher, DWORD bitRate, bool fd,
+                        int loadCap = PROVISION_LOAD_CAP, int maxActive = PROVISION_MAX_ACTIVE);
+    ~TProvisionScheduler();
+
+    void AddPack(uint8_t device, const std::vector<TProvisionItem> &items);
+    TProvisionSummary Run();
+
+    const std::vector<std::unique_ptr<TPackJob> > &Jobs() const { return m_Jobs; }
+
+    // Bits of an extended frame with length data bytes at the nominal bit
+    // rate, worst case stuffing; the FD data phase is counted at the nominal
+    // rate too, so the cap errs low
+    static DWORD FrameBits(int length);
+
+private:
+    TCanDispatcher &m_Dispatcher;
+    HANDLE m_hEvent;                        // set by every transfer on an ACK
+    DWORD m_BitRate;
+    bool m_Fd;
+    DWORD m_BitsPerSecond;                  // budget refill rate
+    DWORD m_BurstBits;
+    int m_MaxActive;
+
+    std::vector<std::unique_ptr<TPackJob> > m_Jobs;
+    std::vector<TPackJob*> m_Active;
+
+    double m_Budget;                        // bits that may be sent now
+    DWORD m_BudgetTime;
+    int m_Offset;
+    int m_Frames;
+    double m_BitsSent;
+
+    void StartJobs(DWORD now);
+    bool UpdateJob(TPackJob *job, DWORD now);
+    DWORD SendRound(DWORD now);
+};
+
+//---------------------------------------------------------------------------
+// Pack IDs from a list such as "0-3, 7, 9": numbers and ranges separated by
+// commas or spaces, each ID once in the order given. False when text is not
+// such a list or an ID is not 0 to 255
+bool ParsePackIds(const char *text, std::vector<uint8_t> &devices);
+//---------------------------------------------------------------------------
+#endif
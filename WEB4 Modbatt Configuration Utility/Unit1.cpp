@@ -12,6 +12,7 @@
 #include <REST.Types.hpp>
 #include <REST.Response.Adapter.hpp>
 #include <algorithm>  // For std::min
+#include <intrin.h>   // For __rdtsc
 
 
 //---------------------------------------------------------------------------
@@ -131,22 +132,23 @@ int clsCritical::GetRecursionCount()
 //////////////////////////////////////////////////////////////////////////////////////////////
 // MessageStatus class
 //
-MessageStatus::MessageStatus(TPCANMsgFD canMsg, TPCANTimestampFD canTimestamp, int listIndex)
+MessageStatus::MessageStatus(const TFrameView &canMsg, int listIndex)
 {
-    m_Msg = canMsg;
-    m_TimeStamp = canTimestamp;
-    m_oldTimeStamp = canTimestamp;
+    m_Msg = TPCANMsgFD();
+    canMsg.CopyTo(m_Msg);
+    m_TimeStamp = canMsg.Timestamp;
+    m_oldTimeStamp = canMsg.Timestamp;
     m_iIndex = listIndex;
     m_Count = 1;
     m_bShowPeriod = true;
     m_bWasChanged = false;
 }
 
-void MessageStatus::Update(TPCANMsgFD canMsg, TPCANTimestampFD canTimestamp)
+void MessageStatus::Update(const TFrameView &canMsg)
 {
-    m_Msg = canMsg;
+    canMsg.CopyTo(m_Msg);
     m_oldTimeStamp = m_TimeStamp;
-    m_TimeStamp = canTimestamp;
+    m_TimeStamp = canMsg.Timestamp;
     m_bWasChanged = true;
     m_Count += 1;
 }
@@ -255,11 +257,17 @@ __fastcall TForm1::TForm1(TComponent* Owner)
 	}
 
 	InitializeControls();
+	FWeb4TaskButton = NULL;
+	m_DecodeCycles = 0;
+	m_DecodeFrames = 0;
 }
 //---------------------------------------------------------------------------
 
 void __fastcall TForm1::FormClose(TObject *Sender, TCloseAction &Action)
 {
+    // A running workflow may be using the channel and the Web4 client
+    FWeb4Task.reset();
+
     // Release Hardware if needed
     //
     if (btnRelease->Enabled)
@@ -746,7 +754,7 @@ bool TForm1::GetFilterStatus(int* status)
 }
 //---------------------------------------------------------------------------
 
-void TForm1::InsertMsgEntry(TPCANMsgFD NewMsg, TPCANTimestampFD timeStamp)
+void TForm1::InsertMsgEntry(const TFrameView &NewMsg)
 {
 	MessageStatus *msgStsCurrentMsg;
 	TListItem *CurrentItem;
@@ -760,7 +768,7 @@ void TForm1::InsertMsgEntry(TPCANMsgFD NewMsg, TPCANTimestampFD timeStamp)
 			 locked = 1;
 			// We add this status in the last message list
 			//
-			msgStsCurrentMsg = new MessageStatus(NewMsg, timeStamp, lstMessages->Items->Count);
+			msgStsCurrentMsg = new MessageStatus(NewMsg, lstMessages->Items->Count);
 			msgStsCurrentMsg->ShowingPeriod = chbShowPeriod->Checked;
 			m_LastMsgsList->Add(msgStsCurrentMsg);
 
@@ -774,7 +782,7 @@ void TForm1::InsertMsgEntry(TPCANMsgFD NewMsg, TPCANTimestampFD timeStamp)
 			CurrentItem->SubItems->Add(msgStsCurrentMsg->IdString);
 			// We set the length of the Message
 			//
-			CurrentItem->SubItems->Add(IntToStr(GetLengthFromDLC(NewMsg.DLC, !(NewMsg.MSGTYPE & PCAN_MESSAGE_FD))));
+			CurrentItem->SubItems->Add(IntToStr(NewMsg.Length));
 			// we set the message count message (this is the First, so count is 1)
 			//
 			CurrentItem->SubItems->Add(IntToStr(msgStsCurrentMsg->Count));
@@ -833,9 +841,9 @@ TPCANStatus TForm1::ReadMessageFD()
     //
     stsResult = m_objPCANBasic->ReadFD(m_PcanHandle, &CANMsg, &CANTimeStamp);
     if (stsResult != PCAN_ERROR_QRCVEMPTY)
-        // We process the received message
+        // We process the received message in place
         //
-        ProcessMessage(CANMsg, CANTimeStamp);
+        ProcessMessage(TFrameView(CANMsg, CANTimeStamp));
 
 	return stsResult;
 }
@@ -851,9 +859,9 @@ TPCANStatus TForm1::ReadMessage()
     //
     stsResult = m_objPCANBasic->Read(m_PcanHandle, &CANMsg, &CANTimeStamp);
     if (stsResult != PCAN_ERROR_QRCVEMPTY)
-        // We process the received message
+        // We process the received message in place
         //
-        ProcessMessage(CANMsg, CANTimeStamp);
+        ProcessMessage(TFrameView(CANMsg, CANTimeStamp));
 
     return stsResult;
 }
@@ -877,14 +885,16 @@ void TForm1::ReadMessages()
 }
 //---------------------------------------------------------------------------
 
-void TForm1::ProcessMessage(TPCANMsgFD theMsg, TPCANTimestampFD itsTimeStamp)
+void TForm1::ProcessMessage(const TFrameView &theMsg)
 {
 	MessageStatus *msg;
-
+	unsigned __int64 start = __rdtsc();
 
 	// OK SO HERE WE ARE GOING TO PROCESS THE DATA AND SHOW IT ON THE FORM
 	// THEN WE WILL COME BACK IN AND UPDATE THE MESSAGE LIST
-	if(theMsg.ID == ID_BMS_DATA_1 + (packID * 0x100)){
+	if(m_Dispatcher.Dispatch(theMsg)){
+		  // Taken by a waiter (key transfer ACK), still listed below
+	}else if(theMsg.ID == ID_BMS_DATA_1 + (packID * 0x100)){
 		  ProcessData1(theMsg);
 	}else if(theMsg.ID == ID_BMS_DATA_2 + (packID * 0x100)){
 		  ProcessData2(theMsg);
@@ -918,6 +928,8 @@ void TForm1::ProcessMessage(TPCANMsgFD theMsg, TPCANTimestampFD itsTimeStamp)
 		  ProcessModuleList(theMsg);
 	}
 
+	m_DecodeCycles += __rdtsc() - start;
+	m_DecodeFrames++;
 
 
 	// We search if a message (Same ID and Type) is
@@ -934,13 +946,13 @@ void TForm1::ProcessMessage(TPCANMsgFD theMsg, TPCANTimestampFD itsTimeStamp)
 			{
 				// Modify the message and exit
 				//
-				msg->Update(theMsg, itsTimeStamp);
+				msg->Update(theMsg);
 				return;
 			}
 		}
 		// Message not found. It will created
 		//
-		InsertMsgEntry(theMsg, itsTimeStamp);
+		InsertMsgEntry(theMsg);
 
 	   /*
 	MessageStatus *msgStsCurrentMsg;
@@ -952,7 +964,7 @@ void TForm1::ProcessMessage(TPCANMsgFD theMsg, TPCANTimestampFD itsTimeStamp)
 
 
 
-	msgStsCurrentMsg = new MessageStatus(theMsg, itsTimeStamp, lstMessages->Items->Count);
+	msgStsCurrentMsg = new MessageStatus(theMsg, lstMessages->Items->Count);
 	msgStsCurrentMsg->ShowingPeriod = chbShowPeriod->Checked;
 	m_LastMsgsList->Add(msgStsCurrentMsg);
 
@@ -982,30 +994,12 @@ void TForm1::ProcessMessage(TPCANMsgFD theMsg, TPCANTimestampFD itsTimeStamp)
 
 
 	//msg = (MessageStatus*)m_LastMsgsList->Items[(m_LastMsgsList->Count)-1];
-	//msg->Update(theMsg, itsTimeStamp);
+	//msg->Update(theMsg);
       	*/
 	}
 
 
 
-}
-//---------------------------------------------------------------------------
-
-void TForm1::ProcessMessage(TPCANMsg theMsg, TPCANTimestamp itsTimeStamp)
-{
-	TPCANMsgFD newMsg;
-	TPCANTimestampFD newTimestamp;
-
-	newMsg = TPCANMsgFD();
-	newMsg.ID = theMsg.ID;
-	newMsg.DLC = theMsg.LEN;
-	for (int i = 0; i < ((theMsg.LEN > 8) ? 8 : theMsg.LEN); i++)
-		newMsg.DATA[i] = theMsg.DATA[i];
-	newMsg.MSGTYPE = theMsg.MSGTYPE;
-
-	newTimestamp = itsTimeStamp.micros + (1000UI64 * itsTimeStamp.millis) + (0x100000000UI64 * 1000UI64 * itsTimeStamp.millis_overflow);
-	ProcessMessage(newMsg, newTimestamp);
-
 }
 //---------------------------------------------------------------------------
 
@@ -1205,6 +1199,14 @@ void __fastcall TForm1::btnReleaseClick(TObject *Sender)
     //
     m_objPCANBasic->Uninitialize(m_PcanHandle);
 
+    // Report the decode cost of this connection
+    //
+    if (m_DecodeFrames > 0)
+        IncludeTextMessage(AnsiString().sprintf("Decoded %lu frames, %.0f cycles per frame",
+            (unsigned long)m_DecodeFrames, (double)m_DecodeCycles / m_DecodeFrames));
+    m_DecodeCycles = 0;
+    m_DecodeFrames = 0;
+
     // Sets the connection status of the main-form
     //
 	SetConnectionStatus(false);
@@ -2537,19 +2539,14 @@ void __fastcall TForm1::chbRemoteClick(TObject *Sender)
 /***************************************************************************************************************
 *     P r o c e s s S t a t e
 ***************************************************************************************************************/
-void TForm1::ProcessState(TPCANMsgFD theMsg){
-
-  CANFRM_0x410_BMS_STATE state;
+void TForm1::ProcessState(const TFrameView &theMsg){
 
   float soh = 0;
   AnsiString sState  ="";
   AnsiString sStatus ="";
 
-  // copy received data to status structure
-  memset(&state,0,sizeof(state));
-  memcpy(&state, theMsg.DATA, sizeof(state));
-
-  switch (state.bms_state){
+  // decode in place, bits as in CANFRM_0x410_BMS_STATE
+  switch (theMsg.Bits(0, 2)){
 	case 0:
 		sState = "Off";
 		break;
@@ -2567,7 +2564,7 @@ void TForm1::ProcessState(TPCANMsgFD theMsg){
 
   }
 
-	switch (state.bms_status){
+	switch (theMsg.Bits(10, 2)){
 	case 0:
 		sStatus = "Off";
 		break;
@@ -2584,34 +2581,29 @@ void TForm1::ProcessState(TPCANMsgFD theMsg){
 		break;
 
   }
-  soh = VCU_SOH_PERCENTAGE_BASE + (state.bms_soh * VCU_SOH_PERCENTAGE_FACTOR);
+  soh = VCU_SOH_PERCENTAGE_BASE + (theMsg.Bits(2, 8) * VCU_SOH_PERCENTAGE_FACTOR);
 
   editSoh->Text 			= FloatToStrF(soh,ffFixed,5,2)  + "%";
   editState->Text 			= sState;
   editStatus->Text 			= sStatus;
-  editFault->Text  			= state.bms_module_off;
-  editTotalModules->Text  	= state.bms_total_mod_cnt;
-  editActiveModules->Text 	= state.bms_active_mod_cnt;
+  editFault->Text  			= (int)theMsg.Bits(14, 1);
+  editTotalModules->Text  	= (int)theMsg.Bits(16, 8);
+  editActiveModules->Text 	= (int)theMsg.Bits(24, 8);
 }
 
 
 /***************************************************************************************************************
 *     P r o c e s s D a t a 1
 ***************************************************************************************************************/
-void TForm1::ProcessData1(TPCANMsgFD theMsg){
-
-  CANFRM_0x421_BMS_DATA_1 data;
+void TForm1::ProcessData1(const TFrameView &theMsg){
 
   float voltage = 0;
   float current = 0;
 
 
-  // copy received data to status structure
-  memset(&data,0,sizeof(data));
-  memcpy(&data, theMsg.DATA, sizeof(data));
-
-  voltage = data.bms_pack_voltage * VCU_VOLTAGE_FACTOR;
-  current = VCU_CURRENT_BASE + (data.bms_pack_current * VCU_CURRENT_FACTOR);
+  // decode in place, bits as in CANFRM_0x421_BMS_DATA_1
+  voltage = theMsg.Bits(32, 16) * VCU_VOLTAGE_FACTOR;
+  current = VCU_CURRENT_BASE + (theMsg.Bits(48, 16) * VCU_CURRENT_FACTOR);
 
   editVoltage->Text = FloatToStrF(voltage,ffFixed,5,2) + "V";
   editCurrent->Text = FloatToStrF(current,ffFixed,5,2) + "A";
@@ -2621,9 +2613,7 @@ void TForm1::ProcessData1(TPCANMsgFD theMsg){
 /***************************************************************************************************************
 *     P r o c e s s D a t a 2
 ***************************************************************************************************************/
-void TForm1::ProcessData2(TPCANMsgFD theMsg){
-
-  CANFRM_0x422_BMS_DATA_2 data;
+void TForm1::ProcessData2(const TFrameView &theMsg){
 
   float soc         = 0;
   float hiCellVolt  = 0;
@@ -2631,14 +2621,11 @@ void TForm1::ProcessData2(TPCANMsgFD theMsg){
   float avgCellVolt = 0;
 
 
-  // copy received data to status structure
-  memset(&data,0,sizeof(data));
-  memcpy(&data, theMsg.DATA, sizeof(data));
-
-  hiCellVolt  = data.bms_high_cell_volt * VCU_CELL_VOLTAGE_FACTOR;
-  loCellVolt  = data.bms_low_cell_volt  * VCU_CELL_VOLTAGE_FACTOR;
-  avgCellVolt = data.bms_avg_cell_volt  * VCU_CELL_VOLTAGE_FACTOR;
-  soc         = data.bms_soc            * VCU_SOC_PERCENTAGE_FACTOR;
+  // decode in place, bits as in CANFRM_0x422_BMS_DATA_2
+  hiCellVolt  = theMsg.Bits(16, 16) * VCU_CELL_VOLTAGE_FACTOR;
+  loCellVolt  = theMsg.Bits(32, 16) * VCU_CELL_VOLTAGE_FACTOR;
+  avgCellVolt = theMsg.Bits(48, 16) * VCU_CELL_VOLTAGE_FACTOR;
+  soc         = theMsg.Bits(0, 16)  * VCU_SOC_PERCENTAGE_FACTOR;
 
   editSoc->Text 		= FloatToStrF(soc,ffFixed,5,2)         + "%";
   editHiCellVolt->Text 	= FloatToStrF(hiCellVolt,ffFixed,5,2)  + "V";
@@ -2650,21 +2637,16 @@ void TForm1::ProcessData2(TPCANMsgFD theMsg){
 /***************************************************************************************************************
 *     P r o c e s s D a t a 3
 ***************************************************************************************************************/
-void TForm1::ProcessData3(TPCANMsgFD theMsg){
-
-  CANFRM_0x423_BMS_DATA_3 data;
+void TForm1::ProcessData3(const TFrameView &theMsg){
 
   float hiCellTemp  = 0;
   float loCellTemp  = 0;
   float avgCellTemp = 0;
 
-  // copy received data to status structure
-  memset(&data,0,sizeof(data));
-  memcpy(&data, theMsg.DATA, sizeof(data));
-
-  hiCellTemp  = VCU_TEMPERATURE_BASE + (data.bms_high_cell_temp * VCU_TEMPERATURE_FACTOR);
-  loCellTemp  = VCU_TEMPERATURE_BASE + (data.bms_low_cell_temp  * VCU_TEMPERATURE_FACTOR);
-  avgCellTemp = VCU_TEMPERATURE_BASE + (data.bms_avg_cell_temp  * VCU_TEMPERATURE_FACTOR);
+  // decode in place, bits as in CANFRM_0x423_BMS_DATA_3
+  hiCellTemp  = VCU_TEMPERATURE_BASE + (theMsg.Bits(0, 16)  * VCU_TEMPERATURE_FACTOR);
+  loCellTemp  = VCU_TEMPERATURE_BASE + (theMsg.Bits(16, 16) * VCU_TEMPERATURE_FACTOR);
+  avgCellTemp = VCU_TEMPERATURE_BASE + (theMsg.Bits(32, 16) * VCU_TEMPERATURE_FACTOR);
 
   editHiCellTemp->Text 	= FloatToStrF(hiCellTemp,ffFixed,5,2)  + "C";
   editLoCellTemp->Text 	= FloatToStrF(loCellTemp,ffFixed,5,2)  + "C";;
@@ -2677,21 +2659,16 @@ void TForm1::ProcessData3(TPCANMsgFD theMsg){
 /***************************************************************************************************************
 *     P r o c e s s D a t a 5
 ***************************************************************************************************************/
-void TForm1::ProcessData5(TPCANMsgFD theMsg){
-
-  CANFRM_0x425_BMS_DATA_5 data;
+void TForm1::ProcessData5(const TFrameView &theMsg){
 
   float chgLimit     = 0;
   float dischgLimit  = 0;
   float endVoltage   = 0;
 
-  // copy received data to status structure
-  memset(&data,0,sizeof(data));
-  memcpy(&data, theMsg.DATA, sizeof(data));
-
-  chgLimit      = VCU_CURRENT_BASE + (data.bms_charge_limit   * VCU_CURRENT_FACTOR);
-  dischgLimit   = VCU_CURRENT_BASE + (data.bms_dischage_limit * VCU_CURRENT_FACTOR);
-  endVoltage    = data.bms_charge_end_voltage_limit * VCU_VOLTAGE_FACTOR;
+  // decode in place, bits as in CANFRM_0x425_BMS_DATA_5
+  chgLimit      = VCU_CURRENT_BASE + (theMsg.Bits(16, 16) * VCU_CURRENT_FACTOR);
+  dischgLimit   = VCU_CURRENT_BASE + (theMsg.Bits(0, 16)  * VCU_CURRENT_FACTOR);
+  endVoltage    = theMsg.Bits(32, 16) * VCU_VOLTAGE_FACTOR;
 
   editChgLimit->Text 		= FloatToStrF(chgLimit,ffFixed,5,2)    + "A";
   editDisChgLimit->Text 	= FloatToStrF(dischgLimit,ffFixed,5,2) + "A";
@@ -2703,16 +2680,11 @@ void TForm1::ProcessData5(TPCANMsgFD theMsg){
 /***************************************************************************************************************
 *    P r o c e s s D a t a 8
 ***************************************************************************************************************/
-void TForm1::ProcessData8(TPCANMsgFD theMsg){
-
-  CANFRM_0x428_BMS_DATA_8 data;
-
-  // copy received data to status structure
-  memset(&data,0,sizeof(data));
-  memcpy(&data, theMsg.DATA, sizeof(data));
+void TForm1::ProcessData8(const TFrameView &theMsg){
 
+  // nothing decoded yet, bytes as in CANFRM_0x428_BMS_DATA_8
   /*
-  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_8  %03x : HIVM=%d LOVM=%d HIVC=%d LOVC=%d",rxObj.bF.id.SID, data.bms_max_volt_mod, data.bms_min_volt_mod, data.bms_max_volt_cell, data.bms_min_volt_cell) ; serialOut(tempBuffer);}
+  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_8  %03x : HIVM=%d LOVM=%d HIVC=%d LOVC=%d",rxObj.bF.id.SID, theMsg.U8(0), theMsg.U8(2), theMsg.U8(1), theMsg.U8(3)) ; serialOut(tempBuffer);}
   */
 
 }
@@ -2721,16 +2693,11 @@ void TForm1::ProcessData8(TPCANMsgFD theMsg){
 /***************************************************************************************************************
 *     P r o c e s s D a t a 9
 ***************************************************************************************************************/
-void TForm1::ProcessData9(TPCANMsgFD theMsg){
-
-  CANFRM_0x429_BMS_DATA_9 data;
+void TForm1::ProcessData9(const TFrameView &theMsg){
 
-
-	  // copy received data to status structure
-	  memset(&data,0,sizeof(data));
-	  memcpy(&data, theMsg.DATA, sizeof(data));
+	  // nothing decoded yet, bytes as in CANFRM_0x429_BMS_DATA_9
 	  /*
-	  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_9  %03x : HITM=%d LOTM=%d HITC=%d LOTC=%d",rxObj.bF.id.SID,data.bms_max_temp_mod, data.bms_min_temp_mod, data.bms_max_temp_cell, data.bms_min_temp_cell) ; serialOut(tempBuffer);}
+	  if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_9  %03x : HITM=%d LOTM=%d HITC=%d LOTC=%d",rxObj.bF.id.SID,theMsg.U8(0), theMsg.U8(2), theMsg.U8(1), theMsg.U8(3)) ; serialOut(tempBuffer);}
 	  */
 
 }
@@ -2739,25 +2706,22 @@ void TForm1::ProcessData9(TPCANMsgFD theMsg){
 /***************************************************************************************************************
 *     P r o c e s s D a t a 1 0
 ***************************************************************************************************************/
-void TForm1::ProcessData10(TPCANMsgFD theMsg){
-
-  CANFRM_0x430_BMS_DATA_10 data;
+void TForm1::ProcessData10(const TFrameView &theMsg){
 
   float isolation     = 0;
    {
 	clsCritical locker(m_objpCS);
 
-  // copy received data to status structure
-  memset(&data,0,sizeof(data));
-  memcpy(&data, theMsg.DATA, sizeof(data));
-
-  isolation = data.bms_hv_bus_actv_iso * VCU_ISOLATION_FACTOR;
+  // decode in place, bits as in CANFRM_0x430_BMS_DATA_10
+  isolation = theMsg.Bits(0, 16) * VCU_ISOLATION_FACTOR;
   //isolation = data.bms_hv_bus_actv_iso * VCU_ISOLATION_FACTOR;
-  editIsolation->Text = FloatToStrF(isolation,ffFixed,2,2) + "Ohm/V";
   /*
   if(debugLevel & (DBG_VCU)){sprintf(tempBuffer,"RX BMS_DATA_10 %03x : ISOL=%.2fOhms/V",rxObj.bF.id.SID,isolation) ; serialOut(tempBuffer);}
   */
    }
+
+  // Outside the lock, the VCL thread may be waiting for it
+  editIsolation->Text = FloatToStrF(isolation,ffFixed,2,2) + "Ohm/V";
 }
 
 /***************************************************************************************************************
@@ -3103,31 +3067,32 @@ void __fastcall TForm1::cboStateChange(TObject *Sender)
 //---------------------------------------------------------------------------
 
 
-void TForm1::ProcessModuleState(TPCANMsgFD theMsg){
-
-	CANFRM_0x411_MODULE_STATE modState;
+void TForm1::ProcessModuleState(const TFrameView &theMsg){
 
 	uint8_t moduleId;
+	uint32_t faultCode;
 
-	// copy received data to status structure
-	memset(&modState,0,sizeof(modState));
-	memcpy(&modState, theMsg.DATA, sizeof(modState));
+	// decode in place, bits as in CANFRM_0x411_MODULE_STATE
+	moduleId  = theMsg.U8(0);
+	faultCode = theMsg.Bits(22, 8);
 
-	moduleId = modState.module_id;
+	{
+	clsCritical locker(m_objpCS);
 
     // Add explicit cast here
-	module[moduleId].currentState = static_cast<moduleState>(modState.module_state);
-	module[moduleId].soh            			= modState.module_soh;
-	module[moduleId].soc            			= modState.module_soc;
-	module[moduleId].status						= modState.module_status;
-	module[moduleId].faultCode.commsError       = modState.module_fault_code & 0x01;
-	module[moduleId].faultCode.hwIncompatible   = modState.module_fault_code & 0x02;
-	module[moduleId].faultCode.commsError       = modState.module_fault_code & 0x04;
-	module[moduleId].faultCode.overCurrent		= modState.module_fault_code & 0x08;
-	module[moduleId].faultCode.overTemperature  = modState.module_fault_code & 0x10;
-	module[moduleId].faultCode.overVoltage      = modState.module_fault_code & 0x20;
-
-	module[moduleId].cellCount      			= modState.module_cell_count;
+	module[moduleId].currentState = static_cast<moduleState>(theMsg.Bits(8, 2));
+	module[moduleId].soh            			= theMsg.Bits(10, 8);
+	module[moduleId].soc            			= theMsg.U8(4);
+	module[moduleId].status						= theMsg.Bits(18, 2);
+	module[moduleId].faultCode.commsError       = faultCode & 0x01;
+	module[moduleId].faultCode.hwIncompatible   = faultCode & 0x02;
+	module[moduleId].faultCode.commsError       = faultCode & 0x04;
+	module[moduleId].faultCode.overCurrent		= faultCode & 0x08;
+	module[moduleId].faultCode.overTemperature  = faultCode & 0x10;
+	module[moduleId].faultCode.overVoltage      = faultCode & 0x20;
+
+	module[moduleId].cellCount      			= theMsg.U8(7);
+	}
 
 	/*
 	modState.module_cell_balance_status;
@@ -3140,103 +3105,82 @@ void TForm1::ProcessModuleState(TPCANMsgFD theMsg){
    UpdateModuleDisplay();
 }
 
-void TForm1::ProcessModulePower(TPCANMsgFD theMsg){
-
-	CANFRM_0x412_MODULE_POWER modPower;
+void TForm1::ProcessModulePower(const TFrameView &theMsg){
 
 	uint8_t moduleId;
 
-	// copy received data to status structure
-	memset(&modPower,0,sizeof(modPower));
-	memcpy(&modPower, theMsg.DATA, sizeof(modPower));
-
-	moduleId 				= modPower.module_id;
-	module[moduleId].mmc	= modPower.module_current;
-	module[moduleId].mmv	= modPower.module_voltage;
+	// decode in place, bits as in CANFRM_0x412_MODULE_POWER; the current
+	// does not fit in the first word and starts the second
+	moduleId 				= theMsg.U8(0);
+	{
+	clsCritical locker(m_objpCS);
+	module[moduleId].mmc	= theMsg.Bits(32, 16);
+	module[moduleId].mmv	= theMsg.Bits(8, 16);
+	}
 
 	UpdateModuleDisplay();
 }
 
-void TForm1::ProcessModuleCellVoltage(TPCANMsgFD theMsg){
-
-	CANFRM_0x413_MODULE_CELL_VOLTAGE modCellVoltage;
+void TForm1::ProcessModuleCellVoltage(const TFrameView &theMsg){
 
 	uint8_t moduleId;
 
-	// copy received data to status structure
-	memset(&modCellVoltage,0,sizeof(modCellVoltage));
-	memcpy(&modCellVoltage, theMsg.DATA, sizeof(modCellVoltage));
-
-	moduleId 						= modCellVoltage.module_id;
-	module[moduleId].cellHiVolt		= modCellVoltage.module_high_cell_volt;
-	module[moduleId].cellLoVolt		= modCellVoltage.module_low_cell_volt;
-	module[moduleId].cellAvgVolt	= modCellVoltage.module_avg_cell_volt;
+	// decode in place, bits as in CANFRM_0x413_MODULE_CELL_VOLTAGE
+	moduleId 						= theMsg.U8(0);
+	{
+	clsCritical locker(m_objpCS);
+	module[moduleId].cellHiVolt		= theMsg.Bits(8, 16);
+	module[moduleId].cellLoVolt		= theMsg.Bits(32, 16);
+	module[moduleId].cellAvgVolt	= theMsg.Bits(48, 16);
+	}
 
 	UpdateModuleDisplay();
 }
 
-void TForm1::ProcessModuleCellTemp(TPCANMsgFD theMsg){
-
-	CANFRM_0x414_MODULE_CELL_TEMP modCellTemp;
+void TForm1::ProcessModuleCellTemp(const TFrameView &theMsg){
 
 	uint8_t moduleId;
 
-	// copy received data to status structure
-	memset(&modCellTemp,0,sizeof(modCellTemp));
-	memcpy(&modCellTemp, theMsg.DATA, sizeof(modCellTemp));
-
-	moduleId 						= modCellTemp.module_id;
-	module[moduleId].cellHiTemp		= modCellTemp.module_high_cell_temp;
-	module[moduleId].cellLoTemp		= modCellTemp.module_low_cell_temp;
-	module[moduleId].cellAvgTemp	= modCellTemp.module_avg_cell_temp;
+	// decode in place, bits as in CANFRM_0x414_MODULE_CELL_TEMP
+	moduleId 						= theMsg.U8(0);
+	{
+	clsCritical locker(m_objpCS);
+	module[moduleId].cellHiTemp		= theMsg.Bits(8, 16);
+	module[moduleId].cellLoTemp		= theMsg.Bits(32, 16);
+	module[moduleId].cellAvgTemp	= theMsg.Bits(48, 16);
+	}
 
 	UpdateModuleDisplay();
 }
 
-void TForm1::ProcessModuleCellId(TPCANMsgFD theMsg){
-
-	CANFRM_0x415_MODULE_CELL_ID modCellId;
-
-	uint8_t moduleId;
-
-	// copy received data to status structure
-	memset(&modCellId,0,sizeof(modCellId));
-	memcpy(&modCellId, theMsg.DATA, sizeof(modCellId));
+void TForm1::ProcessModuleCellId(const TFrameView &theMsg){
 
 	/*
-	DATA UNUSED AT PRESENT
+	DATA UNUSED AT PRESENT, bytes as in CANFRM_0x415_MODULE_CELL_ID
 	*/
 
 	UpdateModuleDisplay();
 }
 
-void TForm1::ProcessModuleLimits(TPCANMsgFD theMsg){
-
-	CANFRM_0x416_MODULE_LIMITS modLimits;
+void TForm1::ProcessModuleLimits(const TFrameView &theMsg){
 
 	uint8_t moduleId;
 
-	// copy received data to status structure
-	memset(&modLimits,0,sizeof(modLimits));
-	memcpy(&modLimits, theMsg.DATA, sizeof(modLimits));
-
-	moduleId 						= modLimits.module_id;
-	module[moduleId].maxDischargeA	= modLimits.module_dischage_limit;
-	module[moduleId].maxChargeA		= modLimits.module_charge_limit;
-	module[moduleId].maxChargeEndV	= modLimits.module_charge_end_voltage_limit;
+	// decode in place, bits as in CANFRM_0x416_MODULE_LIMITS
+	moduleId 						= theMsg.U8(0);
+	{
+	clsCritical locker(m_objpCS);
+	module[moduleId].maxDischargeA	= theMsg.Bits(8, 16);
+	module[moduleId].maxChargeA		= theMsg.Bits(32, 16);
+	module[moduleId].maxChargeEndV	= theMsg.Bits(48, 16);
+	}
 
 	UpdateModuleDisplay();
 }
 
-void TForm1::ProcessModuleList(TPCANMsgFD theMsg){
-	CANFRM_0x41F_MODULE_LIST modList;
-
-	// copy received data to status structure
-	memset(&modList,0,sizeof(modList));
-	memcpy(&modList, theMsg.DATA, sizeof(modList));
-
+void TForm1::ProcessModuleList(const TFrameView &theMsg){
 	/*
-	DATA UNUSED AT PRESENT
+	DATA UNUSED AT PRESENT, one bit per module as in CANFRM_0x41F_MODULE_LIST
 	*/
 
 }
@@ -3261,17 +3205,96 @@ void __fastcall TForm1::btnSendStateClick(TObject *Sender)
 }
 //---------------------------------------------------------------------------
 
+// Queue runs these at once on the VCL thread and hands them to it from a
+// Web4 task, in the order they were called
 void TForm1::UpdateStatus(const String& status)
 {
-	lblWeb4Status->Caption = "Status: " + status;
-	Application->ProcessMessages();
+	TThread::Queue(nullptr, [this, status]() {
+		lblWeb4Status->Caption = "Status: " + status;
+	});
 }
 
 
 void TForm1::ShowProgress(int position)
 {
-	web4Progress->Position = position;
-    Application->ProcessMessages();
+	TThread::Queue(nullptr, [this, position]() {
+		web4Progress->Position = position;
+	});
+}
+
+void TForm1::NotifyUser(const String& message)
+{
+	TThread::Queue(nullptr, [message]() {
+		ShowMessage(message);
+	});
+}
+
+// The old client goes first: its replay thread and cache save work on the
+// same journal and cache files the new one opens
+void TForm1::OpenWeb4Client(void)
+{
+	if (FWeb4Client) {
+		FWeb4Client->Disconnect();
+		FWeb4Client.reset();
+	}
+
+	FWeb4Client.reset(new TWeb4BridgeClient(FConfig));
+	FWeb4Client->OnWriteReplayed = [this](const System::UnicodeString& key, TWeb4Response& response) {
+		WriteReplayed(key, response);
+	};
+}
+
+void TForm1::StartWeb4Task(TButton *button, const String& name, TWeb4Task::TBody body)
+{
+	FWeb4TaskButton = button;
+	FWeb4TaskCaption = button->Caption;
+	button->Caption = "Cancel";
+	btnRegister->Enabled = (button == btnRegister);
+	btnCreate->Enabled = (button == btnCreate);
+	btnDemo->Enabled = (button == btnDemo);
+
+	FWeb4Task.reset(new TWeb4Task(name, body, [this]() { Web4TaskFinished(); }));
+	FWeb4Task->Start();
+}
+
+// True while a task runs, the click then only cancels it
+bool TForm1::CancelWeb4Task(TButton *button)
+{
+	if (!FWeb4Task)
+		return false;
+
+	if (button == FWeb4TaskButton && !FWeb4Task->Cancelled()) {
+		LogMessage("Cancelling " + FWeb4Task->Name() + "...");
+		UpdateStatus("Cancelling...");
+		FWeb4Task->Cancel();
+		button->Enabled = false;
+	}
+	return true;
+}
+
+void TForm1::Web4TaskFinished(void)
+{
+	// Gone already when the form closed while it ran
+	if (!FWeb4Task || FWeb4Task->Running())
+		return;
+
+	String name = FWeb4Task->Name();
+	if (FWeb4Task->Stopped()) {
+		LogMessage(name + " cancelled");
+		UpdateStatus(name + " cancelled");
+	} else if (!FWeb4Task->Error().IsEmpty()) {
+		LogMessage("! " + name + " failed: " + FWeb4Task->Error());
+		UpdateStatus(name + " failed");
+		ShowMessage(name + " failed: " + FWeb4Task->Error());
+	}
+	FWeb4Task.reset();
+
+	FWeb4TaskButton->Caption = FWeb4TaskCaption;
+	FWeb4TaskButton = NULL;
+	btnRegister->Enabled = true;
+	btnCreate->Enabled = true;
+	btnDemo->Enabled = true;
+	ShowProgress(0);
 }
 
 void TForm1::RegisterSingleComponent(const System::UnicodeString& componentId,
@@ -3413,16 +3436,9 @@ void TForm1::RegisterSingleComponentDebug(const System::UnicodeString& component
 			LogMessage("    Transaction Hash: " + registration->TxHash);
 			
 			// Store the generated component ID for later use in LCT creation
-			if (componentType == "battery_pack") {
-				FRegisteredPackId = registration->ComponentId;
-				LogMessage("    Stored Pack ID: " + FRegisteredPackId);
-			} else if (componentType == "battery_module") {
-				FRegisteredModuleId = registration->ComponentId;
-				LogMessage("    Stored Module ID: " + FRegisteredModuleId);
-			} else if (componentType == "host_system") {
-				FRegisteredHostId = registration->ComponentId;
-				LogMessage("    Stored Host ID: " + FRegisteredHostId);
-			}
+			TThread::Synchronize(nullptr, [&]() {
+				StoreRegisteredId(componentType, registration->ComponentId);
+			});
 		} else {
 			LogMessage(" Registration returned null");
 		}
@@ -3442,17 +3458,75 @@ void TForm1::RegisterSingleComponentDebug(const System::UnicodeString& component
 }
 
 
+void TForm1::StoreRegisteredId(const System::UnicodeString& componentType,
+							   const System::UnicodeString& componentId)
+{
+	if (componentType == "battery_pack") {
+		FRegisteredPackId = componentId;
+		LogMessage("    Stored Pack ID: " + FRegisteredPackId);
+	} else if (componentType == "battery_module") {
+		FRegisteredModuleId = componentId;
+		LogMessage("    Stored Module ID: " + FRegisteredModuleId);
+	} else if (componentType == "host_system") {
+		FRegisteredHostId = componentId;
+		LogMessage("    Stored Host ID: " + FRegisteredHostId);
+	}
+}
+
+void TForm1::DeferRegistration(const System::UnicodeString& componentId,
+							   const System::UnicodeString& componentType)
+{
+	System::UnicodeString key = FWeb4Client->RegisterComponentDeferred(
+		FConfig.DefaultCreator,
+		componentId,
+		componentType + "_demo"
+	);
+
+	FDeferredRegistrations[key] = componentType;
+	LogMessage(" Queued " + componentId + " (" + key + ")");
+}
+
+// Runs on the client's replay thread
+void TForm1::WriteReplayed(const System::UnicodeString& key, TWeb4Response& response)
+{
+	System::UnicodeString json = response.Json ? response.Json->ToJSON() : System::UnicodeString();
+	System::UnicodeString error = response.ErrorMessage;
+
+	TThread::Queue(nullptr, [this, key, json, error]() {
+		auto found = FDeferredRegistrations.find(key);
+		if (found == FDeferredRegistrations.end()) {
+			// Journaled by an earlier run, nothing here waits for it
+			LogMessage("Journaled write " + key + (error.IsEmpty() ? " applied" : " rejected: " + error));
+			return;
+		}
+
+		System::UnicodeString componentType = found->second;
+		FDeferredRegistrations.erase(found);
+
+		std::unique_ptr<System::Json::TJSONValue> value(System::Json::TJSONObject::ParseJSONValue(json));
+		System::Json::TJSONObject* object = dynamic_cast<System::Json::TJSONObject*>(value.get());
+		if (!error.IsEmpty() || !object) {
+			LogMessage("Queued " + componentType + " registration rejected: " + error);
+			return;
+		}
+
+		TComponentRegistration registration;
+		registration.FromJSON(object);
+		LogMessage("Queued " + componentType + " registration applied: " + registration.ComponentData);
+		StoreRegisteredId(componentType, registration.ComponentId);
+	});
+}
 
 void TForm1::LogMessage(const System::UnicodeString& message)
 {
     System::UnicodeString timestamp = FormatDateTime("hh:nn:ss", Now());
-	memoWeb4Log->Lines->Add("[" + timestamp + "] " + message);
 
-    // Auto-scroll to bottom
-	SendMessage(memoWeb4Log->Handle, WM_VSCROLL, SB_BOTTOM, 0);
+	TThread::Queue(nullptr, [this, timestamp, message]() {
+		memoWeb4Log->Lines->Add("[" + timestamp + "] " + message);
 
-    // Force update
-    Application->ProcessMessages();
+		// Auto-scroll to bottom
+		SendMessage(memoWeb4Log->Handle, WM_VSCROLL, SB_BOTTOM, 0);
+	});
 }
 
 
@@ -3466,15 +3540,20 @@ void TForm1::LogMessage(const String& message)
 
 void __fastcall TForm1::btnRegisterClick(TObject *Sender)
 {
-	btnRegister->Enabled = false;  // Disable button immediately
+	if (CancelWeb4Task(btnRegister))
+		return;
 
-	try
-	{
+	// Read here, the task must not touch the controls
+	const System::UnicodeString packId = edtBatteryPackId->Text;
+	const System::UnicodeString moduleId = edtBatteryModuleId->Text;
+	const System::UnicodeString hostId = edtHostSystemId->Text;
+
+	OpenWeb4Client();
 
-		FWeb4Client.reset(new TWeb4BridgeClient(FConfig));
+	StartWeb4Task(btnRegister, "Registration", [this, packId, moduleId, hostId](TWeb4Task &task) {
 		if (FWeb4Client->Connect()) {
 			UpdateStatus("Connected to API Bridge");
-			web4Progress->Position = 10;
+			ShowProgress(10);
 			LogMessage("Successfully connected to API Bridge at " +  FConfig.ApiEndpoint + ":" + FConfig.RestPort);
 
 			// Test health check
@@ -3486,112 +3565,130 @@ void __fastcall TForm1::btnRegisterClick(TObject *Sender)
 
 			UpdateStatus("Registering components...");
 			ShowProgress(0);
+			task.Checkpoint();
 
 			// Register Battery Pack
-			LogMessage("Registering battery pack: " + edtBatteryPackId->Text);
+			LogMessage("Registering battery pack: " + packId);
 
-			RegisterSingleComponentDebug(edtBatteryPackId->Text, "battery_pack");
+			RegisterSingleComponentDebug(packId, "battery_pack");
 			ShowProgress(33);
+			task.Checkpoint();
 
 			// Register Battery Module
-			LogMessage("Registering battery module: " + edtBatteryModuleId->Text);
-			RegisterSingleComponentDebug(edtBatteryModuleId->Text, "battery_module");
+			LogMessage("Registering battery module: " + moduleId);
+			RegisterSingleComponentDebug(moduleId, "battery_module");
 			ShowProgress(66);
+			task.Checkpoint();
 
 			// Register Host System
-			LogMessage("Registering host system: " + edtHostSystemId->Text);
-			RegisterSingleComponentDebug(edtHostSystemId->Text, "host_system");
+			LogMessage("Registering host system: " + hostId);
+			RegisterSingleComponentDebug(hostId, "host_system");
 			ShowProgress(100);
 
 			UpdateStatus("Registration complete");
 			LogMessage("Registration complete");
 			LogMessage("");
 
+		} else {
+			// Journaled instead; the IDs arrive through WriteReplayed once the
+			// bridge is back, the client keeps trying until then
+			LogMessage("API Bridge unreachable at " + FConfig.ApiEndpoint + ":" + FConfig.RestPort +
+					   ", registrations queued");
+			TThread::Synchronize(nullptr, [&]() {
+				DeferRegistration(packId, "battery_pack");
+				DeferRegistration(moduleId, "battery_module");
+				DeferRegistration(hostId, "host_system");
+			});
+			UpdateStatus("Registrations queued (" + IntToStr(FWeb4Client->PendingWrites()) + " pending)");
+			LogMessage("");
 		}
-
-	}
-	catch (const Exception& e)
-	{
-		LogMessage("! Registration failed: " + e.Message);
-		UpdateStatus("Registration failed");
-		ShowMessage("Registration failed: " + e.Message);
-
-	}
-	btnRegister->Enabled = true;   // Re-enable button
-	ShowProgress(0);
+	});
 }
 //---------------------------------------------------------------------------
 
 void __fastcall TForm1::btnCreateClick(TObject *Sender)
 {
-    try
-    {
-        // Check if client exists and is connected
-        if (!FWeb4Client) {
-            LogMessage("✗ Web4 client is null - please register components first");
-            UpdateStatus("Error: Web4 client not initialized");
-            ShowMessage("Please register components first before creating LCT relationships.");
-            return;
-        }
+    if (CancelWeb4Task(btnCreate))
+        return;
 
-        if (!FWeb4Client->IsConnected()) {
-            LogMessage("✗ Web4 client not connected");
-            UpdateStatus("Error: Web4 client not connected");
-            ShowMessage("Web4 client is not connected. Please register components first.");
-            return;
-        }
+    // Check if client exists and is connected
+    if (!FWeb4Client) {
+        LogMessage("✗ Web4 client is null - please register components first");
+        UpdateStatus("Error: Web4 client not initialized");
+        ShowMessage("Please register components first before creating LCT relationships.");
+        return;
+    }
 
-        // Validate input fields
-        if (edtBatteryModuleId->Text.IsEmpty() || edtBatteryPackId->Text.IsEmpty()) {
-            LogMessage("✗ Missing required component IDs");
-            UpdateStatus("Error: Missing component IDs");
-            ShowMessage("Please enter both Battery Module ID and Battery Pack ID.");
-            return;
-        }
+    if (!FWeb4Client->IsConnected()) {
+        LogMessage("✗ Web4 client not connected");
+        UpdateStatus("Error: Web4 client not connected");
+        ShowMessage("Web4 client is not connected. Please register components first.");
+        return;
+    }
 
-        UpdateStatus("Creating LCT relationships...");
-        ShowProgress(25);
-        LogMessage("Starting LCT relationship creation...");
+    // Validate input fields
+    if (edtBatteryModuleId->Text.IsEmpty() || edtBatteryPackId->Text.IsEmpty()) {
+        LogMessage("✗ Missing required component IDs");
+        UpdateStatus("Error: Missing component IDs");
+        ShowMessage("Please enter both Battery Module ID and Battery Pack ID.");
+        return;
+    }
 
-        // Create LCT between battery module and pack
-        LogMessage("Creating LCT: " + edtBatteryModuleId->Text + " ↔ " + edtBatteryPackId->Text);
-        LogMessage("Parameters: creator='" + FConfig.DefaultCreator + "', context='race_car_demo'");
-        
-        // Check if we have the registered component IDs
-        LogMessage("Checking for registered component IDs...");
-        if (FRegisteredModuleId.IsEmpty() || FRegisteredPackId.IsEmpty()) {
-            LogMessage("✗ Registered component IDs not found");
-            LogMessage("  Module ID: " + (FRegisteredModuleId.IsEmpty() ? "(empty)" : FRegisteredModuleId));
-            LogMessage("  Pack ID: " + (FRegisteredPackId.IsEmpty() ? "(empty)" : FRegisteredPackId));
-            LogMessage("  Host ID: " + (FRegisteredHostId.IsEmpty() ? "(empty)" : FRegisteredHostId));
-            LogMessage("");
-            LogMessage("SOLUTION: Click the 'Register' button first to register these components:");
-            LogMessage("  1. " + edtBatteryModuleId->Text);
-            LogMessage("  2. " + edtBatteryPackId->Text);
-            if (!edtHostSystemId->Text.IsEmpty()) {
-                LogMessage("  3. " + edtHostSystemId->Text);
-            }
-            
-            UpdateStatus("Components not registered - please register them first");
-            ShowMessage("Components not registered!\n\nPlease click the 'Register' button first to register these components:\n\n• " + 
-                       edtBatteryModuleId->Text + "\n• " + edtBatteryPackId->Text + 
-                       (edtHostSystemId->Text.IsEmpty() ? "" : "\n• " + edtHostSystemId->Text) +
-                       "\n\nThen try creating the LCT relationships again.");
-            ShowProgress(0);
-            return;
+    UpdateStatus("Creating LCT relationships...");
+    ShowProgress(25);
+    LogMessage("Starting LCT relationship creation...");
+
+    // Create LCT between battery module and pack
+    LogMessage("Creating LCT: " + edtBatteryModuleId->Text + " ↔ " + edtBatteryPackId->Text);
+    LogMessage("Parameters: creator='" + FConfig.DefaultCreator + "', context='race_car_demo'");
+    
+    // Check if we have the registered component IDs
+    LogMessage("Checking for registered component IDs...");
+    if (FRegisteredModuleId.IsEmpty() || FRegisteredPackId.IsEmpty()) {
+        LogMessage("✗ Registered component IDs not found");
+        LogMessage("  Module ID: " + (FRegisteredModuleId.IsEmpty() ? "(empty)" : FRegisteredModuleId));
+        LogMessage("  Pack ID: " + (FRegisteredPackId.IsEmpty() ? "(empty)" : FRegisteredPackId));
+        LogMessage("  Host ID: " + (FRegisteredHostId.IsEmpty() ? "(empty)" : FRegisteredHostId));
+        LogMessage("");
+        LogMessage("SOLUTION: Click the 'Register' button first to register these components:");
+        LogMessage("  1. " + edtBatteryModuleId->Text);
+        LogMessage("  2. " + edtBatteryPackId->Text);
+        if (!edtHostSystemId->Text.IsEmpty()) {
+            LogMessage("  3. " + edtHostSystemId->Text);
         }
         
+        UpdateStatus("Components not registered - please register them first");
+        ShowMessage("Components not registered!\n\nPlease click the 'Register' button first to register these components:\n\n• " + 
+                   edtBatteryModuleId->Text + "\n• " + edtBatteryPackId->Text + 
+                   (edtHostSystemId->Text.IsEmpty() ? "" : "\n• " + edtHostSystemId->Text) +
+                   "\n\nThen try creating the LCT relationships again.");
+        ShowProgress(0);
+        return;
+    }
+
+    // Read here, the task must not touch the controls
+    const System::UnicodeString moduleText = edtBatteryModuleId->Text;
+    const System::UnicodeString packText = edtBatteryPackId->Text;
+    const System::UnicodeString hostText = edtHostSystemId->Text;
+
+    // A replayed registration may still change these, the task works on copies
+    const System::UnicodeString moduleId = FRegisteredModuleId;
+    const System::UnicodeString packId = FRegisteredPackId;
+    const System::UnicodeString hostId = FRegisteredHostId;
+
+    StartWeb4Task(btnCreate, "Relationship creation",
+                  [this, moduleText, packText, hostText, moduleId, packId, hostId](TWeb4Task &task) {
         LogMessage("✓ Using registered component IDs:");
-        LogMessage("  Module: " + FRegisteredModuleId + " (from " + edtBatteryModuleId->Text + ")");
-        LogMessage("  Pack: " + FRegisteredPackId + " (from " + edtBatteryPackId->Text + ")");
-        if (!FRegisteredHostId.IsEmpty()) {
-            LogMessage("  Host: " + FRegisteredHostId + " (from " + edtHostSystemId->Text + ")");
+        LogMessage("  Module: " + moduleId + " (from " + moduleText + ")");
+        LogMessage("  Pack: " + packId + " (from " + packText + ")");
+        if (!hostId.IsEmpty()) {
+            LogMessage("  Host: " + hostId + " (from " + hostText + ")");
         }
         
         LogMessage("Calling CreateLct with:");
         LogMessage("  Creator: " + FConfig.DefaultCreator);
-        LogMessage("  ComponentA: " + FRegisteredModuleId);
-        LogMessage("  ComponentB: " + FRegisteredPackId);
+        LogMessage("  ComponentA: " + moduleId);
+        LogMessage("  ComponentB: " + packId);
         LogMessage("  Context: race_car_demo");
         
         std::unique_ptr<TLctRelationship> lct1;
@@ -3622,8 +3719,8 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
         LogMessage("About to call FWeb4Client->CreateLct...");
             lct1 = FWeb4Client->CreateLct(
                 FConfig.DefaultCreator,           // creator
-                FRegisteredModuleId,             // componentA (use stored registered ID)
-                FRegisteredPackId,               // componentB (use stored registered ID)
+                moduleId,                         // componentA (use stored registered ID)
+                packId,                           // componentB (use stored registered ID)
                 "race_car_demo"                  // context
             );
             LogMessage("CreateLct call completed");
@@ -3636,16 +3733,18 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
         }
 
         if (lct1) {
-            LogMessage("✓ LCT relationship created: " + edtBatteryModuleId->Text + " ↔ " + edtBatteryPackId->Text);
-            LogMessage("  Actual IDs used: " + FRegisteredModuleId + " ↔ " + FRegisteredPackId);
+            LogMessage("✓ LCT relationship created: " + moduleText + " ↔ " + packText);
+            LogMessage("  Actual IDs used: " + moduleId + " ↔ " + packId);
             LogMessage("  LCT ID: " + lct1->LctId);
             LogMessage("  Status: " + lct1->Status);
             LogMessage("  Device Key Half: " + lct1->DeviceKeyHalf);
             LogMessage("  LCT Key Half: " + lct1->LctKeyHalf);
             
             // Store Web4 data in battery structures for CAN transmission
-            StoreWeb4DataInModule(edtBatteryModuleId->Text, lct1.get(), FRegisteredModuleId);
-            StoreWeb4DataInPack(edtBatteryPackId->Text, lct1.get(), FRegisteredPackId);
+            TThread::Synchronize(nullptr, [&]() {
+                StoreWeb4DataInModule(moduleText, lct1.get(), moduleId);
+                StoreWeb4DataInPack(packText, lct1.get(), packId);
+            });
             LogMessage("  Web4 data stored in battery structures for CAN transmission");
         } else {
             LogMessage("✗ Failed to create LCT relationship between module and pack");
@@ -3656,18 +3755,21 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
         }
 
         ShowProgress(60);
+        task.Checkpoint();
 
         // Create LCT between app (host) and pack controller for encrypted CAN communication
         std::unique_ptr<TLctRelationship> appToPackLct;
-        if (!FRegisteredHostId.IsEmpty()) {
+        System::UnicodeString appKeyHalf;
+        System::UnicodeString packKeyHalf;
+        if (!hostId.IsEmpty()) {
             LogMessage("Creating App ↔ Pack Controller LCT for encrypted CAN communication");
-            LogMessage("Parameters: creator='" + FConfig.DefaultCreator + "', app_id='" + FRegisteredHostId + "', pack_id='" + FRegisteredPackId + "'");
+            LogMessage("Parameters: creator='" + FConfig.DefaultCreator + "', app_id='" + hostId + "', pack_id='" + packId + "'");
             
             try {
                 appToPackLct = FWeb4Client->CreateLct(
                     FConfig.DefaultCreator,
-                    FRegisteredHostId,        // app component ID
-                    FRegisteredPackId,        // pack controller component ID  
+                    hostId,                   // app component ID
+                    packId,                   // pack controller component ID  
                     "app_pack_communication"  // context for app-pack communication
                 );
                 
@@ -3681,8 +3783,12 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
                     // Store app's portion of the keys (these will be used for CAN encryption)
                     LogMessage("  Storing app-pack encryption keys for CAN communication...");
                     
-                    FAppDeviceKeyHalf = appToPackLct->DeviceKeyHalf;
-                    FPackDeviceKeyHalf = appToPackLct->LctKeyHalf;
+                    appKeyHalf = appToPackLct->DeviceKeyHalf;
+                    packKeyHalf = appToPackLct->LctKeyHalf;
+                    TThread::Synchronize(nullptr, [&]() {
+                        FAppDeviceKeyHalf = appKeyHalf;
+                        FPackDeviceKeyHalf = packKeyHalf;
+                    });
                     
                     LogMessage("  ✓ App-pack encryption keys stored for CAN communication");
                     LogMessage("  Keys ready for distribution to pack controller hardware");
@@ -3705,20 +3811,21 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
         }
 
         ShowProgress(75);
+        task.Checkpoint();
 
         // Create LCT between battery pack and host system (if host system ID is provided)
-        if (!edtHostSystemId->Text.IsEmpty() && !FRegisteredHostId.IsEmpty()) {
-            LogMessage("Creating LCT: " + edtBatteryPackId->Text + " ↔ " + edtHostSystemId->Text);
+        if (!hostText.IsEmpty() && !hostId.IsEmpty()) {
+            LogMessage("Creating LCT: " + packText + " ↔ " + hostText);
             std::unique_ptr<TLctRelationship> lct2 = FWeb4Client->CreateLct(
                 FConfig.DefaultCreator,
-                FRegisteredPackId,        // Use stored registered pack ID
-                FRegisteredHostId,        // Use stored registered host ID
+                packId,                   // Use stored registered pack ID
+                hostId,                   // Use stored registered host ID
                 "race_car_demo"
             );
 
             if (lct2) {
-                LogMessage("✓ LCT relationship created: " + edtBatteryPackId->Text + " ↔ " + edtHostSystemId->Text);
-                LogMessage("  Actual IDs used: " + FRegisteredPackId + " ↔ " + FRegisteredHostId);
+                LogMessage("✓ LCT relationship created: " + packText + " ↔ " + hostText);
+                LogMessage("  Actual IDs used: " + packId + " ↔ " + hostId);
                 LogMessage("  LCT ID: " + lct2->LctId);
                 LogMessage("  Status: " + lct2->Status);
                 LogMessage("  Device Key Half: " + lct2->DeviceKeyHalf);
@@ -3729,7 +3836,7 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
                 ShowProgress(0);
                 return;
             }
-        } else if (!edtHostSystemId->Text.IsEmpty() && FRegisteredHostId.IsEmpty()) {
+        } else if (!hostText.IsEmpty() && hostId.IsEmpty()) {
             LogMessage("Host System ID provided but not registered - skipping pack-to-host LCT creation");
             LogMessage("  Register the host system first to create this relationship");
         } else {
@@ -3737,11 +3844,13 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
         }
 
         ShowProgress(90);
+        task.Checkpoint();
         
         // Distribute keys to pack controller hardware
-        if (!FAppDeviceKeyHalf.IsEmpty() && !FPackDeviceKeyHalf.IsEmpty()) {
+        if (!appKeyHalf.IsEmpty() && !packKeyHalf.IsEmpty()) {
             LogMessage("Distributing encryption keys to pack controller hardware...");
-            DistributeKeysToPackController();
+            DistributeKeysToPackController(&task, appKeyHalf, packKeyHalf, packId, hostId);
+            task.Checkpoint();
         } else {
             LogMessage("No app-pack encryption keys available - skipping key distribution");
         }
@@ -3749,67 +3858,62 @@ void __fastcall TForm1::btnCreateClick(TObject *Sender)
         ShowProgress(100);
         UpdateStatus("LCT relationships created and keys distributed successfully");
         LogMessage("All LCT relationships created and keys distributed successfully!");
-        ShowMessage("LCT relationships created and keys distributed successfully!");
-    }
-    catch (const Exception& e)
-    {
-        LogMessage("! Relationship creation failed: " + e.Message);
-        UpdateStatus("Relationship creation failed");
-        ShowMessage("Relationship creation failed: " + e.Message);
-    }
-
-	ShowProgress(0);
+        NotifyUser("LCT relationships created and keys distributed successfully!");
+    });
 }
 //---------------------------------------------------------------------------
 
 void __fastcall TForm1::btnDemoClick(TObject *Sender)
 {
-		 try
-	{
-		/*
+	if (CancelWeb4Task(btnDemo))
+		return;
+
+	// Read here, the task must not touch the controls
+	const System::UnicodeString packId = edtBatteryPackId->Text;
+	const System::UnicodeString moduleId = edtBatteryModuleId->Text;
+	const System::UnicodeString hostId = edtHostSystemId->Text;
+
+	if (!FWeb4Client) {
+		OpenWeb4Client();
+	}
+
+	StartWeb4Task(btnDemo, "Demo workflow", [this, packId, moduleId, hostId](TWeb4Task &task) {
 		UpdateStatus("Running complete Web4 demo workflow...");
 		LogMessage("Starting Complete Web4 Demo Workflow...");
-		web4Progress->Position = 20;
-
-		std::vector<String> moduleIds = {edtWeb4ModuleId->Text, edtWeb4ModuleId->Text + "-002", edtWeb4ModuleId->Text + "-003"};
-		std::vector<String> packIds = {edtWeb4PackId->Text, edtWeb4PackId->Text.SubString(1, edtWeb4PackId->Text.Length()-1) + "B"};
+		ShowProgress(20);
 
-		//auto results = FWeb4Client->DemoCompleteWeb4Workflow(moduleIds, packIds, edtWeb4HostId->Text);
-		web4Progress->Position = 100;
+		if (!FWeb4Client->IsConnected() && !FWeb4Client->Connect()) {
+			LogMessage("! Demo workflow failed: API Bridge unreachable at " + FConfig.ApiEndpoint + ":" + FConfig.RestPort);
+			UpdateStatus("Demo workflow failed");
+			return;
+		}
+		task.Checkpoint();
+
+		std::vector<System::UnicodeString> packIds(1, packId);
+		std::vector<System::UnicodeString> moduleIds(1, moduleId);
+		TWeb4BridgeClient::TDemoWorkflowResult results =
+			FWeb4Client->ExecuteCompleteBatteryDemo(packIds, moduleIds, hostId);
+		std::unique_ptr<System::Json::TJSONObject> details(results.DetailedResults);
+		ShowProgress(100);
+		task.Checkpoint();
+
+		if (!results.Success) {
+			LogMessage("! Demo workflow failed: " + results.ErrorMessage);
+			UpdateStatus("Demo workflow failed");
+			NotifyUser("Demo workflow failed: " + results.ErrorMessage);
+			return;
+		}
 
 		LogMessage("Complete Web4 Demo Workflow Finished!");
 		LogMessage("Summary:");
-
-		auto registrations = dynamic_cast<TJSONArray*>(results["component_registrations"]);
-		auto relationships = dynamic_cast<TJSONArray*>(results["lct_relationships"]);
-		auto tensors = dynamic_cast<TJSONArray*>(results["trust_tensors"]);
-		auto operations = dynamic_cast<TJSONArray*>(results["energy_operations"]);
-		auto balances = dynamic_cast<TJSONArray*>(results["final_balances"]);
-
-		LogMessage(" - Components: " + IntToStr(registrations ? registrations->Count : 0));
-		LogMessage(" - LCT Relationships: " + IntToStr(relationships ? relationships->Count : 0));
-		LogMessage(" - Trust Tensors: " + IntToStr(tensors ? tensors->Count : 0));
-		LogMessage(" - Energy Operations: " + IntToStr(operations ? operations->Count : 0));
-		LogMessage(" - Final Balances: " + IntToStr(balances ? balances->Count : 0));
+		LogMessage(" - Components: " + IntToStr((int)results.CreatedComponentIds.size()));
+		LogMessage(" - LCT Relationships: " + IntToStr((int)results.CreatedLctIds.size()));
+		LogMessage(" - Trust Tensors: " + IntToStr((int)results.CreatedTensorIds.size()));
+		LogMessage(" - Energy Operations: " + IntToStr((int)results.ExecutedOperationIds.size()));
 
 		UpdateStatus("Complete demo workflow finished successfully");
-		ShowMessage("Complete Web4 demo workflow executed successfully!\n\n"
-					" - All 6 Web4 modules integrated\n"
-					" - LCTs as relationships demonstrated\n"
-					" - Trust tensors operational\n"
-					" - ATP/ADP energy cycles active");
-		*/
-	}
-
-	catch (const Exception& e)
-	{
-		LogMessage("! Demo workflow failed: " + e.Message);
-		UpdateStatus("Demo workflow failed");
-		ShowMessage("Demo workflow failed: " + e.Message + "\n\nMake sure your Web4 blockchain is running on localhost:1317");
-	}
-
-	ShowProgress(0);
-
+		NotifyUser("Complete Web4 demo workflow executed successfully!");
+	});
 }
 //---------------------------------------------------------------------------
 
@@ -3827,7 +3931,9 @@ void TForm1::StoreWeb4DataInModule(const System::UnicodeString& originalModuleId
         // For now, let's assume we're storing in the first available module
         // You should replace this with your actual module selection logic
         if (i == 0) { // Replace with proper module identification
-            // Copy key halves to the module structure
+            // Copy key halves to the module structure, the read thread
+            // decodes into the same array
+            clsCritical locker(m_objpCS);
             strncpy(module[i].web4DeviceKeyHalf, AnsiString(lct->DeviceKeyHalf).c_str(), 63);
             module[i].web4DeviceKeyHalf[63] = '\0'; // Ensure null termination
             
@@ -3838,6 +3944,7 @@ void TForm1::StoreWeb4DataInModule(const System::UnicodeString& originalModuleId
             module[i].web4ComponentId[63] = '\0';
             
             module[i].web4Registered = true;
+            locker.Leave();
             
             LogMessage("    Module Web4 data stored:");
             LogMessage("      Device Key: " + String(module[i].web4DeviceKeyHalf));
@@ -3849,6 +3956,8 @@ void TForm1::StoreWeb4DataInModule(const System::UnicodeString& originalModuleId
 
 void TForm1::StoreWeb4DataInPack(const System::UnicodeString& originalPackId, const TLctRelationship* lct, const System::UnicodeString& generatedComponentId) {
     try {
+        clsCritical locker(m_objpCS);
+
         // Copy key halves to the global pack structure  
         strncpy(pack.web4DeviceKeyHalf, AnsiString(lct->DeviceKeyHalf).c_str(), 63);
         pack.web4DeviceKeyHalf[63] = '\0'; // Ensure null termination
@@ -3860,6 +3969,7 @@ void TForm1::StoreWeb4DataInPack(const System::UnicodeString& originalPackId, co
         pack.web4ComponentId[63] = '\0';
         
         pack.web4Registered = true;
+        locker.Leave();
         
         LogMessage("    ✓ Pack Web4 data stored successfully:");
         LogMessage("      Device Key: " + lct->DeviceKeyHalf);
@@ -3875,17 +3985,21 @@ void TForm1::StoreWeb4DataInPack(const System::UnicodeString& originalPackId, co
 
 ///// Web4 Key Distribution Functions /////
 
-void TForm1::DistributeKeysToPackController(void) {
+void TForm1::DistributeKeysToPackController(TWeb4Task *task,
+                                            const System::UnicodeString& appKeyHalf,
+                                            const System::UnicodeString& packKeyHalf,
+                                            const System::UnicodeString& packId,
+                                            const System::UnicodeString& hostId) {
     LogMessage("Starting key distribution to pack controller hardware...");
     
     // Check if we have the required keys
-    if (FAppDeviceKeyHalf.IsEmpty() || FPackDeviceKeyHalf.IsEmpty()) {
+    if (appKeyHalf.IsEmpty() || packKeyHalf.IsEmpty()) {
         LogMessage("✗ No app-pack keys available for distribution");
         LogMessage("  Create LCT relationships first to generate encryption keys");
         return;
     }
     
-    if (FRegisteredPackId.IsEmpty() || FRegisteredHostId.IsEmpty()) {
+    if (packId.IsEmpty() || hostId.IsEmpty()) {
         LogMessage("✗ Component IDs not available for distribution");
         return;
     }
@@ -3893,40 +4007,74 @@ void TForm1::DistributeKeysToPackController(void) {
     try {
         LogMessage("Distributing Web4 keys via CAN...");
         
-        // Send pack controller's device key half
-        LogMessage("  Sending pack controller device key half...");
-        TPCANStatus result1 = SendKeyData(ID_VCU_WEB4_PACK_KEY_HALF, FPackDeviceKeyHalf);
-        if (result1 != PCAN_ERROR_OK) {
-            LogMessage("  ✗ Failed to send pack key half: " + GetFormatedError(result1));
-            return;
+        // The four items use different standard IDs, so they go out side by side
+        const uint32_t ids[4] = {ID_VCU_WEB4_PACK_KEY_HALF, ID_VCU_WEB4_APP_KEY_HALF,
+                                 ID_VCU_WEB4_COMPONENT_IDS, ID_VCU_WEB4_COMPONENT_IDS + 1};
+        const System::UnicodeString values[4] = {packKeyHalf, appKeyHalf, packId, hostId};
+        const System::UnicodeString names[4] = {"pack key half", "app key half", "pack component ID", "app component ID"};
+        std::vector<TProvisionItem> items(4);
+
+        for (int i = 0; i < 4; i++) {
+            AnsiString bytes = AnsiString(values[i]);
+            if (bytes.Length() > KEYXFER_MAX_LENGTH) {
+                LogMessage("  ✗ " + names[i] + String().sprintf(L" is %d bytes, at most %d fit", bytes.Length(), KEYXFER_MAX_LENGTH));
+                return;
+            }
+            items[i].StdId = (uint16_t)ids[i];
+            items[i].Data.assign((const uint8_t*)bytes.c_str(), (const uint8_t*)bytes.c_str() + bytes.Length());
         }
-        LogMessage("  ✓ Pack key half sent successfully");
-        
-        // Small delay between messages
-        Sleep(10);
-        
-        // Send app's device key half  
-        LogMessage("  Sending app device key half...");
-        TPCANStatus result2 = SendKeyData(ID_VCU_WEB4_APP_KEY_HALF, FAppDeviceKeyHalf);
-        if (result2 != PCAN_ERROR_OK) {
-            LogMessage("  ✗ Failed to send app key half: " + GetFormatedError(result2));
+
+        // The bit rate and the packs come from the controls, the key packs
+        // list when there is one, else the selected pack ID
+        DWORD bitRate = 0;
+        bool fd = false;
+        AnsiString packList;
+        uint8_t selected = 0;
+        TThread::Synchronize(nullptr, [&]() {
+            bitRate = NominalBitRate();
+            fd = m_IsFD;
+            packList = AnsiString(edtProvisionPacks->Text.Trim());
+            selected = packID;
+        });
+
+        std::vector<uint8_t> devices(1, selected);
+        if (!packList.IsEmpty() && !ParsePackIds(packList.c_str(), devices)) {
+            LogMessage("✗ Key packs is not a list of pack IDs 0-255: " + String(packList));
             return;
         }
-        LogMessage("  ✓ App key half sent successfully");
-        
-        // Small delay between messages
-        Sleep(10);
-        
-        // Send component IDs
-        LogMessage("  Sending component IDs...");
-        TPCANStatus result3 = SendComponentIds();
-        if (result3 != PCAN_ERROR_OK) {
-            LogMessage("  ✗ Failed to send component IDs: " + GetFormatedError(result3));
+
+        TProvisionScheduler scheduler(m_Dispatcher, bitRate, fd);
+        for (size_t i = 0; i < devices.size(); i++) {
+            scheduler.AddPack(devices[i], items);
+        }
+        TProvisionSummary summary = RunProvisioning(scheduler, task);
+
+        // Item by item for a single pack or a failed one, the rest is in the log already
+        for (size_t j = 0; j < scheduler.Jobs().size(); j++) {
+            const TPackJob *job = scheduler.Jobs()[j].get();
+            if (devices.size() > 1 && job->State == TPackJob::jsDone) {
+                continue;
+            }
+            for (size_t i = 0; i < job->Transfers.size(); i++) {
+                TKeyTransfer *transfer = job->Transfers[i].get();
+                String pack = (devices.size() > 1) ? String().sprintf(L"pack %d ", job->Device) : String();
+                if (transfer->State() == TKeyTransfer::ksDone) {
+                    LogMessage("  ✓ " + pack + names[i] + String().sprintf(L": %d %s, %d retransmitted, %u ms",
+                              transfer->Chunks(), transfer->IsFD() ? L"FD frame" : L"chunks",
+                              transfer->Retransmits(), transfer->ElapsedMs()));
+                } else {
+                    LogMessage("  ✗ " + pack + names[i] + ": " + String(transfer->Error()) +
+                               String().sprintf(L" after %d frames", transfer->Sends()));
+                }
+            }
+        }
+
+        if (summary.Failed) {
+            LogMessage(String().sprintf(L"✗ Key distribution failed for %d of %d packs", summary.Failed, summary.Packs));
             return;
         }
-        LogMessage("  ✓ Component IDs sent successfully");
         
-        LogMessage("✓ All Web4 keys distributed to pack controller successfully!");
+        LogMessage(String().sprintf(L"✓ All Web4 keys distributed to %d pack controller(s) successfully!", summary.Packs));
         LogMessage("  Pack controller should now have:");
         LogMessage("    - Pack device key half (64 bytes)");
         LogMessage("    - App device key half (64 bytes)");  
@@ -3939,133 +4087,122 @@ void TForm1::DistributeKeysToPackController(void) {
     }
 }
 
-TPCANStatus TForm1::SendKeyData(uint32_t baseCanId, const System::UnicodeString& keyData) {
-    // Convert Unicode string to AnsiString and then to bytes
-    AnsiString ansiKeyData = AnsiString(keyData);
-    const char* keyBytes = ansiKeyData.c_str();
-    int keyLength = ansiKeyData.Length();
-    
-    LogMessage(String().sprintf(L"  Sending %d bytes in 8 chunks with acknowledgment...", keyLength));
-    
-    // Send 8 chunks of 8 bytes each for 64-byte key
-    for (int chunk = 0; chunk < 8; chunk++) {
-        int retries = 0;
-        bool chunkAcked = false;
-        
-        while (!chunkAcked && retries < 3) {
-            // Send chunk with chunk number in extended ID
-            TPCANMsg CANMsg = TPCANMsg();
-            CANMsg.ID = baseCanId | (chunk << 8) | packID;  // Chunk in bits 8-15
-            CANMsg.LEN = 8;
-            CANMsg.MSGTYPE = PCAN_MESSAGE_EXTENDED;
-            
-            // Create generic 8-byte structure using individual byte fields  
-            // All Web4 structures (0x407, 0x408, 0x409) have identical layout
-            struct {
-                uint8_t BYTE0, BYTE1, BYTE2, BYTE3, BYTE4, BYTE5, BYTE6, BYTE7;
-            } keyFrame = {0};
-            
-            // Copy bytes individually for this chunk
-            int startByte = chunk * 8;
-            int bytesToCopy = std::min(8, keyLength - startByte);
-            if (bytesToCopy >= 1) keyFrame.BYTE0 = keyBytes[startByte + 0];
-            if (bytesToCopy >= 2) keyFrame.BYTE1 = keyBytes[startByte + 1];
-            if (bytesToCopy >= 3) keyFrame.BYTE2 = keyBytes[startByte + 2];
-            if (bytesToCopy >= 4) keyFrame.BYTE3 = keyBytes[startByte + 3];
-            if (bytesToCopy >= 5) keyFrame.BYTE4 = keyBytes[startByte + 4];
-            if (bytesToCopy >= 6) keyFrame.BYTE5 = keyBytes[startByte + 5];
-            if (bytesToCopy >= 7) keyFrame.BYTE6 = keyBytes[startByte + 6];
-            if (bytesToCopy >= 8) keyFrame.BYTE7 = keyBytes[startByte + 7];
-            
-            memcpy(CANMsg.DATA, &keyFrame, sizeof(keyFrame));
-            
-            TPCANStatus sendResult = m_objPCANBasic->Write(m_PcanHandle, &CANMsg);
-            if (sendResult != PCAN_ERROR_OK) {
-                LogMessage(String().sprintf(L"  ✗ Failed to send chunk %d: %s", chunk, GetFormatedError(sendResult)));
-                return sendResult;
-            }
-            
-            LogMessage(String().sprintf(L"  → Sent chunk %d/8 (%d bytes)", chunk + 1, bytesToCopy));
-            
-            // Wait for ACK
-            chunkAcked = WaitForChunkAck(baseCanId, chunk, 1000); // 1 second timeout
-            
-            if (!chunkAcked) {
-                retries++;
-                LogMessage(String().sprintf(L"  ⚠ Chunk %d not acknowledged, retry %d/3", chunk + 1, retries));
-                Sleep(100); // Brief delay before retry
-            }
+TProvisionSummary TForm1::RunProvisioning(TProvisionScheduler &scheduler, TWeb4Task *task) {
+    scheduler.Write = [this](TPCANMsgFD &frame) { return WriteKeyFrame(frame); };
+    scheduler.Wait = [this, &scheduler, task](HANDLE event, DWORD ms) {
+        // Cancelling fails what is still sending, Run then returns
+        if (task && task->Cancelled()) {
+            for (size_t i = 0; i < scheduler.Jobs().size(); i++)
+                for (size_t t = 0; t < scheduler.Jobs()[i]->Transfers.size(); t++)
+                    scheduler.Jobs()[i]->Transfers[t]->Abort("cancelled");
         }
-        
-        if (!chunkAcked) {
-            LogMessage(String().sprintf(L"  ✗ Chunk %d failed after 3 retries", chunk + 1));
-            return PCAN_ERROR_XMTFULL; // Use existing error code
+        WaitForKeyAcks(event, ms);
+    };
+    scheduler.Progress = [this, &scheduler](const TPackJob &job) {
+        int done = 0, held = 0, total = 0;
+        for (size_t i = 0; i < scheduler.Jobs().size(); i++) {
+            const TPackJob *other = scheduler.Jobs()[i].get();
+            done += (other->State == TPackJob::jsDone || other->State == TPackJob::jsFailed);
+            held += (other->State == TPackJob::jsDone) ? other->ChunksTotal : other->ChunksHeld;
+            total += other->ChunksTotal;
         }
-        
-        LogMessage(String().sprintf(L"  ✓ Chunk %d acknowledged", chunk + 1));
+        if (job.State == TPackJob::jsDone) {
+            LogMessage(String().sprintf(L"  ✓ Pack %d provisioned in %u ms", job.Device, job.EndTime - job.StartTime));
+        } else if (job.State == TPackJob::jsFailed) {
+            LogMessage(String().sprintf(L"  ✗ Pack %d: ", job.Device) + String(job.Error));
+        }
+        UpdateStatus(String().sprintf(L"Distributing keys: %d of %d packs, %d%% of chunks held",
+                     done, (int)scheduler.Jobs().size(), total ? held * 100 / total : 0));
+    };
+
+    TProvisionSummary summary = scheduler.Run();
+
+    LogMessage(String().sprintf(L"Provisioned %d of %d packs in %u ms, %.1f packs/min, %d frames, %d retransmitted, %.1f%% bus load",
+              summary.Done, summary.Packs, summary.ElapsedMs, summary.PacksPerMinute,
+              summary.Frames, summary.Retransmits, summary.BusLoad));
+    if (summary.Failed)
+        LogMessage(String().sprintf(L"  %d packs failed", summary.Failed));
+    return summary;
+}
+
+void TForm1::WaitForKeyAcks(HANDLE event, DWORD ms) {
+    // On a Web4 task the read thread receives the ACKs. Without it nothing
+    // else empties the queue, so the VCL thread reads it in the same short
+    // slices as below
+    if (GetCurrentThreadId() != MainThreadID) {
+        if (m_hThread == NULL) {
+            TThread::Synchronize(nullptr, [this]() { ReadMessages(); });
+            ms = std::min(ms, (DWORD)10);
+        }
+        WaitForSingleObject(event, ms);
+        return;
+    }
+
+    // Without the read thread nothing else empties the queue
+    if (m_hThread == NULL) {
+        ReadMessages();
+        ms = std::min(ms, (DWORD)10);
+    }
+
+    // The read thread updates the form with SendMessage, so messages sent
+    // to this thread are handled while waiting or it would stall there
+    if (MsgWaitForMultipleObjects(1, &event, FALSE, ms, QS_SENDMESSAGE) == WAIT_OBJECT_0 + 1) {
+        MSG msg;
+        PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_SENDMESSAGE);
     }
-    
-    LogMessage(L"  ✓ All chunks sent and acknowledged successfully");
-    return PCAN_ERROR_OK;
 }
 
-bool TForm1::WaitForChunkAck(uint32_t baseCanId, int expectedChunk, int timeoutMs) {
-    DWORD startTime = GetTickCount();
-    
-    while ((GetTickCount() - startTime) < timeoutMs) {
-        TPCANMsg receivedMsg;
-        TPCANTimestamp timestamp;
-        TPCANStatus result = m_objPCANBasic->Read(m_PcanHandle, &receivedMsg, &timestamp);
-        
-        if (result == PCAN_ERROR_OK) {
-            // Calculate expected response ID
-            uint32_t responseBaseId = baseCanId + 0xA0;  // Response ID (e.g., 0x407 + 0xA0 = 0x4A7)
-            uint32_t expectedId = responseBaseId | (expectedChunk << 8) | packID;
-            
-            if (receivedMsg.ID == expectedId && receivedMsg.LEN >= 4) {
-                // Verify ACK content
-                uint8_t ackStatus = receivedMsg.DATA[0];
-                uint8_t ackChunk = receivedMsg.DATA[1];
-                uint16_t checksum = (receivedMsg.DATA[2] << 8) | receivedMsg.DATA[3];
-                
-                if (ackStatus == 0x01 && ackChunk == expectedChunk) {
-                    // ACK received with correct chunk number
-                    // Could verify checksum here if needed
-                    LogMessage(String().sprintf(L"    ← ACK received for chunk %d (checksum: 0x%04X)", 
-                              expectedChunk + 1, checksum));
-                    return true;
-                } else if (ackStatus == 0x00) {
-                    // NACK received
-                    LogMessage(String().sprintf(L"    ← NACK received for chunk %d", expectedChunk + 1));
-                    return false; // Will trigger retry
-                }
+DWORD TForm1::NominalBitRate(void) {
+    if (m_IsFD) {
+        // f_clock[_mhz] / (nom_brp * (1 + nom_tseg1 + nom_tseg2)) from the FD bit rate string
+        AnsiString text = AnsiString(txtBitrate->Text);
+        double clock = 0, brp = 0, tseg1 = 0, tseg2 = 0;
+        const char *names[5] = {"f_clock_mhz", "f_clock", "nom_brp", "nom_tseg1", "nom_tseg2"};
+        double *values[5] = {&clock, &clock, &brp, &tseg1, &tseg2};
+
+        for (int i = 0; i < 5; i++) {
+            const char *field = strstr(text.c_str(), names[i]);
+            if (field && field[strlen(names[i])] == '=') {
+                *values[i] = atof(field + strlen(names[i]) + 1);
+                if (i == 0)
+                    clock *= 1000000.0;
             }
-        } else if (result != PCAN_ERROR_QRCVEMPTY) {
-            // Only log non-empty queue errors
-            LogMessage(String().sprintf(L"    CAN read error while waiting for ACK: %s", 
-                      GetFormatedError(result)));
         }
-        
-        Sleep(10); // Small delay to prevent busy waiting
+        if (clock > 0 && brp > 0)
+            return (DWORD)(clock / (brp * (1 + tseg1 + tseg2)));
+        return 500000;
     }
-    
-    LogMessage(String().sprintf(L"    ⏱ Timeout waiting for ACK on chunk %d", expectedChunk + 1));
-    return false; // Timeout
-}
 
-TPCANStatus TForm1::SendComponentIds(void) {
-    // Send pack component ID
-    TPCANStatus result1 = SendKeyData(ID_VCU_WEB4_COMPONENT_IDS, FRegisteredPackId);
-    if (result1 != PCAN_ERROR_OK) {
-        return result1;
+    switch (m_Baudrate) {
+        case PCAN_BAUD_1M:   return 1000000;
+        case PCAN_BAUD_800K: return 800000;
+        case PCAN_BAUD_500K: return 500000;
+        case PCAN_BAUD_250K: return 250000;
+        case PCAN_BAUD_125K: return 125000;
+        case PCAN_BAUD_100K: return 100000;
+        case PCAN_BAUD_95K:  return 95238;
+        case PCAN_BAUD_83K:  return 83333;
+        case PCAN_BAUD_50K:  return 50000;
+        case PCAN_BAUD_47K:  return 47619;
+        case PCAN_BAUD_33K:  return 33333;
+        case PCAN_BAUD_20K:  return 20000;
+        case PCAN_BAUD_10K:  return 10000;
+        case PCAN_BAUD_5K:   return 5000;
+        default:             return 500000;
     }
-    
-    Sleep(10);
-    
-    // Send app component ID with different CAN ID (add 1 to distinguish)
-    TPCANStatus result2 = SendKeyData(ID_VCU_WEB4_COMPONENT_IDS + 1, FRegisteredHostId);
-    
-    return result2;
+}
+
+TPCANStatus TForm1::WriteKeyFrame(TPCANMsgFD &frame) {
+    if (m_IsFD)
+        return m_objPCANBasic->WriteFD(m_PcanHandle, &frame);
+
+    // Classic CAN only ever gets 8 byte chunks
+    TPCANMsg CANMsg = TPCANMsg();
+    CANMsg.ID = frame.ID;
+    CANMsg.MSGTYPE = frame.MSGTYPE;
+    CANMsg.LEN = frame.DLC;
+    memcpy(CANMsg.DATA, frame.DATA, sizeof(CANMsg.DATA));
+    return m_objPCANBasic->Write(m_PcanHandle, &CANMsg);
 }
 //---------------------------------------------------------------------------
 
@@ -11,6 +11,11 @@
 #include <ExtCtrls.hpp>
 #include "PCANBasicClass.h"
 #include "WEB4.h"
+#include "FrameView.h"
+#include "CanDispatch.h"
+#include "KeyTransfer.h"
+#include "Provision.h"
+#include "Web4Task.h"
 
 // Critical Section class for thread-safe menbers access
 //
@@ -52,8 +57,8 @@ private:
     void SetShowingPeriod(bool value);
 
 public:
-    MessageStatus(TPCANMsgFD canMsg,TPCANTimestampFD canTimestamp,int listIndex);
-    void Update(TPCANMsgFD canMsg, TPCANTimestampFD canTimestamp);
+    MessageStatus(const TFrameView &canMsg, int listIndex);
+    void Update(const TFrameView &canMsg);
 
     __property TPCANMsgFD CANMsg = {read = m_Msg};
     __property TPCANTimestampFD Timestamp = {read = m_TimeStamp};
@@ -251,6 +256,8 @@ __published:    // IDE-managed Components
 	TLabel *lblWeb4Status;
 	TProgressBar *web4Progress;
 	TMemo *memoWeb4Log;
+	TLabel *lblProvisionPacks;
+	TEdit *edtProvisionPacks;
     void __fastcall btnHwRefreshClick(TObject *Sender);
     void __fastcall cbbBaudratesChange(TObject *Sender);
     void __fastcall cbbHwTypeChange(TObject *Sender);
@@ -336,6 +343,16 @@ private:    // User declarations
     //
     HANDLE m_hThread;
 
+    // Hands received frames to the code waiting for them before they are decoded
+    //
+    TCanDispatcher m_Dispatcher;
+
+    // TSC cycles spent in the dispatcher and decode handlers, and the frames
+    // they took, reported when the channel is released
+    //
+    unsigned __int64 m_DecodeCycles;
+    DWORD m_DecodeFrames;
+
     // Handles of non plug and play PCAN-Hardware
     //
     TPCANHandle m_NonPnPHandles[9];
@@ -361,54 +378,76 @@ private:    // User declarations
 	//TPCANStatus WriteFrameFD();
     TPCANStatus WriteState();
 
-    void ProcessMessage(TPCANMsgFD theMsg, TPCANTimestampFD itsTimeStamp);
-    void ProcessMessage(TPCANMsg MyMsg, TPCANTimestamp itsTimeStamp);
-    void InsertMsgEntry(TPCANMsgFD NewMsg, TPCANTimestampFD itsTimeStamp);
+    void ProcessMessage(const TFrameView &theMsg);
+    void InsertMsgEntry(const TFrameView &NewMsg);
     void DisplayMessages();
     void IncludeTextMessage(AnsiString strMsg);
     bool GetFilterStatus(int* status);
 
 	//void TransmitState(packState state);
-	void ProcessState(TPCANMsgFD theMsg);
-	void ProcessData1(TPCANMsgFD theMsg);
-	void ProcessData2(TPCANMsgFD theMsg);
-	void ProcessData3(TPCANMsgFD theMsg);
-	void ProcessData4(TPCANMsgFD theMsg);
-	void ProcessData5(TPCANMsgFD theMsg);
-	void ProcessData8(TPCANMsgFD theMsg);
-	void ProcessData9(TPCANMsgFD theMsg);
-	void ProcessData10(TPCANMsgFD theMsg);
+	void ProcessState(const TFrameView &theMsg);
+	void ProcessData1(const TFrameView &theMsg);
+	void ProcessData2(const TFrameView &theMsg);
+	void ProcessData3(const TFrameView &theMsg);
+	void ProcessData4(const TFrameView &theMsg);
+	void ProcessData5(const TFrameView &theMsg);
+	void ProcessData8(const TFrameView &theMsg);
+	void ProcessData9(const TFrameView &theMsg);
+	void ProcessData10(const TFrameView &theMsg);
 	void ProcessTimeRequest(void);
 
-	void ProcessModuleState(TPCANMsgFD theMsg);
-	void ProcessModulePower(TPCANMsgFD theMsg);
-	void ProcessModuleCellVoltage(TPCANMsgFD theMsg);
-	void ProcessModuleCellTemp(TPCANMsgFD theMsg);
-	void ProcessModuleCellId(TPCANMsgFD theMsg);
-	void ProcessModuleLimits(TPCANMsgFD theMsg);
-	void ProcessModuleList(TPCANMsgFD theMsg);
+	void ProcessModuleState(const TFrameView &theMsg);
+	void ProcessModulePower(const TFrameView &theMsg);
+	void ProcessModuleCellVoltage(const TFrameView &theMsg);
+	void ProcessModuleCellTemp(const TFrameView &theMsg);
+	void ProcessModuleCellId(const TFrameView &theMsg);
+	void ProcessModuleLimits(const TFrameView &theMsg);
+	void ProcessModuleList(const TFrameView &theMsg);
 
 
 
-	// Web4 Demo
+	// Web4 Demo; these four may be called from a Web4 task
 	void LogMessage(const String& message);
 	void UpdateStatus(const String& status);
 	void ShowProgress(int position);
+	void NotifyUser(const String& message);
+
+	// Web4 workflows run one at a time on a task thread. The button that
+	// started one cancels it, the other Web4 buttons wait
+	std::unique_ptr<TWeb4Task> FWeb4Task;
+	TButton *FWeb4TaskButton;
+	String FWeb4TaskCaption;
+	void StartWeb4Task(TButton *button, const String& name, TWeb4Task::TBody body);
+	bool CancelWeb4Task(TButton *button);
+	void Web4TaskFinished(void);
+	// Replaces FWeb4Client, the old one is disconnected and gone first
+	void OpenWeb4Client(void);
 
 
 	void RegisterSingleComponent(const System::UnicodeString& componentId, const System::UnicodeString& componentType);
 
     void RegisterSingleComponentDebug(const System::UnicodeString& componentId, const System::UnicodeString& componentType);
+    void StoreRegisteredId(const System::UnicodeString& componentType, const System::UnicodeString& componentId);
+
+    // Registrations waiting in the client's journal, by key
+    void DeferRegistration(const System::UnicodeString& componentId, const System::UnicodeString& componentType);
+    void WriteReplayed(const System::UnicodeString& key, TWeb4Response& response);
+    std::map<System::UnicodeString, System::UnicodeString> FDeferredRegistrations;     // key -> component type
     
     // Web4 integration helper functions
     void StoreWeb4DataInModule(const System::UnicodeString& originalModuleId, const TLctRelationship* lct, const System::UnicodeString& generatedComponentId);
     void StoreWeb4DataInPack(const System::UnicodeString& originalPackId, const TLctRelationship* lct, const System::UnicodeString& generatedComponentId);
     
     // Web4 Key Distribution Functions
-    void DistributeKeysToPackController(void);
-    TPCANStatus SendKeyData(uint32_t canId, const System::UnicodeString& keyData);
-    bool WaitForChunkAck(uint32_t baseCanId, int expectedChunk, int timeoutMs);
-    TPCANStatus SendComponentIds(void);
+    void DistributeKeysToPackController(TWeb4Task *task,
+                                        const System::UnicodeString& appKeyHalf,
+                                        const System::UnicodeString& packKeyHalf,
+                                        const System::UnicodeString& packId,
+                                        const System::UnicodeString& hostId);
+    TProvisionSummary RunProvisioning(TProvisionScheduler &scheduler, TWeb4Task *task);
+    void WaitForKeyAcks(HANDLE event, DWORD ms);
+    DWORD NominalBitRate(void);
+    TPCANStatus WriteKeyFrame(TPCANMsgFD &frame);
 
     std::unique_ptr<TWeb4BridgeClient> FWeb4Client;
 	TWeb4BridgeConfig FConfig;
@@ -16,7 +16,13 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <deque>
 #include <functional>
+#include <future>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 // Compatibility for older compilers
 #ifndef nullptr
@@ -196,8 +202,18 @@ public:
     System::UnicodeString ApiEndpoint;      // API Bridge endpoint
     System::UnicodeString RestPort;         // REST API port
     System::UnicodeString GrpcPort;         // gRPC port (future use)
-    int RequestTimeoutSeconds;
-    int MaxRetryAttempts;
+    int RequestTimeoutSeconds;              // Deadline of writes
+    int ReadTimeoutSeconds;                 // Deadline of reads, retries included
+    std::map<System::UnicodeString, int> EndpointTimeoutSeconds;   // By endpoint prefix, before the two above
+    int MaxRetryAttempts;                   // Retries of a failed read within its deadline
+    int HedgeDelayMs;                       // Reads still running this long get a second copy, 0 for never
+    int MaxConcurrentRequests;              // Keep-alive connections, also the request concurrency
+    int MaxBatchSize;                       // Operations per batch request
+    bool EnableCache;
+    System::UnicodeString CacheFile;        // Where the cache is kept between runs, empty for nowhere
+    int TensorCacheSeconds;
+    int BalanceCacheSeconds;
+    System::UnicodeString JournalFile;      // Writes waiting for the bridge, empty to keep them in memory only
     System::UnicodeString DefaultCreator;   // Default creator account
     bool EnableLogging;
     System::UnicodeString LogLevel;
@@ -217,17 +233,347 @@ public:
     EWeb4Exception(const System::UnicodeString& msg, int code = 0, const System::UnicodeString& type = "");
 };
 
+// ===========================================================================
+// CONNECTION POOL
+// ===========================================================================
+
+// Outcome of one request. Requests run on pool threads hand this back
+// instead of throwing; MakeRequest turns a failure into an EWeb4Exception.
+class TWeb4Response {
+public:
+    int StatusCode;
+    std::unique_ptr<System::Json::TJSONObject> Json;   // Parsed body on success
+    System::UnicodeString ErrorMessage;
+    int ErrorCode;
+    System::UnicodeString ErrorType;        // Empty on success
+
+    TWeb4Response() : StatusCode(0), ErrorCode(0) {}
+    bool Succeeded() const { return ErrorType.IsEmpty(); }
+};
+
+// One keep-alive HTTP connection to the API bridge, one request at a time
+class TWeb4Connection {
+public:
+    std::unique_ptr<Rest::Client::TRESTClient> Client;
+    std::unique_ptr<Rest::Client::TRESTRequest> Request;
+    std::unique_ptr<Rest::Client::TRESTResponse> Response;
+
+    TWeb4Connection(const System::UnicodeString& baseUrl, int timeoutMs);
+};
+
+// Bounded set of connections shared by synchronous and queued requests.
+// Queued requests run on pool threads, at most one per connection.
+class TWeb4ConnectionPool {
+public:
+    typedef std::function<TWeb4Response(TWeb4Connection* connection)> TRunFunc;
+    typedef std::function<void(TWeb4Response& response)> TDoneFunc;
+
+    TWeb4ConnectionPool(const System::UnicodeString& baseUrl, int timeoutMs, int maxConnections);
+    ~TWeb4ConnectionPool();
+
+    // Waits until a connection is free
+    TWeb4Connection* Acquire();
+    void Release(TWeb4Connection* connection);
+
+    // run gets a connection on a pool thread, done follows once the connection
+    // is back. Jobs still queued at shutdown only get done, with an error
+    void Post(TRunFunc run, TDoneFunc done);
+
+    // Stops the pool threads. Afterwards Acquire returns nullptr and Post
+    // only calls done, with an error; connections still held stay valid
+    // until the last reference to the pool goes
+    void Shutdown();
+
+    int Size() const { return static_cast<int>(FConnections.size()); }
+    int Busy();
+    int Queued();
+
+private:
+    struct TJob {
+        TRunFunc Run;
+        TDoneFunc Done;
+    };
+
+    std::vector<std::unique_ptr<TWeb4Connection>> FConnections;
+    std::vector<TWeb4Connection*> FIdle;
+    std::deque<TJob> FJobs;
+    std::vector<std::thread> FWorkers;
+    std::mutex FLock;
+    std::condition_variable FIdleChanged;
+    std::condition_variable FJobsChanged;
+    bool FStopping;
+
+    void WorkerLoop();
+};
+
+// ===========================================================================
+// RESPONSE CACHE
+// ===========================================================================
+
+// Bridge records by type and ID, kept as the JSON the bridge sent.
+// Registrations and LCTs do not change once created and stay until
+// invalidated; tensors and balances expire after their TTL.
+class TWeb4Cache {
+public:
+    enum TKind { ckComponent, ckLct, ckTrustTensor, ckRelationship, ckEnergyBalance, ckKindCount };
+
+    TWeb4Cache();
+
+    void SetTtl(TKind kind, int seconds);   // 0 never expires
+    bool Get(TKind kind, const System::UnicodeString& key, System::UnicodeString& json);
+    // Entries with persist false, e.g. ones holding key halves, never go to disk
+    void Put(TKind kind, const System::UnicodeString& key, const System::UnicodeString& json, bool persist = true);
+    void Invalidate(TKind kind, const System::UnicodeString& key);
+    void InvalidateKind(TKind kind);
+
+    void Load(const System::UnicodeString& path);
+    void Save(const System::UnicodeString& path);
+
+    int Hits() const { return FHits; }
+    int Misses() const { return FMisses; }
+    int Count();
+
+private:
+    struct TEntry {
+        System::UnicodeString Json;
+        __int64 StoredAt;                   // Unix seconds, so entries keep their age on disk
+        bool Persist;
+    };
+
+    std::map<System::UnicodeString, TEntry> FEntries[ckKindCount];
+    int FTtl[ckKindCount];
+    std::mutex FLock;
+    std::atomic<int> FHits;
+    std::atomic<int> FMisses;
+
+    bool Expired(TKind kind, const TEntry& entry, __int64 now) const;
+};
+
+// ===========================================================================
+// WRITE-BEHIND JOURNAL
+// ===========================================================================
+
+// A write waiting for the bridge. Its idempotency key goes with every
+// attempt, so a replay after a lost reply is not applied twice.
+struct TWeb4JournalEntry {
+    System::UnicodeString Key;
+    System::UnicodeString Method;
+    System::UnicodeString Endpoint;
+    System::UnicodeString Body;
+    __int64 CreatedAt;                      // Unix seconds
+};
+
+// Append-only file of writes, one JSON line per write and one per write
+// the bridge has answered. Open keeps the writes without an answer and
+// rewrites the file with just those.
+class TWeb4Journal {
+public:
+    void Open(const System::UnicodeString& path);
+
+    // On disk before it returns; the new entry's idempotency key
+    System::UnicodeString Append(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        const System::UnicodeString& body);
+    void Complete(const System::UnicodeString& key);
+
+    // Oldest first
+    std::vector<TWeb4JournalEntry> Pending(size_t max);
+    int Count();
+
+private:
+    System::UnicodeString FPath;
+    std::deque<TWeb4JournalEntry> FPending;
+    std::mutex FLock;
+
+    static System::UnicodeString EntryLine(const TWeb4JournalEntry& entry);
+    void WriteLine(const System::UnicodeString& line);
+    // Rewrites the file with the pending entries only; FLock held
+    void Compact();
+};
+
+// ===========================================================================
+// LATENCY STATISTICS
+// ===========================================================================
+
+// Recent request latencies by method and endpoint, with IDs in the path
+// folded together so one lookup endpoint is one entry
+class TWeb4LatencyStats {
+public:
+    static System::UnicodeString EndpointKey(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint);
+
+    void Record(const System::UnicodeString& key, double ms);
+    // Over the samples kept for key, 0 with fewer than minSamples
+    double Percentile(const System::UnicodeString& key, double percent, size_t minSamples = 1);
+    // {key: {count, p50_ms, p95_ms, p99_ms, max_ms}}
+    System::Json::TJSONObject* ToJSON();
+
+private:
+    static const size_t MaxSamples = 256;
+
+    struct TSamples {
+        std::vector<double> Ms;             // Ring of the latest MaxSamples
+        size_t Next;
+        __int64 Count;
+        double Max;
+    };
+
+    std::map<System::UnicodeString, TSamples> FEndpoints;
+    std::mutex FLock;
+
+    static double PercentileOf(std::vector<double> ms, double percent);
+};
+
+// One operation of a batch request; Body is serialized JSON, empty for none
+struct TWeb4BatchOperation {
+    System::UnicodeString Method;
+    System::UnicodeString Endpoint;
+    System::UnicodeString Body;
+    System::UnicodeString IdempotencyKey;   // Empty for reads and writes sent only once
+    TWeb4Cache::TKind CacheKind = TWeb4Cache::ckKindCount;  // ckKindCount for reads not cached
+    System::UnicodeString CacheKey;
+    int TimeoutMs = 0;                      // 0 for the endpoint's deadline
+};
+
 // ===========================================================================
 // ENHANCED WEB4 CLIENT WITH API BRIDGE INTEGRATION
 // ===========================================================================
 
 class TWeb4BridgeClient {
+public:
+    // Called on a pool thread, or at once on the caller's when disconnected;
+    // marshal to the UI thread before touching the form
+    typedef std::function<void(TWeb4Response& response)> TResponseHandler;
+    // Called on the replay thread, with the key the deferred call returned
+    typedef std::function<void(const System::UnicodeString& key, TWeb4Response& response)> TReplayHandler;
+
 private:
-    std::unique_ptr<Rest::Client::TRESTClient> FRESTClient;
-    std::unique_ptr<Rest::Client::TRESTRequest> FRESTRequest;
-    std::unique_ptr<Rest::Client::TRESTResponse> FRESTResponse;
+    std::shared_ptr<TWeb4ConnectionPool> FPool;
+    std::mutex FPoolLock;                   // The replay thread uses the pool too
+    bool FPoolClosed;                       // Disconnected, Pool() builds no new one
     TWeb4BridgeConfig FConfig;
     bool FConnected;
+    std::atomic<__int64> FParseTicks;       // Performance counter ticks spent parsing responses
+    std::atomic<__int64> FParsedBytes;
+    TWeb4Cache FCache;
+
+    // The cached record of kind under key, nullptr when there is none
+    template <class T>
+    std::unique_ptr<T> FromCache(TWeb4Cache::TKind kind, const System::UnicodeString& key) {
+        System::UnicodeString json;
+        if (!FConfig.EnableCache || !FCache.Get(kind, key, json)) return nullptr;
+
+        std::unique_ptr<System::Json::TJSONValue> value(System::Json::TJSONObject::ParseJSONValue(json));
+        System::Json::TJSONObject* object = dynamic_cast<System::Json::TJSONObject*>(value.get());
+        if (!object) return nullptr;
+
+        std::unique_ptr<T> record(new T());
+        record->FromJSON(object);
+        return record;
+    }
+    void ToCache(TWeb4Cache::TKind kind, const System::UnicodeString& key,
+                 System::Json::TJSONObject* response, bool persist = true);
+    void InvalidateRelationship(const System::UnicodeString& componentA, const System::UnicodeString& componentB);
+    void ApplyCacheConfig();
+
+    // Write-behind support
+    TWeb4Journal FJournal;
+    std::thread FReplayThread;
+    std::mutex FReplayLock;
+    std::condition_variable FReplayWake;
+    bool FReplayStop;
+    System::UnicodeString DeferWrite(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        System::Json::TJSONObject* data);
+    void StartReplay();
+    void StopReplay();
+    void ReplayLoop();
+    void ReplayApplied(const TWeb4JournalEntry& entry, TWeb4Response& response);
+
+    // Request bodies shared by the immediate and deferred calls
+    System::Json::TJSONObject* RegisterComponentBody(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentData,
+        const System::UnicodeString& context);
+    System::Json::TJSONObject* CreateLctBody(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentA,
+        const System::UnicodeString& componentB,
+        const System::UnicodeString& context);
+    System::Json::TJSONObject* TensorScoreBody(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentA,
+        const System::UnicodeString& componentB,
+        double score,
+        const System::UnicodeString& context);
+
+    // Deadlines, retries and hedging
+    TWeb4LatencyStats FLatency;
+    std::atomic<int> FRetries;
+    std::atomic<int> FHedged;
+    std::atomic<int> FHedgeWins;            // Hedged reads the second copy answered first
+    int DeadlineFor(const System::UnicodeString& method, const System::UnicodeString& endpoint) const;
+    static bool RetryLater(const TWeb4Response& response);
+    TWeb4Response ExecuteOnce(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        const System::UnicodeString& body,
+        int timeoutMs);
+    TWeb4Response ExecuteHedged(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        int timeoutMs);
+
+    // Each request holds its own reference, so Disconnect cannot free the
+    // pool under it; nullptr after Disconnect until Connect or a replay
+    std::shared_ptr<TWeb4ConnectionPool> Pool();
+    void OpenPool();
+    // timeoutMs 0 for the endpoint's deadline
+    TWeb4Response Execute(
+        TWeb4Connection* connection,
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        const System::UnicodeString& body,
+        const System::UnicodeString& idempotencyKey = "",
+        int timeoutMs = 0);
+    static System::UnicodeString RequestBody(
+        const System::UnicodeString& method,
+        System::Json::TJSONObject* data);
+    void PostRequest(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        const System::UnicodeString& body,
+        TResponseHandler handler,
+        const System::UnicodeString& idempotencyKey = "",
+        int timeoutMs = 0);
+
+    // Batch support
+    std::atomic<bool> FBatchUnsupported;    // The bridge has no batch endpoint, call one by one
+    bool SendBatch(const std::vector<TWeb4BatchOperation>& operations, size_t start, size_t count,
+                   std::vector<TWeb4Response>& results);
+    void SendIndividually(const std::vector<TWeb4BatchOperation>& operations, size_t start, size_t count,
+                          std::vector<TWeb4Response>& results);
+    void RetryReads(const std::vector<TWeb4BatchOperation>& operations, std::vector<TWeb4Response>& results,
+                    DWORD started);
+    bool BatchFromCache(const TWeb4BatchOperation& operation, TWeb4Response& response);
+    static TWeb4BatchOperation BatchOperation(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        System::Json::TJSONObject* data = nullptr);
+    static TWeb4BatchOperation CachedRead(
+        const System::UnicodeString& endpoint,
+        TWeb4Cache::TKind kind,
+        const System::UnicodeString& key);
+    static System::UnicodeString RelationshipTensorEndpoint(
+        const System::UnicodeString& componentA,
+        const System::UnicodeString& componentB);
+    static System::UnicodeString AuthorizationCheckEndpoint(
+        const System::UnicodeString& componentA,
+        const System::UnicodeString& componentB,
+        const System::UnicodeString& operationalContext);
 
     // Helper methods
     System::Json::TJSONObject* MakeRequest(
@@ -262,6 +608,56 @@ public:
     System::Json::TJSONObject* CheckHealth();
     System::Json::TJSONObject* CheckDetailedHealth();
 
+    // Queued requests; data is serialized before these return
+    std::future<TWeb4Response> MakeRequestAsync(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        System::Json::TJSONObject* data = nullptr);
+
+    void MakeRequestAsync(
+        const System::UnicodeString& method,
+        const System::UnicodeString& endpoint,
+        System::Json::TJSONObject* data,
+        TResponseHandler handler);
+
+    // Many operations in as few round trips as MaxBatchSize allows, one
+    // result per operation in the same order. Falls back to individual
+    // requests in parallel when the bridge has no batch endpoint. Reads
+    // are retried as MakeRequest retries them, cached reads answered from
+    // and kept in the cache
+    std::vector<TWeb4Response> ExecuteBatch(const std::vector<TWeb4BatchOperation>& operations);
+
+    // ===================================================================
+    // DEFERRED WRITES
+    // ===================================================================
+
+    // The deferred calls put the write in the journal and return its key at
+    // once, whatever the state of the bridge. A replay thread sends what the
+    // journal holds in batches, backing off while the bridge is unreachable,
+    // and hands each answer to OnWriteReplayed. Replay of writes left from an
+    // earlier run starts with Connect, so set the handler before that.
+    TReplayHandler OnWriteReplayed;
+
+    System::UnicodeString RegisterComponentDeferred(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentData,
+        const System::UnicodeString& context = "");
+
+    System::UnicodeString CreateLctDeferred(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentA,
+        const System::UnicodeString& componentB,
+        const System::UnicodeString& context);
+
+    System::UnicodeString UpdateTensorScoreDeferred(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentA,
+        const System::UnicodeString& componentB,
+        double score,
+        const System::UnicodeString& context = "");
+
+    int PendingWrites() { return FJournal.Count(); }
+
     // ===================================================================
     // COMPONENT REGISTRY OPERATIONS
     // ===================================================================
@@ -271,6 +667,12 @@ public:
         const System::UnicodeString& componentData,
         const System::UnicodeString& context = "");
 
+    // Registrations started together overlap their round trips
+    std::future<std::unique_ptr<TComponentRegistration>> RegisterComponentAsync(
+        const System::UnicodeString& creator,
+        const System::UnicodeString& componentData,
+        const System::UnicodeString& context = "");
+
     std::unique_ptr<TComponentRegistration> GetComponent(
         const System::UnicodeString& componentId);
 
@@ -0,0 +1,73 @@
+//---------------------------------------------------------------------------
+
+#include <vcl.h>
+#pragma hdrstop
+
+#include "Web4Task.h"
+
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+TWeb4Task::TWeb4Task(const System::UnicodeString &name, TBody body, TFinishedFunc finished)
+    : m_Name(name), m_Body(body), m_Finished(finished)
+{
+    m_Cancelled = false;
+    m_Running = false;
+    m_Stopped = false;
+    m_Error = "";
+}
+//---------------------------------------------------------------------------
+
+TWeb4Task::~TWeb4Task()
+{
+    Cancel();
+
+    // The body may be waiting in Synchronize for this thread
+    while (m_Running)
+        CheckSynchronize(10);
+    if (m_Thread.joinable())
+        m_Thread.join();
+}
+//---------------------------------------------------------------------------
+
+void TWeb4Task::Start()
+{
+    m_Running = true;
+    m_Thread = std::thread(&TWeb4Task::Run, this);
+}
+//---------------------------------------------------------------------------
+
+void TWeb4Task::Checkpoint()
+{
+    if (m_Cancelled)
+        throw EAbort("Cancelled");
+}
+//---------------------------------------------------------------------------
+
+void TWeb4Task::Run()
+{
+    try
+    {
+        m_Body(*this);
+    }
+    catch (const EAbort &)
+    {
+        m_Stopped = true;
+    }
+    catch (const Exception &e)
+    {
+        m_Error = e.Message;
+    }
+    catch (...)
+    {
+        m_Error = "unknown exception";
+    }
+
+    // Nothing of this object is used once m_Running is clear, the
+    // destructor may run from then on
+    TFinishedFunc finished = m_Finished;
+    m_Running = false;
+    if (finished)
+        TThread::Queue(nullptr, [finished]() { finished(); });
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------
+//  Web4Task.h
+//
+//  Web4 workflows run off the VCL thread.
+//
+//  The body runs on a thread of its own with the inputs it was given, so
+//  the CAN display and the receive path keep going while it waits on the
+//  bridge or on key ACKs. It must not touch controls itself; what it reports
+//  goes through the form's own thread-safe helpers. Cancel only sets a
+//  flag: the body stops at its next Checkpoint, a request in progress ends
+//  within its deadline. Finished is queued to the VCL thread once the body
+//  has returned.
+//---------------------------------------------------------------------------
+
+#ifndef Web4TaskH
+#define Web4TaskH
+
+#include <System.Classes.hpp>
+#include <System.SysUtils.hpp>
+#include <functional>
+#include <thread>
+#include <atomic>
+
+//---------------------------------------------------------------------------
+class TWeb4Task
+{
+public:
+    typedef std::function<void(TWeb4Task &task)> TBody;
+    typedef std::function<void()> TFinishedFunc;
+
+    TWeb4Task(const System::UnicodeString &name, TBody body, TFinishedFunc finished);
+    // Cancels and waits for the body; call on the VCL thread
+    ~TWeb4Task();
+
+    void Start();
+    void Cancel() { m_Cancelled = true; }
+
+    // From the body, throws EAbort once cancelled
+    void Checkpoint();
+
+    const System::UnicodeString &Name() const { return m_Name; }
+    bool Cancelled() const { return m_Cancelled; }
+    bool Running() const { return m_Running; }
+    // The body returned early because of Cancel
+    bool Stopped() const { return m_Stopped; }
+    // Message of the exception that ended the body, empty if none did
+    const System::UnicodeString &Error() const { return m_Error; }
+
+private:
+    System::UnicodeString m_Name;
+    TBody m_Body;
+    TFinishedFunc m_Finished;
+    std::thread m_Thread;
+    std::atomic<bool> m_Cancelled;
+    std::atomic<bool> m_Running;
+    bool m_Stopped;
+    System::UnicodeString m_Error;
+
+    void Run();
+};
+//---------------------------------------------------------------------------
+#endif
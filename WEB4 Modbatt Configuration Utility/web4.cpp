@@ -10,6 +10,8 @@
 #include <System.IOUtils.hpp>
 #include <Windows.hpp>
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 
 // ===========================================================================
 // HELPER FUNCTIONS AND CONSTANTS
@@ -320,7 +322,17 @@ TWeb4BridgeConfig::TWeb4BridgeConfig() {
     RestPort = "8082";
     GrpcPort = "9090";
     RequestTimeoutSeconds = 30;
+    ReadTimeoutSeconds = 5;
+    EndpointTimeoutSeconds["/health"] = 3;
     MaxRetryAttempts = 3;
+    HedgeDelayMs = 0;
+    MaxConcurrentRequests = 4;
+    MaxBatchSize = 100;
+    EnableCache = true;
+    CacheFile = System::Sysutils::ExtractFilePath(System::ParamStr(0)) + "web4_cache.json";
+    TensorCacheSeconds = 10;
+    BalanceCacheSeconds = 5;
+    JournalFile = System::Sysutils::ExtractFilePath(System::ParamStr(0)) + "web4_journal.jsonl";
     DefaultCreator = "alice";  // Default demo account
     EnableLogging = true;
     LogLevel = "info";
@@ -336,7 +348,24 @@ void TWeb4BridgeConfig::LoadFromFile(const System::UnicodeString& configPath) {
         RestPort = ini->ReadString("server", "rest_port", RestPort);
         GrpcPort = ini->ReadString("server", "grpc_port", GrpcPort);
         RequestTimeoutSeconds = ini->ReadInteger("server", "timeout", RequestTimeoutSeconds);
+        ReadTimeoutSeconds = ini->ReadInteger("server", "read_timeout", ReadTimeoutSeconds);
         MaxRetryAttempts = ini->ReadInteger("server", "max_retries", MaxRetryAttempts);
+        HedgeDelayMs = ini->ReadInteger("server", "hedge_delay_ms", HedgeDelayMs);
+        MaxConcurrentRequests = ini->ReadInteger("server", "max_concurrent", MaxConcurrentRequests);
+        MaxBatchSize = ini->ReadInteger("server", "max_batch", MaxBatchSize);
+        EnableCache = ini->ReadBool("cache", "enabled", EnableCache);
+        CacheFile = ini->ReadString("cache", "file", CacheFile);
+        TensorCacheSeconds = ini->ReadInteger("cache", "tensor_ttl", TensorCacheSeconds);
+        BalanceCacheSeconds = ini->ReadInteger("cache", "balance_ttl", BalanceCacheSeconds);
+        JournalFile = ini->ReadString("journal", "file", JournalFile);
+
+        // Endpoint prefix = seconds
+        std::unique_ptr<System::Classes::TStringList> prefixes(new System::Classes::TStringList());
+        ini->ReadSection("deadlines", prefixes.get());
+        for (int i = 0; i < prefixes->Count; i++) {
+            EndpointTimeoutSeconds[prefixes->Strings[i]] = ini->ReadInteger("deadlines", prefixes->Strings[i], 0);
+        }
+
         DefaultCreator = ini->ReadString("client", "default_creator", DefaultCreator);
         EnableLogging = ini->ReadBool("logging", "enabled", EnableLogging);
         LogLevel = ini->ReadString("logging", "level", LogLevel);
@@ -354,7 +383,19 @@ void TWeb4BridgeConfig::SaveToFile(const System::UnicodeString& configPath) {
         ini->WriteString("server", "rest_port", RestPort);
         ini->WriteString("server", "grpc_port", GrpcPort);
         ini->WriteInteger("server", "timeout", RequestTimeoutSeconds);
+        ini->WriteInteger("server", "read_timeout", ReadTimeoutSeconds);
         ini->WriteInteger("server", "max_retries", MaxRetryAttempts);
+        ini->WriteInteger("server", "hedge_delay_ms", HedgeDelayMs);
+        ini->WriteInteger("server", "max_concurrent", MaxConcurrentRequests);
+        ini->WriteInteger("server", "max_batch", MaxBatchSize);
+        ini->WriteBool("cache", "enabled", EnableCache);
+        ini->WriteString("cache", "file", CacheFile);
+        ini->WriteInteger("cache", "tensor_ttl", TensorCacheSeconds);
+        ini->WriteInteger("cache", "balance_ttl", BalanceCacheSeconds);
+        ini->WriteString("journal", "file", JournalFile);
+        for (const auto& item : EndpointTimeoutSeconds) {
+            ini->WriteInteger("deadlines", item.first, item.second);
+        }
         ini->WriteString("client", "default_creator", DefaultCreator);
         ini->WriteBool("logging", "enabled", EnableLogging);
         ini->WriteString("logging", "level", LogLevel);
@@ -376,223 +417,1429 @@ void TWeb4BridgeConfig::LoadFromEnvironment() {
     envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_GRPC_PORT");
     if (!envValue.IsEmpty()) GrpcPort = envValue;
 
-    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_TIMEOUT");
-    if (!envValue.IsEmpty()) RequestTimeoutSeconds = System::Sysutils::StrToIntDef(envValue, RequestTimeoutSeconds);
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_TIMEOUT");
+    if (!envValue.IsEmpty()) RequestTimeoutSeconds = System::Sysutils::StrToIntDef(envValue, RequestTimeoutSeconds);
+
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_READ_TIMEOUT");
+    if (!envValue.IsEmpty()) ReadTimeoutSeconds = System::Sysutils::StrToIntDef(envValue, ReadTimeoutSeconds);
+
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_MAX_RETRIES");
+    if (!envValue.IsEmpty()) MaxRetryAttempts = System::Sysutils::StrToIntDef(envValue, MaxRetryAttempts);
+
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_HEDGE_DELAY_MS");
+    if (!envValue.IsEmpty()) HedgeDelayMs = System::Sysutils::StrToIntDef(envValue, HedgeDelayMs);
+
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_MAX_CONCURRENT");
+    if (!envValue.IsEmpty()) MaxConcurrentRequests = System::Sysutils::StrToIntDef(envValue, MaxConcurrentRequests);
+
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_MAX_BATCH");
+    if (!envValue.IsEmpty()) MaxBatchSize = System::Sysutils::StrToIntDef(envValue, MaxBatchSize);
+
+    envValue = System::Sysutils::GetEnvironmentVariable("WEB4_DEFAULT_CREATOR");
+    if (!envValue.IsEmpty()) DefaultCreator = envValue;
+
+    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_LOG_LEVEL");
+    if (!envValue.IsEmpty()) LogLevel = envValue;
+}
+
+// ===========================================================================
+// RESPONSE CACHE IMPLEMENTATION
+// ===========================================================================
+
+TWeb4Cache::TWeb4Cache() :
+    FHits(0),
+    FMisses(0) {
+
+    for (int kind = 0; kind < ckKindCount; kind++) {
+        FTtl[kind] = 0;
+    }
+}
+
+void TWeb4Cache::SetTtl(TKind kind, int seconds) {
+    std::lock_guard<std::mutex> lock(FLock);
+    FTtl[kind] = std::max(0, seconds);
+}
+
+bool TWeb4Cache::Expired(TKind kind, const TEntry& entry, __int64 now) const {
+    return FTtl[kind] > 0 && now - entry.StoredAt >= FTtl[kind];
+}
+
+bool TWeb4Cache::Get(TKind kind, const System::UnicodeString& key, System::UnicodeString& json) {
+    std::lock_guard<std::mutex> lock(FLock);
+    auto found = FEntries[kind].find(key);
+
+    if (found != FEntries[kind].end()) {
+        if (!Expired(kind, found->second, MyDateTimeToUnix(System::Sysutils::Now()))) {
+            json = found->second.Json;
+            FHits++;
+            return true;
+        }
+        FEntries[kind].erase(found);
+    }
+
+    FMisses++;
+    return false;
+}
+
+void TWeb4Cache::Put(TKind kind, const System::UnicodeString& key, const System::UnicodeString& json, bool persist) {
+    std::lock_guard<std::mutex> lock(FLock);
+    TEntry& entry = FEntries[kind][key];
+
+    entry.Json = json;
+    entry.StoredAt = MyDateTimeToUnix(System::Sysutils::Now());
+    entry.Persist = persist;
+}
+
+void TWeb4Cache::Invalidate(TKind kind, const System::UnicodeString& key) {
+    std::lock_guard<std::mutex> lock(FLock);
+    FEntries[kind].erase(key);
+}
+
+void TWeb4Cache::InvalidateKind(TKind kind) {
+    std::lock_guard<std::mutex> lock(FLock);
+    FEntries[kind].clear();
+}
+
+int TWeb4Cache::Count() {
+    std::lock_guard<std::mutex> lock(FLock);
+    size_t count = 0;
+
+    for (int kind = 0; kind < ckKindCount; kind++) {
+        count += FEntries[kind].size();
+    }
+    return static_cast<int>(count);
+}
+
+void TWeb4Cache::Load(const System::UnicodeString& path) {
+    if (path.IsEmpty() || !System::Ioutils::TFile::Exists(path)) return;
+
+    try {
+        std::unique_ptr<System::Json::TJSONValue> value(
+            System::Json::TJSONObject::ParseJSONValue(System::Ioutils::TFile::ReadAllText(path)));
+        System::Json::TJSONObject* root = dynamic_cast<System::Json::TJSONObject*>(value.get());
+        System::Json::TJSONArray* entries = root ?
+            dynamic_cast<System::Json::TJSONArray*>(root->GetValue("entries")) : nullptr;
+        if (!entries) return;
+
+        std::lock_guard<std::mutex> lock(FLock);
+        __int64 now = MyDateTimeToUnix(System::Sysutils::Now());
+
+        for (int i = 0; i < entries->Count; i++) {
+            System::Json::TJSONObject* item = dynamic_cast<System::Json::TJSONObject*>(entries->Items[i]);
+            if (!item) continue;
+
+            int kind = static_cast<int>(TWeb4Utils::SafeJsonInt64(item->GetValue("kind"), -1));
+            if (kind < 0 || kind >= ckKindCount) continue;
+
+            TEntry entry;
+            entry.Json = TWeb4Utils::SafeJsonString(item->GetValue("json"));
+            entry.StoredAt = TWeb4Utils::SafeJsonInt64(item->GetValue("stored_at"));
+            entry.Persist = true;
+            if (!Expired(static_cast<TKind>(kind), entry, now)) {
+                FEntries[kind][TWeb4Utils::SafeJsonString(item->GetValue("key"))] = entry;
+            }
+        }
+    }
+    catch (...) {
+        // A damaged cache file only means a cold start
+    }
+}
+
+void TWeb4Cache::Save(const System::UnicodeString& path) {
+    if (path.IsEmpty()) return;
+
+    try {
+        std::unique_ptr<System::Json::TJSONObject> root(TWeb4Utils::CreateRequestBody());
+        System::Json::TJSONArray* entries = new System::Json::TJSONArray();
+        root->AddPair("entries", entries);
+
+        {
+            std::lock_guard<std::mutex> lock(FLock);
+            __int64 now = MyDateTimeToUnix(System::Sysutils::Now());
+
+            for (int kind = 0; kind < ckKindCount; kind++) {
+                for (const auto& item : FEntries[kind]) {
+                    if (!item.second.Persist || Expired(static_cast<TKind>(kind), item.second, now)) continue;
+
+                    System::Json::TJSONObject* entry = TWeb4Utils::CreateRequestBody();
+                    TWeb4Utils::AddNumberField(entry, "kind", kind);
+                    TWeb4Utils::AddStringField(entry, "key", item.first);
+                    TWeb4Utils::AddStringField(entry, "stored_at", System::Sysutils::IntToStr(item.second.StoredAt));
+                    TWeb4Utils::AddStringField(entry, "json", item.second.Json);
+                    entries->AddElement(entry);
+                }
+            }
+        }
+
+        System::Ioutils::TFile::WriteAllText(path, root->ToJSON());
+    }
+    catch (...) {
+        // Not saving the cache only costs the next start its warm entries
+    }
+}
+
+// ===========================================================================
+// WRITE-BEHIND JOURNAL IMPLEMENTATION
+// ===========================================================================
+
+System::UnicodeString TWeb4Journal::EntryLine(const TWeb4JournalEntry& entry) {
+    std::unique_ptr<System::Json::TJSONObject> line(TWeb4Utils::CreateRequestBody());
+
+    TWeb4Utils::AddStringField(line.get(), "op", "write");
+    TWeb4Utils::AddStringField(line.get(), "key", entry.Key);
+    TWeb4Utils::AddStringField(line.get(), "method", entry.Method);
+    TWeb4Utils::AddStringField(line.get(), "endpoint", entry.Endpoint);
+    TWeb4Utils::AddStringField(line.get(), "body", entry.Body);
+    TWeb4Utils::AddStringField(line.get(), "created_at", System::Sysutils::IntToStr(entry.CreatedAt));
+    return line->ToJSON();
+}
+
+void TWeb4Journal::WriteLine(const System::UnicodeString& line) {
+    if (FPath.IsEmpty()) return;
+
+    try {
+        System::Sysutils::TBytes bytes = System::Sysutils::TEncoding::UTF8->GetBytes(line + "\n");
+        std::unique_ptr<System::Classes::TFileStream> stream(new System::Classes::TFileStream(FPath,
+            System::Ioutils::TFile::Exists(FPath) ? (fmOpenWrite | fmShareDenyWrite) : fmCreate));
+
+        stream->Seek(static_cast<__int64>(0), System::Classes::soEnd);
+        stream->WriteBuffer(&bytes[0], bytes.Length);
+        FlushFileBuffers(reinterpret_cast<HANDLE>(stream->Handle));
+    }
+    catch (...) {
+        // The entry is still replayed from memory, it only would not survive a restart
+    }
+}
+
+void TWeb4Journal::Open(const System::UnicodeString& path) {
+    std::lock_guard<std::mutex> lock(FLock);
+
+    FPath = path;
+    FPending.clear();
+    if (path.IsEmpty() || !System::Ioutils::TFile::Exists(path)) return;
+
+    try {
+        System::DynamicArray<System::UnicodeString> lines = System::Ioutils::TFile::ReadAllLines(path);
+        std::map<System::UnicodeString, bool> answered;
+        std::vector<TWeb4JournalEntry> written;
+
+        for (int i = 0; i < lines.Length; i++) {
+            std::unique_ptr<System::Json::TJSONValue> value(System::Json::TJSONObject::ParseJSONValue(lines[i]));
+            System::Json::TJSONObject* line = dynamic_cast<System::Json::TJSONObject*>(value.get());
+            if (!line) continue;   // e.g. a line cut short by a crash
+
+            System::UnicodeString op = TWeb4Utils::SafeJsonString(line->GetValue("op"));
+            System::UnicodeString key = TWeb4Utils::SafeJsonString(line->GetValue("key"));
+            if (op == "done") {
+                answered[key] = true;
+            } else if (op == "write" && !key.IsEmpty()) {
+                TWeb4JournalEntry entry;
+                entry.Key = key;
+                entry.Method = TWeb4Utils::SafeJsonString(line->GetValue("method"));
+                entry.Endpoint = TWeb4Utils::SafeJsonString(line->GetValue("endpoint"));
+                entry.Body = TWeb4Utils::SafeJsonString(line->GetValue("body"));
+                entry.CreatedAt = TWeb4Utils::SafeJsonInt64(line->GetValue("created_at"));
+                written.push_back(entry);
+            }
+        }
+
+        for (const auto& entry : written) {
+            if (answered.count(entry.Key)) continue;
+            FPending.push_back(entry);
+        }
+        Compact();
+    }
+    catch (...) {
+        // What was read so far is replayed, the file is left as it was
+    }
+}
+
+void TWeb4Journal::Compact() {
+    if (FPath.IsEmpty()) return;
+
+    System::UnicodeString text;
+    for (const auto& entry : FPending) {
+        text += EntryLine(entry) + "\n";
+    }
+
+    // Written next to the journal and swapped in, so a crash leaves one or the other
+    System::UnicodeString compacted = FPath + ".tmp";
+    System::Ioutils::TFile::WriteAllText(compacted, text);
+    MoveFileExW(compacted.c_str(), FPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+}
+
+System::UnicodeString TWeb4Journal::Append(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    const System::UnicodeString& body) {
+
+    System::TGUID guid;
+    System::Sysutils::CreateGUID(guid);
+
+    TWeb4JournalEntry entry;
+    entry.Key = System::Sysutils::GUIDToString(guid).SubString(2, 36).LowerCase();
+    entry.Method = method;
+    entry.Endpoint = endpoint;
+    entry.Body = body;
+    entry.CreatedAt = MyDateTimeToUnix(System::Sysutils::Now());
+
+    std::lock_guard<std::mutex> lock(FLock);
+    WriteLine(EntryLine(entry));
+    FPending.push_back(entry);
+    return entry.Key;
+}
+
+void TWeb4Journal::Complete(const System::UnicodeString& key) {
+    std::lock_guard<std::mutex> lock(FLock);
+
+    for (auto it = FPending.begin(); it != FPending.end(); ++it) {
+        if (it->Key == key) {
+            FPending.erase(it);
+            break;
+        }
+    }
+
+    if (FPending.empty() && !FPath.IsEmpty()) {
+        // Nothing left to replay, the file starts over. Swapped for an empty
+        // one rather than deleted, the path stays the journal's
+        try {
+            Compact();
+            return;
+        }
+        catch (...) {
+            // Falls back to the done line below
+        }
+    }
+
+    std::unique_ptr<System::Json::TJSONObject> line(TWeb4Utils::CreateRequestBody());
+    TWeb4Utils::AddStringField(line.get(), "op", "done");
+    TWeb4Utils::AddStringField(line.get(), "key", key);
+    WriteLine(line->ToJSON());
+}
+
+std::vector<TWeb4JournalEntry> TWeb4Journal::Pending(size_t max) {
+    std::lock_guard<std::mutex> lock(FLock);
+    size_t count = std::min(max, FPending.size());
+
+    return std::vector<TWeb4JournalEntry>(FPending.begin(), FPending.begin() + count);
+}
+
+int TWeb4Journal::Count() {
+    std::lock_guard<std::mutex> lock(FLock);
+    return static_cast<int>(FPending.size());
+}
+
+// ===========================================================================
+// LATENCY STATISTICS IMPLEMENTATION
+// ===========================================================================
+
+System::UnicodeString TWeb4LatencyStats::EndpointKey(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint) {
+
+    System::UnicodeString path = endpoint;
+    int query = path.Pos("?");
+    if (query > 0) {
+        path = path.SubString(1, query - 1);
+    }
+
+    // Segments with digits are IDs, apart from the version
+    System::UnicodeString key = method + " ";
+    int start = 1;
+    while (start <= path.Length()) {
+        int end = start;
+        while (end <= path.Length() && path[end] != '/') end++;
+
+        System::UnicodeString segment = path.SubString(start, end - start);
+        bool digits = false;
+        bool version = segment.Length() > 1 && segment[1] == 'v';
+        for (int i = 1; i <= segment.Length(); i++) {
+            bool digit = segment[i] >= '0' && segment[i] <= '9';
+            digits = digits || digit;
+            version = version && (i == 1 || digit);
+        }
+        key += (digits && !version) ? System::UnicodeString("{id}") : segment;
+        if (end <= path.Length()) key += "/";
+        start = end + 1;
+    }
+    return key;
+}
+
+void TWeb4LatencyStats::Record(const System::UnicodeString& key, double ms) {
+    std::lock_guard<std::mutex> lock(FLock);
+    auto found = FEndpoints.find(key);
+
+    if (found == FEndpoints.end()) {
+        TSamples samples;
+        samples.Next = 0;
+        samples.Count = 0;
+        samples.Max = 0.0;
+        found = FEndpoints.insert(std::make_pair(key, samples)).first;
+    }
+
+    TSamples& samples = found->second;
+    if (samples.Ms.size() < MaxSamples) {
+        samples.Ms.push_back(ms);
+    } else {
+        samples.Ms[samples.Next] = ms;
+    }
+    samples.Next = (samples.Next + 1) % MaxSamples;
+    samples.Count++;
+    samples.Max = std::max(samples.Max, ms);
+}
+
+double TWeb4LatencyStats::PercentileOf(std::vector<double> ms, double percent) {
+    if (ms.empty()) return 0.0;
+
+    // Nearest rank
+    size_t rank = static_cast<size_t>(percent / 100.0 * ms.size() + 0.999999);
+    size_t index = std::min(ms.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(ms.begin(), ms.begin() + index, ms.end());
+    return ms[index];
+}
+
+double TWeb4LatencyStats::Percentile(const System::UnicodeString& key, double percent, size_t minSamples) {
+    std::lock_guard<std::mutex> lock(FLock);
+    auto found = FEndpoints.find(key);
+
+    if (found == FEndpoints.end() || found->second.Ms.size() < std::max<size_t>(1, minSamples)) {
+        return 0.0;
+    }
+    return PercentileOf(found->second.Ms, percent);
+}
+
+System::Json::TJSONObject* TWeb4LatencyStats::ToJSON() {
+    System::Json::TJSONObject* json = TWeb4Utils::CreateRequestBody();
+    std::lock_guard<std::mutex> lock(FLock);
+
+    for (const auto& item : FEndpoints) {
+        System::Json::TJSONObject* endpoint = TWeb4Utils::CreateRequestBody();
+        TWeb4Utils::AddNumberField(endpoint, "count", static_cast<double>(item.second.Count));
+        TWeb4Utils::AddNumberField(endpoint, "p50_ms", PercentileOf(item.second.Ms, 50.0));
+        TWeb4Utils::AddNumberField(endpoint, "p95_ms", PercentileOf(item.second.Ms, 95.0));
+        TWeb4Utils::AddNumberField(endpoint, "p99_ms", PercentileOf(item.second.Ms, 99.0));
+        TWeb4Utils::AddNumberField(endpoint, "max_ms", item.second.Max);
+        json->AddPair(item.first, endpoint);
+    }
+    return json;
+}
+
+// ===========================================================================
+// CONNECTION POOL IMPLEMENTATION
+// ===========================================================================
+
+TWeb4Connection::TWeb4Connection(const System::UnicodeString& baseUrl, int timeoutMs) {
+    Client.reset(new Rest::Client::TRESTClient(nullptr));
+    Request.reset(new Rest::Client::TRESTRequest(nullptr));
+    Response.reset(new Rest::Client::TRESTResponse(nullptr));
+
+    Request->Client = Client.get();
+    Request->Response = Response.get();
+
+    // Pool threads must not wait for the main thread to run REST events
+    Client->SynchronizedEvents = false;
+    Request->SynchronizedEvents = false;
+
+    // Set once so the underlying HTTP connection stays open between requests
+    Client->BaseURL = baseUrl;
+    Client->AddParameter("Connection", "keep-alive", Rest::Types::pkHTTPHEADER);
+    Client->ConnectTimeout = timeoutMs;
+    Client->ReadTimeout = timeoutMs;
+}
+
+TWeb4ConnectionPool::TWeb4ConnectionPool(const System::UnicodeString& baseUrl, int timeoutMs, int maxConnections) :
+    FStopping(false) {
+
+    for (int i = 0; i < std::max(1, maxConnections); i++) {
+        FConnections.push_back(std::unique_ptr<TWeb4Connection>(new TWeb4Connection(baseUrl, timeoutMs)));
+        FIdle.push_back(FConnections.back().get());
+    }
+}
+
+static TWeb4Response DisconnectedResponse() {
+    TWeb4Response response;
+    response.ErrorMessage = "Client disconnected";
+    response.ErrorType = "DISCONNECTED";
+    return response;
+}
+
+TWeb4ConnectionPool::~TWeb4ConnectionPool() {
+    Shutdown();
+}
+
+void TWeb4ConnectionPool::Shutdown() {
+    std::vector<std::thread> workers;
+    std::deque<TJob> jobs;
+    {
+        std::lock_guard<std::mutex> lock(FLock);
+        FStopping = true;
+        workers.swap(FWorkers);
+        jobs.swap(FJobs);
+    }
+    FJobsChanged.notify_all();
+    FIdleChanged.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Nobody runs what is left, but whoever waits on it must hear so
+    for (auto& job : jobs) {
+        TWeb4Response response = DisconnectedResponse();
+        try {
+            job.Done(response);
+        }
+        catch (...) {
+        }
+    }
+}
+
+TWeb4Connection* TWeb4ConnectionPool::Acquire() {
+    std::unique_lock<std::mutex> lock(FLock);
+    FIdleChanged.wait(lock, [this] { return !FIdle.empty() || FStopping; });
+    if (FStopping) {
+        return nullptr;
+    }
+
+    TWeb4Connection* connection = FIdle.back();
+    FIdle.pop_back();
+    return connection;
+}
+
+void TWeb4ConnectionPool::Release(TWeb4Connection* connection) {
+    {
+        std::lock_guard<std::mutex> lock(FLock);
+        FIdle.push_back(connection);
+    }
+    FIdleChanged.notify_one();
+}
+
+void TWeb4ConnectionPool::Post(TRunFunc run, TDoneFunc done) {
+    {
+        std::lock_guard<std::mutex> lock(FLock);
+        if (!FStopping) {
+            FJobs.push_back(TJob{run, done});
+
+            // Threads start as the queue first needs them, never more than connections
+            if (FWorkers.size() < FConnections.size()) {
+                FWorkers.push_back(std::thread(&TWeb4ConnectionPool::WorkerLoop, this));
+            }
+            FJobsChanged.notify_one();
+            return;
+        }
+    }
+
+    TWeb4Response response = DisconnectedResponse();
+    try {
+        done(response);
+    }
+    catch (...) {
+    }
+}
+
+int TWeb4ConnectionPool::Busy() {
+    std::lock_guard<std::mutex> lock(FLock);
+    return static_cast<int>(FConnections.size() - FIdle.size());
+}
+
+int TWeb4ConnectionPool::Queued() {
+    std::lock_guard<std::mutex> lock(FLock);
+    return static_cast<int>(FJobs.size());
+}
+
+void TWeb4ConnectionPool::WorkerLoop() {
+    while (true) {
+        TJob job;
+        {
+            std::unique_lock<std::mutex> lock(FLock);
+            FJobsChanged.wait(lock, [this] { return !FJobs.empty() || FStopping; });
+            if (FStopping) {
+                return;
+            }
+            job = FJobs.front();
+            FJobs.pop_front();
+        }
+
+        TWeb4Connection* connection = Acquire();
+        TWeb4Response response;
+        if (connection) {
+            response = job.Run(connection);
+            Release(connection);
+        } else {
+            response = DisconnectedResponse();
+        }
+
+        try {
+            job.Done(response);
+        }
+        catch (...) {
+            // A failing handler must not take the pool thread with it
+        }
+    }
+}
+
+     // ===========================================================================
+// MAIN CLIENT IMPLEMENTATION
+// ===========================================================================
+
+TWeb4BridgeClient::TWeb4BridgeClient(const TWeb4BridgeConfig& config) :
+    FPoolClosed(false),
+    FConfig(config),
+    FConnected(false),
+    FParseTicks(0),
+    FParsedBytes(0),
+    FReplayStop(false),
+    FRetries(0),
+    FHedged(0),
+    FHedgeWins(0),
+    FBatchUnsupported(false) {
+
+    ApplyCacheConfig();
+    if (FConfig.EnableCache) {
+        FCache.Load(FConfig.CacheFile);
+    }
+    FJournal.Open(FConfig.JournalFile);
+}
+
+TWeb4BridgeClient::~TWeb4BridgeClient() {
+    Disconnect();
+    if (FConfig.EnableCache) {
+        FCache.Save(FConfig.CacheFile);
+    }
+}
+
+void TWeb4BridgeClient::ApplyCacheConfig() {
+    FCache.SetTtl(TWeb4Cache::ckComponent, 0);
+    FCache.SetTtl(TWeb4Cache::ckLct, 0);
+    FCache.SetTtl(TWeb4Cache::ckTrustTensor, FConfig.TensorCacheSeconds);
+    FCache.SetTtl(TWeb4Cache::ckRelationship, FConfig.TensorCacheSeconds);
+    FCache.SetTtl(TWeb4Cache::ckEnergyBalance, FConfig.BalanceCacheSeconds);
+}
+
+void TWeb4BridgeClient::InvalidateRelationship(const System::UnicodeString& componentA,
+                                               const System::UnicodeString& componentB) {
+    // The tensor may have been looked up either way round; its ID is not known
+    // here, so tensors by ID go too
+    FCache.Invalidate(TWeb4Cache::ckRelationship, componentA + "|" + componentB);
+    FCache.Invalidate(TWeb4Cache::ckRelationship, componentB + "|" + componentA);
+    FCache.InvalidateKind(TWeb4Cache::ckTrustTensor);
+}
+
+void TWeb4BridgeClient::ToCache(TWeb4Cache::TKind kind, const System::UnicodeString& key,
+                                System::Json::TJSONObject* response, bool persist) {
+    if (FConfig.EnableCache && response && !key.IsEmpty()) {
+        FCache.Put(kind, key, response->ToJSON(), persist);
+    }
+}
+
+bool TWeb4BridgeClient::Connect() {
+    OpenPool();
+
+    // Writes journaled earlier go out once the bridge answers, now or later
+    if (FJournal.Count() > 0) {
+        StartReplay();
+    }
+
+    try {
+        // Test connection with health check
+        System::Json::TJSONObject* healthResponse = CheckHealth();
+        if (healthResponse) {
+            FConnected = true;
+            delete healthResponse;
+            return true;
+        }
+
+        FConnected = false;
+        return false;
+    }
+    catch (const System::Sysutils::Exception& e) {
+        HandleError("Connect", e);
+        FConnected = false;
+        return false;
+    }
+}
+
+void TWeb4BridgeClient::Disconnect() {
+try {
+        FConnected = false;
+        // The replay thread must be done with the pool before it goes
+        StopReplay();
+
+        std::shared_ptr<TWeb4ConnectionPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(FPoolLock);
+            FPoolClosed = true;
+            pool.swap(FPool);
+        }
+        // Queued requests fail; ones in progress keep the pool until they end
+        if (pool) {
+            pool->Shutdown();
+        }
+    }
+    catch (...) {
+        // Don't throw in destructor
+    }
+}
+
+bool TWeb4BridgeClient::TestConnection() {
+    try {
+        System::Json::TJSONObject* response = CheckHealth();
+        if (response) {
+            delete response;
+            return true;
+        }
+    }
+    catch (...) {
+        // Connection failed
+    }
+    return false;
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::CheckHealth() {
+    return MakeGetRequest("/health");
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::CheckDetailedHealth() {
+    return MakeGetRequest("/health/detailed");
+}
+
+// ===========================================================================
+// HTTP REQUEST METHODS
+// ===========================================================================
+
+std::shared_ptr<TWeb4ConnectionPool> TWeb4BridgeClient::Pool() {
+    std::lock_guard<std::mutex> lock(FPoolLock);
+    if (!FPool && !FPoolClosed) {
+        FPool.reset(new TWeb4ConnectionPool(BuildUrl(""), FConfig.RequestTimeoutSeconds * 1000,
+                                            FConfig.MaxConcurrentRequests));
+    }
+    return FPool;
+}
+
+void TWeb4BridgeClient::OpenPool() {
+    std::lock_guard<std::mutex> lock(FPoolLock);
+    FPoolClosed = false;
+}
+
+System::UnicodeString TWeb4BridgeClient::RequestBody(
+    const System::UnicodeString& method,
+    System::Json::TJSONObject* data) {
+
+    if (data && (method.Compare("POST") == 0 || method.Compare("PUT") == 0)) {
+        return data->ToJSON();
+    }
+    return "";
+}
+
+TWeb4Response TWeb4BridgeClient::Execute(
+    TWeb4Connection* connection,
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    const System::UnicodeString& body,
+    const System::UnicodeString& idempotencyKey,
+    int timeoutMs) {
+
+    TWeb4Response result;
+    Rest::Client::TRESTRequest* request = connection->Request.get();
+    Rest::Client::TRESTResponse* response = connection->Response.get();
+    LARGE_INTEGER sent;
+    sent.QuadPart = 0;
+
+    try {
+        LogRequest(method, endpoint);
+
+        request->Resource = endpoint;
+
+        // Set HTTP method
+        if (method.Compare("GET") == 0) request->Method = Rest::Types::rmGET;
+        else if (method.Compare("POST") == 0) request->Method = Rest::Types::rmPOST;
+        else if (method.Compare("PUT") == 0) request->Method = Rest::Types::rmPUT;
+        else if (method.Compare("DELETE") == 0) request->Method = Rest::Types::rmDELETE;
+
+        // Clear previous parameters and body
+        request->Params->Clear();
+        request->ClearBody();
+
+        // Lets the bridge recognise a write it has already applied
+        if (!idempotencyKey.IsEmpty()) {
+            request->AddParameter("Idempotency-Key", idempotencyKey, Rest::Types::pkHTTPHEADER);
+        }
+
+        // Add request body for POST/PUT
+        if (!body.IsEmpty()) {
+            // FIXED: Proper JSON string handling with correct content type
+            request->AddParameter("Content-Type", "application/json", Rest::Types::pkHTTPHEADER);
+            request->AddBody(body, "application/json");
+        }
+
+        // A connection serves every endpoint, so its timeouts are set per request
+        if (timeoutMs <= 0) timeoutMs = DeadlineFor(method, endpoint);
+        connection->Client->ConnectTimeout = timeoutMs;
+        connection->Client->ReadTimeout = timeoutMs;
+
+        // Execute request
+        QueryPerformanceCounter(&sent);
+        request->Execute();
+
+        result.StatusCode = response->StatusCode;
+        if (FConfig.EnableLogging) {
+            LogResponse(response->StatusCode, response->Content);
+        }
+
+        // Check response status
+        if (response->StatusCode >= 200 && response->StatusCode < 300) {
+            System::DynamicArray<System::Byte> raw = response->RawBytes;
+
+            if (raw.Length > 0) {
+                // Parsed once, straight from the UTF-8 body; the object is ours
+                // to hand out, the response keeps no reference to it
+                LARGE_INTEGER started, finished;
+                QueryPerformanceCounter(&started);
+                System::Json::TJSONValue* jsonValue = nullptr;
+                try {
+                    jsonValue = System::Json::TJSONObject::ParseJSONValue(raw, 0, true);
+                }
+                catch (...) {
+                    jsonValue = nullptr;
+                }
+                QueryPerformanceCounter(&finished);
+                FParseTicks += finished.QuadPart - started.QuadPart;
+                FParsedBytes += raw.Length;
+
+                result.Json.reset(dynamic_cast<System::Json::TJSONObject*>(jsonValue));
+                if (!result.Json && jsonValue) {
+                    delete jsonValue; // Not an object
+                }
+            } else {
+                result.Json.reset(new System::Json::TJSONObject()); // Empty success response
+            }
+        } else {
+            result.ErrorMessage = "HTTP " +
+                System::Sysutils::IntToStr(response->StatusCode) +
+                ": " + response->StatusText;
+            result.ErrorCode = response->StatusCode;
+            result.ErrorType = "HTTP_ERROR";
+        }
+    }
+    catch (const System::Sysutils::Exception& e) {
+        result.ErrorMessage = "Request failed: " + e.Message;
+        result.ErrorCode = 0;
+        result.ErrorType = "REQUEST_ERROR";
+    }
+
+    // Failures count too, a timeout is the latency the caller saw
+    if (sent.QuadPart != 0) {
+        LARGE_INTEGER finished, frequency;
+        QueryPerformanceCounter(&finished);
+        QueryPerformanceFrequency(&frequency);
+        FLatency.Record(TWeb4LatencyStats::EndpointKey(method, endpoint),
+                        (finished.QuadPart - sent.QuadPart) * 1000.0 / frequency.QuadPart);
+    }
+
+    return result;
+}
+
+int TWeb4BridgeClient::DeadlineFor(const System::UnicodeString& method, const System::UnicodeString& endpoint) const {
+    int seconds = method.Compare("GET") == 0 ? FConfig.ReadTimeoutSeconds : FConfig.RequestTimeoutSeconds;
+    int matched = 0;
+
+    // The longest prefix that matches wins
+    for (const auto& item : FConfig.EndpointTimeoutSeconds) {
+        if (item.first.Length() > matched && endpoint.Pos(item.first) == 1) {
+            seconds = item.second;
+            matched = item.first.Length();
+        }
+    }
+    return std::max(1, seconds) * 1000;
+}
+
+bool TWeb4BridgeClient::RetryLater(const TWeb4Response& response) {
+    if (response.Succeeded()) return false;
+
+    // The bridge turning a request down is an answer too; only not reaching
+    // it, or it being too busy to decide, is worth another try. A client
+    // that is disconnected has nothing to try with.
+    if (response.ErrorType == "REQUEST_ERROR" || response.ErrorType == "BATCH_ERROR") return true;
+    if (response.ErrorType != "HTTP_ERROR") return false;
+    return response.ErrorCode >= 500 || response.ErrorCode == 408 || response.ErrorCode == 429;
+}
+
+TWeb4Response TWeb4BridgeClient::ExecuteOnce(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    const System::UnicodeString& body,
+    int timeoutMs) {
+
+    std::shared_ptr<TWeb4ConnectionPool> pool = Pool();
+    TWeb4Connection* connection = pool ? pool->Acquire() : nullptr;
+
+    if (!connection) {
+        return DisconnectedResponse();
+    }
+
+    TWeb4Response response = Execute(connection, method, endpoint, body, "", timeoutMs);
+    pool->Release(connection);
+    return response;
+}
+
+TWeb4Response TWeb4BridgeClient::ExecuteHedged(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    int timeoutMs) {
+
+    struct TRace {
+        std::mutex Lock;
+        std::condition_variable Changed;
+        int Launched;
+        int Finished;
+        int Winner;                         // Copy whose answer counts, -1 while there is none
+        TWeb4Response Response;
+    };
+    std::shared_ptr<TWeb4ConnectionPool> pool = Pool();
+    if (!pool) {
+        return DisconnectedResponse();
+    }
+
+    std::shared_ptr<TRace> race(new TRace());
+    race->Launched = 1;
+    race->Finished = 0;
+    race->Winner = -1;
+
+    auto launch = [this, pool, race, method, endpoint, timeoutMs](int copy) {
+        pool->Post(
+            [this, method, endpoint, timeoutMs](TWeb4Connection* connection) {
+                return Execute(connection, method, endpoint, "", "", timeoutMs);
+            },
+            [race, copy](TWeb4Response& response) {
+                std::lock_guard<std::mutex> lock(race->Lock);
+                race->Finished++;
+                // The first success, or the last failure when none succeeded
+                if (race->Winner < 0 && (response.Succeeded() || race->Finished == race->Launched)) {
+                    race->Winner = copy;
+                    race->Response = std::move(response);
+                }
+                race->Changed.notify_all();
+            });
+    };
+
+    // Hedge at the endpoint's p95 once it has a few samples, at the
+    // configured delay before that
+    int delayMs = static_cast<int>(FLatency.Percentile(TWeb4LatencyStats::EndpointKey(method, endpoint), 95.0, 20));
+    if (delayMs <= 0) delayMs = FConfig.HedgeDelayMs;
+
+    launch(0);
+
+    std::unique_lock<std::mutex> lock(race->Lock);
+    if (!race->Changed.wait_for(lock, std::chrono::milliseconds(delayMs), [race] { return race->Winner >= 0; }) &&
+        pool->Size() > 1) {
+        race->Launched = 2;
+        lock.unlock();
+        launch(1);
+        FHedged++;
+        lock.lock();
+    }
+
+    // The copy that loses still runs to its end, its answer is dropped
+    race->Changed.wait(lock, [race] { return race->Winner >= 0; });
+    if (race->Winner == 1) {
+        FHedgeWins++;
+    }
+    return std::move(race->Response);
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::MakeRequest(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    System::Json::TJSONObject* data) {
+
+    System::UnicodeString body = RequestBody(method, data);
+    bool idempotent = method.Compare("GET") == 0;
+    int attempts = idempotent ? 1 + std::max(0, FConfig.MaxRetryAttempts) : 1;
+    int deadlineMs = DeadlineFor(method, endpoint);
+    int backoffMs = 100;
+    DWORD started = GetTickCount();
+    TWeb4Response response;
+
+    // Retries and their waits all fit in the one deadline
+    for (int attempt = 1; ; attempt++) {
+        int remainingMs = deadlineMs - static_cast<int>(GetTickCount() - started);
+
+        if (idempotent && FConfig.HedgeDelayMs > 0) {
+            response = ExecuteHedged(method, endpoint, remainingMs);
+        } else {
+            response = ExecuteOnce(method, endpoint, body, remainingMs);
+        }
+        if (response.Succeeded() || attempt >= attempts || !RetryLater(response)) break;
+
+        int waitMs = backoffMs / 2 + std::rand() % (backoffMs / 2 + 1);
+        if (static_cast<int>(GetTickCount() - started) + waitMs >= deadlineMs) break;
+
+        Sleep(waitMs);
+        backoffMs = std::min(backoffMs * 2, 2000);
+        FRetries++;
+    }
+
+    if (!response.Succeeded()) {
+        throw EWeb4Exception(response.ErrorMessage, response.ErrorCode, response.ErrorType);
+    }
+    return response.Json.release();
+}
+
+std::future<TWeb4Response> TWeb4BridgeClient::MakeRequestAsync(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    System::Json::TJSONObject* data) {
+
+    std::shared_ptr<std::promise<TWeb4Response>> promise(new std::promise<TWeb4Response>());
+    std::future<TWeb4Response> future = promise->get_future();
+
+    MakeRequestAsync(method, endpoint, data, [promise](TWeb4Response& response) {
+        promise->set_value(std::move(response));
+    });
+    return future;
+}
+
+void TWeb4BridgeClient::MakeRequestAsync(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    System::Json::TJSONObject* data,
+    TResponseHandler handler) {
+
+    PostRequest(method, endpoint, RequestBody(method, data), handler);
+}
+
+void TWeb4BridgeClient::PostRequest(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    const System::UnicodeString& body,
+    TResponseHandler handler,
+    const System::UnicodeString& idempotencyKey,
+    int timeoutMs) {
+
+    std::shared_ptr<TWeb4ConnectionPool> pool = Pool();
+    if (!pool) {
+        TWeb4Response response = DisconnectedResponse();
+        handler(response);
+        return;
+    }
+
+    pool->Post(
+        [this, method, endpoint, body, idempotencyKey, timeoutMs](TWeb4Connection* connection) {
+            return Execute(connection, method, endpoint, body, idempotencyKey, timeoutMs);
+        },
+        handler);
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::MakeGetRequest(const System::UnicodeString& endpoint) {
+	return MakeRequest("GET", endpoint);
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::MakePostRequest(const System::UnicodeString& endpoint, System::Json::TJSONObject* data) {
+    return MakeRequest("POST", endpoint, data);
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::MakePutRequest(const System::UnicodeString& endpoint, System::Json::TJSONObject* data) {
+    return MakeRequest("PUT", endpoint, data);
+}
+
+System::Json::TJSONObject* TWeb4BridgeClient::MakeDeleteRequest(const System::UnicodeString& endpoint, System::Json::TJSONObject* data) {
+    return MakeRequest("DELETE", endpoint, data);
+}
+
+// ===========================================================================
+// BATCH OPERATIONS
+// ===========================================================================
+
+TWeb4BatchOperation TWeb4BridgeClient::BatchOperation(
+    const System::UnicodeString& method,
+    const System::UnicodeString& endpoint,
+    System::Json::TJSONObject* data) {
+
+    TWeb4BatchOperation operation;
+    operation.Method = method;
+    operation.Endpoint = endpoint;
+    operation.Body = RequestBody(method, data);
+    return operation;
+}
+
+TWeb4BatchOperation TWeb4BridgeClient::CachedRead(
+    const System::UnicodeString& endpoint,
+    TWeb4Cache::TKind kind,
+    const System::UnicodeString& key) {
+
+    TWeb4BatchOperation operation = BatchOperation("GET", endpoint);
+    operation.CacheKind = kind;
+    operation.CacheKey = key;
+    return operation;
+}
+
+std::vector<TWeb4Response> TWeb4BridgeClient::ExecuteBatch(const std::vector<TWeb4BatchOperation>& operations) {
+    std::vector<TWeb4Response> results(operations.size());
+    size_t chunk = static_cast<size_t>(std::max(1, FConfig.MaxBatchSize));
+    DWORD started = GetTickCount();
+
+    // Only what the cache cannot answer goes to the bridge
+    std::vector<TWeb4BatchOperation> requests;
+    std::vector<size_t> owners;
+    for (size_t i = 0; i < operations.size(); i++) {
+        if (!BatchFromCache(operations[i], results[i])) {
+            requests.push_back(operations[i]);
+            owners.push_back(i);
+        }
+    }
+
+    std::vector<TWeb4Response> answers(requests.size());
+    for (size_t start = 0; start < requests.size(); start += chunk) {
+        size_t count = std::min(chunk, requests.size() - start);
+        if (FBatchUnsupported || !SendBatch(requests, start, count, answers)) {
+            SendIndividually(requests, start, count, answers);
+        }
+    }
+    RetryReads(requests, answers, started);
+
+    for (size_t r = 0; r < requests.size(); r++) {
+        const TWeb4BatchOperation& operation = requests[r];
+        if (operation.CacheKind != TWeb4Cache::ckKindCount && answers[r].Succeeded() &&
+            ValidateResponse(answers[r].Json.get())) {
+            ToCache(operation.CacheKind, operation.CacheKey, answers[r].Json.get());
+        }
+        results[owners[r]] = std::move(answers[r]);
+    }
+
+    return results;
+}
+
+bool TWeb4BridgeClient::BatchFromCache(const TWeb4BatchOperation& operation, TWeb4Response& response) {
+    System::UnicodeString json;
+    if (operation.CacheKind == TWeb4Cache::ckKindCount || !FConfig.EnableCache ||
+        !FCache.Get(operation.CacheKind, operation.CacheKey, json)) {
+        return false;
+    }
 
-    envValue = System::Sysutils::GetEnvironmentVariable("WEB4_DEFAULT_CREATOR");
-    if (!envValue.IsEmpty()) DefaultCreator = envValue;
+    std::unique_ptr<System::Json::TJSONValue> value(System::Json::TJSONObject::ParseJSONValue(json));
+    System::Json::TJSONObject* object = dynamic_cast<System::Json::TJSONObject*>(value.get());
+    if (!object) return false;
 
-    envValue = System::Sysutils::GetEnvironmentVariable("API_BRIDGE_LOG_LEVEL");
-    if (!envValue.IsEmpty()) LogLevel = envValue;
+    value.release();
+    response.StatusCode = 200;
+    response.Json.reset(object);
+    return true;
 }
 
-     // ===========================================================================
-// MAIN CLIENT IMPLEMENTATION
-// ===========================================================================
+// The retries of MakeRequest for the reads of a batch: each round sends the
+// reads that failed in a way worth another try, side by side, after the same
+// backoff, and only while they fit in their own deadline. Writes go once
+void TWeb4BridgeClient::RetryReads(const std::vector<TWeb4BatchOperation>& operations,
+                                   std::vector<TWeb4Response>& results, DWORD started) {
+    int backoffMs = 100;
 
-TWeb4BridgeClient::TWeb4BridgeClient(const TWeb4BridgeConfig& config) :
-    FConfig(config),
-    FConnected(false) {
+    for (int attempt = 1; attempt <= FConfig.MaxRetryAttempts; attempt++) {
+        int waitMs = backoffMs / 2 + std::rand() % (backoffMs / 2 + 1);
+        int elapsedMs = static_cast<int>(GetTickCount() - started);
+        std::vector<TWeb4BatchOperation> retries;
+        std::vector<size_t> owners;
 
-    FRESTClient.reset(new Rest::Client::TRESTClient(nullptr));
-    FRESTRequest.reset(new Rest::Client::TRESTRequest(nullptr));
-    FRESTResponse.reset(new Rest::Client::TRESTResponse(nullptr));
+        for (size_t i = 0; i < operations.size(); i++) {
+            const TWeb4BatchOperation& operation = operations[i];
+            if (operation.Method.Compare("GET") != 0 || results[i].Succeeded() || !RetryLater(results[i])) continue;
 
-    FRESTRequest->Client = FRESTClient.get();
-    FRESTRequest->Response = FRESTResponse.get();
+            int remainingMs = DeadlineFor(operation.Method, operation.Endpoint) - elapsedMs - waitMs;
+            if (remainingMs <= 0) continue;
 
-    FRESTClient->ConnectTimeout = FConfig.RequestTimeoutSeconds * 1000;
-    FRESTClient->ReadTimeout = FConfig.RequestTimeoutSeconds * 1000;
-}
+            retries.push_back(operation);
+            retries.back().TimeoutMs = remainingMs;
+            owners.push_back(i);
+        }
+        if (retries.empty()) break;
 
-TWeb4BridgeClient::~TWeb4BridgeClient() {
-    Disconnect();
+        Sleep(waitMs);
+        backoffMs = std::min(backoffMs * 2, 2000);
+        FRetries += static_cast<int>(retries.size());
+
+        std::vector<TWeb4Response> answers(retries.size());
+        SendIndividually(retries, 0, retries.size(), answers);
+        for (size_t r = 0; r < retries.size(); r++) {
+            results[owners[r]] = std::move(answers[r]);
+        }
+    }
 }
 
-bool TWeb4BridgeClient::Connect() {
-    try {
-        FRESTClient->BaseURL = BuildUrl("");
+bool TWeb4BridgeClient::SendBatch(const std::vector<TWeb4BatchOperation>& operations, size_t start, size_t count,
+                                  std::vector<TWeb4Response>& results) {
+    // Bodies are already JSON text, so the request is put together as text too
+    System::UnicodeString body = "{\"operations\":[";
+    for (size_t i = 0; i < count; i++) {
+        const TWeb4BatchOperation& operation = operations[start + i];
+        std::unique_ptr<System::Json::TJSONString> method(new System::Json::TJSONString(operation.Method));
+        std::unique_ptr<System::Json::TJSONString> path(new System::Json::TJSONString(operation.Endpoint));
 
-        // Test connection with health check
-        System::Json::TJSONObject* healthResponse = CheckHealth();
-        if (healthResponse) {
-            FConnected = true;
-            delete healthResponse;
-            return true;
+        if (i > 0) body += ",";
+        body += "{\"id\":\"" + System::Sysutils::IntToStr(static_cast<int>(i)) + "\"" +
+                ",\"method\":" + method->ToJSON() +
+                ",\"path\":" + path->ToJSON();
+        if (!operation.Body.IsEmpty()) {
+            body += ",\"body\":" + operation.Body;
         }
-
-        FConnected = false;
-        return false;
+        if (!operation.IdempotencyKey.IsEmpty()) {
+            body += ",\"idempotency_key\":\"" + operation.IdempotencyKey + "\"";
+        }
+        body += "}";
     }
-    catch (const System::Sysutils::Exception& e) {
-        HandleError("Connect", e);
-        FConnected = false;
+    body += "]}";
+
+    std::shared_ptr<TWeb4ConnectionPool> pool = Pool();
+    TWeb4Connection* connection = pool ? pool->Acquire() : nullptr;
+    if (!connection) {
         return false;
     }
-}
+    TWeb4Response response = Execute(connection, "POST", "/api/v1/batch", body);
+    pool->Release(connection);
 
-void TWeb4BridgeClient::Disconnect() {
-try {
-        if (FConnected) {
-            Disconnect();
+    System::Json::TJSONArray* answers = response.Json ?
+        dynamic_cast<System::Json::TJSONArray*>(response.Json->GetValue("results")) : nullptr;
+
+    if (!response.Succeeded()) {
+        // Bridges without the endpoint get individual calls from now on
+        if (response.ErrorCode == 404 || response.ErrorCode == 405 || response.ErrorCode == 501) {
+            FBatchUnsupported = true;
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            results[start + i].ErrorMessage = response.ErrorMessage;
+            results[start + i].ErrorCode = response.ErrorCode;
+            results[start + i].ErrorType = response.ErrorType;
         }
-        // Smart pointers will clean up automatically
-        FRESTResponse.reset();
-        FRESTRequest.reset();
-        FRESTClient.reset();
+        return true;
     }
-    catch (...) {
-        // Don't throw in destructor
+    if (!answers) {
+        FBatchUnsupported = true;
+        return false;
     }
-}
 
-bool TWeb4BridgeClient::TestConnection() {
-    try {
-        System::Json::TJSONObject* response = CheckHealth();
-        if (response) {
-            delete response;
-            return true;
+    std::vector<bool> answered(count, false);
+    for (int a = 0; a < answers->Count; a++) {
+        System::Json::TJSONObject* answer = dynamic_cast<System::Json::TJSONObject*>(answers->Items[a]);
+        if (!answer) continue;
+
+        int index = System::Sysutils::StrToIntDef(TWeb4Utils::SafeJsonString(answer->GetValue("id")), -1);
+        if (index < 0 || index >= static_cast<int>(count)) continue;
+
+        TWeb4Response& result = results[start + index];
+        answered[index] = true;
+        result.StatusCode = static_cast<int>(TWeb4Utils::SafeJsonNumber(answer->GetValue("status")));
+        if (result.StatusCode >= 200 && result.StatusCode < 300) {
+            System::Json::TJSONObject* itemBody = dynamic_cast<System::Json::TJSONObject*>(answer->GetValue("body"));
+            result.Json.reset(itemBody ? static_cast<System::Json::TJSONObject*>(itemBody->Clone())
+                                       : new System::Json::TJSONObject());
+        } else {
+            result.ErrorMessage = "HTTP " + System::Sysutils::IntToStr(result.StatusCode) + ": " +
+                TWeb4Utils::SafeJsonString(answer->GetValue("error"));
+            result.ErrorCode = result.StatusCode;
+            result.ErrorType = "HTTP_ERROR";
         }
     }
-    catch (...) {
-        // Connection failed
+
+    for (size_t i = 0; i < count; i++) {
+        if (!answered[i]) {
+            results[start + i].ErrorMessage = "No result in batch response";
+            results[start + i].ErrorType = "BATCH_ERROR";
+        }
     }
-    return false;
+    return true;
 }
 
-System::Json::TJSONObject* TWeb4BridgeClient::CheckHealth() {
-    return MakeGetRequest("/health");
-}
+void TWeb4BridgeClient::SendIndividually(const std::vector<TWeb4BatchOperation>& operations, size_t start, size_t count,
+                                         std::vector<TWeb4Response>& results) {
+    std::vector<std::future<TWeb4Response>> pending;
 
-System::Json::TJSONObject* TWeb4BridgeClient::CheckDetailedHealth() {
-    return MakeGetRequest("/health/detailed");
+    // All queued at once, the pool runs as many side by side as it has connections
+    for (size_t i = 0; i < count; i++) {
+        const TWeb4BatchOperation& operation = operations[start + i];
+        std::shared_ptr<std::promise<TWeb4Response>> promise(new std::promise<TWeb4Response>());
+
+        pending.push_back(promise->get_future());
+        PostRequest(operation.Method, operation.Endpoint, operation.Body, [promise](TWeb4Response& response) {
+            promise->set_value(std::move(response));
+        }, operation.IdempotencyKey, operation.TimeoutMs);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        results[start + i] = pending[i].get();
+    }
 }
 
 // ===========================================================================
-// HTTP REQUEST METHODS
+// DEFERRED WRITES
 // ===========================================================================
 
-System::Json::TJSONObject* TWeb4BridgeClient::MakeRequest(
+System::UnicodeString TWeb4BridgeClient::DeferWrite(
     const System::UnicodeString& method,
     const System::UnicodeString& endpoint,
     System::Json::TJSONObject* data) {
 
-    try {
-        LogRequest(method, endpoint);
+    System::UnicodeString key = FJournal.Append(method, endpoint, RequestBody(method, data));
+    StartReplay();
+    return key;
+}
 
-        FRESTClient->BaseURL = BuildUrl("");
-        FRESTRequest->Resource = endpoint;
+System::UnicodeString TWeb4BridgeClient::RegisterComponentDeferred(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentData,
+    const System::UnicodeString& context) {
 
-        // Set HTTP method
-        if (method.Compare("GET") == 0) FRESTRequest->Method = Rest::Types::rmGET;
-        else if (method.Compare("POST") == 0) FRESTRequest->Method = Rest::Types::rmPOST;
-        else if (method.Compare("PUT") == 0) FRESTRequest->Method = Rest::Types::rmPUT;
-        else if (method.Compare("DELETE") == 0) FRESTRequest->Method = Rest::Types::rmDELETE;
+    std::unique_ptr<System::Json::TJSONObject> requestData(RegisterComponentBody(creator, componentData, context));
+    return DeferWrite("POST", "/api/v1/components/register", requestData.get());
+}
 
-        // Clear previous parameters and body
-        FRESTRequest->Params->Clear();
-        FRESTRequest->ClearBody();
+System::UnicodeString TWeb4BridgeClient::CreateLctDeferred(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentA,
+    const System::UnicodeString& componentB,
+    const System::UnicodeString& context) {
 
-        // Add request body for POST/PUT
-        if (data && (method.Compare("POST") == 0 || method.Compare("PUT") == 0)) {
-            // FIXED: Proper JSON string handling with correct content type
-            System::UnicodeString jsonString = data->ToJSON();
-            
-            // Try manually setting content type and using AddBody
-            FRESTRequest->AddParameter("Content-Type", "application/json", Rest::Types::pkHTTPHEADER);
-            FRESTRequest->AddBody(jsonString, "application/json");
-        }
+    std::unique_ptr<System::Json::TJSONObject> requestData(CreateLctBody(creator, componentA, componentB, context));
+    return DeferWrite("POST", "/api/v1/lct/create", requestData.get());
+}
 
-        // Execute request
-        FRESTRequest->Execute();
+System::UnicodeString TWeb4BridgeClient::UpdateTensorScoreDeferred(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentA,
+    const System::UnicodeString& componentB,
+    double score,
+    const System::UnicodeString& context) {
 
-        LogResponse(FRESTResponse->StatusCode, FRESTResponse->Content);
+    std::unique_ptr<System::Json::TJSONObject> requestData(TensorScoreBody(creator, componentA, componentB, score, context));
+    InvalidateRelationship(componentA, componentB);
+    return DeferWrite("PUT", "/api/v1/trust-enhanced/score", requestData.get());
+}
 
-        // Check response status
-        if (FRESTResponse->StatusCode >= 200 && FRESTResponse->StatusCode < 300) {
-            if (!FRESTResponse->Content.IsEmpty()) {
-                // FIXED: Proper JSON parsing with error handling
-                try {
-                    System::Json::TJSONValue* jsonValue =
-                        System::Json::TJSONObject::ParseJSONValue(FRESTResponse->Content);
-                    
-                    System::Json::TJSONObject* jsonObject =
-                        dynamic_cast<System::Json::TJSONObject*>(jsonValue);
-
-                    if (jsonObject) {
-                        // Create a clean copy to avoid memory corruption
-                        try {
-                            System::UnicodeString jsonText = jsonObject->ToJSON();
-                            delete jsonObject; // Clean up original
-                            
-                            // Parse the string back into a new clean object
-                            System::Json::TJSONValue* newValue = System::Json::TJSONObject::ParseJSONValue(jsonText);
-                            System::Json::TJSONObject* newObject = dynamic_cast<System::Json::TJSONObject*>(newValue);
-                            
-                            return newObject; // Return clean copy or nullptr if failed
-                        }
-                        catch (...) {
-                            return nullptr;
-                        }
-                    } else {
-                        // If cast failed, clean up and return null
-                        if (jsonValue) delete jsonValue;
-                        return nullptr;
-                    }
-                } catch (...) {
-                    // JSON parsing failed
-                    return nullptr;
-                }
-            }
-            return new System::Json::TJSONObject(); // Empty success response
-        } else {
-            System::UnicodeString errorMsg = "HTTP " +
-                System::Sysutils::IntToStr(FRESTResponse->StatusCode) +
-                ": " + FRESTResponse->StatusText;
-            throw EWeb4Exception(errorMsg, FRESTResponse->StatusCode, "HTTP_ERROR");
+void TWeb4BridgeClient::StartReplay() {
+    OpenPool();
+    {
+        std::lock_guard<std::mutex> lock(FReplayLock);
+        if (!FReplayThread.joinable()) {
+            FReplayStop = false;
+            FReplayThread = std::thread(&TWeb4BridgeClient::ReplayLoop, this);
         }
     }
-    catch (const EWeb4Exception&) {
-        throw; // Re-throw Web4 exceptions
+    FReplayWake.notify_one();
+}
+
+void TWeb4BridgeClient::StopReplay() {
+    {
+        std::lock_guard<std::mutex> lock(FReplayLock);
+        FReplayStop = true;
     }
-    catch (const System::Sysutils::Exception& e) {
-        throw EWeb4Exception("Request failed: " + e.Message, 0, "REQUEST_ERROR");
+    FReplayWake.notify_one();
+    if (FReplayThread.joinable()) {
+        FReplayThread.join();
     }
 }
 
-System::Json::TJSONObject* TWeb4BridgeClient::MakeGetRequest(const System::UnicodeString& endpoint) {
-	return MakeRequest("GET", endpoint);
-}
+void TWeb4BridgeClient::ReplayApplied(const TWeb4JournalEntry& entry, TWeb4Response& response) {
+    if (!response.Succeeded() || !ValidateResponse(response.Json.get())) return;
 
-System::Json::TJSONObject* TWeb4BridgeClient::MakePostRequest(const System::UnicodeString& endpoint, System::Json::TJSONObject* data) {
-    return MakeRequest("POST", endpoint, data);
+    // Same cache effects as the immediate calls
+    if (entry.Endpoint == "/api/v1/components/register") {
+        ToCache(TWeb4Cache::ckComponent,
+                TWeb4Utils::SafeJsonString(response.Json->GetValue("component_id")), response.Json.get());
+    } else if (entry.Endpoint == "/api/v1/lct/create") {
+        ToCache(TWeb4Cache::ckLct,
+                TWeb4Utils::SafeJsonString(response.Json->GetValue("lct_id")), response.Json.get(), false);
+        FCache.InvalidateKind(TWeb4Cache::ckRelationship);
+        FCache.InvalidateKind(TWeb4Cache::ckTrustTensor);
+    } else if (entry.Endpoint == "/api/v1/trust-enhanced/score") {
+        FCache.InvalidateKind(TWeb4Cache::ckRelationship);
+        FCache.InvalidateKind(TWeb4Cache::ckTrustTensor);
+    }
 }
 
-System::Json::TJSONObject* TWeb4BridgeClient::MakePutRequest(const System::UnicodeString& endpoint, System::Json::TJSONObject* data) {
-    return MakeRequest("PUT", endpoint, data);
-}
+void TWeb4BridgeClient::ReplayLoop() {
+    const int firstBackoffMs = 1000;
+    const int maxBackoffMs = 60000;
+    int backoffMs = 0;
 
-System::Json::TJSONObject* TWeb4BridgeClient::MakeDeleteRequest(const System::UnicodeString& endpoint, System::Json::TJSONObject* data) {
-    return MakeRequest("DELETE", endpoint, data);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(FReplayLock);
+            if (backoffMs > 0) {
+                // Half to all of the backoff, so clients that lost the bridge
+                // together do not all come back in the same second
+                int waitMs = backoffMs / 2 + std::rand() % (backoffMs / 2 + 1);
+                FReplayWake.wait_for(lock, std::chrono::milliseconds(waitMs), [this] { return FReplayStop; });
+            } else {
+                FReplayWake.wait(lock, [this] { return FReplayStop || FJournal.Count() > 0; });
+            }
+            if (FReplayStop) return;
+        }
+
+        std::vector<TWeb4JournalEntry> entries = FJournal.Pending(static_cast<size_t>(std::max(1, FConfig.MaxBatchSize)));
+        if (entries.empty()) {
+            backoffMs = 0;
+            continue;
+        }
+
+        std::vector<TWeb4BatchOperation> operations;
+        for (const auto& entry : entries) {
+            TWeb4BatchOperation operation;
+            operation.Method = entry.Method;
+            operation.Endpoint = entry.Endpoint;
+            operation.Body = entry.Body;
+            operation.IdempotencyKey = entry.Key;
+            operations.push_back(operation);
+        }
+
+        std::vector<TWeb4Response> results = ExecuteBatch(operations);
+        bool unreachable = false;
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            // Writes cut off by Disconnect stay journaled for the next replay
+            if (RetryLater(results[i]) || results[i].ErrorType == "DISCONNECTED") {
+                unreachable = true;
+                continue;
+            }
+
+            FJournal.Complete(entries[i].Key);
+            try {
+                ReplayApplied(entries[i], results[i]);
+                if (OnWriteReplayed) {
+                    OnWriteReplayed(entries[i].Key, results[i]);
+                }
+            }
+            catch (...) {
+                // A failing handler must not stop the replay
+            }
+        }
+
+        backoffMs = unreachable ? std::min(std::max(backoffMs * 2, firstBackoffMs), maxBackoffMs) : 0;
+    }
 }
 
 // ===========================================================================
 // COMPONENT REGISTRY OPERATIONS
 // ===========================================================================
 
-std::unique_ptr<TComponentRegistration> TWeb4BridgeClient::RegisterComponent(
+System::Json::TJSONObject* TWeb4BridgeClient::RegisterComponentBody(
     const System::UnicodeString& creator,
     const System::UnicodeString& componentData,
     const System::UnicodeString& context) {
 
-    // FIXED: Use smart pointer for automatic cleanup
-    std::unique_ptr<System::Json::TJSONObject> requestData(TWeb4Utils::CreateRequestBody());
+    System::Json::TJSONObject* requestData = TWeb4Utils::CreateRequestBody();
 
-    TWeb4Utils::AddStringField(requestData.get(), "creator", creator.IsEmpty() ? FConfig.DefaultCreator : creator);
-    TWeb4Utils::AddStringField(requestData.get(), "component_data", componentData);
+    TWeb4Utils::AddStringField(requestData, "creator", creator.IsEmpty() ? FConfig.DefaultCreator : creator);
+    TWeb4Utils::AddStringField(requestData, "component_data", componentData);
     if (!context.IsEmpty()) {
-        TWeb4Utils::AddStringField(requestData.get(), "context", context);
+        TWeb4Utils::AddStringField(requestData, "context", context);
     }
+    return requestData;
+}
+
+std::unique_ptr<TComponentRegistration> TWeb4BridgeClient::RegisterComponent(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentData,
+    const System::UnicodeString& context) {
+
+    // FIXED: Use smart pointer for automatic cleanup
+    std::unique_ptr<System::Json::TJSONObject> requestData(RegisterComponentBody(creator, componentData, context));
 
     try {
         // FIXED: Pass raw pointer, but manage cleanup properly
@@ -601,6 +1848,8 @@ std::unique_ptr<TComponentRegistration> TWeb4BridgeClient::RegisterComponent(
         if (response && ValidateResponse(response)) {
             std::unique_ptr<TComponentRegistration> registration(new TComponentRegistration());
             registration->FromJSON(response);
+            // A registration never changes, GetComponent can answer from here
+            ToCache(TWeb4Cache::ckComponent, registration->ComponentId, response);
             delete response; // Clean up response
             return registration;
         } else if (response) {
@@ -624,9 +1873,46 @@ std::unique_ptr<TComponentRegistration> TWeb4BridgeClient::RegisterComponent(
     }
 }
 
+std::future<std::unique_ptr<TComponentRegistration>> TWeb4BridgeClient::RegisterComponentAsync(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentData,
+    const System::UnicodeString& context) {
+
+    std::unique_ptr<System::Json::TJSONObject> requestData(RegisterComponentBody(creator, componentData, context));
+
+    typedef std::promise<std::unique_ptr<TComponentRegistration>> TRegistrationPromise;
+    std::shared_ptr<TRegistrationPromise> promise(new TRegistrationPromise());
+    std::future<std::unique_ptr<TComponentRegistration>> future = promise->get_future();
+
+    MakeRequestAsync("POST", "/api/v1/components/register", requestData.get(),
+        [this, promise](TWeb4Response& response) {
+            std::unique_ptr<TComponentRegistration> registration;
+            try {
+                if (response.Succeeded() && ValidateResponse(response.Json.get())) {
+                    registration.reset(new TComponentRegistration());
+                    registration->FromJSON(response.Json.get());
+                    ToCache(TWeb4Cache::ckComponent, registration->ComponentId, response.Json.get());
+                } else if (!response.Succeeded()) {
+                    HandleError("RegisterComponentAsync",
+                        EWeb4Exception(response.ErrorMessage, response.ErrorCode, response.ErrorType));
+                }
+            }
+            catch (const System::Sysutils::Exception& e) {
+                HandleError("RegisterComponentAsync", e);
+                registration.reset();
+            }
+            promise->set_value(std::move(registration));
+        });
+
+    return future;
+}
+
 std::unique_ptr<TComponentRegistration> TWeb4BridgeClient::GetComponent(
 	const System::UnicodeString& componentId) {
 
+    std::unique_ptr<TComponentRegistration> cached = FromCache<TComponentRegistration>(TWeb4Cache::ckComponent, componentId);
+    if (cached) return cached;
+
     try {
         System::UnicodeString endpoint = "/api/v1/components/" + componentId;
         System::Json::TJSONObject* response = MakeGetRequest(endpoint);
@@ -634,6 +1920,7 @@ std::unique_ptr<TComponentRegistration> TWeb4BridgeClient::GetComponent(
         if (ValidateResponse(response)) {
             std::unique_ptr<TComponentRegistration> registration(new TComponentRegistration());
             registration->FromJSON(response);
+            ToCache(TWeb4Cache::ckComponent, componentId, response);
             delete response;
             return registration;
         }
@@ -671,7 +1958,7 @@ System::Json::TJSONObject* TWeb4BridgeClient::VerifyComponent(
 // LCT MANAGEMENT OPERATIONS
 // ===========================================================================
 
-std::unique_ptr<TLctRelationship> TWeb4BridgeClient::CreateLct(
+System::Json::TJSONObject* TWeb4BridgeClient::CreateLctBody(
     const System::UnicodeString& creator,
     const System::UnicodeString& componentA,
     const System::UnicodeString& componentB,
@@ -682,6 +1969,16 @@ std::unique_ptr<TLctRelationship> TWeb4BridgeClient::CreateLct(
     TWeb4Utils::AddStringField(requestData, "component_a", componentA);
     TWeb4Utils::AddStringField(requestData, "component_b", componentB);
     TWeb4Utils::AddStringField(requestData, "context", context);
+    return requestData;
+}
+
+std::unique_ptr<TLctRelationship> TWeb4BridgeClient::CreateLct(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentA,
+    const System::UnicodeString& componentB,
+    const System::UnicodeString& context) {
+
+    System::Json::TJSONObject* requestData = CreateLctBody(creator, componentA, componentB, context);
 
     try {
         System::Json::TJSONObject* response = MakePostRequest("/api/v1/lct/create", requestData);
@@ -717,6 +2014,9 @@ std::unique_ptr<TLctRelationship> TWeb4BridgeClient::CreateLct(
         if (ValidateResponse(response)) {
             std::unique_ptr<TLctRelationship> lct(new TLctRelationship());
             lct->FromJSON(response);
+            // Holds the key halves, so memory only
+            ToCache(TWeb4Cache::ckLct, lct->LctId, response, false);
+            InvalidateRelationship(componentA, componentB);
             delete response;
             delete requestData;
             return lct;
@@ -734,6 +2034,9 @@ std::unique_ptr<TLctRelationship> TWeb4BridgeClient::CreateLct(
 }
 
 std::unique_ptr<TLctRelationship> TWeb4BridgeClient::GetLct(const System::UnicodeString& lctId) {
+    std::unique_ptr<TLctRelationship> cached = FromCache<TLctRelationship>(TWeb4Cache::ckLct, lctId);
+    if (cached) return cached;
+
     try {
         System::UnicodeString endpoint = "/api/v1/lct/" + lctId;
         System::Json::TJSONObject* response = MakeGetRequest(endpoint);
@@ -741,6 +2044,8 @@ std::unique_ptr<TLctRelationship> TWeb4BridgeClient::GetLct(const System::Unicod
         if (ValidateResponse(response)) {
             std::unique_ptr<TLctRelationship> lct(new TLctRelationship());
             lct->FromJSON(response);
+            ToCache(TWeb4Cache::ckLct, lctId, response,
+                    lct->DeviceKeyHalf.IsEmpty() && lct->LctKeyHalf.IsEmpty());
             delete response;
             return lct;
         }
@@ -774,6 +2079,7 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::CreateTrustTensor(
 
     try {
         System::Json::TJSONObject* response = MakePostRequest("/api/v1/trust/tensor", requestData);
+        InvalidateRelationship(componentA, componentB);
 
         if (ValidateResponse(response)) {
             std::unique_ptr<TTrustTensor> tensor(new TTrustTensor());
@@ -795,6 +2101,9 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::CreateTrustTensor(
 }
 
 std::unique_ptr<TTrustTensor> TWeb4BridgeClient::GetTrustTensor(const System::UnicodeString& tensorId) {
+    std::unique_ptr<TTrustTensor> cached = FromCache<TTrustTensor>(TWeb4Cache::ckTrustTensor, tensorId);
+    if (cached) return cached;
+
     try {
         System::UnicodeString endpoint = "/api/v1/trust/tensor/" + tensorId;
         System::Json::TJSONObject* response = MakeGetRequest(endpoint);
@@ -802,6 +2111,7 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::GetTrustTensor(const System::Un
         if (ValidateResponse(response)) {
             std::unique_ptr<TTrustTensor> tensor(new TTrustTensor());
             tensor->FromJSON(response);
+            ToCache(TWeb4Cache::ckTrustTensor, tensorId, response);
             delete response;
             return tensor;
         }
@@ -827,6 +2137,7 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::CalculateRelationshipTrust(
 
     try {
         System::Json::TJSONObject* response = MakePostRequest("/api/v1/trust-enhanced/calculate", requestData);
+        InvalidateRelationship(componentA, componentB);
 
         if (ValidateResponse(response)) {
             std::unique_ptr<TTrustTensor> tensor(new TTrustTensor());
@@ -847,18 +2158,28 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::CalculateRelationshipTrust(
     return nullptr;
 }
 
+System::UnicodeString TWeb4BridgeClient::RelationshipTensorEndpoint(
+    const System::UnicodeString& componentA,
+    const System::UnicodeString& componentB) {
+
+	return System::UnicodeString("/api/v1/trust-enhanced/relationship?component_a=") +
+		componentA + System::UnicodeString("&component_b=") + componentB;
+}
+
 std::unique_ptr<TTrustTensor> TWeb4BridgeClient::GetRelationshipTensor(
     const System::UnicodeString& componentA,
     const System::UnicodeString& componentB) {
 
+    std::unique_ptr<TTrustTensor> cached = FromCache<TTrustTensor>(TWeb4Cache::ckRelationship, componentA + "|" + componentB);
+    if (cached) return cached;
+
 	try {
-		System::UnicodeString endpoint = System::UnicodeString("/api/v1/trust-enhanced/relationship?component_a=") +
-			componentA + System::UnicodeString("&component_b=") + componentB;
-		System::Json::TJSONObject* response = MakeGetRequest(endpoint);
+		System::Json::TJSONObject* response = MakeGetRequest(RelationshipTensorEndpoint(componentA, componentB));
 
         if (ValidateResponse(response)) {
             std::unique_ptr<TTrustTensor> tensor(new TTrustTensor());
             tensor->FromJSON(response);
+            ToCache(TWeb4Cache::ckRelationship, componentA + "|" + componentB, response);
             delete response;
             return tensor;
         }
@@ -872,7 +2193,7 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::GetRelationshipTensor(
     return nullptr;
 }
 
-std::unique_ptr<TTrustTensor> TWeb4BridgeClient::UpdateTensorScore(
+System::Json::TJSONObject* TWeb4BridgeClient::TensorScoreBody(
     const System::UnicodeString& creator,
     const System::UnicodeString& componentA,
     const System::UnicodeString& componentB,
@@ -887,9 +2208,21 @@ std::unique_ptr<TTrustTensor> TWeb4BridgeClient::UpdateTensorScore(
     if (!context.IsEmpty()) {
         TWeb4Utils::AddStringField(requestData, "context", context);
     }
+    return requestData;
+}
+
+std::unique_ptr<TTrustTensor> TWeb4BridgeClient::UpdateTensorScore(
+    const System::UnicodeString& creator,
+    const System::UnicodeString& componentA,
+    const System::UnicodeString& componentB,
+    double score,
+    const System::UnicodeString& context) {
+
+    System::Json::TJSONObject* requestData = TensorScoreBody(creator, componentA, componentB, score, context);
 
     try {
         System::Json::TJSONObject* response = MakePutRequest("/api/v1/trust-enhanced/score", requestData);
+        InvalidateRelationship(componentA, componentB);
 
         if (ValidateResponse(response)) {
             std::unique_ptr<TTrustTensor> tensor(new TTrustTensor());
@@ -1186,17 +2519,25 @@ System::Json::TJSONObject* TWeb4BridgeClient::RevokeAuthorization(
     }
 }
 
+System::UnicodeString TWeb4BridgeClient::AuthorizationCheckEndpoint(
+    const System::UnicodeString& componentA,
+    const System::UnicodeString& componentB,
+    const System::UnicodeString& operationalContext) {
+
+	return System::UnicodeString("/api/v1/authorization/check") +
+		System::UnicodeString("?component_a=") + componentA +
+		System::UnicodeString("&component_b=") + componentB +
+		System::UnicodeString("&operational_context=") + operationalContext;
+}
+
 std::unique_ptr<TAuthorizationCheck> TWeb4BridgeClient::CheckPairingAuthorization(
     const System::UnicodeString& componentA,
     const System::UnicodeString& componentB,
     const System::UnicodeString& operationalContext) {
 
     try {
-		System::UnicodeString endpoint = System::UnicodeString("/api/v1/authorization/check") +
-			System::UnicodeString("?component_a=") + componentA +
-			System::UnicodeString("&component_b=") + componentB +
-			System::UnicodeString("&operational_context=") + operationalContext;
-        System::Json::TJSONObject* response = MakeGetRequest(endpoint);
+        System::Json::TJSONObject* response = MakeGetRequest(
+            AuthorizationCheckEndpoint(componentA, componentB, operationalContext));
 
         if (ValidateResponse(response)) {
             std::unique_ptr<TAuthorizationCheck> check(new TAuthorizationCheck());
@@ -1236,6 +2577,8 @@ std::unique_ptr<TEnergyOperation> TWeb4BridgeClient::CreateEnergyOperation(
 
     try {
         System::Json::TJSONObject* response = MakePostRequest("/api/v1/energy/operation", requestData);
+        FCache.Invalidate(TWeb4Cache::ckEnergyBalance, componentA);
+        FCache.Invalidate(TWeb4Cache::ckEnergyBalance, componentB);
 
         if (ValidateResponse(response)) {
             std::unique_ptr<TEnergyOperation> operation(new TEnergyOperation());
@@ -1266,6 +2609,8 @@ System::Json::TJSONObject* TWeb4BridgeClient::ExecuteEnergyTransfer(
 
     try {
         System::Json::TJSONObject* response = MakePostRequest("/api/v1/energy/transfer", requestData);
+        // Only the operation ID is known here, not whose balances moved
+        FCache.InvalidateKind(TWeb4Cache::ckEnergyBalance);
         delete requestData;
         return response;
     }
@@ -1277,6 +2622,9 @@ System::Json::TJSONObject* TWeb4BridgeClient::ExecuteEnergyTransfer(
 }
 
 std::unique_ptr<TEnergyBalance> TWeb4BridgeClient::GetEnergyBalance(const System::UnicodeString& componentId) {
+    std::unique_ptr<TEnergyBalance> cached = FromCache<TEnergyBalance>(TWeb4Cache::ckEnergyBalance, componentId);
+    if (cached) return cached;
+
     try {
         System::UnicodeString endpoint = "/api/v1/energy/balance/" + componentId;
         System::Json::TJSONObject* response = MakeGetRequest(endpoint);
@@ -1284,6 +2632,7 @@ std::unique_ptr<TEnergyBalance> TWeb4BridgeClient::GetEnergyBalance(const System
         if (ValidateResponse(response)) {
             std::unique_ptr<TEnergyBalance> balance(new TEnergyBalance());
             balance->FromJSON(response);
+            ToCache(TWeb4Cache::ckEnergyBalance, componentId, response);
             delete response;
             return balance;
         }
@@ -1552,14 +2901,106 @@ std::vector<TWeb4BridgeClient::TBatteryPairingResult> TWeb4BridgeClient::Establi
     const std::vector<System::UnicodeString>& componentIds,
     const System::UnicodeString& operationalContext) {
 
-    std::vector<TBatteryPairingResult> results;
-
-    // Pair each component with every other component
+    // Pair each component with every other component; each step of
+    // EstablishBatteryPairing goes out for all pairs in one batch
+    std::vector<std::pair<size_t, size_t>> pairs;
     for (size_t i = 0; i < componentIds.size(); i++) {
         for (size_t j = i + 1; j < componentIds.size(); j++) {
-            TBatteryPairingResult result = EstablishBatteryPairing(
-                componentIds[i], componentIds[j], operationalContext);
-            results.push_back(result);
+            pairs.push_back(std::make_pair(i, j));
+        }
+    }
+
+    std::vector<TBatteryPairingResult> results(pairs.size());
+    for (auto& result : results) {
+        result.Success = false;
+        result.InitialTrustScore = 0.5;
+    }
+
+    // Step 1: Check if pairing is authorized
+    std::vector<TWeb4BatchOperation> operations;
+    for (const auto& pair : pairs) {
+        operations.push_back(BatchOperation("GET", AuthorizationCheckEndpoint(
+            componentIds[pair.first], componentIds[pair.second], operationalContext)));
+    }
+    std::vector<TWeb4Response> answers = ExecuteBatch(operations);
+
+    std::vector<size_t> active;
+    for (size_t p = 0; p < pairs.size(); p++) {
+        TAuthorizationCheck check;
+        if (ValidateResponse(answers[p].Json.get())) {
+            check.FromJSON(answers[p].Json.get());
+        }
+        if (check.Authorized) {
+            active.push_back(p);
+        } else {
+            results[p].ErrorMessage = "Pairing not authorized";
+        }
+    }
+
+    // Step 2: Initiate pairing
+    operations.clear();
+    for (size_t p : active) {
+        std::unique_ptr<System::Json::TJSONObject> requestData(TWeb4Utils::CreateRequestBody());
+        TWeb4Utils::AddStringField(requestData.get(), "creator", FConfig.DefaultCreator);
+        TWeb4Utils::AddStringField(requestData.get(), "component_a", componentIds[pairs[p].first]);
+        TWeb4Utils::AddStringField(requestData.get(), "component_b", componentIds[pairs[p].second]);
+        TWeb4Utils::AddStringField(requestData.get(), "operational_context", operationalContext);
+        operations.push_back(BatchOperation("POST", "/api/v1/pairing/initiate", requestData.get()));
+    }
+    answers = ExecuteBatch(operations);
+
+    std::vector<size_t> initiated;
+    std::vector<System::UnicodeString> challengeIds;
+    for (size_t a = 0; a < active.size(); a++) {
+        if (ValidateResponse(answers[a].Json.get())) {
+            TPairingChallenge challenge;
+            challenge.FromJSON(answers[a].Json.get());
+            initiated.push_back(active[a]);
+            challengeIds.push_back(challenge.ChallengeId);
+        } else {
+            results[active[a]].ErrorMessage = "Failed to initiate pairing";
+        }
+    }
+
+    // Step 3: Complete pairing (simplified for demo)
+    operations.clear();
+    for (size_t i = 0; i < initiated.size(); i++) {
+        std::unique_ptr<System::Json::TJSONObject> requestData(TWeb4Utils::CreateRequestBody());
+        TWeb4Utils::AddStringField(requestData.get(), "creator", FConfig.DefaultCreator);
+        TWeb4Utils::AddStringField(requestData.get(), "challenge_id", challengeIds[i]);
+        TWeb4Utils::AddStringField(requestData.get(), "response", "demo_response");
+        operations.push_back(BatchOperation("POST", "/api/v1/pairing/complete", requestData.get()));
+    }
+    answers = ExecuteBatch(operations);
+
+    std::vector<size_t> completed;
+    for (size_t i = 0; i < initiated.size(); i++) {
+        TBatteryPairingResult& result = results[initiated[i]];
+        if (answers[i].Succeeded() && answers[i].Json) {
+            result.Success = true;
+            result.PairingId = challengeIds[i];
+            completed.push_back(initiated[i]);
+        } else {
+            result.ErrorMessage = "Failed to complete pairing";
+        }
+    }
+
+    // Step 4: Calculate initial trust
+    operations.clear();
+    for (size_t p : completed) {
+        std::unique_ptr<System::Json::TJSONObject> requestData(TWeb4Utils::CreateRequestBody());
+        TWeb4Utils::AddStringField(requestData.get(), "component_a", componentIds[pairs[p].first]);
+        TWeb4Utils::AddStringField(requestData.get(), "component_b", componentIds[pairs[p].second]);
+        TWeb4Utils::AddStringField(requestData.get(), "operational_context", operationalContext);
+        operations.push_back(BatchOperation("POST", "/api/v1/trust-enhanced/calculate", requestData.get()));
+    }
+    answers = ExecuteBatch(operations);
+
+    for (size_t c = 0; c < completed.size(); c++) {
+        if (ValidateResponse(answers[c].Json.get())) {
+            TTrustTensor tensor;
+            tensor.FromJSON(answers[c].Json.get());
+            results[completed[c]].InitialTrustScore = tensor.TrustScore;
         }
     }
 
@@ -1571,10 +3012,81 @@ std::vector<std::unique_ptr<TWeb4BridgeClient::TBatteryStatusSummary>> TWeb4Brid
 
     std::vector<std::unique_ptr<TBatteryStatusSummary>> statuses;
 
+    // Round one: the lookups of GetBatteryStatus for every component
+    std::vector<TWeb4BatchOperation> operations;
     for (const auto& componentId : componentIds) {
-        std::unique_ptr<TBatteryStatusSummary> status = GetBatteryStatus(componentId);
-        if (status) {
-            statuses.push_back(std::move(status));
+        operations.push_back(CachedRead("/api/v1/energy/balance/" + componentId,
+                                        TWeb4Cache::ckEnergyBalance, componentId));
+        operations.push_back(BatchOperation("GET", "/api/v1/queue/status/" + componentId));
+        operations.push_back(BatchOperation("GET", "/api/v1/authorization/component/" + componentId));
+    }
+    std::vector<TWeb4Response> answers = ExecuteBatch(operations);
+
+    std::vector<TWeb4BatchOperation> tensorOperations;
+    std::vector<size_t> tensorOwners;
+    for (size_t c = 0; c < componentIds.size(); c++) {
+        const System::UnicodeString& componentId = componentIds[c];
+        std::unique_ptr<TBatteryStatusSummary> summary(new TBatteryStatusSummary());
+        summary->ComponentId = componentId;
+        summary->EnergyLevel = 0.0;
+        summary->TrustScore = 0.5;
+        summary->ActiveConnections = 0;
+        summary->PendingRequests = 0;
+        summary->HealthStatus = "unknown";
+
+        System::Json::TJSONObject* balanceJson = answers[c * 3].Json.get();
+        if (ValidateResponse(balanceJson)) {
+            TEnergyBalance balance;
+            balance.FromJSON(balanceJson);
+            summary->EnergyLevel = balance.TotalEnergy;
+        }
+
+        System::Json::TJSONObject* queueJson = answers[c * 3 + 1].Json.get();
+        if (ValidateResponse(queueJson)) {
+            TQueueStatus queueStatus;
+            queueStatus.FromJSON(queueJson);
+            summary->PendingRequests = queueStatus.PendingRequests;
+            summary->HealthStatus = queueStatus.Status;
+        }
+
+        System::Json::TJSONObject* authJson = answers[c * 3 + 2].Json.get();
+        System::Json::TJSONArray* authArray = ValidateResponse(authJson) ?
+            dynamic_cast<System::Json::TJSONArray*>(authJson->GetValue("authorizations")) : nullptr;
+        if (authArray) {
+            for (int i = 0; i < authArray->Count; i++) {
+                System::Json::TJSONObject* authData = dynamic_cast<System::Json::TJSONObject*>(authArray->Items[i]);
+                if (!authData) continue;
+
+                TPairingAuthorization auth;
+                auth.FromJSON(authData);
+                summary->ActiveConnections++;
+                const System::UnicodeString& self = auth.ComponentA == componentId ? auth.ComponentA : auth.ComponentB;
+                const System::UnicodeString& other = auth.ComponentA == componentId ? auth.ComponentB : auth.ComponentA;
+                tensorOperations.push_back(CachedRead(RelationshipTensorEndpoint(self, other),
+                                                      TWeb4Cache::ckRelationship, self + "|" + other));
+                tensorOwners.push_back(c);
+            }
+        }
+
+        statuses.push_back(std::move(summary));
+    }
+
+    // Round two: the trust of every relationship found, averaged per component
+    std::vector<TWeb4Response> tensors = ExecuteBatch(tensorOperations);
+    std::vector<double> totalTrust(componentIds.size(), 0.0);
+    std::vector<int> trustCount(componentIds.size(), 0);
+
+    for (size_t t = 0; t < tensors.size(); t++) {
+        if (ValidateResponse(tensors[t].Json.get())) {
+            TTrustTensor tensor;
+            tensor.FromJSON(tensors[t].Json.get());
+            totalTrust[tensorOwners[t]] += tensor.TrustScore;
+            trustCount[tensorOwners[t]]++;
+        }
+    }
+    for (size_t c = 0; c < statuses.size(); c++) {
+        if (trustCount[c] > 0) {
+            statuses[c]->TrustScore = totalTrust[c] / trustCount[c];
         }
     }
 
@@ -1627,10 +3139,18 @@ bool TWeb4BridgeClient::ValidateResponse(System::Json::TJSONObject* response) {
 }
 
 void TWeb4BridgeClient::UpdateConfig(const TWeb4BridgeConfig& newConfig) {
+    bool wasConnected = FConnected;
+
+    // The pool was built for the old endpoint, which may have had no batch support
+    Disconnect();
     FConfig = newConfig;
-    if (FConnected) {
-        Disconnect();
+    FBatchUnsupported = false;
+    ApplyCacheConfig();
+    FJournal.Open(FConfig.JournalFile);
+    if (wasConnected) {
         Connect();
+    } else if (FJournal.Count() > 0) {
+        StartReplay();
     }
 }
 
@@ -1646,7 +3166,35 @@ System::Json::TJSONObject* TWeb4BridgeClient::GetSystemMetrics() {
     TWeb4Utils::AddBoolField(metrics, "connected", FConnected);
     TWeb4Utils::AddStringField(metrics, "endpoint", BuildUrl(""));
     TWeb4Utils::AddNumberField(metrics, "timeout_seconds", FConfig.RequestTimeoutSeconds);
+    TWeb4Utils::AddNumberField(metrics, "read_timeout_seconds", FConfig.ReadTimeoutSeconds);
+    TWeb4Utils::AddNumberField(metrics, "max_retry_attempts", FConfig.MaxRetryAttempts);
+    TWeb4Utils::AddNumberField(metrics, "retries", FRetries);
+    TWeb4Utils::AddNumberField(metrics, "hedge_delay_ms", FConfig.HedgeDelayMs);
+    TWeb4Utils::AddNumberField(metrics, "hedged_requests", FHedged);
+    TWeb4Utils::AddNumberField(metrics, "hedge_wins", FHedgeWins);
+    TWeb4Utils::AddNumberField(metrics, "max_concurrent_requests", FConfig.MaxConcurrentRequests);
+    std::shared_ptr<TWeb4ConnectionPool> pool;
+    {
+        std::lock_guard<std::mutex> lock(FPoolLock);
+        pool = FPool;
+    }
+    TWeb4Utils::AddNumberField(metrics, "requests_in_flight", pool ? pool->Busy() : 0);
+    TWeb4Utils::AddNumberField(metrics, "requests_queued", pool ? pool->Queued() : 0);
+    TWeb4Utils::AddNumberField(metrics, "max_batch_size", FConfig.MaxBatchSize);
+    TWeb4Utils::AddBoolField(metrics, "batch_supported", !FBatchUnsupported);
+    TWeb4Utils::AddBoolField(metrics, "cache_enabled", FConfig.EnableCache);
+    TWeb4Utils::AddNumberField(metrics, "cache_entries", FCache.Count());
+    TWeb4Utils::AddNumberField(metrics, "cache_hits", FCache.Hits());
+    TWeb4Utils::AddNumberField(metrics, "cache_misses", FCache.Misses());
+    TWeb4Utils::AddNumberField(metrics, "writes_pending", FJournal.Count());
     TWeb4Utils::AddStringField(metrics, "default_creator", FConfig.DefaultCreator);
+
+    // Response parsing cost, e.g. before and after a run of large list queries
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    TWeb4Utils::AddNumberField(metrics, "json_bytes_parsed", static_cast<double>(FParsedBytes));
+    TWeb4Utils::AddNumberField(metrics, "json_parse_ms", FParseTicks * 1000.0 / frequency.QuadPart);
+    metrics->AddPair("latency", FLatency.ToJSON());
     TWeb4Utils::AddStringField(metrics, "timestamp", TWeb4Utils::GenerateTimestamp());
 
     return metrics;
@@ -1707,52 +3255,43 @@ TWeb4BridgeClient::TDemoWorkflowResult TWeb4BridgeClient::ExecuteCompleteBattery
         // Step 1: Register all components
         TWeb4Utils::AddStringField(result.DetailedResults, "step", "registering_components");
 
-        // Register battery packs
+        // Start every registration before waiting on any, the pool overlaps them
+        std::vector<System::UnicodeString> registerIds;
+        std::vector<System::UnicodeString> registerContexts;
         for (const auto& packId : batteryPackIds) {
-            std::unique_ptr<TComponentRegistration> registration = RegisterComponent(
-                FConfig.DefaultCreator, packId, "battery_pack_demo");
+            registerIds.push_back(packId);
+            registerContexts.push_back("battery_pack_demo");
+        }
+        for (const auto& moduleId : batteryModuleIds) {
+            registerIds.push_back(moduleId);
+            registerContexts.push_back("battery_module_demo");
+        }
+        if (!hostSystemId.IsEmpty()) {
+            registerIds.push_back(hostSystemId);
+            registerContexts.push_back("host_system_demo");
+        }
 
-            if (registration) {
-                result.CreatedComponentIds.push_back(registration->ComponentId);
-                System::Json::TJSONObject* regResult = registration->ToJSON();
-                registrationResults->AddElement(regResult);
-            } else {
-                System::Json::TJSONObject* errorResult = TWeb4Utils::CreateRequestBody();
-                TWeb4Utils::AddStringField(errorResult, "component_id", packId);
-                TWeb4Utils::AddStringField(errorResult, "error", "registration_failed");
-                registrationResults->AddElement(errorResult);
-            }
+        std::vector<std::future<std::unique_ptr<TComponentRegistration>>> pendingRegistrations;
+        for (size_t i = 0; i < registerIds.size(); i++) {
+            pendingRegistrations.push_back(RegisterComponentAsync(
+                FConfig.DefaultCreator, registerIds[i], registerContexts[i]));
         }
 
-        // Register battery modules
-        for (const auto& moduleId : batteryModuleIds) {
-            std::unique_ptr<TComponentRegistration> registration = RegisterComponent(
-                FConfig.DefaultCreator, moduleId, "battery_module_demo");
+        for (size_t i = 0; i < pendingRegistrations.size(); i++) {
+            std::unique_ptr<TComponentRegistration> registration = pendingRegistrations[i].get();
 
             if (registration) {
                 result.CreatedComponentIds.push_back(registration->ComponentId);
                 System::Json::TJSONObject* regResult = registration->ToJSON();
                 registrationResults->AddElement(regResult);
-            } else {
+            } else if (registerContexts[i] != "host_system_demo") {
                 System::Json::TJSONObject* errorResult = TWeb4Utils::CreateRequestBody();
-                TWeb4Utils::AddStringField(errorResult, "component_id", moduleId);
+                TWeb4Utils::AddStringField(errorResult, "component_id", registerIds[i]);
                 TWeb4Utils::AddStringField(errorResult, "error", "registration_failed");
                 registrationResults->AddElement(errorResult);
             }
         }
 
-        // Register host system
-        if (!hostSystemId.IsEmpty()) {
-            std::unique_ptr<TComponentRegistration> registration = RegisterComponent(
-                FConfig.DefaultCreator, hostSystemId, "host_system_demo");
-
-            if (registration) {
-                result.CreatedComponentIds.push_back(registration->ComponentId);
-                System::Json::TJSONObject* regResult = registration->ToJSON();
-                registrationResults->AddElement(regResult);
-            }
-        }
-
         // Step 2: Create LCT relationships and establish pairings
         TWeb4Utils::AddStringField(result.DetailedResults, "step", "establishing_pairings");
 